@@ -227,6 +227,18 @@ void ComputePipelineBase::setResourceDirect(uint64_t byteOffset, uint32_t typeSi
     handle->impl->setResourceDirect(byteOffset, typeSize, image, bindType);
 }
 
+void ComputePipelineBase::setDebugName(const std::string &name)
+{
+    auto const handle = gComputePipelineStorage.acquire_read(computePipelineID.load(std::memory_order_acquire));
+    handle->impl->setDebugName(name);
+}
+
+void ComputePipelineBase::setPreciseBarriers(bool enabled)
+{
+    auto const handle = gComputePipelineStorage.acquire_read(computePipelineID.load(std::memory_order_acquire));
+    handle->impl->setPreciseBarriers(enabled);
+}
+
 ComputePipelineBase &ComputePipelineBase::operator()(uint16_t x, uint16_t y, uint16_t z)
 {
     // Auto-bind: read current resource from each EDSL proxy's back-pointer
@@ -1,8 +1,14 @@
-﻿#include "CabbageHardware.h"
+﻿#include <algorithm>
+#include <deque>
+
+#include "CabbageHardware.h"
 #include "HardwareCommands.h"
 #include "HardwareWrapperVulkan/HardwareContext.h"
+#include "HardwareWrapperVulkan/HardwareVulkan/CompletionWaiterVulkan.h"
 #include "HardwareWrapperVulkan/HardwareVulkan/HardwareExecutorVulkan.h"
+#include "HardwareWrapperVulkan/HardwareVulkan/HardwareMetricsVulkan.h"
 #include "HardwareWrapperVulkan/HardwareVulkan/ResourceCommand.h"
+#include "HardwareWrapperVulkan/HardwareVulkan/StagingRingVulkan.h"
 #include "HardwareWrapperVulkan/ResourcePool.h"
 #include "corona/kernel/utils/storage.h"
 
@@ -31,6 +37,20 @@ VkBufferUsageFlags convertBufferUsage(BufferUsage const usage)
     return vkUsage;
 }
 
+static ResourceManager::BufferPlacement convertBufferMemory(BufferMemory const memory)
+{
+    switch (memory)
+    {
+    case BufferMemory::DeviceLocal:
+        return ResourceManager::BufferPlacement::DeviceLocal;
+    case BufferMemory::Auto:
+        return ResourceManager::BufferPlacement::Auto;
+    case BufferMemory::HostVisible:
+    default:
+        return ResourceManager::BufferPlacement::HostVisible;
+    }
+}
+
 static void incrementBufferRefCount(uint64_t id, const Corona::Kernel::Utils::Storage<ResourceManager::BufferHardwareWrap>::WriteHandle &handle)
 {
     ++handle->refCount;
@@ -41,6 +61,7 @@ static bool decrementBufferRefCount(uint64_t id, const Corona::Kernel::Utils::St
     uint64_t const newCount = --handle->refCount;
     if (newCount == 0)
     {
+        HardwareMetricsVulkan::get().untrackBuffer(*handle);
         globalHardwareContext.getMainDevice()->resourceManager.destroyBuffer(*handle);
         return true;
     }
@@ -52,17 +73,28 @@ HardwareBuffer::HardwareBuffer()
 {
 }
 
-HardwareBuffer::HardwareBuffer(const uint32_t bufferSize, const uint32_t elementSize, const BufferUsage usage, const void *data, bool useDedicated)
+HardwareBuffer::HardwareBuffer(const uint32_t bufferSize, const uint32_t elementSize, const BufferUsage usage, const void *data, bool useDedicated, bool exportable, BufferMemory memory)
 {
     auto const buffer_id = globalBufferStorages.allocate();
     bufferID.store(buffer_id, std::memory_order_release);
-    auto const handle = globalBufferStorages.acquire_write(buffer_id);
-    *handle = globalHardwareContext.getMainDevice()->resourceManager.createBuffer(bufferSize, elementSize, convertBufferUsage(usage), true, useDedicated);
-
-    if (data != nullptr && handle->bufferAllocInfo.pMappedData != nullptr)
     {
-        std::memcpy(handle->bufferAllocInfo.pMappedData, data, static_cast<size_t>(bufferSize) * elementSize);
+        auto const handle = globalBufferStorages.acquire_write(buffer_id);
+        *handle = globalHardwareContext.getMainDevice()->resourceManager.createBuffer(bufferSize, elementSize, convertBufferUsage(usage), convertBufferMemory(memory), useDedicated, exportable);
+        HardwareMetricsVulkan::get().trackBuffer(*handle);
+
+        if (data == nullptr || handle->bufferHandle == VK_NULL_HANDLE)
+        {
+            return;
+        }
+        if (handle->bufferAllocInfo.pMappedData != nullptr)
+        {
+            std::memcpy(handle->bufferAllocInfo.pMappedData, data, static_cast<size_t>(bufferSize) * elementSize);
+            return;
+        }
     }
+
+    // 显存缓冲的初始数据经暂存缓冲上传；copyFromData 需要自行获取句柄，须先释放上面的写句柄
+    copyFromData(data, static_cast<uint64_t>(bufferSize) * elementSize);
 }
 
 HardwareBuffer::HardwareBuffer(const ExternalHandle &memHandle, const uint32_t bufferSize, const uint32_t elementSize, const uint32_t allocSize, const BufferUsage usage)
@@ -79,6 +111,7 @@ HardwareBuffer::HardwareBuffer(const ExternalHandle &memHandle, const uint32_t b
     bufferID.store(buffer_id, std::memory_order_release);
     auto const bufferHandle = globalBufferStorages.acquire_write(buffer_id);
     *bufferHandle = globalHardwareContext.getMainDevice()->resourceManager.importBufferMemory(memory_handle, bufferSize, elementSize, allocSize, vkUsage);
+    HardwareMetricsVulkan::get().trackBuffer(*bufferHandle);
 }
 
 HardwareBuffer::HardwareBuffer(const HardwareBuffer &other)
@@ -267,7 +300,48 @@ bool HardwareBuffer::copyFromData(const void *inputData, const uint64_t size) co
         std::memcpy(handle->bufferAllocInfo.pMappedData, inputData, size);
         return true;
     }
-    return false;
+
+    // 不可映射的缓冲经暂存环分块上传，等待传输完成后返回。
+    // 环放不下下一块时先提交已写入的块，等它们完成、归还环空间后继续，不为上传另建暂存缓冲
+    auto dstHandle = globalBufferStorages.acquire_write(self_buffer_id);
+    const uint64_t copySize = std::min<uint64_t>(size, static_cast<uint64_t>(dstHandle->elementCount) * dstHandle->elementSize);
+    if (copySize == 0)
+    {
+        return false;
+    }
+
+    StagingRingVulkan &stagingRing = globalHardwareContext.getMainDevice()->resourceManager.getStagingRing();
+    const auto *source = static_cast<const uint8_t *>(inputData);
+    uint64_t uploaded = 0;
+    while (uploaded < copySize)
+    {
+        // 执行器析构时等待本轮的拷贝完成，分配随之归还给暂存环
+        HardwareExecutorVulkan tempExecutor;
+        std::deque<CopyBufferCommand> copyCommands;
+        while (uploaded < copySize)
+        {
+            const uint64_t chunkSize = std::min(copySize - uploaded, StagingRingVulkan::MAX_ALLOCATION_SIZE);
+            auto staging = stagingRing.allocate(chunkSize, 4);
+            if (!staging)
+            {
+                break;
+            }
+            staging->write(source + uploaded, chunkSize);
+
+            copyCommands.emplace_back(*staging->buffer, *dstHandle, staging->offset, uploaded, chunkSize);
+            tempExecutor << &copyCommands.back();
+            tempExecutor.pendingResources.push_back(std::move(staging));
+            uploaded += chunkSize;
+        }
+
+        if (copyCommands.empty())
+        {
+            CFW_LOG_ERROR("Failed to allocate staging memory to upload {} bytes to HardwareBuffer.", copySize - uploaded);
+            return false;
+        }
+        tempExecutor << tempExecutor.commit();
+    }
+    return true;
 }
 
 bool HardwareBuffer::copyToData(void *outputData, const uint64_t size) const
@@ -283,12 +357,51 @@ bool HardwareBuffer::copyToData(void *outputData, const uint64_t size) const
         return false;
     }
     if (const auto handle = globalBufferStorages.acquire_write(self_buffer_id);
-        handle->bufferAllocInfo.pMappedData != nullptr)
+        handle->bufferAllocInfo.pMappedData != nullptr && !handle->readbackViaTransfer)
     {
         globalHardwareContext.getMainDevice()->resourceManager.copyBufferToHost(*handle, outputData, size);
         return true;
     }
-    return false;
+
+    // 不可映射（或映射在写合并内存上）的缓冲先拷贝到 HOST_ACCESS_RANDOM 的回读缓冲，等待传输完成后再由 CPU 读出
+    HardwareExecutorVulkan tempExecutor;
+    ResourceManager &resourceManager = tempExecutor.hardwareContext->resourceManager;
+
+    auto srcHandle = globalBufferStorages.acquire_write(self_buffer_id);
+    const uint64_t copySize = std::min<uint64_t>(size, static_cast<uint64_t>(srcHandle->elementCount) * srcHandle->elementSize);
+    if (copySize == 0)
+    {
+        return false;
+    }
+
+    ResourceManager::BufferHardwareWrap readbackBuffer = resourceManager.createStagingBuffer(copySize, true);
+    if (readbackBuffer.bufferHandle == VK_NULL_HANDLE)
+    {
+        CFW_LOG_ERROR("Failed to create readback buffer of {} bytes.", copySize);
+        return false;
+    }
+    HardwareMetricsVulkan::get().recordStaging(copySize);
+
+    CopyBufferCommand copyCmd(*srcHandle, readbackBuffer, 0, 0, copySize);
+    tempExecutor << &copyCmd << tempExecutor.commit();
+
+    bool completed = false;
+    if (const std::shared_ptr<CompletionTokenVulkan> token = tempExecutor.createCompletionToken())
+    {
+        completed = token->wait(UINT64_MAX);
+    }
+    if (completed)
+    {
+        resourceManager.copyBufferToHost(readbackBuffer, outputData, copySize);
+    }
+    else
+    {
+        CFW_LOG_ERROR("Readback of HardwareBuffer did not complete.");
+    }
+
+    // 传输已完成，回读缓冲经墓地回收
+    resourceManager.destroyBuffer(readbackBuffer);
+    return completed;
 }
 
 void *HardwareBuffer::getMappedData() const
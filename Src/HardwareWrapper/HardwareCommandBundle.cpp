@@ -0,0 +1,270 @@
+﻿#include "CabbageHardware.h"
+#include "HardwareWrapperVulkan/HardwareVulkan/CommandBundleVulkan.h"
+#include "HardwareWrapperVulkan/ResourcePool.h"
+#include "corona/kernel/utils/storage.h"
+
+static void incCommandBundle(uint32_t id, const Corona::Kernel::Utils::Storage<CommandBundleWrap>::WriteHandle &handle)
+{
+    ++handle->refCount;
+    // CFW_LOG_TRACE("HardwareCommandBundle ref++: id={}, count={}", id, handle->refCount);
+}
+
+static bool decCommandBundle(uint32_t id, const Corona::Kernel::Utils::Storage<CommandBundleWrap>::WriteHandle &handle)
+{
+    int count = --handle->refCount;
+    // CFW_LOG_TRACE("HardwareCommandBundle ref--: id={}, count={}", id, count);
+    if (count == 0)
+    {
+        delete handle->impl;
+        handle->impl = nullptr;
+        // CFW_LOG_TRACE("HardwareCommandBundle destroyed: id={}", id);
+        return true;
+    }
+    return false;
+}
+
+HardwareCommandBundle::HardwareCommandBundle() : commandBundleID(gCommandBundleStorage.allocate())
+{
+    auto const self_id = commandBundleID.load(std::memory_order_acquire);
+    auto handle = gCommandBundleStorage.acquire_write(self_id);
+    handle->impl = new CommandBundleVulkan();
+    // CFW_LOG_TRACE("HardwareCommandBundle created: id={}", self_id);
+}
+
+HardwareCommandBundle::HardwareCommandBundle(const HardwareCommandBundle &other)
+{
+    std::lock_guard<std::mutex> lock(other.commandBundleMutex);
+    commandBundleID.store(other.commandBundleID.load(std::memory_order_acquire), std::memory_order_release);
+    auto const self_id = commandBundleID.load(std::memory_order_acquire);
+    if (self_id > 0)
+    {
+        auto const handle = gCommandBundleStorage.acquire_write(self_id);
+        incCommandBundle(self_id, handle);
+    }
+}
+
+HardwareCommandBundle::HardwareCommandBundle(HardwareCommandBundle &&other) noexcept
+{
+    std::lock_guard<std::mutex> lock(other.commandBundleMutex);
+    commandBundleID.store(other.commandBundleID.load(std::memory_order_acquire), std::memory_order_release);
+    other.commandBundleID.store(0, std::memory_order_release);
+}
+
+HardwareCommandBundle::~HardwareCommandBundle()
+{
+    auto const self_id = commandBundleID.load(std::memory_order_acquire);
+    if (self_id > 0)
+    {
+        bool should_destroy_self = false;
+        if (auto const handle = gCommandBundleStorage.acquire_write(self_id);
+            decCommandBundle(self_id, handle))
+        {
+            should_destroy_self = true;
+        }
+        if (should_destroy_self)
+        {
+            gCommandBundleStorage.deallocate(self_id);
+        }
+        commandBundleID.store(0, std::memory_order_release);
+    }
+}
+
+HardwareCommandBundle &HardwareCommandBundle::operator=(const HardwareCommandBundle &other)
+{
+    if (this == &other)
+    {
+        return *this;
+    }
+    std::scoped_lock lock(commandBundleMutex, other.commandBundleMutex);
+    auto const self_id = commandBundleID.load(std::memory_order_acquire);
+    auto const other_id = other.commandBundleID.load(std::memory_order_acquire);
+
+    if (self_id == 0 && other_id == 0)
+    {
+        return *this;
+    }
+    if (self_id == other_id)
+    {
+        return *this;
+    }
+
+    bool should_destroy_self = false;
+    if (other_id == 0)
+    {
+        if (auto const self_handle = gCommandBundleStorage.acquire_write(self_id);
+            decCommandBundle(self_id, self_handle))
+        {
+            should_destroy_self = true;
+        }
+        if (should_destroy_self)
+        {
+            gCommandBundleStorage.deallocate(self_id);
+        }
+        commandBundleID.store(0, std::memory_order_release);
+        return *this;
+    }
+
+    if (self_id == 0)
+    {
+        commandBundleID.store(other_id, std::memory_order_release);
+        auto const other_handle = gCommandBundleStorage.acquire_write(other_id);
+        incCommandBundle(other_id, other_handle);
+        return *this;
+    }
+
+    if (self_id < other_id)
+    {
+        auto const self_handle = gCommandBundleStorage.acquire_write(self_id);
+        auto const other_handle = gCommandBundleStorage.acquire_write(other_id);
+        incCommandBundle(other_id, other_handle);
+        if (decCommandBundle(self_id, self_handle))
+        {
+            should_destroy_self = true;
+        }
+    }
+    else
+    {
+        auto const other_handle = gCommandBundleStorage.acquire_write(other_id);
+        auto const self_handle = gCommandBundleStorage.acquire_write(self_id);
+        incCommandBundle(other_id, other_handle);
+        if (decCommandBundle(self_id, self_handle))
+        {
+            should_destroy_self = true;
+        }
+    }
+
+    if (should_destroy_self)
+    {
+        gCommandBundleStorage.deallocate(self_id);
+    }
+    commandBundleID.store(other_id, std::memory_order_release);
+    return *this;
+}
+
+HardwareCommandBundle &HardwareCommandBundle::operator=(HardwareCommandBundle &&other) noexcept
+{
+    if (this == &other)
+    {
+        return *this;
+    }
+    std::scoped_lock lock(commandBundleMutex, other.commandBundleMutex);
+    auto const self_id = commandBundleID.load(std::memory_order_acquire);
+    auto const other_id = other.commandBundleID.load(std::memory_order_acquire);
+
+    if (self_id > 0)
+    {
+        bool should_destroy_self = false;
+        if (auto const self_handle = gCommandBundleStorage.acquire_write(self_id);
+            decCommandBundle(self_id, self_handle))
+        {
+            should_destroy_self = true;
+        }
+        if (should_destroy_self)
+        {
+            gCommandBundleStorage.deallocate(self_id);
+        }
+    }
+    commandBundleID.store(other_id, std::memory_order_release);
+    other.commandBundleID.store(0, std::memory_order_release);
+    return *this;
+}
+
+HardwareCommandBundle &HardwareCommandBundle::operator<<(ComputePipelineBase &computePipeline)
+{
+    auto const self_id = commandBundleID.load(std::memory_order_acquire);
+    if (self_id == 0 || computePipeline.getComputePipelineID() == 0)
+    {
+        return *this;
+    }
+
+    CommandRecordVulkan *record = nullptr;
+    if (auto const pipeline_handle = gComputePipelineStorage.acquire_read(computePipeline.getComputePipelineID());
+        pipeline_handle.valid())
+    {
+        record = pipeline_handle->impl;
+    }
+
+    if (auto const handle = gCommandBundleStorage.acquire_write(self_id); handle->impl && record)
+    {
+        handle->impl->addCommand(record, nullptr);
+        handle->impl->retainedComputePipelines.push_back(computePipeline);
+    }
+    return *this;
+}
+
+HardwareCommandBundle &HardwareCommandBundle::operator<<(RasterizerPipelineBase &rasterizerPipeline)
+{
+    auto const self_id = commandBundleID.load(std::memory_order_acquire);
+    if (self_id == 0 || rasterizerPipeline.getRasterizerPipelineID() == 0)
+    {
+        return *this;
+    }
+
+    CommandRecordVulkan *record = nullptr;
+    if (auto const raster_handle = gRasterizerPipelineStorage.acquire_read(rasterizerPipeline.getRasterizerPipelineID());
+        raster_handle.valid())
+    {
+        record = raster_handle->impl;
+    }
+
+    if (auto const handle = gCommandBundleStorage.acquire_write(self_id); handle->impl && record)
+    {
+        handle->impl->addCommand(record, nullptr);
+        handle->impl->retainedRasterizerPipelines.push_back(rasterizerPipeline);
+    }
+    return *this;
+}
+
+HardwareCommandBundle &HardwareCommandBundle::operator<<(const CopyCommand &cmd)
+{
+    auto const self_id = commandBundleID.load(std::memory_order_acquire);
+    if (self_id == 0 || !cmd.impl)
+    {
+        return *this;
+    }
+
+    if (auto const handle = gCommandBundleStorage.acquire_write(self_id); handle->impl)
+    {
+        handle->impl->addCommand(cmd.impl->getCommandRecord(), cmd.impl);
+    }
+    return *this;
+}
+
+bool HardwareCommandBundle::record()
+{
+    auto const self_id = commandBundleID.load(std::memory_order_acquire);
+    if (self_id == 0)
+    {
+        return false;
+    }
+
+    auto const handle = gCommandBundleStorage.acquire_write(self_id);
+    return handle->impl && handle->impl->record();
+}
+
+bool HardwareCommandBundle::isValid() const
+{
+    auto const self_id = commandBundleID.load(std::memory_order_acquire);
+    if (self_id == 0)
+    {
+        return false;
+    }
+
+    // 校验会读取图像句柄上的布局，与执行器提交使用同一把写锁
+    auto const handle = gCommandBundleStorage.acquire_write(self_id);
+    return handle->impl && handle->impl->isValid();
+}
+
+void HardwareCommandBundle::reset()
+{
+    auto const self_id = commandBundleID.load(std::memory_order_acquire);
+    if (self_id == 0)
+    {
+        return;
+    }
+
+    if (auto const handle = gCommandBundleStorage.acquire_write(self_id); handle->impl)
+    {
+        handle->impl->reset();
+    }
+}
@@ -1,5 +1,6 @@
 ﻿#include "CabbageHardware.h"
 #include "HardwareCommands.h"
+#include "HardwareWrapperVulkan/HardwareVulkan/CompletionWaiterVulkan.h"
 #include "HardwareWrapperVulkan/HardwareVulkan/HardwareExecutorVulkan.h"
 #include "HardwareWrapperVulkan/PipelineVulkan/ComputePipeline.h"
 #include "HardwareWrapperVulkan/PipelineVulkan/RasterizerPipeline.h"
@@ -239,6 +240,44 @@ HardwareExecutor &HardwareExecutor::operator<<(const CopyCommand &cmd)
     return *this;
 }
 
+HardwareExecutor &HardwareExecutor::operator<<(HardwareRenderGraph &renderGraph)
+{
+    auto const self_id = executorID.load(std::memory_order_acquire);
+    auto const graph_id = renderGraph.getRenderGraphID();
+    if (self_id == 0 || graph_id == 0)
+    {
+        return *this;
+    }
+
+    auto executor_handle = gExecutorStorage.acquire_write(self_id);
+    if (auto const graph_handle = gRenderGraphStorage.acquire_write(graph_id);
+        executor_handle->impl && graph_handle->impl)
+    {
+        // 未编译时在这里编译：剔除、排序并分配瞬态图像内存，随后按顺序送入 pass
+        graph_handle->impl->execute(*executor_handle->impl);
+    }
+    return *this;
+}
+
+HardwareExecutor &HardwareExecutor::operator<<(HardwareCommandBundle &commandBundle)
+{
+    auto const self_id = executorID.load(std::memory_order_acquire);
+    auto const bundle_id = commandBundle.getCommandBundleID();
+    if (self_id == 0 || bundle_id == 0)
+    {
+        return *this;
+    }
+
+    auto executor_handle = gExecutorStorage.acquire_write(self_id);
+    if (auto const bundle_handle = gCommandBundleStorage.acquire_read(bundle_id);
+        executor_handle->impl && bundle_handle->impl && bundle_handle->impl->isRecorded())
+    {
+        // 有效性在 commit 时校验，届时绑定或布局已变化的命令包被跳过
+        *executor_handle->impl << static_cast<CommandRecordVulkan *>(bundle_handle->impl);
+    }
+    return *this;
+}
+
 HardwareExecutor &HardwareExecutor::wait(HardwareExecutor &other)
 {
     auto const self_id = executorID.load(std::memory_order_acquire);
@@ -280,6 +319,167 @@ HardwareExecutor &HardwareExecutor::commit()
     return *this;
 }
 
+HardwareExecutor &HardwareExecutor::commit(HardwareCompletionToken &completionToken)
+{
+    completionToken.impl.reset();
+
+    auto const self_id = executorID.load(std::memory_order_acquire);
+    if (self_id == 0)
+    {
+        return *this;
+    }
+
+    auto handle = gExecutorStorage.acquire_write(self_id);
+    if (handle->impl)
+    {
+        handle->impl->commit();
+        completionToken.impl = handle->impl->createCompletionToken();
+    }
+    return *this;
+}
+
+HardwareCompletionToken HardwareExecutor::getCompletionToken()
+{
+    HardwareCompletionToken completionToken;
+
+    auto const self_id = executorID.load(std::memory_order_acquire);
+    if (self_id == 0)
+    {
+        return completionToken;
+    }
+
+    auto handle = gExecutorStorage.acquire_write(self_id);
+    if (handle->impl)
+    {
+        completionToken.impl = handle->impl->createCompletionToken();
+    }
+    return completionToken;
+}
+
+HardwareExecutor &HardwareExecutor::setAsyncSubmit(bool enable)
+{
+    auto const self_id = executorID.load(std::memory_order_acquire);
+    if (self_id == 0)
+    {
+        return *this;
+    }
+
+    auto handle = gExecutorStorage.acquire_write(self_id);
+    if (handle->impl)
+    {
+        handle->impl->setAsyncSubmit(enable);
+    }
+    return *this;
+}
+
+HardwareExecutor &HardwareExecutor::setPriority(ExecutorPriority priority)
+{
+    auto const self_id = executorID.load(std::memory_order_acquire);
+    if (self_id == 0)
+    {
+        return *this;
+    }
+
+    DeviceManager::QueuePriority queuePriority = DeviceManager::QueuePriority::Normal;
+    switch (priority)
+    {
+    case ExecutorPriority::Realtime:
+        queuePriority = DeviceManager::QueuePriority::Realtime;
+        break;
+    case ExecutorPriority::Background:
+        queuePriority = DeviceManager::QueuePriority::Background;
+        break;
+    default:
+        break;
+    }
+
+    auto handle = gExecutorStorage.acquire_write(self_id);
+    if (handle->impl)
+    {
+        handle->impl->setPriority(queuePriority);
+    }
+    return *this;
+}
+
+HardwareExecutor &HardwareExecutor::setPipelineStatistics(bool enable)
+{
+    auto const self_id = executorID.load(std::memory_order_acquire);
+    if (self_id == 0)
+    {
+        return *this;
+    }
+
+    auto handle = gExecutorStorage.acquire_write(self_id);
+    if (handle->impl)
+    {
+        handle->impl->setPipelineStatistics(enable);
+    }
+    return *this;
+}
+
+HardwareExecutor &HardwareExecutor::setOcclusionQueries(bool enable)
+{
+    auto const self_id = executorID.load(std::memory_order_acquire);
+    if (self_id == 0)
+    {
+        return *this;
+    }
+
+    auto handle = gExecutorStorage.acquire_write(self_id);
+    if (handle->impl)
+    {
+        handle->impl->setOcclusionQueries(enable);
+    }
+    return *this;
+}
+
+void HardwareExecutor::takeQueryResults(std::vector<HardwarePipelineStatistics> &statistics, std::vector<HardwareOcclusionResult> &occlusion)
+{
+    auto const self_id = executorID.load(std::memory_order_acquire);
+    if (self_id == 0)
+    {
+        return;
+    }
+
+    auto handle = gExecutorStorage.acquire_write(self_id);
+    if (handle->impl)
+    {
+        handle->impl->takeQueryResults(statistics, occlusion);
+    }
+}
+
+static HardwareLatencySummary toLatencySummary(const LatencyHistogramVulkan::Summary &summary)
+{
+    return {summary.count, summary.totalNs, summary.maxNs, summary.p50Ns, summary.p90Ns, summary.p99Ns};
+}
+
+HardwareCommitLatencyStats HardwareExecutor::getCommitLatencyStats() const
+{
+    HardwareCommitLatencyStats result;
+    auto const self_id = executorID.load(std::memory_order_acquire);
+    if (self_id == 0)
+    {
+        return result;
+    }
+
+    auto const handle = gExecutorStorage.acquire_read(self_id);
+    if (handle->impl)
+    {
+        const HardwareExecutorVulkan::CommitLatencyStats stats = handle->impl->getCommitLatencyStats();
+        result.commits = stats.commits;
+        result.submits = stats.submits;
+        result.failedSubmits = stats.failedSubmits;
+        result.droppedSegments = stats.droppedSegments;
+        result.contendedQueueLocks = stats.contendedQueueLocks;
+        result.timelineWaitTimeouts = stats.timelineWaitTimeouts;
+        result.queueLockWait = toLatencySummary(stats.queueLockWait);
+        result.timelineWait = toLatencySummary(stats.timelineWait);
+        result.recording = toLatencySummary(stats.recording);
+        result.queueSubmit = toLatencySummary(stats.queueSubmit);
+    }
+    return result;
+}
+
 // ========== 延迟释放相关接口实现 ==========
 
 void HardwareExecutor::waitForDeferredResources()
@@ -310,4 +510,38 @@ void HardwareExecutor::cleanupDeferredResources()
     {
         handle->impl->cleanupCompletedResources();
     }
-}
\ No newline at end of file
+}
+
+// ========== 完成令牌 ==========
+
+bool HardwareCompletionToken::isReady() const
+{
+    return !impl || impl->isReady();
+}
+
+bool HardwareCompletionToken::wait(uint64_t timeoutNs) const
+{
+    return !impl || impl->wait(timeoutNs);
+}
+
+bool HardwareCompletionToken::isAbandoned() const
+{
+    return impl && impl->abandoned.load(std::memory_order_acquire);
+}
+
+const HardwareCompletionToken &HardwareCompletionToken::onComplete(std::function<void()> callback) const
+{
+    if (!callback)
+    {
+        return *this;
+    }
+
+    if (!impl)
+    {
+        callback();
+        return *this;
+    }
+
+    impl->deviceManager->getCompletionWaiter().enqueue(impl, std::move(callback));
+    return *this;
+}
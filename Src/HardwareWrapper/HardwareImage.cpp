@@ -1,8 +1,13 @@
-﻿#include "CabbageHardware.h"
+﻿#include <cstring>
+#include <numeric>
+
+#include "CabbageHardware.h"
 #include "HardwareCommands.h"
 #include "HardwareWrapperVulkan/HardwareContext.h"
 #include "HardwareWrapperVulkan/HardwareVulkan/HardwareExecutorVulkan.h"
+#include "HardwareWrapperVulkan/HardwareVulkan/HardwareMetricsVulkan.h"
 #include "HardwareWrapperVulkan/HardwareVulkan/ResourceCommand.h"
+#include "HardwareWrapperVulkan/HardwareVulkan/StagingRingVulkan.h"
 #include "HardwareWrapperVulkan/ResourcePool.h"
 
 struct ImageFormatInfo
@@ -128,6 +133,7 @@ static bool decrementImageRefCount(uint32_t id, const Corona::Kernel::Utils::Sto
     // CFW_LOG_TRACE("HardwareImage ref--: id={}, count={}", id, count);
     if (count == 0)
     {
+        HardwareMetricsVulkan::get().untrackImage(*handle);
         globalHardwareContext.getMainDevice()->resourceManager.destroyImage(*handle);
         // CFW_LOG_TRACE("HardwareImage destroyed: id={}", id);
         return true;
@@ -135,6 +141,42 @@ static bool decrementImageRefCount(uint32_t id, const Corona::Kernel::Utils::Sto
     return false;
 }
 
+// vkCmdCopyBufferToImage 要求 bufferOffset 同时是 4 与纹素（压缩格式为块）字节数的倍数
+static uint64_t stagingAlignmentOf(const ResourceManager::ImageHardwareWrap &image)
+{
+    const bool isCompressed = image.pixelSize < 2.0f;
+    const uint64_t texelBytes = static_cast<uint64_t>(isCompressed ? image.pixelSize * 16.0f : image.pixelSize);
+    return std::lcm<uint64_t>(4, std::max<uint64_t>(1, texelBytes));
+}
+
+// 从暂存环上传的 Buffer 到 Image 拷贝：执行器延迟释放本对象时，环上的区间随之归还
+struct StagedBufferToImageCommandImpl : CopyCommandImpl
+{
+    std::shared_ptr<StagingRingVulkan::Allocation> staging;
+    HardwareImage dstImage;
+    uint32_t imageMip{0};
+
+    std::unique_ptr<CopyBufferToImageCommand> command;
+
+    StagedBufferToImageCommandImpl(std::shared_ptr<StagingRingVulkan::Allocation> allocation, const HardwareImage &dst, uint32_t mip)
+        : staging(std::move(allocation)), dstImage(dst), imageMip(mip)
+    {
+    }
+
+    CommandRecordVulkan *getCommandRecord() override
+    {
+        if (!staging || dstImage.getImageID() == 0)
+        {
+            return nullptr;
+        }
+
+        auto dstHandle = globalImageStorages.acquire_write(dstImage.getImageID());
+        command = std::make_unique<CopyBufferToImageCommand>(*staging->buffer, *dstHandle, imageMip, staging->offset);
+
+        return command.get();
+    }
+};
+
 HardwareImage::HardwareImage()
     : imageID(0)
 {
@@ -192,6 +234,7 @@ HardwareImage::HardwareImage(const HardwareImageCreateInfo &createInfo)
             vkUsage,
             createInfo.arrayLayers,
             createInfo.mipLevels);
+        HardwareMetricsVulkan::get().trackImage(*handle, handle->imageAllocInfo.size);
     }
 
     //CFW_LOG_TRACE("HardwareImage created: id={}", self_image_id);
@@ -258,6 +301,7 @@ HardwareImage::HardwareImage(uint32_t width, uint32_t height, ImageFormat imageF
             pixelSize,
             vkUsage,
             arrayLayers);
+        HardwareMetricsVulkan::get().trackImage(*handle, handle->imageAllocInfo.size);
     }
 
     //CFW_LOG_TRACE("HardwareImage created: id={}", self_image_id);
@@ -267,15 +311,75 @@ HardwareImage::HardwareImage(uint32_t width, uint32_t height, ImageFormat imageF
         HardwareExecutorVulkan tempExecutor;
 
         auto imageHandle = globalImageStorages.acquire_write(self_image_id);
-        HardwareBuffer stagingBuffer(imageHandle->imageSize.x * imageHandle->imageSize.y * imageHandle->pixelSize,
-                                     BufferUsage::StorageBuffer,
-                                     imageData);
+        const uint32_t stagingSize = static_cast<uint32_t>(imageHandle->imageSize.x * imageHandle->imageSize.y * imageHandle->pixelSize);
+
+        if (auto staging = imageHandle->resourceManager->getStagingRing().allocate(stagingSize, stagingAlignmentOf(*imageHandle)))
+        {
+            staging->write(imageData, stagingSize);
+
+            CopyBufferToImageCommand copyCmd(*staging->buffer, *imageHandle, 0, staging->offset);
+            tempExecutor << &copyCmd;
+            // 分配随提交进入延迟释放，拷贝完成后才归还给暂存环
+            tempExecutor.pendingResources.push_back(std::move(staging));
+            tempExecutor << tempExecutor.commit();
+        }
+        else
+        {
+            HardwareBuffer stagingBuffer(stagingSize,
+                                         BufferUsage::StorageBuffer,
+                                         imageData);
+            HardwareMetricsVulkan::get().recordStaging(stagingSize);
+
+            auto bufferHandle = globalBufferStorages.acquire_write(stagingBuffer.getBufferID());
+
+            CopyBufferToImageCommand copyCmd(*bufferHandle, *imageHandle, 0);
+            tempExecutor << &copyCmd << tempExecutor.commit();
+        }
+    }
+}
 
-        auto bufferHandle = globalBufferStorages.acquire_write(stagingBuffer.getBufferID());
+// ========== 渲染图瞬态图像 ==========
+// 只创建 VkImage 并登记到渲染图，内存在 HardwareRenderGraph::compile() 时按生命周期别名分配
+HardwareImage HardwareRenderGraph::createTransientImage(const HardwareImageCreateInfo &createInfo)
+{
+    HardwareImage transientImage;
 
-        CopyBufferToImageCommand copyCmd(*bufferHandle, *imageHandle, 0);
-        tempExecutor << &copyCmd << tempExecutor.commit();
+    auto const self_id = renderGraphID.load(std::memory_order_acquire);
+    if (self_id == 0)
+    {
+        return transientImage;
+    }
+
+    auto const graph_handle = gRenderGraphStorage.acquire_write(self_id);
+    if (!graph_handle->impl || graph_handle->impl->isCompiled())
+    {
+        CFW_LOG_ERROR("[RenderGraph] createTransientImage called after compile(), ignored");
+        return transientImage;
     }
+
+    const auto [vkFormat, pixelSize, isCompressed] = convertImageFormat(createInfo.format);
+    const VkImageUsageFlags vkUsage = convertImageUsage(createInfo.usage, isCompressed);
+
+    auto const transient_image_id = globalImageStorages.allocate();
+    transientImage.imageID.store(transient_image_id, std::memory_order_release);
+
+    VkMemoryRequirements memoryRequirements{};
+    {
+        const auto handle = globalImageStorages.acquire_write(transient_image_id);
+
+        *handle = globalHardwareContext.getMainDevice()->resourceManager.createAliasableImage(
+            ktm::uvec2(createInfo.width, createInfo.height),
+            vkFormat,
+            pixelSize,
+            vkUsage,
+            createInfo.arrayLayers,
+            createInfo.mipLevels,
+            memoryRequirements);
+        HardwareMetricsVulkan::get().trackImage(*handle, 0);
+    }
+
+    graph_handle->impl->addTransientImage(transientImage, memoryRequirements);
+    return transientImage;
 }
 
 HardwareImage::HardwareImage(const HardwareImage &other)
@@ -384,7 +488,9 @@ HardwareImage HardwareImage::operator[](const uint32_t index)
             subImageHandle->imageHandle = imageHandle->imageHandle; // 共享同一个 VkImage
             subImageHandle->imageAlloc = imageHandle->imageAlloc;
             subImageHandle->imageAllocInfo = imageHandle->imageAllocInfo;
+            subImageHandle->ownedImage = imageHandle->ownedImage; // 子图像存活期间 VkImage 不会被销毁
             subImageHandle->bindlessIndex = -1;
+            HardwareMetricsVulkan::get().trackImage(*subImageHandle, 0);
 
             // 直接获取mipmap（单层数组图像）
             if (imageHandle->arrayLayers == 1)
@@ -568,6 +674,8 @@ BufferToImageCommand HardwareImage::copyFrom(const void *inputData,
     }
 
     uint64_t bufferSize = 0;
+    uint64_t stagingAlignment = 4;
+    ResourceManager *resourceManager = nullptr;
 
     {
         auto const imageHandle = globalImageStorages.acquire_read(imageID.load(std::memory_order_acquire));
@@ -575,6 +683,8 @@ BufferToImageCommand HardwareImage::copyFrom(const void *inputData,
         {
             return BufferToImageCommand();
         }
+        stagingAlignment = stagingAlignmentOf(*imageHandle);
+        resourceManager = imageHandle->resourceManager;
         const uint32_t width = std::max(1u, imageHandle->imageSize.x >> imageMip);
         const uint32_t height = std::max(1u, imageHandle->imageSize.y >> imageMip);
 
@@ -598,7 +708,21 @@ BufferToImageCommand HardwareImage::copyFrom(const void *inputData,
         }
     }
 
+    if (resourceManager != nullptr)
+    {
+        if (auto staging = resourceManager->getStagingRing().allocate(bufferSize, stagingAlignment))
+        {
+            staging->write(inputData, bufferSize);
+
+            BufferToImageCommand cmd;
+            cmd.impl = std::make_shared<StagedBufferToImageCommandImpl>(std::move(staging), *this, imageMip);
+            return cmd;
+        }
+    }
+
+    // 暂存环已满或单次上传超过环容量一半时，退回独立的暂存缓冲
     HardwareBuffer stagingBuffer(bufferSize, BufferUsage::StorageBuffer, inputData);
+    HardwareMetricsVulkan::get().recordStaging(bufferSize);
     auto cmd = BufferToImageCommand(std::move(stagingBuffer), *this, 0, imageLayer, imageMip);
     return cmd;
 }
\ No newline at end of file
@@ -0,0 +1,36 @@
+﻿#include "CabbageHardware.h"
+#include "HardwareWrapperVulkan/HardwareVulkan/HardwareMetricsVulkan.h"
+
+static HardwareBindlessOccupancy toBindlessOccupancy(const HardwareMetricsVulkan::BindlessSlots &slots)
+{
+    return {slots.capacity, slots.occupied, slots.highWater};
+}
+
+HardwareMetricsSnapshot HardwareMetrics::snapshot()
+{
+    const HardwareMetricsVulkan::Snapshot metrics = HardwareMetricsVulkan::get().snapshot();
+
+    HardwareMetricsSnapshot result;
+    result.liveBuffers = metrics.liveBuffers;
+    result.liveBufferBytes = metrics.liveBufferBytes;
+    result.liveImages = metrics.liveImages;
+    result.liveImageBytes = metrics.liveImageBytes;
+
+    result.textureSlots = toBindlessOccupancy(metrics.bindless[static_cast<uint32_t>(HardwareMetricsVulkan::BindlessSet::Texture)]);
+    result.storageBufferSlots = toBindlessOccupancy(metrics.bindless[static_cast<uint32_t>(HardwareMetricsVulkan::BindlessSet::StorageBuffer)]);
+    result.storageImageSlots = toBindlessOccupancy(metrics.bindless[static_cast<uint32_t>(HardwareMetricsVulkan::BindlessSet::StorageImage)]);
+
+    result.liveComputePipelines = metrics.liveComputePipelines;
+    result.liveGraphicsPipelines = metrics.liveGraphicsPipelines;
+    result.compiledPipelines = metrics.compiledPipelines;
+    result.totalCompileNs = metrics.totalCompileNs;
+    result.maxCompileNs = metrics.maxCompileNs;
+
+    result.deferredReleasePending = metrics.deferredReleasePending;
+
+    result.stagingAllocations = metrics.stagingAllocations;
+    result.stagingBytes = metrics.stagingBytes;
+    result.stagingRingAllocations = metrics.stagingRingAllocations;
+    result.stagingRingBytes = metrics.stagingRingBytes;
+    return result;
+}
@@ -0,0 +1,48 @@
+﻿#include <fstream>
+
+#include "CabbageHardware.h"
+#include "HardwareWrapperVulkan/HardwareContext.h"
+#include "HardwareWrapperVulkan/HardwareVulkan/GpuProfilerVulkan.h"
+#include "corona/kernel/core/i_logger.h"
+
+void HardwareProfiler::setEnabled(bool enable)
+{
+    GpuProfilerVulkan::setEnabled(enable);
+}
+
+bool HardwareProfiler::isEnabled()
+{
+    return GpuProfilerVulkan::isEnabled();
+}
+
+bool HardwareProfiler::exportChromeTrace(const std::string &filePath)
+{
+    std::ofstream out(filePath, std::ios::out | std::ios::trunc);
+    if (!out)
+    {
+        CFW_LOG_ERROR("HardwareProfiler: failed to open {} for writing!", filePath);
+        return false;
+    }
+
+    out << "{\"traceEvents\":[\n";
+
+    bool firstEvent = true;
+    std::vector<GpuProfilerVulkan::TraceEvent> events;
+    const auto &devices = globalHardwareContext.getAllDevices();
+    for (size_t deviceIndex = 0; deviceIndex < devices.size(); ++deviceIndex)
+    {
+        GpuProfilerVulkan &profiler = devices[deviceIndex]->deviceManager.getGpuProfiler();
+
+        events.clear();
+        profiler.takeEvents(events);
+        GpuProfilerVulkan::writeChromeTraceEvents(out, static_cast<uint32_t>(deviceIndex), events, firstEvent);
+
+        if (const uint64_t dropped = profiler.getDroppedEventCount(); dropped > 0)
+        {
+            CFW_LOG_WARNING("HardwareProfiler: {} events were dropped on device {}, export more often", dropped, deviceIndex);
+        }
+    }
+
+    out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    return static_cast<bool>(out);
+}
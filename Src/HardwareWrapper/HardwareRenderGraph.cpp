@@ -0,0 +1,287 @@
+﻿#include "CabbageHardware.h"
+#include "HardwareWrapperVulkan/HardwareVulkan/RenderGraphVulkan.h"
+#include "HardwareWrapperVulkan/ResourcePool.h"
+#include "corona/kernel/utils/storage.h"
+
+static void incRenderGraph(uint32_t id, const Corona::Kernel::Utils::Storage<RenderGraphWrap>::WriteHandle &handle)
+{
+    ++handle->refCount;
+    // CFW_LOG_TRACE("HardwareRenderGraph ref++: id={}, count={}", id, handle->refCount);
+}
+
+static bool decRenderGraph(uint32_t id, const Corona::Kernel::Utils::Storage<RenderGraphWrap>::WriteHandle &handle)
+{
+    int count = --handle->refCount;
+    // CFW_LOG_TRACE("HardwareRenderGraph ref--: id={}, count={}", id, count);
+    if (count == 0)
+    {
+        delete handle->impl;
+        handle->impl = nullptr;
+        // CFW_LOG_TRACE("HardwareRenderGraph destroyed: id={}", id);
+        return true;
+    }
+    return false;
+}
+
+HardwareRenderGraph::HardwareRenderGraph() : renderGraphID(gRenderGraphStorage.allocate())
+{
+    auto const self_id = renderGraphID.load(std::memory_order_acquire);
+    auto handle = gRenderGraphStorage.acquire_write(self_id);
+    handle->impl = new RenderGraphVulkan();
+    // CFW_LOG_TRACE("HardwareRenderGraph created: id={}", self_id);
+}
+
+HardwareRenderGraph::HardwareRenderGraph(const HardwareRenderGraph &other)
+{
+    std::lock_guard<std::mutex> lock(other.renderGraphMutex);
+    renderGraphID.store(other.renderGraphID.load(std::memory_order_acquire), std::memory_order_release);
+    auto const self_id = renderGraphID.load(std::memory_order_acquire);
+    if (self_id > 0)
+    {
+        auto const handle = gRenderGraphStorage.acquire_write(self_id);
+        incRenderGraph(self_id, handle);
+    }
+}
+
+HardwareRenderGraph::HardwareRenderGraph(HardwareRenderGraph &&other) noexcept
+{
+    std::lock_guard<std::mutex> lock(other.renderGraphMutex);
+    renderGraphID.store(other.renderGraphID.load(std::memory_order_acquire), std::memory_order_release);
+    other.renderGraphID.store(0, std::memory_order_release);
+}
+
+HardwareRenderGraph::~HardwareRenderGraph()
+{
+    auto const self_id = renderGraphID.load(std::memory_order_acquire);
+    if (self_id > 0)
+    {
+        bool should_destroy_self = false;
+        if (auto const handle = gRenderGraphStorage.acquire_write(self_id);
+            decRenderGraph(self_id, handle))
+        {
+            should_destroy_self = true;
+        }
+        if (should_destroy_self)
+        {
+            gRenderGraphStorage.deallocate(self_id);
+        }
+        renderGraphID.store(0, std::memory_order_release);
+    }
+}
+
+HardwareRenderGraph &HardwareRenderGraph::operator=(const HardwareRenderGraph &other)
+{
+    if (this == &other)
+    {
+        return *this;
+    }
+    std::scoped_lock lock(renderGraphMutex, other.renderGraphMutex);
+    auto const self_id = renderGraphID.load(std::memory_order_acquire);
+    auto const other_id = other.renderGraphID.load(std::memory_order_acquire);
+
+    if (self_id == 0 && other_id == 0)
+    {
+        return *this;
+    }
+    if (self_id == other_id)
+    {
+        return *this;
+    }
+
+    bool should_destroy_self = false;
+    if (other_id == 0)
+    {
+        if (auto const self_handle = gRenderGraphStorage.acquire_write(self_id);
+            decRenderGraph(self_id, self_handle))
+        {
+            should_destroy_self = true;
+        }
+        if (should_destroy_self)
+        {
+            gRenderGraphStorage.deallocate(self_id);
+        }
+        renderGraphID.store(0, std::memory_order_release);
+        return *this;
+    }
+
+    if (self_id == 0)
+    {
+        renderGraphID.store(other_id, std::memory_order_release);
+        auto const other_handle = gRenderGraphStorage.acquire_write(other_id);
+        incRenderGraph(other_id, other_handle);
+        return *this;
+    }
+
+    if (self_id < other_id)
+    {
+        auto const self_handle = gRenderGraphStorage.acquire_write(self_id);
+        auto const other_handle = gRenderGraphStorage.acquire_write(other_id);
+        incRenderGraph(other_id, other_handle);
+        if (decRenderGraph(self_id, self_handle))
+        {
+            should_destroy_self = true;
+        }
+    }
+    else
+    {
+        auto const other_handle = gRenderGraphStorage.acquire_write(other_id);
+        auto const self_handle = gRenderGraphStorage.acquire_write(self_id);
+        incRenderGraph(other_id, other_handle);
+        if (decRenderGraph(self_id, self_handle))
+        {
+            should_destroy_self = true;
+        }
+    }
+
+    if (should_destroy_self)
+    {
+        gRenderGraphStorage.deallocate(self_id);
+    }
+    renderGraphID.store(other_id, std::memory_order_release);
+    return *this;
+}
+
+HardwareRenderGraph &HardwareRenderGraph::operator=(HardwareRenderGraph &&other) noexcept
+{
+    if (this == &other)
+    {
+        return *this;
+    }
+    std::scoped_lock lock(renderGraphMutex, other.renderGraphMutex);
+    auto const self_id = renderGraphID.load(std::memory_order_acquire);
+    auto const other_id = other.renderGraphID.load(std::memory_order_acquire);
+
+    if (self_id > 0)
+    {
+        bool should_destroy_self = false;
+        if (auto const self_handle = gRenderGraphStorage.acquire_write(self_id);
+            decRenderGraph(self_id, self_handle))
+        {
+            should_destroy_self = true;
+        }
+        if (should_destroy_self)
+        {
+            gRenderGraphStorage.deallocate(self_id);
+        }
+    }
+    renderGraphID.store(other_id, std::memory_order_release);
+    other.renderGraphID.store(0, std::memory_order_release);
+    return *this;
+}
+
+// createTransientImage 需要图像格式转换，实现在 HardwareImage.cpp 中
+
+HardwareRenderGraph &HardwareRenderGraph::addPass(const std::string &name, ComputePipelineBase &computePipeline, const RenderPassResources &resources)
+{
+    auto const self_id = renderGraphID.load(std::memory_order_acquire);
+    if (self_id == 0 || computePipeline.getComputePipelineID() == 0)
+    {
+        return *this;
+    }
+
+    CommandRecordVulkan *record = nullptr;
+    if (auto const pipeline_handle = gComputePipelineStorage.acquire_read(computePipeline.getComputePipelineID());
+        pipeline_handle.valid())
+    {
+        record = pipeline_handle->impl;
+    }
+
+    if (auto const handle = gRenderGraphStorage.acquire_write(self_id); handle->impl && record)
+    {
+        handle->impl->addPass(name, record, nullptr, resources);
+        handle->impl->retainedComputePipelines.push_back(computePipeline);
+    }
+    return *this;
+}
+
+HardwareRenderGraph &HardwareRenderGraph::addPass(const std::string &name, RasterizerPipelineBase &rasterizerPipeline, const RenderPassResources &resources)
+{
+    auto const self_id = renderGraphID.load(std::memory_order_acquire);
+    if (self_id == 0 || rasterizerPipeline.getRasterizerPipelineID() == 0)
+    {
+        return *this;
+    }
+
+    CommandRecordVulkan *record = nullptr;
+    if (auto const raster_handle = gRasterizerPipelineStorage.acquire_read(rasterizerPipeline.getRasterizerPipelineID());
+        raster_handle.valid())
+    {
+        record = raster_handle->impl;
+    }
+
+    if (auto const handle = gRenderGraphStorage.acquire_write(self_id); handle->impl && record)
+    {
+        handle->impl->addPass(name, record, nullptr, resources);
+        handle->impl->retainedRasterizerPipelines.push_back(rasterizerPipeline);
+    }
+    return *this;
+}
+
+HardwareRenderGraph &HardwareRenderGraph::addPass(const std::string &name, const CopyCommand &cmd, const RenderPassResources &resources)
+{
+    auto const self_id = renderGraphID.load(std::memory_order_acquire);
+    if (self_id == 0 || !cmd.impl)
+    {
+        return *this;
+    }
+
+    if (auto const handle = gRenderGraphStorage.acquire_write(self_id); handle->impl)
+    {
+        handle->impl->addPass(name, cmd.impl->getCommandRecord(), cmd.impl, resources);
+    }
+    return *this;
+}
+
+HardwareRenderGraph &HardwareRenderGraph::markOutput(const HardwareImage &image)
+{
+    auto const self_id = renderGraphID.load(std::memory_order_acquire);
+    if (self_id == 0)
+    {
+        return *this;
+    }
+
+    if (auto const handle = gRenderGraphStorage.acquire_write(self_id); handle->impl)
+    {
+        handle->impl->markOutput(image);
+    }
+    return *this;
+}
+
+HardwareRenderGraph &HardwareRenderGraph::compile()
+{
+    auto const self_id = renderGraphID.load(std::memory_order_acquire);
+    if (self_id == 0)
+    {
+        return *this;
+    }
+
+    if (auto const handle = gRenderGraphStorage.acquire_write(self_id); handle->impl)
+    {
+        handle->impl->compile();
+    }
+    return *this;
+}
+
+uint64_t HardwareRenderGraph::getTransientMemorySize() const
+{
+    auto const self_id = renderGraphID.load(std::memory_order_acquire);
+    if (self_id == 0)
+    {
+        return 0;
+    }
+
+    auto const handle = gRenderGraphStorage.acquire_read(self_id);
+    return handle->impl ? handle->impl->getTransientMemorySize() : 0;
+}
+
+uint64_t HardwareRenderGraph::getUnaliasedTransientMemorySize() const
+{
+    auto const self_id = renderGraphID.load(std::memory_order_acquire);
+    if (self_id == 0)
+    {
+        return 0;
+    }
+
+    auto const handle = gRenderGraphStorage.acquire_read(self_id);
+    return handle->impl ? handle->impl->getUnaliasedTransientMemorySize() : 0;
+}
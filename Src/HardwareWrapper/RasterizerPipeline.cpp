@@ -220,6 +220,24 @@ void RasterizerPipelineBase::setDepthEnabled(bool enabled)
     handle->impl->setDepthEnabled(enabled);
 }
 
+void RasterizerPipelineBase::setParallelRecording(uint32_t drawsPerShard)
+{
+    auto handle = gRasterizerPipelineStorage.acquire_read(rasterizerPipelineID.load(std::memory_order_acquire));
+    handle->impl->setParallelRecording(drawsPerShard);
+}
+
+void RasterizerPipelineBase::setDebugName(const std::string &name)
+{
+    auto handle = gRasterizerPipelineStorage.acquire_read(rasterizerPipelineID.load(std::memory_order_acquire));
+    handle->impl->setDebugName(name);
+}
+
+void RasterizerPipelineBase::setPreciseBarriers(bool enabled)
+{
+    auto handle = gRasterizerPipelineStorage.acquire_read(rasterizerPipelineID.load(std::memory_order_acquire));
+    handle->impl->setPreciseBarriers(enabled);
+}
+
 //void RasterizerPipeline::setDepthWriteEnabled(bool enabled)
 //{
 //    auto handle = gRasterizerPipelineStorage.acquire_read(rasterizerPipelineID.load(std::memory_order_acquire));
@@ -301,6 +301,10 @@ void DisplayManager::choosePresentDevice()
 
     mainDeviceExecutor = std::make_shared<HardwareExecutorVulkan>(globalHardwareContext.getMainDevice());
     displayDeviceExecutor = std::make_shared<HardwareExecutorVulkan>(displayDevice);
+
+    // 呈现前的拷贝与呈现本身处在帧的关键路径上
+    mainDeviceExecutor->setPriority(DeviceManager::QueuePriority::Realtime);
+    displayDeviceExecutor->setPriority(DeviceManager::QueuePriority::Realtime);
 }
 
 void DisplayManager::createSwapChain()
@@ -515,6 +519,8 @@ void DisplayManager::setupCrossDeviceTransfer(const ResourceManager::ImageHardwa
 
 bool DisplayManager::waitExecutor(HardwareExecutorVulkan &executor)
 {
+    // 拷贝只带走提交点，异步提交的最近一次 commit 需要先回收才能被拷贝看到
+    executor.resolveAsyncSubmit();
     waitedExecutor = std::make_shared<HardwareExecutorVulkan>(executor);
     return true;
 }
@@ -144,6 +144,9 @@ void HardwareContext::prepareFeaturesChain()
         features.shaderInt16 = VK_TRUE;
         features.wideLines = VK_TRUE;
         features.fragmentStoresAndAtomics = VK_TRUE;
+        // 以下只在支持时启用，供执行器的管线统计与遮挡查询使用
+        features.pipelineStatisticsQuery = VK_TRUE;
+        features.occlusionQueryPrecise = VK_TRUE;
 
         VkPhysicalDeviceVulkan11Features features11{};
         features11.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
@@ -165,6 +168,7 @@ void HardwareContext::prepareFeaturesChain()
         features12.descriptorBindingVariableDescriptorCount = VK_TRUE;
         features12.descriptorIndexing = VK_TRUE;
         features12.timelineSemaphore = VK_TRUE;
+        features12.hostQueryReset = VK_TRUE;
 
         VkPhysicalDeviceVulkan13Features features13{};
         features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
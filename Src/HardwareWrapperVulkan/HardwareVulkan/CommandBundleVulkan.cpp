@@ -0,0 +1,186 @@
+﻿#include "CommandBundleVulkan.h"
+
+#include <algorithm>
+
+CommandBundleVulkan::CommandBundleVulkan()
+    : hardwareContext(globalHardwareContext.getMainDevice())
+{
+}
+
+void CommandBundleVulkan::addCommand(CommandRecordVulkan *commandRecord, std::shared_ptr<CopyCommandImpl> copyCommand)
+{
+    if (commandRecord == nullptr || commandRecord->getExecutorType() == ExecutorType::Invalid)
+    {
+        return;
+    }
+
+    commandList.push_back(commandRecord);
+    if (copyCommand)
+    {
+        retainedCopyCommands.push_back(std::move(copyCommand));
+    }
+}
+
+void CommandBundleVulkan::collectCurrentBindings(const std::vector<CommandRecordVulkan *> &records)
+{
+    currentBuffers.clear();
+    currentImages.clear();
+    for (CommandRecordVulkan *commandRecord : records)
+    {
+        commandRecord->collectBindings(currentBuffers, currentImages);
+    }
+}
+
+bool CommandBundleVulkan::record()
+{
+    recorded.reset();
+    recordedExecutorType = ExecutorType::Invalid;
+    queueFamilyIndex = UINT32_MAX;
+    recordedList.clear();
+    recordedAccesses.clear();
+    recordedAllAccesses = false;
+    recordedBuffers.clear();
+    recordedImages.clear();
+    imageLayouts.clear();
+
+    if (commandList.empty() || !hardwareContext)
+    {
+        return false;
+    }
+
+    // 录制前的布局就是命令缓冲开头假定的入口布局
+    collectCurrentBindings(commandList);
+    for (ResourceManager::ImageHardwareWrap *image : currentImages)
+    {
+        const bool known = std::any_of(imageLayouts.begin(), imageLayouts.end(), [image](const ImageLayoutState &state) {
+            return state.image == image;
+        });
+        if (!known)
+        {
+            imageLayouts.push_back({image, image->imageHandle, image->imageLayout, VK_IMAGE_LAYOUT_UNDEFINED});
+        }
+    }
+
+    // 借用一个临时执行器完成屏障推导与录制，录制结果连同其命令缓冲池一起转移给命令包
+    HardwareExecutorVulkan captureExecutor(hardwareContext);
+    for (CommandRecordVulkan *commandRecord : commandList)
+    {
+        captureExecutor << commandRecord;
+    }
+    uint32_t capturedQueueFamilyIndex = UINT32_MAX;
+    ExecutorCommandPool::RecordCommandBuffer *recordBuffer = captureExecutor.recordReusable(capturedQueueFamilyIndex);
+
+    // 录制后的绑定作为之后比对的快照（光栅管线按次记录的绑定此时已清空）；录制期间才出现的图像入口布局为 UNDEFINED
+    collectCurrentBindings(commandList);
+    for (ResourceManager::ImageHardwareWrap *image : currentImages)
+    {
+        const bool known = std::any_of(imageLayouts.begin(), imageLayouts.end(), [image](const ImageLayoutState &state) {
+            return state.image == image;
+        });
+        if (!known)
+        {
+            imageLayouts.push_back({image, image->imageHandle, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED});
+        }
+    }
+
+    // 录制只推进了句柄上记录的布局，GPU 尚未执行；恢复为入口布局，回放时再应用出口布局
+    for (ImageLayoutState &state : imageLayouts)
+    {
+        state.exitLayout = state.image->imageLayout;
+        state.image->imageLayout = state.entryLayout;
+    }
+
+    if (recordBuffer == nullptr)
+    {
+        CFW_LOG_ERROR("Failed to record command bundle!");
+        imageLayouts.clear();
+        commandList.clear();
+        captureExecutor.pendingResources.clear();
+        return false;
+    }
+
+    recorded = std::make_shared<RecordedCommands>();
+    recorded->commandPool = captureExecutor.commandPool;
+    recorded->commandBuffer = recordBuffer->commandBuffer;
+    recorded->resources.swap(captureExecutor.pendingResources);
+
+    recordedExecutorType = commandList.front()->getExecutorType();
+    queueFamilyIndex = capturedQueueFamilyIndex;
+    recordedAccesses.swap(captureExecutor.resourceAccesses);
+    recordedAllAccesses = std::all_of(commandList.begin(), commandList.end(), [](const CommandRecordVulkan *commandRecord) {
+        return commandRecord->declaresAllAccesses();
+    });
+    recordedBuffers.swap(currentBuffers);
+    recordedImages.swap(currentImages);
+    recordedList.swap(commandList);
+
+    return true;
+}
+
+void CommandBundleVulkan::reset()
+{
+    // 正在 GPU 上执行的回放各自持有 recorded 的引用，这里只放弃命令包自己的引用
+    recorded.reset();
+    recordedExecutorType = ExecutorType::Invalid;
+    queueFamilyIndex = UINT32_MAX;
+    commandList.clear();
+    recordedList.clear();
+    recordedAccesses.clear();
+    recordedAllAccesses = false;
+    recordedBuffers.clear();
+    recordedImages.clear();
+    imageLayouts.clear();
+    retainedCopyCommands.clear();
+    retainedComputePipelines.clear();
+    retainedRasterizerPipelines.clear();
+}
+
+bool CommandBundleVulkan::isValid()
+{
+    if (!recorded)
+    {
+        return false;
+    }
+
+    // 先比较绑定：绑定变化后旧图像可能已销毁，不能再读取其句柄
+    collectCurrentBindings(recordedList);
+    if (currentBuffers != recordedBuffers || currentImages != recordedImages)
+    {
+        return false;
+    }
+
+    for (const ImageLayoutState &state : imageLayouts)
+    {
+        if (state.image->imageHandle != state.imageHandle)
+        {
+            return false;
+        }
+        if (state.entryLayout != VK_IMAGE_LAYOUT_UNDEFINED && state.image->imageLayout != state.entryLayout)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+VkCommandBuffer CommandBundleVulkan::replayPrerecorded(HardwareExecutorVulkan &executor, uint32_t targetQueueFamilyIndex)
+{
+    // 命令缓冲只能提交到录制时所在设备的同一队列族
+    if (executor.hardwareContext != hardwareContext || targetQueueFamilyIndex != queueFamilyIndex || !isValid())
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    for (const ImageLayoutState &state : imageLayouts)
+    {
+        state.image->imageLayout = state.exitLayout;
+    }
+
+    executor.pendingResources.push_back(recorded);
+    return recorded->commandBuffer;
+}
+
+void CommandBundleVulkan::collectResourceAccesses(std::vector<ResourceAccessVulkan> &accesses)
+{
+    accesses.insert(accesses.end(), recordedAccesses.begin(), recordedAccesses.end());
+}
@@ -0,0 +1,102 @@
+﻿#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "CabbageHardware.h"
+#include "HardwareWrapperVulkan/HardwareContext.h"
+#include "HardwareWrapperVulkan/HardwareVulkan/HardwareExecutorVulkan.h"
+
+// ========== 录制一次、多次提交的命令包 ==========
+// record() 把加入的管线/拷贝命令连同屏障录制进一个主命令缓冲（SIMULTANEOUS_USE），之后每次送入执行器
+// 都单独成段直接提交，不再逐条录制。render pass 不能在二级命令缓冲中开始，因此使用主命令缓冲而非 vkCmdExecuteCommands。
+// 录制时固化推送常量、绘制参数与各图像的入口布局；回放前若绑定的缓冲/图像发生变化，
+// 或图像当前布局与入口布局不符（入口为 UNDEFINED 的图像不校验，每次回放都不保留其内容），该次回放不执行命令，
+// 执行器仍以空提交完成该段的等待与 signal/fence
+struct CommandBundleVulkan : public CommandRecordVulkan
+{
+    // 录制结果：命令缓冲所在的 pool 与录制期间产生的资源，每次回放都挂到执行器的延迟释放上
+    struct RecordedCommands : public CopyCommandImpl
+    {
+        std::shared_ptr<ExecutorCommandPool> commandPool;
+        VkCommandBuffer commandBuffer{VK_NULL_HANDLE};
+        std::vector<std::shared_ptr<CopyCommandImpl>> resources;
+
+        CommandRecordVulkan *getCommandRecord() override
+        {
+            return nullptr;
+        }
+    };
+
+    struct ImageLayoutState
+    {
+        ResourceManager::ImageHardwareWrap *image{nullptr};
+        VkImage imageHandle{VK_NULL_HANDLE};
+        VkImageLayout entryLayout{VK_IMAGE_LAYOUT_UNDEFINED}; // 命令缓冲开头假定的布局
+        VkImageLayout exitLayout{VK_IMAGE_LAYOUT_UNDEFINED};  // 命令缓冲执行后的布局
+    };
+
+    CommandBundleVulkan();
+
+    CommandBundleVulkan(const CommandBundleVulkan &) = delete;
+    CommandBundleVulkan &operator=(const CommandBundleVulkan &) = delete;
+
+    // copyCommand 非空时由命令包持有，保证拷贝记录引用的资源在命令包生命周期内有效
+    void addCommand(CommandRecordVulkan *commandRecord, std::shared_ptr<CopyCommandImpl> copyCommand);
+
+    // 录制已加入的命令；失败时命令包保持未录制状态
+    bool record();
+    void reset();
+
+    [[nodiscard]] bool isRecorded() const
+    {
+        return recorded != nullptr;
+    }
+
+    // 已录制且绑定、布局都与录制时一致
+    [[nodiscard]] bool isValid();
+
+    ExecutorType getExecutorType() override
+    {
+        return recordedExecutorType;
+    }
+
+    [[nodiscard]] bool isPrerecorded() const override
+    {
+        return true;
+    }
+
+    VkCommandBuffer replayPrerecorded(HardwareExecutorVulkan &executor, uint32_t queueFamilyIndex) override;
+    void collectResourceAccesses(std::vector<ResourceAccessVulkan> &accesses) override;
+
+    [[nodiscard]] bool declaresAllAccesses() const override
+    {
+        return recordedAllAccesses;
+    }
+
+    // 管线对象的引用，保证记录在命令包的生命周期内有效
+    std::vector<ComputePipelineBase> retainedComputePipelines;
+    std::vector<RasterizerPipelineBase> retainedRasterizerPipelines;
+
+  private:
+    void collectCurrentBindings(const std::vector<CommandRecordVulkan *> &records);
+
+    std::shared_ptr<HardwareContext::HardwareUtils> hardwareContext;
+
+    std::vector<CommandRecordVulkan *> commandList;    // 尚未录制的记录
+    std::vector<CommandRecordVulkan *> recordedList;   // 已录制进命令缓冲的记录，回放前据此检查绑定
+    std::vector<std::shared_ptr<CopyCommandImpl>> retainedCopyCommands;
+
+    std::shared_ptr<RecordedCommands> recorded;
+    ExecutorType recordedExecutorType{ExecutorType::Invalid};
+    uint32_t queueFamilyIndex{UINT32_MAX};
+    std::vector<ResourceAccessVulkan> recordedAccesses; // 录制时的资源访问，每次回放登记到依赖跟踪器
+    bool recordedAllAccesses{false};                   // 录制的每条记录都上报了全部访问
+    std::vector<ImageLayoutState> imageLayouts;
+
+    // 录制后的绑定快照与回放前的当前绑定，二者不同即视为失效
+    std::vector<VkBuffer> recordedBuffers;
+    std::vector<ResourceManager::ImageHardwareWrap *> recordedImages;
+    std::vector<VkBuffer> currentBuffers;
+    std::vector<ResourceManager::ImageHardwareWrap *> currentImages;
+};
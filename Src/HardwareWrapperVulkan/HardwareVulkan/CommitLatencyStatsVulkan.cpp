@@ -0,0 +1,101 @@
+﻿#include "CommitLatencyStatsVulkan.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+
+uint32_t LatencyHistogramVulkan::bucketIndex(uint64_t value)
+{
+    if (value < SUB_BUCKET_COUNT)
+    {
+        return static_cast<uint32_t>(value);
+    }
+
+    // 最高位之下保留 SUB_BUCKET_BITS 位作为子桶号
+    const uint32_t shift = static_cast<uint32_t>(std::bit_width(value)) - 1 - SUB_BUCKET_BITS;
+    const uint32_t subBucket = static_cast<uint32_t>(value >> shift) & (SUB_BUCKET_COUNT - 1);
+    return (shift + 1) * SUB_BUCKET_COUNT + subBucket;
+}
+
+uint64_t LatencyHistogramVulkan::bucketUpperBound(uint32_t index)
+{
+    if (index < SUB_BUCKET_COUNT)
+    {
+        return index;
+    }
+
+    const uint32_t shift = index / SUB_BUCKET_COUNT - 1;
+    const uint64_t subBucket = index % SUB_BUCKET_COUNT;
+    const uint64_t lowerBound = (SUB_BUCKET_COUNT + subBucket) << shift;
+    return lowerBound + ((uint64_t{1} << shift) - 1);
+}
+
+void LatencyHistogramVulkan::record(uint64_t valueNs)
+{
+    buckets[bucketIndex(valueNs)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    totalNs.fetch_add(valueNs, std::memory_order_relaxed);
+
+    uint64_t currentMax = maxNs.load(std::memory_order_relaxed);
+    while (valueNs > currentMax && !maxNs.compare_exchange_weak(currentMax, valueNs, std::memory_order_relaxed))
+    {
+    }
+}
+
+LatencyHistogramVulkan::Summary LatencyHistogramVulkan::summarize() const
+{
+    Summary summary;
+    summary.maxNs = maxNs.load(std::memory_order_relaxed);
+    summary.totalNs = totalNs.load(std::memory_order_relaxed);
+
+    // 以桶计数之和作为分位数的分母，避免与并发 record 的 count 不一致
+    std::array<uint64_t, BUCKET_COUNT> counts;
+    uint64_t bucketTotal = 0;
+    for (uint32_t i = 0; i < BUCKET_COUNT; ++i)
+    {
+        counts[i] = buckets[i].load(std::memory_order_relaxed);
+        bucketTotal += counts[i];
+    }
+    summary.count = bucketTotal;
+    if (bucketTotal == 0)
+    {
+        return summary;
+    }
+
+    const uint64_t p50Rank = (bucketTotal * 50 + 99) / 100;
+    const uint64_t p90Rank = (bucketTotal * 90 + 99) / 100;
+    const uint64_t p99Rank = (bucketTotal * 99 + 99) / 100;
+
+    uint64_t cumulative = 0;
+    for (uint32_t i = 0; i < BUCKET_COUNT && cumulative < p99Rank; ++i)
+    {
+        if (counts[i] == 0)
+        {
+            continue;
+        }
+
+        const uint64_t previous = cumulative;
+        cumulative += counts[i];
+        const uint64_t upperBound = std::min(bucketUpperBound(i), summary.maxNs);
+        if (previous < p50Rank && cumulative >= p50Rank)
+        {
+            summary.p50Ns = upperBound;
+        }
+        if (previous < p90Rank && cumulative >= p90Rank)
+        {
+            summary.p90Ns = upperBound;
+        }
+        if (previous < p99Rank && cumulative >= p99Rank)
+        {
+            summary.p99Ns = upperBound;
+        }
+    }
+    return summary;
+}
+
+uint64_t CommitLatencyStatsVulkan::nowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
@@ -0,0 +1,68 @@
+﻿#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// ========== 无锁延迟直方图 ==========
+// HDR 风格的对数线性分桶：小于 SUB_BUCKET_COUNT 的值精确计数，之后每个 2 的幂区间再等分为 SUB_BUCKET_COUNT 个子桶，
+// 相对误差不超过 1/SUB_BUCKET_COUNT。record 只做几次 relaxed 原子操作，可在任意线程（包括持有队列锁时）调用
+class LatencyHistogramVulkan
+{
+  public:
+    static constexpr uint32_t SUB_BUCKET_BITS = 3;
+    static constexpr uint32_t SUB_BUCKET_COUNT = 1u << SUB_BUCKET_BITS;
+    static constexpr uint32_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    struct Summary
+    {
+        uint64_t count = 0;
+        uint64_t totalNs = 0;
+        uint64_t maxNs = 0;
+        uint64_t p50Ns = 0; // 分位数取所在桶的上界（不超过 maxNs）
+        uint64_t p90Ns = 0;
+        uint64_t p99Ns = 0;
+    };
+
+    void record(uint64_t valueNs);
+
+    // 读取期间可能有并发 record，分位数与计数之间只保证近似一致
+    [[nodiscard]] Summary summarize() const;
+
+  private:
+    static uint32_t bucketIndex(uint64_t value);
+    static uint64_t bucketUpperBound(uint32_t index);
+
+    std::array<std::atomic_uint64_t, BUCKET_COUNT> buckets{};
+    std::atomic_uint64_t count{0};
+    std::atomic_uint64_t totalNs{0};
+    std::atomic_uint64_t maxNs{0};
+};
+
+// 获取队列锁的等待情况，供提交路径区分锁竞争与其他开销
+struct QueueLockWait
+{
+    bool blocked{false}; // 没有可立即 try_lock 的空闲队列，阻塞在负载最小的队列上
+    uint64_t waitNs{0};  // 阻塞等锁的耗时（纳秒），不含选择队列的开销
+};
+
+// ========== 执行器提交路径的 CPU 侧计数 ==========
+// 区分提交耗时的来源：队列锁竞争、等待队列命令缓冲槽位的 GPU 反压、录制本身以及驱动的 vkQueueSubmit2。
+// 由执行器拷贝之间共享；异步提交时锁等待与 vkQueueSubmit2 由提交线程测得，随批次结果回收时计入
+struct CommitLatencyStatsVulkan
+{
+    LatencyHistogramVulkan queueLockWait; // 获取队列锁的等待（try_lock 成功时记为 0）
+    LatencyHistogramVulkan timelineWait;  // 旧路径等待命令缓冲环槽位的 timeline 值
+    LatencyHistogramVulkan recording;     // 每个队列段命令缓冲的录制
+    LatencyHistogramVulkan queueSubmit;   // vkQueueSubmit2 调用本身
+
+    std::atomic_uint64_t commits{0};
+    std::atomic_uint64_t submits{0};              // 成功的 vkQueueSubmit2（按命令缓冲计）
+    std::atomic_uint64_t failedSubmits{0};        // semaphore 校验失败或 vkQueueSubmit2 返回错误
+    std::atomic_uint64_t droppedSegments{0};      // 命令未执行、只提交了等待与 signal 的队列段（命令包失效等）
+    std::atomic_uint64_t contendedQueueLocks{0};  // 没有空闲队列可 try_lock、只能阻塞等锁的次数
+    std::atomic_uint64_t timelineWaitTimeouts{0}; // 槽位等待超时后重新选择队列的次数
+
+    // steady_clock 纳秒时间戳
+    static uint64_t nowNs();
+};
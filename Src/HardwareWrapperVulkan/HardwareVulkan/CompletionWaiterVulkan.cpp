@@ -0,0 +1,232 @@
+﻿#include "CompletionWaiterVulkan.h"
+
+#include "corona/kernel/core/i_logger.h"
+
+bool CompletionTokenVulkan::isReady() const
+{
+    TimelineValueCache &timelineValueCache = deviceManager->getTimelineValueCache();
+    for (size_t i = 0; i < semaphores.size(); ++i)
+    {
+        if (!timelineValueCache.isReached(semaphores[i], values[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CompletionTokenVulkan::wait(uint64_t timeoutNs) const
+{
+    if (semaphores.empty())
+    {
+        return true;
+    }
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.flags = 0; // 等待所有 semaphore
+    waitInfo.semaphoreCount = static_cast<uint32_t>(semaphores.size());
+    waitInfo.pSemaphores = semaphores.data();
+    waitInfo.pValues = values.data();
+
+    const VkResult result = vkWaitSemaphores(deviceManager->getLogicalDevice(), &waitInfo, timeoutNs);
+    if (result != VK_SUCCESS && result != VK_TIMEOUT)
+    {
+        CFW_LOG_ERROR("[CompletionTokenVulkan] vkWaitSemaphores failed, VkResult: {}", coronaHardwareResultStr(result));
+    }
+    if (result != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    TimelineValueCache &timelineValueCache = deviceManager->getTimelineValueCache();
+    for (size_t i = 0; i < semaphores.size(); ++i)
+    {
+        timelineValueCache.observe(semaphores[i], values[i]);
+    }
+    return true;
+}
+
+CompletionWaiterVulkan::CompletionWaiterVulkan(DeviceManager &deviceManager)
+    : deviceManager(deviceManager)
+{
+    VkSemaphoreTypeCreateInfo typeCreateInfo{};
+    typeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeCreateInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeCreateInfo;
+
+    coronaHardwareCheck(vkCreateSemaphore(deviceManager.getLogicalDevice(), &semaphoreInfo, nullptr, &wakeSemaphore));
+
+    waitingCallbacks.reserve(64);
+    readyCallbacks.reserve(64);
+
+    waiterThread = std::thread(&CompletionWaiterVulkan::threadLoop, this);
+}
+
+CompletionWaiterVulkan::~CompletionWaiterVulkan()
+{
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        running = false;
+        wake();
+    }
+    pendingCondition.notify_one();
+
+    if (waiterThread.joinable())
+    {
+        waiterThread.join();
+    }
+
+    vkDestroySemaphore(deviceManager.getLogicalDevice(), wakeSemaphore, nullptr);
+}
+
+void CompletionWaiterVulkan::wake()
+{
+    // 调用方持有 pendingMutex，保证 signal 值严格递增
+    VkSemaphoreSignalInfo signalInfo{};
+    signalInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+    signalInfo.semaphore = wakeSemaphore;
+    signalInfo.value = ++wakeValue;
+    vkSignalSemaphore(deviceManager.getLogicalDevice(), &signalInfo);
+}
+
+void CompletionWaiterVulkan::enqueue(std::shared_ptr<CompletionTokenVulkan> token, std::function<void()> callback)
+{
+    bool accepted = false;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        if (running)
+        {
+            pendingCallbacks.push_back({std::move(token), std::move(callback)});
+            wake();
+            accepted = true;
+        }
+    }
+
+    if (!accepted)
+    {
+        // 等待线程正在退出，不会再执行新的回调：在调用线程上放弃等待
+        token->abandoned.store(true, std::memory_order_release);
+        callback();
+        return;
+    }
+    pendingCondition.notify_one();
+}
+
+void CompletionWaiterVulkan::abandonWaitingCallbacks()
+{
+    // 先移出再执行：回调中可以再次注册
+    readyCallbacks.clear();
+    readyCallbacks.swap(waitingCallbacks);
+    for (auto &pending : readyCallbacks)
+    {
+        pending.token->abandoned.store(true, std::memory_order_release);
+        pending.callback();
+    }
+    readyCallbacks.clear();
+}
+
+void CompletionWaiterVulkan::threadLoop()
+{
+    const VkDevice device = deviceManager.getLogicalDevice();
+    TimelineValueCache &timelineValueCache = deviceManager.getTimelineValueCache();
+
+    while (true)
+    {
+        uint64_t observedWakeValue = 0;
+        bool stopping = false;
+        {
+            std::unique_lock<std::mutex> lock(pendingMutex);
+            pendingCondition.wait(lock, [this] {
+                return !running || !pendingCallbacks.empty() || !waitingCallbacks.empty();
+            });
+
+            for (auto &pending : pendingCallbacks)
+            {
+                waitingCallbacks.push_back(std::move(pending));
+            }
+            pendingCallbacks.clear();
+            observedWakeValue = wakeValue;
+            stopping = !running;
+        }
+
+        // 取出已完成的令牌，回调在锁外执行，回调中可以再次注册
+        readyCallbacks.clear();
+        std::erase_if(waitingCallbacks, [this](PendingCallback &pending) {
+            if (!pending.token->isReady())
+            {
+                return false;
+            }
+            readyCallbacks.push_back(std::move(pending));
+            return true;
+        });
+
+        for (auto &ready : readyCallbacks)
+        {
+            ready.callback();
+        }
+        readyCallbacks.clear();
+
+        if (stopping)
+        {
+            if (!waitingCallbacks.empty())
+            {
+                CFW_LOG_WARNING("[CompletionWaiterVulkan] Abandoning {} callbacks whose work has not completed",
+                                waitingCallbacks.size());
+                abandonWaitingCallbacks();
+            }
+            // 本轮取出之后、停止之前注册的回调
+            {
+                std::lock_guard<std::mutex> lock(pendingMutex);
+                waitingCallbacks.swap(pendingCallbacks);
+            }
+            abandonWaitingCallbacks();
+            break;
+        }
+
+        if (waitingCallbacks.empty())
+        {
+            continue;
+        }
+
+        // 任一令牌的首个未完成 semaphore 推进或有新注册时醒来，随后重新检查
+        waitSemaphores.clear();
+        waitValues.clear();
+        waitSemaphores.push_back(wakeSemaphore);
+        waitValues.push_back(observedWakeValue + 1);
+        for (const auto &waiting : waitingCallbacks)
+        {
+            const CompletionTokenVulkan &token = *waiting.token;
+            for (size_t i = 0; i < token.semaphores.size(); ++i)
+            {
+                // 上面的 isReady 刚刚刷新过缓存，这里直接读取缓存值
+                if (timelineValueCache.cachedValue(token.semaphores[i]) >= token.values[i])
+                {
+                    continue;
+                }
+                waitSemaphores.push_back(token.semaphores[i]);
+                waitValues.push_back(token.values[i]);
+                break;
+            }
+        }
+
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.flags = VK_SEMAPHORE_WAIT_ANY_BIT;
+        waitInfo.semaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+        waitInfo.pSemaphores = waitSemaphores.data();
+        waitInfo.pValues = waitValues.data();
+
+        const VkResult result = vkWaitSemaphores(device, &waitInfo, UINT64_MAX);
+        if (result != VK_SUCCESS)
+        {
+            CFW_LOG_ERROR("[CompletionWaiterVulkan] vkWaitSemaphores failed, VkResult: {}", coronaHardwareResultStr(result));
+            // 设备丢失等情况下 semaphore 不会再推进，放弃等待并执行回调，避免忙等或协程永远挂起
+            abandonWaitingCallbacks();
+        }
+    }
+}
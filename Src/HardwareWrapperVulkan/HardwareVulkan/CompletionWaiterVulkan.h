@@ -0,0 +1,75 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "DeviceManager.h"
+
+// ========== 一次 commit 的完成令牌 ==========
+// 记录 commit 各队列段的 timeline semaphore 与 signal 值，全部达到即表示 GPU 已完成
+struct CompletionTokenVulkan
+{
+    DeviceManager *deviceManager{nullptr};
+    std::vector<VkSemaphore> semaphores;
+    std::vector<uint64_t> values;
+
+    // 等待线程退出或设备出错时放弃等待，未完成的回调照常执行；此后不能再认为 GPU 工作已完成
+    std::atomic_bool abandoned{false};
+
+    // 非阻塞：逐个查询 counter 值
+    [[nodiscard]] bool isReady() const;
+
+    // 阻塞至完成或超时，返回是否已完成
+    bool wait(uint64_t timeoutNs) const;
+};
+
+// ========== 每设备一个的完成回调线程 ==========
+// 注册的回调在对应令牌完成后于此线程执行。线程用 VK_SEMAPHORE_WAIT_ANY 同时等待所有未完成令牌
+// 以及一个自有的唤醒 timeline semaphore，新注册时在 host 侧 signal 唤醒 semaphore，无需轮询。
+// 线程退出或 vkWaitSemaphores 出错时，剩余回调把令牌标记为 abandoned 后立即执行，挂起的协程不会永远得不到恢复
+class CompletionWaiterVulkan
+{
+  public:
+    explicit CompletionWaiterVulkan(DeviceManager &deviceManager);
+    ~CompletionWaiterVulkan();
+
+    CompletionWaiterVulkan(const CompletionWaiterVulkan &) = delete;
+    CompletionWaiterVulkan &operator=(const CompletionWaiterVulkan &) = delete;
+
+    void enqueue(std::shared_ptr<CompletionTokenVulkan> token, std::function<void()> callback);
+
+  private:
+    struct PendingCallback
+    {
+        std::shared_ptr<CompletionTokenVulkan> token;
+        std::function<void()> callback;
+    };
+
+    void threadLoop();
+    void wake();
+
+    // 放弃等待 waitingCallbacks 中的令牌并执行其回调
+    void abandonWaitingCallbacks();
+
+    DeviceManager &deviceManager;
+    VkSemaphore wakeSemaphore{VK_NULL_HANDLE};
+
+    std::mutex pendingMutex;
+    std::condition_variable pendingCondition;
+    std::vector<PendingCallback> pendingCallbacks;
+    uint64_t wakeValue{0}; // 已 signal 到唤醒 semaphore 的最大值，受 pendingMutex 保护
+    bool running{true};
+
+    // 以下容器只由等待线程访问，跨轮次复用容量
+    std::vector<PendingCallback> waitingCallbacks;
+    std::vector<PendingCallback> readyCallbacks;
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<uint64_t> waitValues;
+
+    std::thread waiterThread;
+};
@@ -1,4 +1,8 @@
 ﻿#include "DeviceManager.h"
+#include "SubmitThreadVulkan.h"
+#include "CompletionWaiterVulkan.h"
+#include "RecordWorkersVulkan.h"
+#include "GpuProfilerVulkan.h"
 
 #include <algorithm>
 #include <cassert>
@@ -16,6 +20,8 @@ void DeviceManager::initDeviceManager(const CreateCallback &createCallback, cons
 
     createDevices(createCallback, vkInstance);
     createQueueUtils();
+    timelineValueCache.setDevice(logicalDevice);
+    dependencyTracker.setTimelineValueCache(timelineValueCache);
     // createCommandBuffers();
     // createTimelineSemaphore();
 
@@ -68,6 +74,22 @@ void DeviceManager::initDeviceManager(const CreateCallback &createCallback, cons
 
 void DeviceManager::cleanUpDeviceManager()
 {
+    // 先停止提交线程，保证之后不再有来自它的 vkQueueSubmit2
+    {
+        std::lock_guard<std::mutex> lock(submitThreadMutex);
+        submitThread.reset();
+    }
+    {
+        std::lock_guard<std::mutex> lock(completionWaiterMutex);
+        completionWaiter.reset();
+    }
+    {
+        std::lock_guard<std::mutex> lock(recordWorkersMutex);
+        recordWorkers.reset();
+    }
+    dependencyTracker.clear();
+    timelineValueCache.clear();
+
     if (logicalDevice == VK_NULL_HANDLE)
     {
         graphicsQueues.clear();
@@ -83,6 +105,11 @@ void DeviceManager::cleanUpDeviceManager()
 
     vkDeviceWaitIdle(logicalDevice);
 
+    {
+        std::lock_guard<std::mutex> lock(gpuProfilerMutex);
+        gpuProfiler.reset();
+    }
+
     // 清理跨设备导入的 semaphore
     for (auto &[foreignSem, localSem] : importedTimelineSemaphores)
     {
@@ -124,6 +151,7 @@ void DeviceManager::destroyQueueResources(std::vector<QueueUtils> &queues)
         {
             // 资源已被释放，只需清理引用
             queue.commandBuffer = VK_NULL_HANDLE;
+            queue.commandBufferRing.reset();
             queue.commandPool = VK_NULL_HANDLE;
             queue.timelineSemaphore = VK_NULL_HANDLE;
             queue.vkQueue = VK_NULL_HANDLE;
@@ -133,11 +161,20 @@ void DeviceManager::destroyQueueResources(std::vector<QueueUtils> &queues)
             continue;
         }
 
-        if (queue.commandBuffer != VK_NULL_HANDLE && queue.commandPool != VK_NULL_HANDLE)
+        if (queue.commandBufferRing && queue.commandPool != VK_NULL_HANDLE)
         {
-            vkFreeCommandBuffers(logicalDevice, queue.commandPool, 1, &queue.commandBuffer);
-            queue.commandBuffer = VK_NULL_HANDLE;
+            for (auto &slot : queue.commandBufferRing->slots)
+            {
+                if (slot.commandBuffer != VK_NULL_HANDLE)
+                {
+                    vkFreeCommandBuffers(logicalDevice, queue.commandPool, 1, &slot.commandBuffer);
+                    slot.commandBuffer = VK_NULL_HANDLE;
+                }
+            }
+            queue.commandBufferRing->slots.clear();
         }
+        queue.commandBufferRing.reset();
+        queue.commandBuffer = VK_NULL_HANDLE;
 
         if (queue.commandPool != VK_NULL_HANDLE)
         {
@@ -193,6 +230,45 @@ void DeviceManager::destroyQueueResources(std::vector<QueueUtils> &queues)
 //     }
 // }
 
+// 队列族内各队列的优先级类别：第一个队列留给实时工作，最后一个留给后台工作，其余为普通。
+// 只有一个队列时所有类别共用它；只有两个队列时没有普通队列，普通工作与后台工作共用第二个，
+// 实时队列不被普通工作占用（见 HardwareExecutorVulkan 中的 closestQueuePriority）。
+// 实时队列忙碌时实时工作可以退回到普通队列（见 lockQueueOfFamily），后台工作只使用后台队列
+static DeviceManager::QueuePriority queuePriorityOfIndex(uint32_t queueIndex, uint32_t queueCount)
+{
+    if (queueCount <= 1)
+    {
+        return DeviceManager::QueuePriority::Normal;
+    }
+    if (queueIndex == 0)
+    {
+        return DeviceManager::QueuePriority::Realtime;
+    }
+    if (queueIndex + 1 == queueCount)
+    {
+        return DeviceManager::QueuePriority::Background;
+    }
+    return DeviceManager::QueuePriority::Normal;
+}
+
+static float queuePriorityValue(uint32_t queueIndex, uint32_t queueCount)
+{
+    if (queueCount <= 1)
+    {
+        return 1.0f;
+    }
+
+    switch (queuePriorityOfIndex(queueIndex, queueCount))
+    {
+    case DeviceManager::QueuePriority::Realtime:
+        return 1.0f;
+    case DeviceManager::QueuePriority::Background:
+        return 0.0f;
+    default:
+        return 0.5f;
+    }
+}
+
 void DeviceManager::createDevices(const CreateCallback &initInfo, const VkInstance &vkInstance)
 {
     std::set<const char *> inputExtensions = initInfo.requiredDeviceExtensions(vkInstance, physicalDevice);
@@ -239,18 +315,44 @@ void DeviceManager::createDevices(const CreateCallback &initInfo, const VkInstan
     queueFamilies.resize(queueFamilyCount);
     vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
 
+    // VK_EXT_global_priority 只能按队列族设置，提升承载帧关键图形工作的图形队列族。
+    // 同一族内的后台队列也随之提升：后台优先级只是族内相对于实时/普通队列的 pQueuePriorities，
+    // 相对于其他队列族（以及其他进程）的调度并不低于默认全局优先级
+    const bool globalPrioritySupported = std::any_of(availableExtensions.begin(), availableExtensions.end(), [](const VkExtensionProperties &available) {
+        return strcmp(available.extensionName, VK_EXT_GLOBAL_PRIORITY_EXTENSION_NAME) == 0;
+    });
+    if (globalPrioritySupported &&
+        std::none_of(requiredExtensions.begin(), requiredExtensions.end(), [](const char *required) {
+            return strcmp(required, VK_EXT_GLOBAL_PRIORITY_EXTENSION_NAME) == 0;
+        }))
+    {
+        requiredExtensions.push_back(VK_EXT_GLOBAL_PRIORITY_EXTENSION_NAME);
+    }
+
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::vector<std::vector<float>> queuePriorities(queueFamilies.size());
 
+    VkDeviceQueueGlobalPriorityCreateInfoEXT graphicsGlobalPriority{};
+    graphicsGlobalPriority.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_GLOBAL_PRIORITY_CREATE_INFO_EXT;
+    graphicsGlobalPriority.globalPriority = VK_QUEUE_GLOBAL_PRIORITY_HIGH_EXT;
+
     for (int i = 0; i < queueFamilies.size(); i++)
     {
-        queuePriorities[i].resize(queueFamilies[i].queueCount, 1.0f);
+        queuePriorities[i].resize(queueFamilies[i].queueCount);
+        for (uint32_t queueIndex = 0; queueIndex < queueFamilies[i].queueCount; queueIndex++)
+        {
+            queuePriorities[i][queueIndex] = queuePriorityValue(queueIndex, queueFamilies[i].queueCount);
+        }
 
         VkDeviceQueueCreateInfo queueCreateInfo{};
         queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
         queueCreateInfo.queueFamilyIndex = static_cast<uint32_t>(i);
         queueCreateInfo.queueCount = queueFamilies[i].queueCount;
         queueCreateInfo.pQueuePriorities = queuePriorities[i].data();
+        if (globalPrioritySupported && (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+        {
+            queueCreateInfo.pNext = &graphicsGlobalPriority;
+        }
 
         queueCreateInfos.push_back(queueCreateInfo);
     }
@@ -266,7 +368,18 @@ void DeviceManager::createDevices(const CreateCallback &initInfo, const VkInstan
     createInfo.pEnabledFeatures = nullptr;
     createInfo.pNext = deviceFeaturesUtils.featuresChain.getChainHead();
 
-    coronaHardwareCheck(vkCreateDevice(physicalDevice, &createInfo, nullptr, &logicalDevice));
+    VkResult result = vkCreateDevice(physicalDevice, &createInfo, nullptr, &logicalDevice);
+    if (result == VK_ERROR_NOT_PERMITTED_EXT)
+    {
+        // 提升全局优先级需要系统权限，被拒绝时退回默认全局优先级
+        CFW_LOG_WARNING("Global queue priority not permitted, creating device with default global priority");
+        for (auto &queueCreateInfo : queueCreateInfos)
+        {
+            queueCreateInfo.pNext = nullptr;
+        }
+        result = vkCreateDevice(physicalDevice, &createInfo, nullptr, &logicalDevice);
+    }
+    coronaHardwareCheck(result);
 }
 
 void DeviceManager::createQueueUtils()
@@ -317,9 +430,18 @@ void DeviceManager::createQueueUtils()
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         allocInfo.commandPool = queue.commandPool;
         allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandBufferCount = 1;
+        allocInfo.commandBufferCount = MAX_IN_FLIGHT_COMMAND_BUFFERS;
+
+        std::vector<VkCommandBuffer> commandBuffers(MAX_IN_FLIGHT_COMMAND_BUFFERS);
+        coronaHardwareCheck(vkAllocateCommandBuffers(logicalDevice, &allocInfo, commandBuffers.data()));
 
-        coronaHardwareCheck(vkAllocateCommandBuffers(logicalDevice, &allocInfo, &queue.commandBuffer));
+        queue.commandBufferRing = std::make_shared<CommandBufferRing>();
+        queue.commandBufferRing->slots.resize(MAX_IN_FLIGHT_COMMAND_BUFFERS);
+        for (uint32_t i = 0; i < MAX_IN_FLIGHT_COMMAND_BUFFERS; ++i)
+        {
+            queue.commandBufferRing->slots[i].commandBuffer = commandBuffers[i];
+        }
+        queue.commandBuffer = commandBuffers[0];
     };
 
     int queue_count = 0;
@@ -330,6 +452,7 @@ void DeviceManager::createQueueUtils()
         {
             QueueUtils queueUtils{};
             queueUtils.queueFamilyIndex = static_cast<uint32_t>(i);
+            queueUtils.priority = queuePriorityOfIndex(queueIndex, queueFamilies[i].queueCount);
             queueUtils.deviceManager = this;
             queueUtils.queueMutex = std::make_shared<std::mutex>();
             queueUtils.timelineValue = std::make_shared<std::atomic_uint64_t>(0);
@@ -389,6 +512,46 @@ void DeviceManager::createQueueUtils()
 //     return true;
 // }
 
+SubmitThreadVulkan &DeviceManager::getSubmitThread()
+{
+    std::lock_guard<std::mutex> lock(submitThreadMutex);
+    if (!submitThread)
+    {
+        submitThread = std::make_unique<SubmitThreadVulkan>(*this);
+    }
+    return *submitThread;
+}
+
+CompletionWaiterVulkan &DeviceManager::getCompletionWaiter()
+{
+    std::lock_guard<std::mutex> lock(completionWaiterMutex);
+    if (!completionWaiter)
+    {
+        completionWaiter = std::make_unique<CompletionWaiterVulkan>(*this);
+    }
+    return *completionWaiter;
+}
+
+GpuProfilerVulkan &DeviceManager::getGpuProfiler()
+{
+    std::lock_guard<std::mutex> lock(gpuProfilerMutex);
+    if (!gpuProfiler)
+    {
+        gpuProfiler = std::make_unique<GpuProfilerVulkan>(*this);
+    }
+    return *gpuProfiler;
+}
+
+RecordWorkersVulkan &DeviceManager::getRecordWorkers()
+{
+    std::lock_guard<std::mutex> lock(recordWorkersMutex);
+    if (!recordWorkers)
+    {
+        recordWorkers = std::make_unique<RecordWorkersVulkan>();
+    }
+    return *recordWorkers;
+}
+
 std::vector<DeviceManager::QueueUtils> DeviceManager::pickAvailableQueues(std::function<bool(const QueueUtils &)> predicate) const
 {
     std::vector<QueueUtils> result;
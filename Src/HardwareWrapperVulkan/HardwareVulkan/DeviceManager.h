@@ -5,8 +5,15 @@
 #include <unordered_map>
 
 #include "FeaturesChain.h"
+#include "ResourceDependencyTracker.h"
+#include "TimelineValueCache.h"
 #include "HardwareWrapperVulkan/HardwareUtilsVulkan.h"
 
+class SubmitThreadVulkan;
+class CompletionWaiterVulkan;
+class RecordWorkersVulkan;
+class GpuProfilerVulkan;
+
 class DeviceManager
 {
   public:
@@ -19,6 +26,31 @@ class DeviceManager
 #endif
     };
 
+    // 每个队列同时允许在 GPU 上排队的命令缓冲数量
+    static constexpr uint32_t MAX_IN_FLIGHT_COMMAND_BUFFERS = 4u;
+
+    struct CommandBufferSlot
+    {
+        VkCommandBuffer commandBuffer{VK_NULL_HANDLE};
+        uint64_t signalValue{0}; // 最近一次使用该命令缓冲的提交的 signal 值，timeline 达到后可复用
+    };
+
+    // 命令缓冲环：由同一队列的所有 QueueUtils 拷贝共享，只能在持有 queueMutex 时访问
+    struct CommandBufferRing
+    {
+        std::vector<CommandBufferSlot> slots;
+        size_t nextSlot{0};
+    };
+
+    // 队列优先级类别：同一队列族内的队列以不同的 pQueuePriorities 创建，执行器按类别选择队列。
+    // 类别只在队列族内有效：图形队列族整体提升全局优先级时，其中的后台队列也一同提升
+    enum class QueuePriority : uint8_t
+    {
+        Realtime,
+        Normal,
+        Background
+    };
+
     struct QueueUtils
     {
         std::shared_ptr<std::mutex> queueMutex;
@@ -28,7 +60,9 @@ class DeviceManager
         uint32_t queueFamilyIndex = -1;
         VkQueue vkQueue{VK_NULL_HANDLE};
         VkCommandPool commandPool{VK_NULL_HANDLE};
-        VkCommandBuffer commandBuffer{VK_NULL_HANDLE};
+        VkCommandBuffer commandBuffer{VK_NULL_HANDLE}; // 本次提交正在录制的命令缓冲（取自 commandBufferRing）
+        std::shared_ptr<CommandBufferRing> commandBufferRing;
+        QueuePriority priority{QueuePriority::Normal};
         DeviceManager *deviceManager{nullptr};
     };
 
@@ -65,6 +99,30 @@ class DeviceManager
 
     std::vector<QueueUtils> pickAvailableQueues(std::function<bool(const QueueUtils &)> predicate) const;
 
+    /// 获取本设备的提交线程（首次调用时启动），供启用异步提交的执行器使用。
+    SubmitThreadVulkan &getSubmitThread();
+
+    /// 获取本设备的完成回调线程（首次调用时启动），HardwareCompletionToken::onComplete 的回调在其上执行。
+    CompletionWaiterVulkan &getCompletionWaiter();
+
+    /// 获取本设备的录制工作线程池（首次调用时启动），大批量绘制据此拆分到多个二级命令缓冲并行录制。
+    RecordWorkersVulkan &getRecordWorkers();
+
+    /// 获取本设备的 GPU 时间戳分析器（首次调用时创建），启用分析后执行器据此为每条记录计时。
+    GpuProfilerVulkan &getGpuProfiler();
+
+    /// 获取本设备的资源依赖跟踪器，提交时据此只等待真正读写同一资源的先前提交。
+    ResourceDependencyTracker &getDependencyTracker()
+    {
+        return dependencyTracker;
+    }
+
+    /// 获取本设备的 timeline 值缓存，已知满足的等待据此跳过驱动查询。
+    TimelineValueCache &getTimelineValueCache()
+    {
+        return timelineValueCache;
+    }
+
     VkPhysicalDevice getPhysicalDevice() const
     {
         return physicalDevice;
@@ -85,6 +143,10 @@ class DeviceManager
     {
         return static_cast<uint16_t>(queueFamilies.size());
     }
+    const std::vector<VkQueueFamilyProperties> &getQueueFamilies() const
+    {
+        return queueFamilies;
+    }
 
     bool operator==(const DeviceManager &other) const
     {
@@ -118,6 +180,28 @@ class DeviceManager
     // 用于追踪已销毁的资源，避免共享队列的重复释放
     std::set<VkCommandPool> destroyedPools;
 
+    // 异步提交线程，按需创建，cleanUpDeviceManager 时先于队列资源停止
+    std::mutex submitThreadMutex;
+    std::unique_ptr<SubmitThreadVulkan> submitThread;
+
+    // 完成回调线程，按需创建，与提交线程一同在 cleanUpDeviceManager 时停止
+    std::mutex completionWaiterMutex;
+    std::unique_ptr<CompletionWaiterVulkan> completionWaiter;
+
+    // 录制工作线程池，按需创建
+    std::mutex recordWorkersMutex;
+    std::unique_ptr<RecordWorkersVulkan> recordWorkers;
+
+    // GPU 时间戳分析器，按需创建；查询池在设备空闲后随之销毁
+    std::mutex gpuProfilerMutex;
+    std::unique_ptr<GpuProfilerVulkan> gpuProfiler;
+
+    // 按资源记录最近的写入者/读取者，替代整设备串行的图形提交链
+    ResourceDependencyTracker dependencyTracker;
+
+    // 各 timeline semaphore 最近观察到的值，提交、延迟释放与完成令牌共用
+    TimelineValueCache timelineValueCache;
+
     // 跨设备 timeline semaphore 缓存：外部 VkSemaphore → 本设备已导入的 VkSemaphore
     std::unordered_map<VkSemaphore, VkSemaphore> importedTimelineSemaphores;
 };
\ No newline at end of file
@@ -0,0 +1,341 @@
+﻿#include "ExecutorQueryPool.h"
+
+#include <bit>
+#include <iterator>
+
+#include "DeviceManager.h"
+#include "corona/kernel/core/i_logger.h"
+
+namespace
+{
+// 图形队列族统计顶点/片元/计算调用次数，纯计算队列族只统计计算调用次数；结果按位从低到高排列
+constexpr VkQueryPipelineStatisticFlags kGraphicsStatisticFlags = VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+                                                                  VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+                                                                  VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+constexpr VkQueryPipelineStatisticFlags kComputeStatisticFlags = VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+const VkPhysicalDeviceVulkan12Features *findVulkan12Features(const VkPhysicalDeviceFeatures2 *chainHead)
+{
+    for (auto *node = static_cast<const VkBaseInStructure *>(chainHead->pNext); node != nullptr; node = node->pNext)
+    {
+        if (node->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES)
+        {
+            return reinterpret_cast<const VkPhysicalDeviceVulkan12Features *>(node);
+        }
+    }
+    return nullptr;
+}
+} // namespace
+
+ExecutorQueryPool::ExecutorQueryPool(DeviceManager &deviceManager)
+    : deviceManager(deviceManager), device(deviceManager.getLogicalDevice())
+{
+    const VkPhysicalDeviceFeatures2 *enabledFeatures = deviceManager.getFeaturesUtils().featuresChain.getChainHead();
+    statisticsQuery = enabledFeatures->features.pipelineStatisticsQuery == VK_TRUE;
+    preciseOcclusion = enabledFeatures->features.occlusionQueryPrecise == VK_TRUE;
+
+    const VkPhysicalDeviceVulkan12Features *features12 = findVulkan12Features(enabledFeatures);
+    hostQueryReset = features12 != nullptr && features12->hostQueryReset == VK_TRUE;
+
+    if (!hostQueryReset)
+    {
+        CFW_LOG_WARNING("ExecutorQueryPool: hostQueryReset is not enabled, pipeline statistics and occlusion queries are unavailable");
+    }
+}
+
+ExecutorQueryPool::~ExecutorQueryPool()
+{
+    // 已提交的查询可能仍被 GPU 写入，等到对应 timeline 值后再销毁查询池
+    std::vector<VkSemaphore> semaphores;
+    std::vector<uint64_t> values;
+    for (const QueryBlock &block : queryBlocks)
+    {
+        if (block.state == QueryBlock::State::Submitted)
+        {
+            semaphores.push_back(block.semaphore);
+            values.push_back(block.signalValue);
+        }
+    }
+
+    if (!semaphores.empty())
+    {
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = static_cast<uint32_t>(semaphores.size());
+        waitInfo.pSemaphores = semaphores.data();
+        waitInfo.pValues = values.data();
+        vkWaitSemaphores(device, &waitInfo, UINT64_MAX);
+    }
+
+    for (QueryBlock &block : queryBlocks)
+    {
+        if (block.queryPool != VK_NULL_HANDLE)
+        {
+            vkDestroyQueryPool(device, block.queryPool, nullptr);
+            block.queryPool = VK_NULL_HANDLE;
+        }
+    }
+    queryBlocks.clear();
+}
+
+bool ExecutorQueryPool::isSupported(QueryKind kind) const
+{
+    return hostQueryReset && (kind == QueryKind::Occlusion || statisticsQuery);
+}
+
+ExecutorQueryPool::QueryBlock *ExecutorQueryPool::acquireBlock(QueryKind kind, uint32_t queueFamilyIndex)
+{
+    const std::vector<VkQueueFamilyProperties> &queueFamilies = deviceManager.getQueueFamilies();
+    if (!isSupported(kind) || queueFamilyIndex >= queueFamilies.size())
+    {
+        return nullptr;
+    }
+
+    VkQueryPipelineStatisticFlags statisticFlags = 0;
+    const VkQueueFlags queueFlags = queueFamilies[queueFamilyIndex].queueFlags;
+    if (kind == QueryKind::Occlusion)
+    {
+        if ((queueFlags & VK_QUEUE_GRAPHICS_BIT) == 0)
+        {
+            return nullptr;
+        }
+    }
+    else if (queueFlags & VK_QUEUE_GRAPHICS_BIT)
+    {
+        statisticFlags = kGraphicsStatisticFlags;
+    }
+    else if (queueFlags & VK_QUEUE_COMPUTE_BIT)
+    {
+        statisticFlags = kComputeStatisticFlags;
+    }
+    else
+    {
+        return nullptr;
+    }
+
+    QueryBlock *block = nullptr;
+    for (QueryBlock &candidate : queryBlocks)
+    {
+        if (candidate.state == QueryBlock::State::Free && candidate.kind == kind && candidate.statisticFlags == statisticFlags)
+        {
+            block = &candidate;
+            break;
+        }
+    }
+
+    if (block == nullptr)
+    {
+        // 先把已完成的块读出来腾出空位，仍然不够时才新建
+        resolveCompleted();
+        for (QueryBlock &candidate : queryBlocks)
+        {
+            if (candidate.state == QueryBlock::State::Free && candidate.kind == kind && candidate.statisticFlags == statisticFlags)
+            {
+                block = &candidate;
+                break;
+            }
+        }
+    }
+
+    if (block == nullptr)
+    {
+        if (queryBlocks.size() >= MAX_QUERY_BLOCKS)
+        {
+            return nullptr;
+        }
+
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = kind == QueryKind::Occlusion ? VK_QUERY_TYPE_OCCLUSION : VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        queryPoolInfo.queryCount = QUERIES_PER_BLOCK;
+        queryPoolInfo.pipelineStatistics = statisticFlags;
+
+        QueryBlock newBlock{};
+        if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &newBlock.queryPool) != VK_SUCCESS)
+        {
+            CFW_LOG_ERROR("ExecutorQueryPool: failed to create query pool!");
+            return nullptr;
+        }
+        newBlock.owner = this;
+        newBlock.kind = kind;
+        newBlock.statisticFlags = statisticFlags;
+        queryBlocks.push_back(std::move(newBlock));
+        block = &queryBlocks.back();
+    }
+
+    vkResetQueryPool(device, block->queryPool, 0, QUERIES_PER_BLOCK);
+    block->queueFamilyIndex = queueFamilyIndex;
+    block->usedQueries = 0;
+    block->labelCount = 0;
+    block->semaphore = VK_NULL_HANDLE;
+    block->signalValue = 0;
+    block->state = QueryBlock::State::Recording;
+    return block;
+}
+
+ExecutorQueryPool::ActiveQuery ExecutorQueryPool::beginQuery(VkCommandBuffer commandBuffer,
+                                                             std::vector<QueryBlock *> &blocks,
+                                                             QueryKind kind,
+                                                             uint32_t queueFamilyIndex,
+                                                             const char *name,
+                                                             uint32_t drawIndex,
+                                                             uint32_t queryCount)
+{
+    if (queryCount == 0 || queryCount > QUERIES_PER_BLOCK)
+    {
+        return {};
+    }
+
+    QueryBlock *block = nullptr;
+    for (auto it = blocks.rbegin(); it != blocks.rend(); ++it)
+    {
+        if ((*it)->kind == kind)
+        {
+            if ((*it)->usedQueries + queryCount <= QUERIES_PER_BLOCK)
+            {
+                block = *it;
+            }
+            break;
+        }
+    }
+
+    if (block == nullptr)
+    {
+        block = acquireBlock(kind, queueFamilyIndex);
+        if (block == nullptr)
+        {
+            return {};
+        }
+        blocks.push_back(block);
+    }
+
+    if (block->labels.size() <= block->labelCount)
+    {
+        block->labels.emplace_back();
+    }
+    QueryLabel &label = block->labels[block->labelCount++];
+    label.name.assign(name);
+    label.drawIndex = drawIndex;
+    label.firstQuery = block->usedQueries;
+    label.queryCount = queryCount;
+    block->usedQueries += queryCount;
+
+    const VkQueryControlFlags controlFlags = kind == QueryKind::Occlusion && preciseOcclusion ? VK_QUERY_CONTROL_PRECISE_BIT : 0;
+    vkCmdBeginQuery(commandBuffer, block->queryPool, label.firstQuery, controlFlags);
+    return {block, label.firstQuery};
+}
+
+void ExecutorQueryPool::endQuery(VkCommandBuffer commandBuffer, const ActiveQuery &query)
+{
+    if (query.block != nullptr)
+    {
+        vkCmdEndQuery(commandBuffer, query.block->queryPool, query.firstQuery);
+    }
+}
+
+void ExecutorQueryPool::submitBlock(QueryBlock &block, VkSemaphore semaphore, uint64_t signalValue)
+{
+    block.semaphore = semaphore;
+    block.signalValue = signalValue;
+    block.state = block.labelCount > 0 ? QueryBlock::State::Submitted : QueryBlock::State::Free;
+}
+
+void ExecutorQueryPool::releaseBlock(QueryBlock &block)
+{
+    block.state = QueryBlock::State::Free;
+}
+
+void ExecutorQueryPool::resolveCompleted()
+{
+    TimelineValueCache &timelineValueCache = deviceManager.getTimelineValueCache();
+
+    for (QueryBlock &block : queryBlocks)
+    {
+        if (block.state != QueryBlock::State::Submitted ||
+            !timelineValueCache.isReached(block.semaphore, block.signalValue))
+        {
+            continue;
+        }
+
+        const uint32_t valuesPerQuery = block.kind == QueryKind::Occlusion ? 1u : static_cast<uint32_t>(std::popcount(block.statisticFlags));
+        queryResults.resize(static_cast<size_t>(block.usedQueries) * valuesPerQuery);
+        const VkResult result = vkGetQueryPoolResults(device,
+                                                      block.queryPool,
+                                                      0,
+                                                      block.usedQueries,
+                                                      queryResults.size() * sizeof(uint64_t),
+                                                      queryResults.data(),
+                                                      valuesPerQuery * sizeof(uint64_t),
+                                                      VK_QUERY_RESULT_64_BIT);
+        if (result == VK_NOT_READY)
+        {
+            continue;
+        }
+        block.state = QueryBlock::State::Free;
+
+        if (result != VK_SUCCESS)
+        {
+            CFW_LOG_WARNING("ExecutorQueryPool: failed to read query results!");
+            continue;
+        }
+
+        for (uint32_t labelIndex = 0; labelIndex < block.labelCount; ++labelIndex)
+        {
+            const QueryLabel &label = block.labels[labelIndex];
+            const uint64_t *values = queryResults.data() + static_cast<size_t>(label.firstQuery) * valuesPerQuery;
+
+            if (block.kind == QueryKind::Occlusion)
+            {
+                if (completedOcclusion.size() >= MAX_PENDING_RESULTS)
+                {
+                    continue;
+                }
+
+                // 多视图时实现可能把总数写在第一个查询、其余写 0，也可能分视图写入，求和两种情况都正确
+                HardwareOcclusionResult occlusionResult;
+                occlusionResult.name = label.name;
+                occlusionResult.drawIndex = label.drawIndex;
+                for (uint32_t view = 0; view < label.queryCount; ++view)
+                {
+                    occlusionResult.samplesPassed += values[view];
+                }
+                completedOcclusion.push_back(std::move(occlusionResult));
+            }
+            else
+            {
+                if (completedStatistics.size() >= MAX_PENDING_RESULTS)
+                {
+                    continue;
+                }
+
+                HardwarePipelineStatistics statistics;
+                statistics.name = label.name;
+                if (block.statisticFlags == kGraphicsStatisticFlags)
+                {
+                    statistics.vertexShaderInvocations = values[0];
+                    statistics.fragmentShaderInvocations = values[1];
+                    statistics.computeShaderInvocations = values[2];
+                }
+                else
+                {
+                    statistics.computeShaderInvocations = values[0];
+                }
+                completedStatistics.push_back(std::move(statistics));
+            }
+        }
+    }
+}
+
+void ExecutorQueryPool::takeResults(std::vector<HardwarePipelineStatistics> &statistics, std::vector<HardwareOcclusionResult> &occlusion)
+{
+    resolveCompleted();
+
+    statistics.insert(statistics.end(),
+                      std::make_move_iterator(completedStatistics.begin()),
+                      std::make_move_iterator(completedStatistics.end()));
+    occlusion.insert(occlusion.end(),
+                     std::make_move_iterator(completedOcclusion.begin()),
+                     std::make_move_iterator(completedOcclusion.end()));
+    completedStatistics.clear();
+    completedOcclusion.clear();
+}
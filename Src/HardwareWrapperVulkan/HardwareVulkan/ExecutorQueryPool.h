@@ -0,0 +1,102 @@
+﻿#pragma once
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "CabbageHardware.h"
+#include "HardwareWrapperVulkan/HardwareUtilsVulkan.h"
+
+class DeviceManager;
+
+// ========== 执行器私有的管线统计/遮挡查询池 ==========
+// 查询块在主机侧重置（hostQueryReset），因此渲染通道内也能随时换用新块；
+// 块随命令缓冲一起提交，timeline 达到后才读取结果，读取永不等待 GPU
+struct ExecutorQueryPool
+{
+    enum class QueryKind : uint8_t
+    {
+        PipelineStatistics,
+        Occlusion
+    };
+
+    static constexpr uint32_t QUERIES_PER_BLOCK = 64;
+    static constexpr size_t MAX_QUERY_BLOCKS = 256;
+    static constexpr size_t MAX_PENDING_RESULTS = 1u << 16;
+
+    struct QueryLabel
+    {
+        std::string name;
+        uint32_t drawIndex{0};
+        uint32_t firstQuery{0};
+        uint32_t queryCount{0}; // 多视图渲染通道内一个查询占用 viewCount 个连续索引
+    };
+
+    struct QueryBlock
+    {
+        enum class State : uint8_t
+        {
+            Free,
+            Recording,
+            Submitted
+        };
+
+        ExecutorQueryPool *owner{nullptr};
+        QueryKind kind{QueryKind::PipelineStatistics};
+        VkQueryPool queryPool{VK_NULL_HANDLE};
+        uint32_t queueFamilyIndex{0};
+        VkQueryPipelineStatisticFlags statisticFlags{0};
+        uint32_t usedQueries{0};
+        uint32_t labelCount{0};
+        std::vector<QueryLabel> labels; // 容量跨轮次复用
+        VkSemaphore semaphore{VK_NULL_HANDLE};
+        uint64_t signalValue{0};
+        State state{State::Free};
+    };
+
+    // 正在进行的查询；block 为空表示未开始（未启用、队列族不支持或查询块耗尽）
+    struct ActiveQuery
+    {
+        QueryBlock *block{nullptr};
+        uint32_t firstQuery{0};
+    };
+
+    explicit ExecutorQueryPool(DeviceManager &deviceManager);
+    ~ExecutorQueryPool();
+
+    ExecutorQueryPool(const ExecutorQueryPool &) = delete;
+    ExecutorQueryPool &operator=(const ExecutorQueryPool &) = delete;
+
+    [[nodiscard]] bool isSupported(QueryKind kind) const;
+
+    // 在 blocks 中最后一个同类且有空位的块上开始查询，没有时取一个新块追加到 blocks
+    ActiveQuery beginQuery(VkCommandBuffer commandBuffer,
+                           std::vector<QueryBlock *> &blocks,
+                           QueryKind kind,
+                           uint32_t queueFamilyIndex,
+                           const char *name,
+                           uint32_t drawIndex,
+                           uint32_t queryCount = 1);
+    void endQuery(VkCommandBuffer commandBuffer, const ActiveQuery &query);
+
+    void submitBlock(QueryBlock &block, VkSemaphore semaphore, uint64_t signalValue);
+    void releaseBlock(QueryBlock &block);
+
+    // 读取已完成块的结果并追加到输出，不阻塞；仍在 GPU 上执行的留到下次
+    void takeResults(std::vector<HardwarePipelineStatistics> &statistics, std::vector<HardwareOcclusionResult> &occlusion);
+
+  private:
+    QueryBlock *acquireBlock(QueryKind kind, uint32_t queueFamilyIndex);
+    void resolveCompleted();
+
+    DeviceManager &deviceManager;
+    VkDevice device{VK_NULL_HANDLE};
+    bool hostQueryReset{false};
+    bool statisticsQuery{false};
+    bool preciseOcclusion{false};
+
+    std::deque<QueryBlock> queryBlocks; // deque 保证扩容时已发出的指针不失效
+    std::vector<uint64_t> queryResults; // 读取查询结果的暂存，跨轮次复用
+    std::vector<HardwarePipelineStatistics> completedStatistics;
+    std::vector<HardwareOcclusionResult> completedOcclusion;
+};
@@ -0,0 +1,351 @@
+﻿#include "GpuProfilerVulkan.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+#include "DeviceManager.h"
+#include "corona/kernel/core/i_logger.h"
+
+namespace
+{
+std::atomic_bool profilerEnabled{false};
+
+void writeJsonString(std::ostream &out, const std::string &text)
+{
+    out << '"';
+    for (const char c : text)
+    {
+        switch (c)
+        {
+        case '"':
+            out << "\\\"";
+            break;
+        case '\\':
+            out << "\\\\";
+            break;
+        case '\n':
+            out << "\\n";
+            break;
+        case '\t':
+            out << "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                out << ' ';
+            }
+            else
+            {
+                out << c;
+            }
+            break;
+        }
+    }
+    out << '"';
+}
+} // namespace
+
+GpuProfilerVulkan::GpuProfilerVulkan(DeviceManager &deviceManager)
+    : deviceManager(deviceManager), device(deviceManager.getLogicalDevice())
+{
+    const VkPhysicalDeviceLimits &limits = deviceManager.getFeaturesUtils().supportedProperties.properties.limits;
+    timestampPeriodNs = static_cast<double>(limits.timestampPeriod);
+
+    for (const VkQueueFamilyProperties &queueFamily : deviceManager.getQueueFamilies())
+    {
+        const uint32_t validBits = queueFamily.timestampValidBits;
+        timestampMasks.push_back(validBits == 0 ? 0 : (validBits >= 64 ? UINT64_MAX : (uint64_t{1} << validBits) - 1));
+    }
+}
+
+GpuProfilerVulkan::~GpuProfilerVulkan()
+{
+    // 设备清理时已 vkDeviceWaitIdle，查询池不再被 GPU 使用
+    for (QueryBlock &block : queryBlocks)
+    {
+        if (block.queryPool != VK_NULL_HANDLE)
+        {
+            vkDestroyQueryPool(device, block.queryPool, nullptr);
+            block.queryPool = VK_NULL_HANDLE;
+        }
+    }
+    queryBlocks.clear();
+}
+
+void GpuProfilerVulkan::setEnabled(bool enable)
+{
+    profilerEnabled.store(enable, std::memory_order_relaxed);
+}
+
+bool GpuProfilerVulkan::isEnabled()
+{
+    return profilerEnabled.load(std::memory_order_relaxed);
+}
+
+uint64_t GpuProfilerVulkan::hostNowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+
+std::string GpuProfilerVulkan::makeDebugName(const char *kind, const std::source_location &sourceLocation)
+{
+    std::string fileName = sourceLocation.file_name();
+    if (const size_t separator = fileName.find_last_of("/\\"); separator != std::string::npos)
+    {
+        fileName.erase(0, separator + 1);
+    }
+    return std::string(kind) + " " + fileName + ":" + std::to_string(sourceLocation.line());
+}
+
+GpuProfilerVulkan::QueryBlock *GpuProfilerVulkan::beginBlock(VkCommandBuffer commandBuffer, uint32_t queueFamilyIndex)
+{
+    if (queueFamilyIndex >= timestampMasks.size() || timestampMasks[queueFamilyIndex] == 0)
+    {
+        return nullptr;
+    }
+
+    QueryBlock *block = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(profilerMutex);
+        resolveCompletedLocked();
+
+        for (QueryBlock &candidate : queryBlocks)
+        {
+            if (candidate.state == QueryBlock::State::Free)
+            {
+                block = &candidate;
+                break;
+            }
+        }
+
+        if (block == nullptr)
+        {
+            if (queryBlocks.size() >= MAX_QUERY_BLOCKS)
+            {
+                return nullptr;
+            }
+
+            VkQueryPoolCreateInfo queryPoolInfo{};
+            queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            queryPoolInfo.queryCount = MAX_RECORDS_PER_BLOCK * 2;
+
+            QueryBlock newBlock{};
+            if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &newBlock.queryPool) != VK_SUCCESS)
+            {
+                CFW_LOG_ERROR("GpuProfilerVulkan: failed to create timestamp query pool!");
+                return nullptr;
+            }
+            newBlock.profiler = this;
+            queryBlocks.push_back(std::move(newBlock));
+            block = &queryBlocks.back();
+        }
+
+        block->state = QueryBlock::State::Recording;
+    }
+
+    block->queueFamilyIndex = queueFamilyIndex;
+    block->recordCount = 0;
+    block->semaphore = VK_NULL_HANDLE;
+    block->signalValue = 0;
+
+    vkCmdResetQueryPool(commandBuffer, block->queryPool, 0, MAX_RECORDS_PER_BLOCK * 2);
+    return block;
+}
+
+uint32_t GpuProfilerVulkan::writeRecordBegin(VkCommandBuffer commandBuffer, QueryBlock &block, const char *name)
+{
+    if (block.recordCount >= MAX_RECORDS_PER_BLOCK)
+    {
+        return UINT32_MAX;
+    }
+
+    const uint32_t recordIndex = block.recordCount++;
+    if (block.recordNames.size() <= recordIndex)
+    {
+        block.recordNames.emplace_back();
+    }
+    block.recordNames[recordIndex].assign(name);
+
+    vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, block.queryPool, recordIndex * 2);
+    return recordIndex;
+}
+
+void GpuProfilerVulkan::writeRecordEnd(VkCommandBuffer commandBuffer, QueryBlock &block, uint32_t recordIndex)
+{
+    vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, block.queryPool, recordIndex * 2 + 1);
+}
+
+void GpuProfilerVulkan::submitBlock(QueryBlock &block, VkSemaphore semaphore, uint64_t signalValue)
+{
+    std::lock_guard<std::mutex> lock(profilerMutex);
+    block.semaphore = semaphore;
+    block.signalValue = signalValue;
+    block.submitHostNs = hostNowNs();
+    block.state = block.recordCount > 0 ? QueryBlock::State::Submitted : QueryBlock::State::Free;
+}
+
+void GpuProfilerVulkan::releaseBlock(QueryBlock &block)
+{
+    std::lock_guard<std::mutex> lock(profilerMutex);
+    block.state = QueryBlock::State::Free;
+}
+
+void GpuProfilerVulkan::addCpuSpan(const char *name, uint64_t beginNs, uint64_t endNs)
+{
+    TraceEvent event;
+    event.name = name;
+    event.beginNs = beginNs;
+    event.durationNs = endNs > beginNs ? endNs - beginNs : 0;
+    event.track = static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    event.gpu = false;
+
+    std::lock_guard<std::mutex> lock(profilerMutex);
+    pushEventLocked(std::move(event));
+}
+
+void GpuProfilerVulkan::resolveCompleted()
+{
+    std::lock_guard<std::mutex> lock(profilerMutex);
+    resolveCompletedLocked();
+}
+
+void GpuProfilerVulkan::resolveCompletedLocked()
+{
+    TimelineValueCache &timelineValueCache = deviceManager.getTimelineValueCache();
+
+    for (QueryBlock &block : queryBlocks)
+    {
+        if (block.state != QueryBlock::State::Submitted ||
+            !timelineValueCache.isReached(block.semaphore, block.signalValue))
+        {
+            continue;
+        }
+
+        const uint32_t queryCount = block.recordCount * 2;
+        queryResults.resize(queryCount);
+        const VkResult result = vkGetQueryPoolResults(device,
+                                                      block.queryPool,
+                                                      0,
+                                                      queryCount,
+                                                      queryCount * sizeof(uint64_t),
+                                                      queryResults.data(),
+                                                      sizeof(uint64_t),
+                                                      VK_QUERY_RESULT_64_BIT);
+        if (result == VK_NOT_READY)
+        {
+            continue;
+        }
+
+        if (result == VK_SUCCESS)
+        {
+            const uint64_t mask = timestampMasks[block.queueFamilyIndex];
+            const auto toNs = [this, mask](uint64_t ticks) {
+                return static_cast<uint64_t>(static_cast<double>(ticks & mask) * timestampPeriodNs);
+            };
+
+            // GPU 开始执行不早于提交：据此收紧偏移下界，事件在导出时统一换算到主机时钟
+            const int64_t offsetBound = static_cast<int64_t>(block.submitHostNs) - static_cast<int64_t>(toNs(queryResults[0]));
+            gpuToHostOffsetNs = std::max(gpuToHostOffsetNs, offsetBound);
+
+            for (uint32_t i = 0; i < block.recordCount; ++i)
+            {
+                const uint64_t beginNs = toNs(queryResults[i * 2]);
+                const uint64_t endNs = toNs(queryResults[i * 2 + 1]);
+
+                TraceEvent event;
+                event.name = block.recordNames[i];
+                event.beginNs = beginNs;
+                event.durationNs = endNs > beginNs ? endNs - beginNs : 0;
+                event.track = block.queueFamilyIndex;
+                event.gpu = true;
+                pushEventLocked(std::move(event));
+            }
+        }
+        else
+        {
+            CFW_LOG_WARNING("GpuProfilerVulkan: failed to read timestamp queries!");
+        }
+
+        block.state = QueryBlock::State::Free;
+    }
+}
+
+void GpuProfilerVulkan::pushEventLocked(TraceEvent &&event)
+{
+    if (events.size() >= MAX_PENDING_EVENTS)
+    {
+        droppedEvents.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    events.push_back(std::move(event));
+}
+
+void GpuProfilerVulkan::takeEvents(std::vector<TraceEvent> &outEvents)
+{
+    std::lock_guard<std::mutex> lock(profilerMutex);
+    resolveCompletedLocked();
+
+    const int64_t offsetNs = gpuToHostOffsetNs == INT64_MIN ? 0 : gpuToHostOffsetNs;
+    for (TraceEvent &event : events)
+    {
+        if (event.gpu)
+        {
+            event.beginNs = static_cast<uint64_t>(static_cast<int64_t>(event.beginNs) + offsetNs);
+        }
+        outEvents.push_back(std::move(event));
+    }
+    events.clear();
+}
+
+void GpuProfilerVulkan::writeChromeTraceEvents(std::ostream &out, uint32_t processId, const std::vector<TraceEvent> &events, bool &firstEvent)
+{
+    const auto separator = [&out, &firstEvent]() {
+        if (!firstEvent)
+        {
+            out << ",\n";
+        }
+        firstEvent = false;
+    };
+
+    // 轨道命名：GPU 事件按队列族分轨，与 CPU 线程区分开
+    std::vector<uint32_t> gpuTracks;
+    for (const TraceEvent &event : events)
+    {
+        if (event.gpu && std::find(gpuTracks.begin(), gpuTracks.end(), event.track) == gpuTracks.end())
+        {
+            gpuTracks.push_back(event.track);
+        }
+    }
+
+    separator();
+    out << R"({"name":"process_name","ph":"M","pid":)" << processId << R"(,"args":{"name":"Device )" << processId << "\"}}";
+    for (const uint32_t track : gpuTracks)
+    {
+        separator();
+        out << R"({"name":"thread_name","ph":"M","pid":)" << processId << R"(,"tid":"gpu)" << track
+            << R"(","args":{"name":"GPU queue family )" << track << "\"}}";
+    }
+
+    for (const TraceEvent &event : events)
+    {
+        separator();
+        out << R"({"name":)";
+        writeJsonString(out, event.name);
+        out << R"(,"cat":")" << (event.gpu ? "gpu" : "cpu") << R"(","ph":"X","ts":)" << static_cast<double>(event.beginNs) / 1000.0
+            << R"(,"dur":)" << static_cast<double>(event.durationNs) / 1000.0 << R"(,"pid":)" << processId << R"(,"tid":)";
+        if (event.gpu)
+        {
+            out << "\"gpu" << event.track << '"';
+        }
+        else
+        {
+            out << event.track;
+        }
+        out << '}';
+    }
+}
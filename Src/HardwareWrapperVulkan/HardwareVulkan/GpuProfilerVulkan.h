@@ -0,0 +1,113 @@
+﻿#pragma once
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <source_location>
+#include <string>
+#include <vector>
+
+#include "HardwareWrapperVulkan/HardwareUtilsVulkan.h"
+
+class DeviceManager;
+
+// ========== 每设备一个的 GPU 时间戳分析器 ==========
+// 执行器录制时向命令缓冲借用一个查询块，在每条记录前后写入时间戳；提交后块携带 timeline 值，
+// 达到后才读取结果（不等待 GPU），换算为主机时间的事件，连同 CPU 侧的 commit 区间一起导出为 Chrome trace_event JSON。
+// 查询块循环复用，全部在飞行中时本次提交不计时而不是等待
+class GpuProfilerVulkan
+{
+  public:
+    static constexpr uint32_t MAX_RECORDS_PER_BLOCK = 64;
+    static constexpr size_t MAX_QUERY_BLOCKS = 64;
+    static constexpr size_t MAX_PENDING_EVENTS = 1u << 20;
+
+    struct QueryBlock
+    {
+        enum class State : uint8_t
+        {
+            Free,
+            Recording,
+            Submitted
+        };
+
+        GpuProfilerVulkan *profiler{nullptr};
+        VkQueryPool queryPool{VK_NULL_HANDLE};
+        uint32_t queueFamilyIndex{0};
+        uint32_t recordCount{0};
+        std::vector<std::string> recordNames; // 容量跨轮次复用
+        VkSemaphore semaphore{VK_NULL_HANDLE};
+        uint64_t signalValue{0};
+        uint64_t submitHostNs{0};
+        State state{State::Free};
+    };
+
+    struct TraceEvent
+    {
+        std::string name;
+        uint64_t beginNs{0};    // 主机 steady_clock 时间
+        uint64_t durationNs{0};
+        uint32_t track{0};      // GPU 事件为队列族索引，CPU 事件为线程编号
+        bool gpu{false};
+    };
+
+    explicit GpuProfilerVulkan(DeviceManager &deviceManager);
+    ~GpuProfilerVulkan();
+
+    GpuProfilerVulkan(const GpuProfilerVulkan &) = delete;
+    GpuProfilerVulkan &operator=(const GpuProfilerVulkan &) = delete;
+
+    // 全局开关，关闭时执行器不借用查询块，也不记录 CPU 区间
+    static void setEnabled(bool enable);
+    [[nodiscard]] static bool isEnabled();
+    [[nodiscard]] static uint64_t hostNowNs();
+
+    // 形如 "ComputePipeline main.cpp:42"，用作记录的默认调试名
+    [[nodiscard]] static std::string makeDebugName(const char *kind, const std::source_location &sourceLocation);
+
+    // 在命令缓冲开头重置一个查询块并返回；队列族不支持时间戳或查询块耗尽时返回 nullptr
+    QueryBlock *beginBlock(VkCommandBuffer commandBuffer, uint32_t queueFamilyIndex);
+
+    // 在记录前写入开始时间戳，返回记录在块内的序号；块已满时返回 UINT32_MAX，此记录不计时
+    uint32_t writeRecordBegin(VkCommandBuffer commandBuffer, QueryBlock &block, const char *name);
+    void writeRecordEnd(VkCommandBuffer commandBuffer, QueryBlock &block, uint32_t recordIndex);
+
+    // 命令缓冲已提交：timeline 达到 signalValue 后结果可读
+    void submitBlock(QueryBlock &block, VkSemaphore semaphore, uint64_t signalValue);
+    // 命令缓冲未能提交，查询块直接归还
+    void releaseBlock(QueryBlock &block);
+
+    void addCpuSpan(const char *name, uint64_t beginNs, uint64_t endNs);
+
+    // 读取已完成查询块的结果并转换为事件，不阻塞
+    void resolveCompleted();
+
+    // 解析后把累积的事件追加到 events 并清空内部缓存
+    void takeEvents(std::vector<TraceEvent> &events);
+
+    [[nodiscard]] uint64_t getDroppedEventCount() const
+    {
+        return droppedEvents.load(std::memory_order_relaxed);
+    }
+
+    // 把事件写为 trace_event 数组元素（调用方负责外层的 "traceEvents" 数组），processId 区分设备
+    static void writeChromeTraceEvents(std::ostream &out, uint32_t processId, const std::vector<TraceEvent> &events, bool &firstEvent);
+
+  private:
+    void resolveCompletedLocked();
+    void pushEventLocked(TraceEvent &&event);
+
+    DeviceManager &deviceManager;
+    VkDevice device{VK_NULL_HANDLE};
+    double timestampPeriodNs{1.0};
+    std::vector<uint64_t> timestampMasks; // 按队列族，0 表示不支持时间戳
+
+    std::mutex profilerMutex;
+    std::deque<QueryBlock> queryBlocks;
+    std::vector<TraceEvent> events;
+    std::vector<uint64_t> queryResults; // 读取查询结果的暂存，跨轮次复用
+    // GPU 时钟到主机时钟的偏移下界：GPU 开始执行不会早于提交，取所有块 (提交时刻 - 首个时间戳) 的最大值
+    int64_t gpuToHostOffsetNs{INT64_MIN};
+    std::atomic_uint64_t droppedEvents{0};
+};
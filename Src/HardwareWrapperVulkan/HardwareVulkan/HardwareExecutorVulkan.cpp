@@ -1,24 +1,19 @@
 ﻿#include "HardwareExecutorVulkan.h"
+#include "SubmitThreadVulkan.h"
+#include "CompletionWaiterVulkan.h"
 
 #include "corona/kernel/core/i_logger.h"
 #include <algorithm>
-
-struct GraphicsSubmitChainState
-{
-    VkSemaphore semaphore{VK_NULL_HANDLE};
-    uint64_t value{0};
-};
-
-std::mutex gGraphicsSubmitChainMutex;
-std::unordered_map<VkDevice, GraphicsSubmitChainState> gGraphicsSubmitChains;
-
-std::vector<VkSemaphoreSubmitInfo> mergeSemaphoreSubmitInfos(const std::vector<VkSemaphoreSubmitInfo> &infos)
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+
+// 合并同一 semaphore 的多个条目（取最大 value、合并 stageMask），结果写入 mergedInfos 复用其容量。
+// 每次提交涉及的 semaphore 只有寥寥几个，线性查找比哈希表更快且不分配内存
+static void mergeSemaphoreSubmitInfos(const std::vector<VkSemaphoreSubmitInfo> &infos,
+                                      std::vector<VkSemaphoreSubmitInfo> &mergedInfos)
 {
-    std::vector<VkSemaphoreSubmitInfo> mergedInfos;
-    mergedInfos.reserve(infos.size());
-
-    std::unordered_map<VkSemaphore, size_t> semaphoreToIndex;
-    semaphoreToIndex.reserve(infos.size());
+    mergedInfos.clear();
 
     for (const auto &info : infos)
     {
@@ -27,48 +22,297 @@ std::vector<VkSemaphoreSubmitInfo> mergeSemaphoreSubmitInfos(const std::vector<V
             continue;
         }
 
-        auto it = semaphoreToIndex.find(info.semaphore);
-        if (it == semaphoreToIndex.end())
+        auto it = std::find_if(mergedInfos.begin(), mergedInfos.end(), [&info](const VkSemaphoreSubmitInfo &merged) {
+            return merged.semaphore == info.semaphore;
+        });
+        if (it == mergedInfos.end())
         {
             VkSemaphoreSubmitInfo normalizedInfo = info;
             normalizedInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
             normalizedInfo.pNext = nullptr;
             mergedInfos.push_back(normalizedInfo);
-            semaphoreToIndex.emplace(info.semaphore, mergedInfos.size() - 1);
             continue;
         }
 
-        auto &dst = mergedInfos[it->second];
-        dst.value = std::max(dst.value, info.value);
-        dst.stageMask |= info.stageMask;
+        it->value = std::max(it->value, info.value);
+        it->stageMask |= info.stageMask;
     }
+}
+
+// 队列上尚未完成的提交数：已分配的最大 signal 值与已观察到的完成值之差。
+// 缓存值已追上时不查询驱动；semaphore 损坏或查询失败时返回 UINT64_MAX，调用方不应选择该队列
+static uint64_t queueOutstandingWork(DeviceManager::QueueUtils &queue)
+{
+    const uint64_t pendingValue = queue.timelineValue->load(std::memory_order_acquire);
+    TimelineValueCache &timelineValueCache = queue.deviceManager->getTimelineValueCache();
 
-    return mergedInfos;
+    uint64_t completedValue = timelineValueCache.cachedValue(queue.timelineSemaphore);
+    if (completedValue < pendingValue &&
+        (!timelineValueCache.refresh(queue.timelineSemaphore, completedValue) || completedValue == UINT64_MAX))
+    {
+        return UINT64_MAX;
+    }
+    return pendingValue > completedValue ? pendingValue - completedValue : 0;
 }
 
-// ========== 析构函数：等待所有延迟释放的资源完成 ==========
-HardwareExecutorVulkan::~HardwareExecutorVulkan()
+// queues 中（queueFamilyIndex 为 UINT32_MAX 时不限队列族）与期望优先级最接近的队列类别。
+// 设备上没有对应类别的队列时，实时与后台工作退回到最接近的类别，而不是与所有队列混用。
+// 普通工作与实时、后台距离相同：没有普通队列（队列族只有两个队列）时明确与后台工作共用，实时队列只留给实时工作
+static DeviceManager::QueuePriority closestQueuePriority(const std::vector<DeviceManager::QueueUtils> &queues,
+                                                         uint32_t queueFamilyIndex,
+                                                         DeviceManager::QueuePriority priority)
 {
-    // ========== Step 1: 收集所有需要等待的 semaphore 和对应的 timeline 值 ==========
-    std::vector<VkSemaphore> semaphoresToWait;
-    std::vector<uint64_t> valuesToWait;
+    DeviceManager::QueuePriority closestPriority = priority;
+    int closestDistance = INT_MAX;
+    bool hasBackground = false;
+    for (const auto &queue : queues)
+    {
+        if (queueFamilyIndex != UINT32_MAX && queue.queueFamilyIndex != queueFamilyIndex)
+        {
+            continue;
+        }
+        hasBackground = hasBackground || queue.priority == DeviceManager::QueuePriority::Background;
 
-    // 从 deferredReleaseQueue 中收集所有唯一的 semaphore 及其最大 timeline 值
-    std::unordered_map<VkSemaphore, uint64_t> semaphoreMaxValues;
+        const int distance = std::abs(static_cast<int>(queue.priority) - static_cast<int>(priority));
+        if (distance < closestDistance || (distance == closestDistance && queue.priority < closestPriority))
+        {
+            closestPriority = queue.priority;
+            closestDistance = distance;
+        }
+    }
+
+    if (priority == DeviceManager::QueuePriority::Normal && closestDistance != 0 && hasBackground)
+    {
+        return DeviceManager::QueuePriority::Background;
+    }
+    return closestPriority;
+}
+
+DeviceManager::QueueUtils *lockQueueOfFamily(std::atomic_uint16_t &currentQueueIndex,
+                                             std::vector<DeviceManager::QueueUtils> &currentQueues,
+                                             uint32_t queueFamilyIndex,
+                                             DeviceManager::QueuePriority priority,
+                                             QueueLockWait *lockWait)
+{
+    DeviceManager::QueueUtils *leastLoadedQueue = nullptr;
+    uint64_t leastLoad = UINT64_MAX;
+    const size_t queueCount = currentQueues.size();
+    const uint16_t startIndex = currentQueueIndex.fetch_add(1);
+    const DeviceManager::QueuePriority queuePriority = closestQueuePriority(currentQueues, queueFamilyIndex, priority);
+
+    // 实时队列每个队列族只有一个，所有实时执行器都落在它上面：它忙碌时同样考虑普通队列，
+    // 空闲的普通队列优先于排队等待实时队列，负载相同时仍选实时队列
+    const bool normalFallback = queuePriority == DeviceManager::QueuePriority::Realtime;
+
+    // 优先选择没有未完成提交且锁空闲的队列；否则阻塞在未完成提交最少的队列上（锁只覆盖提交本身，持有时间很短）。
+    // 轮询起点只用于在负载相同的队列之间分摊
+    for (int pass = 0; pass < (normalFallback ? 2 : 1); ++pass)
+    {
+        const DeviceManager::QueuePriority passPriority = pass == 0 ? queuePriority : DeviceManager::QueuePriority::Normal;
+        for (size_t i = 0; i < queueCount; ++i)
+        {
+            DeviceManager::QueueUtils *candidate = &currentQueues[(startIndex + i) % queueCount];
+            if (candidate->queueFamilyIndex != queueFamilyIndex || candidate->priority != passPriority)
+            {
+                continue;
+            }
+
+            // semaphore 损坏的队列不可用：阻塞在它上面的提交永远无法完成
+            const uint64_t load = queueOutstandingWork(*candidate);
+            if (load == UINT64_MAX)
+            {
+                continue;
+            }
+            if (load == 0 && candidate->queueMutex->try_lock())
+            {
+                if (lockWait != nullptr)
+                {
+                    *lockWait = {};
+                }
+                return candidate;
+            }
+            if (leastLoadedQueue == nullptr || load < leastLoad)
+            {
+                leastLoadedQueue = candidate;
+                leastLoad = load;
+            }
+        }
+    }
+
+    if (leastLoadedQueue == nullptr)
+    {
+        CFW_LOG_ERROR("[lockQueueOfFamily] No usable queue in queue family {}", queueFamilyIndex);
+        return nullptr;
+    }
+
+    const uint64_t lockBeginNs = lockWait != nullptr ? CommitLatencyStatsVulkan::nowNs() : 0;
+    leastLoadedQueue->queueMutex->lock();
+    if (lockWait != nullptr)
+    {
+        lockWait->blocked = true;
+        lockWait->waitNs = CommitLatencyStatsVulkan::nowNs() - lockBeginNs;
+    }
+    return leastLoadedQueue;
+}
+
+bool prepareSubmitSemaphores(TimelineValueCache &timelineValueCache,
+                             const std::vector<VkSemaphoreSubmitInfo> &waitSemaphores,
+                             const std::vector<VkSemaphoreSubmitInfo> &signalSemaphores,
+                             std::vector<VkSemaphoreSubmitInfo> &mergedWaitSemaphores,
+                             std::vector<VkSemaphoreSubmitInfo> &mergedSignalSemaphores)
+{
+    mergeSemaphoreSubmitInfos(waitSemaphores, mergedWaitSemaphores);
+    mergeSemaphoreSubmitInfos(signalSemaphores, mergedSignalSemaphores);
 
-    for (const auto &entry : deferredReleaseQueue)
+    // timeline semaphore 在同一次 submit 中 wait+signal 时，signal value 必须严格大于 wait value。
+    // binary semaphore 的 value 固定为 0，这里通过 value==0 直接跳过。
+    for (auto &signalSem : mergedSignalSemaphores)
     {
-        auto it = semaphoreMaxValues.find(entry.semaphore);
-        if (it == semaphoreMaxValues.end())
+        if (signalSem.value == 0)
         {
-            semaphoreMaxValues[entry.semaphore] = entry.timelineValue;
+            continue;
         }
-        else
+
+        auto it = std::find_if(mergedWaitSemaphores.begin(), mergedWaitSemaphores.end(), [&signalSem](const VkSemaphoreSubmitInfo &waitSem) {
+            return waitSem.semaphore == signalSem.semaphore;
+        });
+        if (it != mergedWaitSemaphores.end() && signalSem.value <= it->value)
+        {
+            signalSem.value = it->value + 1;
+        }
+    }
+
+    // ===== 修复4: Semaphore 值验证 =====
+    // 在提交前验证所有 timeline semaphore 的当前值是否有效
+    // 如果 semaphore 值为 UINT64_MAX，说明 semaphore 已损坏或设备丢失
+    // 缓存中已确认达到的等待直接剔除，既不查询驱动也不交给队列
+    bool semaphoreValid = true;
+    size_t keptCount = 0;
+    for (size_t i = 0; i < mergedWaitSemaphores.size(); ++i)
+    {
+        const VkSemaphoreSubmitInfo &waitSem = mergedWaitSemaphores[i];
+
+        // 跳过 Binary Semaphore（Binary Semaphore 的 value 固定为 0）
+        if (waitSem.value == 0 || waitSem.semaphore == VK_NULL_HANDLE)
+        {
+            mergedWaitSemaphores[keptCount++] = waitSem;
+            continue;
+        }
+
+        if (timelineValueCache.cachedValue(waitSem.semaphore) >= waitSem.value)
+        {
+            continue;
+        }
+
+        uint64_t currentValue = 0;
+        if (!timelineValueCache.refresh(waitSem.semaphore, currentValue))
+        {
+            CFW_LOG_ERROR("[commit] Failed to query semaphore counter value");
+            semaphoreValid = false;
+            break;
+        }
+
+        // 检查 semaphore 值是否为无效的 UINT64_MAX
+        if (currentValue == UINT64_MAX)
+        {
+            CFW_LOG_ERROR("[commit] Timeline semaphore {} has invalid value UINT64_MAX, device may be lost!",
+                          reinterpret_cast<uintptr_t>(waitSem.semaphore));
+            semaphoreValid = false;
+            break;
+        }
+
+        if (currentValue >= waitSem.value)
+        {
+            continue;
+        }
+
+        // 检查等待值是否超出合理范围（maxTimelineSemaphoreValueDifference 通常是 UINT64_MAX）
+        // 但如果当前值和期望等待值差距过大，可能存在逻辑错误
+        if (waitSem.value - currentValue > 10000)
+        {
+            CFW_LOG_WARNING("[commit] Semaphore wait value {} is far ahead of current value {}, potential sync issue",
+                            waitSem.value, currentValue);
+        }
+
+        mergedWaitSemaphores[keptCount++] = waitSem;
+    }
+
+    if (semaphoreValid)
+    {
+        mergedWaitSemaphores.resize(keptCount);
+    }
+
+    return semaphoreValid;
+}
+
+// ========== 延迟释放环 ==========
+void DeferredReleaseRing::push(DeferredRelease &&entry)
+{
+    if (count == slots.size())
+    {
+        // 扩容为 2 的幂，按 FIFO 顺序把现有条目搬到新数组开头
+        std::vector<DeferredRelease> grown(std::max<size_t>(16, slots.size() * 2));
+        for (size_t i = 0; i < count; ++i)
         {
-            // 取最大值，确保等待所有工作完成
-            it->second = std::max(it->second, entry.timelineValue);
+            grown[i] = std::move(slots[(head + i) & (slots.size() - 1)]);
         }
+        slots.swap(grown);
+        head = 0;
+    }
+
+    newestValue = std::max(newestValue, entry.timelineValue);
+    slots[(head + count) & (slots.size() - 1)] = std::move(entry);
+    ++count;
+    HardwareMetricsVulkan::get().addDeferredRelease();
+}
+
+void HardwareExecutorVulkan::deferRelease(VkSemaphore semaphore, uint64_t timelineValue, std::shared_ptr<CopyCommandImpl> resource)
+{
+    // semaphore 只有各队列的 timeline，数量很少，线性查找即可
+    auto ringIt = std::find_if(deferredReleaseRings.begin(), deferredReleaseRings.end(), [semaphore](const DeferredReleaseRing &ring) {
+        return ring.semaphore == semaphore;
+    });
+    if (ringIt == deferredReleaseRings.end())
+    {
+        deferredReleaseRings.emplace_back();
+        ringIt = std::prev(deferredReleaseRings.end());
+        ringIt->semaphore = semaphore;
+    }
+
+    ringIt->push({timelineValue, std::move(resource), semaphore});
+}
+
+HardwareExecutorVulkan::HardwareExecutorVulkan(const HardwareExecutorVulkan &other)
+    : currentRecordQueue(other.currentRecordQueue),
+      lastSignalValue(other.lastSignalValue),
+      lastSubmissions(other.lastSubmissions),
+      hardwareContext(other.hardwareContext),
+      latencyStats(other.latencyStats),
+      submitThread(other.submitThread),
+      priority(other.priority)
+{
+    // 不共享 other 的命令池：池不加锁，两个执行器可能在不同线程上同时录制
+    pendingResources.reserve(32);
+    submitPendingResources.reserve(32);
+    deferredReleaseRings.reserve(8);
+    commandList.reserve(32);
+}
+
+ExecutorCommandPool &HardwareExecutorVulkan::ensureCommandPool()
+{
+    if (!commandPool)
+    {
+        commandPool = std::make_shared<ExecutorCommandPool>(hardwareContext->deviceManager.getLogicalDevice(),
+                                                            hardwareContext->deviceManager.getTimelineValueCache());
     }
+    return *commandPool;
+}
+
+// ========== 析构函数：等待所有延迟释放的资源完成 ==========
+HardwareExecutorVulkan::~HardwareExecutorVulkan()
+{
+    // 回收仍在提交线程中的批次，其资源随之进入 deferredReleaseRings
+    resolveAsyncSubmit();
 
     // 如果有 pendingResources 但还未提交，需要考虑当前队列
     // 注意：正常流程中 pendingResources 应该在 commit 后为空
@@ -80,14 +324,20 @@ HardwareExecutorVulkan::~HardwareExecutorVulkan()
         pendingResources.clear();
     }
 
-    // ========== Step 2: 构建等待参数 ==========
-    for (const auto &[semaphore, maxValue] : semaphoreMaxValues)
+    // ========== Step 1: 每个环等待其最大的 timeline 值 ==========
+    std::vector<VkSemaphore> semaphoresToWait;
+    std::vector<uint64_t> valuesToWait;
+
+    for (const auto &ring : deferredReleaseRings)
     {
-        semaphoresToWait.push_back(semaphore);
-        valuesToWait.push_back(maxValue);
+        if (!ring.empty())
+        {
+            semaphoresToWait.push_back(ring.semaphore);
+            valuesToWait.push_back(ring.newestValue);
+        }
     }
 
-    // ========== Step 3: 等待所有 semaphore ==========
+    // ========== Step 2: 等待所有 semaphore ==========
     if (!semaphoresToWait.empty() && hardwareContext)
     {
         VkSemaphoreWaitInfo waitInfo{};
@@ -118,129 +368,104 @@ HardwareExecutorVulkan::~HardwareExecutorVulkan()
         }
         else
         {
+            TimelineValueCache &timelineValueCache = hardwareContext->deviceManager.getTimelineValueCache();
+            for (size_t i = 0; i < semaphoresToWait.size(); ++i)
+            {
+                timelineValueCache.observe(semaphoresToWait[i], valuesToWait[i]);
+            }
             CFW_LOG_TRACE("HardwareExecutorVulkan destructor: successfully waited for {} semaphores",
                           semaphoresToWait.size());
         }
     }
 
-    // ========== Step 4: 清空队列（此时 GPU 已完成，安全释放） ==========
-    deferredReleaseQueue.clear();
+    // ========== Step 3: 清空所有环（此时 GPU 已完成，安全释放） ==========
+    for (auto &ring : deferredReleaseRings)
+    {
+        ring.clear();
+    }
+    deferredReleaseRings.clear();
 }
 
 // ========== 清理已完成的资源（非阻塞） ==========
 void HardwareExecutorVulkan::cleanupCompletedResources()
 {
-    if (deferredReleaseQueue.empty())
-    {
-        return;
-    }
+    const auto cleanupStart = std::chrono::steady_clock::now();
+    size_t releasedCount = 0;
 
-    // ========== Step 1: 收集所有不同的 semaphore ==========
-    std::unordered_map<VkSemaphore, uint64_t> semaphoreCompletedValues;
+    TimelineValueCache &timelineValueCache = hardwareContext->deviceManager.getTimelineValueCache();
 
-    for (const auto &entry : deferredReleaseQueue)
+    for (auto &ring : deferredReleaseRings)
     {
-        // 只记录 semaphore，稍后批量查询
-        semaphoreCompletedValues[entry.semaphore] = 0;
-    }
+        // 设备级缓存的值由提交、完成令牌等路径共同推进，队头不超过它时无需查询
+        uint64_t completedValue = timelineValueCache.cachedValue(ring.semaphore);
 
-    // ========== Step 2: 批量查询每个 semaphore 的当前值 ==========
-    // 用于记录损坏的 semaphore
-    std::unordered_set<VkSemaphore> corruptedSemaphores;
+        // 同一 semaphore 上的 timeline 值按入队顺序递增，从队头弹出直到遇到未完成的条目即可
+        while (!ring.empty())
+        {
+            if (ring.front().timelineValue > completedValue)
+            {
+                // 缓存的 counter 值不足以判断时才查询，每个环每次最多查询一次
+                const bool queried = timelineValueCache.refresh(ring.semaphore, completedValue);
+                ++deferredReleaseCost.semaphoreQueries;
 
-    for (auto &[semaphore, completedValue] : semaphoreCompletedValues)
-    {
-        VkResult result = vkGetSemaphoreCounterValue(
-            hardwareContext->deviceManager.logicalDevice,
-            semaphore,
-            &completedValue);
+                if (!queried)
+                {
+                    CFW_LOG_ERROR("Failed to query timeline semaphore value");
+                    // 查询失败时不释放该 semaphore 对应的资源
+                    break;
+                }
 
-        if (result != VK_SUCCESS)
-        {
-            CFW_LOG_ERROR("Failed to query timeline semaphore value, VkResult: {}",
-                          static_cast<int>(result));
-            // 查询失败时设为 0，不释放该 semaphore 对应的资源
-            completedValue = 0;
-        }
-        else if (completedValue == UINT64_MAX)
-        {
-            // ===== 修复4: 检测损坏的 semaphore =====
-            CFW_LOG_ERROR("[cleanupCompletedResources] Semaphore {} has invalid value UINT64_MAX, marking as corrupted",
-                          reinterpret_cast<uintptr_t>(semaphore));
-            corruptedSemaphores.insert(semaphore);
-            // 设为一个非常大的值以触发资源释放，防止内存泄漏
-            completedValue = UINT64_MAX - 1;
-        }
-    }
+                if (completedValue == UINT64_MAX)
+                {
+                    // 损坏的 semaphore 永远不会正常推进，强制释放其资源，防止内存泄漏
+                    CFW_LOG_ERROR("[cleanupCompletedResources] Semaphore {} has invalid value UINT64_MAX, marking as corrupted",
+                                  reinterpret_cast<uintptr_t>(ring.semaphore));
+                    releasedCount += ring.count;
+                    ring.clear();
+                    break;
+                }
 
-    // ========== Step 3: 分区并移除已完成的资源 ==========
-    // 使用 stable_partition 保持未完成资源的相对顺序（FIFO 释放）
-    auto partitionPoint = std::stable_partition(
-        deferredReleaseQueue.begin(),
-        deferredReleaseQueue.end(),
-        [&semaphoreCompletedValues, &corruptedSemaphores](const DeferredRelease &entry) {
-            // 如果 semaphore 已损坏，强制释放其资源
-            if (corruptedSemaphores.count(entry.semaphore) > 0)
-            {
-                return false; // 移除（释放）
+                if (ring.front().timelineValue > completedValue)
+                {
+                    break;
+                }
             }
 
-            // 返回 true 表示保留（未完成），返回 false 表示移除（已完成）
-            auto it = semaphoreCompletedValues.find(entry.semaphore);
-            if (it != semaphoreCompletedValues.end())
-            {
-                // timelineValue <= completedValue 表示 GPU 已完成
-                return entry.timelineValue > it->second;
-            }
-            // 未找到 semaphore 信息，保守处理：保留
-            return true;
-        });
+            // 实际释放资源（shared_ptr 析构）
+            ring.pop();
+            ++releasedCount;
+        }
+    }
 
-    // ========== Step 4: 记录释放信息并清理 ==========
-    size_t releasedCount = std::distance(partitionPoint, deferredReleaseQueue.end());
+    const uint64_t elapsedNs = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - cleanupStart).count());
+    ++deferredReleaseCost.cleanupCalls;
+    deferredReleaseCost.retiredResources += releasedCount;
+    deferredReleaseCost.totalCleanupNs += elapsedNs;
+    deferredReleaseCost.lastCleanupNs = elapsedNs;
+    deferredReleaseCost.lastCleanupRetired = releasedCount;
 
     if (releasedCount > 0)
     {
-        CFW_LOG_TRACE("Released {} deferred resources, remaining: {}",
-                      releasedCount,
-                      std::distance(deferredReleaseQueue.begin(), partitionPoint));
+        CFW_LOG_TRACE("Released {} deferred resources in {} ns", releasedCount, elapsedNs);
     }
-
-    // 实际释放资源（shared_ptr 析构）
-    deferredReleaseQueue.erase(partitionPoint, deferredReleaseQueue.end());
 }
 
 // ========== 同步等待所有延迟释放的资源完成 ==========
 void HardwareExecutorVulkan::waitForAllDeferredResources()
 {
-    if (deferredReleaseQueue.empty())
-    {
-        return;
-    }
-
-    // 收集所有 semaphore 及最大 timeline 值
-    std::unordered_map<VkSemaphore, uint64_t> semaphoreMaxValues;
-
-    for (const auto &entry : deferredReleaseQueue)
-    {
-        auto it = semaphoreMaxValues.find(entry.semaphore);
-        if (it == semaphoreMaxValues.end())
-        {
-            semaphoreMaxValues[entry.semaphore] = entry.timelineValue;
-        }
-        else
-        {
-            it->second = std::max(it->second, entry.timelineValue);
-        }
-    }
+    resolveAsyncSubmit();
 
     std::vector<VkSemaphore> semaphores;
     std::vector<uint64_t> values;
 
-    for (const auto &[sem, val] : semaphoreMaxValues)
+    for (const auto &ring : deferredReleaseRings)
     {
-        semaphores.push_back(sem);
-        values.push_back(val);
+        if (!ring.empty())
+        {
+            semaphores.push_back(ring.semaphore);
+            values.push_back(ring.newestValue);
+        }
     }
 
     if (semaphores.empty())
@@ -269,290 +494,700 @@ void HardwareExecutorVulkan::waitForAllDeferredResources()
     }
 
     // 等待完成后，清理所有资源
-    size_t count = deferredReleaseQueue.size();
-    deferredReleaseQueue.clear();
+    size_t count = 0;
+    TimelineValueCache &timelineValueCache = hardwareContext->deviceManager.getTimelineValueCache();
+    for (auto &ring : deferredReleaseRings)
+    {
+        count += ring.count;
+        timelineValueCache.observe(ring.semaphore, ring.newestValue);
+        ring.clear();
+    }
 
     CFW_LOG_TRACE("waitForAllDeferredResources: released {} resources", count);
 }
 
+// ========== 获取提交延迟统计信息 ==========
+HardwareExecutorVulkan::CommitLatencyStats HardwareExecutorVulkan::getCommitLatencyStats() const
+{
+    CommitLatencyStats stats;
+    stats.commits = latencyStats->commits.load(std::memory_order_relaxed);
+    stats.submits = latencyStats->submits.load(std::memory_order_relaxed);
+    stats.failedSubmits = latencyStats->failedSubmits.load(std::memory_order_relaxed);
+    stats.droppedSegments = latencyStats->droppedSegments.load(std::memory_order_relaxed);
+    stats.contendedQueueLocks = latencyStats->contendedQueueLocks.load(std::memory_order_relaxed);
+    stats.timelineWaitTimeouts = latencyStats->timelineWaitTimeouts.load(std::memory_order_relaxed);
+    stats.queueLockWait = latencyStats->queueLockWait.summarize();
+    stats.timelineWait = latencyStats->timelineWait.summarize();
+    stats.recording = latencyStats->recording.summarize();
+    stats.queueSubmit = latencyStats->queueSubmit.summarize();
+    return stats;
+}
+
 // ========== 获取延迟释放统计信息 ==========
 HardwareExecutorVulkan::DeferredReleaseStats HardwareExecutorVulkan::getDeferredReleaseStats() const
 {
-    DeferredReleaseStats stats;
-    stats.currentPending = deferredReleaseQueue.size();
-
-    if (deferredReleaseQueue.empty())
-    {
-        return stats;
-    }
+    DeferredReleaseStats stats = deferredReleaseCost;
+    stats.currentPending = 0;
+    stats.totalSemaphores = 0;
 
-    // 统计不同的 semaphore 数量
-    std::unordered_set<VkSemaphore> uniqueSemaphores;
     uint64_t minTimeline = UINT64_MAX;
     uint64_t maxTimeline = 0;
 
-    for (const auto &entry : deferredReleaseQueue)
+    for (const auto &ring : deferredReleaseRings)
     {
-        uniqueSemaphores.insert(entry.semaphore);
-        minTimeline = std::min(minTimeline, entry.timelineValue);
-        maxTimeline = std::max(maxTimeline, entry.timelineValue);
+        if (ring.empty())
+        {
+            continue;
+        }
+
+        stats.currentPending += ring.count;
+        ++stats.totalSemaphores;
+        minTimeline = std::min(minTimeline, ring.front().timelineValue);
+        maxTimeline = std::max(maxTimeline, ring.newestValue);
+    }
+
+    if (stats.currentPending == 0)
+    {
+        return stats;
     }
 
-    stats.totalSemaphores = uniqueSemaphores.size();
     stats.oldestTimeline = minTimeline;
     stats.newestTimeline = maxTimeline;
 
     return stats;
 }
 
-DeviceManager::QueueUtils *HardwareExecutorVulkan::pickQueueAndCommit(std::atomic_uint16_t &currentQueueIndex,
-                                                                      std::vector<DeviceManager::QueueUtils> &currentQueues,
-                                                                      std::function<bool(DeviceManager::QueueUtils *currentRecordQueue)> commitCommand)
-{
-    DeviceManager::QueueUtils *queue;
-
-    while (true)
-    {
-        uint16_t queueIndex = currentQueueIndex.fetch_add(1) % currentQueues.size();
-        queue = &currentQueues[queueIndex];
-
-        if (queue->queueMutex->try_lock())
-        {
-            // if (!needsCommandBuffer)
-            //{
-            //     if (queue->queueWaitFence != VK_NULL_HANDLE)
-            //     {
-            //         VkResult status = vkGetFenceStatus(queue->deviceManager->logicalDevice, queue->queueWaitFence);
-            //         if (status == VK_SUCCESS)
-            //         {
-            //             // fence已经是signaled状态
-            //             queue->queueWaitFence = VK_NULL_HANDLE;
-            //             break;
-            //         }
-            //         else if (status == VK_NOT_READY)
-            //         {
-            //             // fence还未signaled
-            //             queue->queueMutex->unlock();
-            //             std::this_thread::yield();
-            //             continue;
-            //         }
-            //     }
-            //     break;
-            // }
-
-            uint64_t timelineCounterValue = 0;
-            VkResult result = vkGetSemaphoreCounterValue(queue->deviceManager->logicalDevice, queue->timelineSemaphore, &timelineCounterValue);
-            if (result == VK_SUCCESS)
-            {
-                // ===== 修复3&4: 检测损坏的 semaphore 值 =====
-                if (timelineCounterValue == UINT64_MAX)
-                {
-                    queue->queueMutex->unlock();
-                    CFW_LOG_ERROR("[pickQueueAndCommit] Queue {} timeline semaphore has invalid value UINT64_MAX, skipping",
-                                  queueIndex);
-                    continue; // 跳过这个队列，尝试下一个
-                }
-
-                if (timelineCounterValue >= queue->timelineValue->load(std::memory_order_acquire))
-                {
-                    break;
-                }
-                else
-                {
-                    queue->queueMutex->unlock();
-                }
-            }
-            else
+// ========== 执行器命令缓冲池 ==========
+ExecutorCommandPool::~ExecutorCommandPool()
+{
+    // 等待仍在 GPU 上执行的命令缓冲完成后再销毁 pool
+    std::unordered_map<VkSemaphore, uint64_t> semaphoreMaxValues;
+    auto collectMaxValues = [&semaphoreMaxValues](const std::deque<RecordCommandBuffer> &commandBuffers) {
+        for (const auto &recordBuffer : commandBuffers)
+        {
+            if (recordBuffer.semaphore == VK_NULL_HANDLE)
             {
-                queue->queueMutex->unlock();
-                CFW_LOG_ERROR("Failed to get timeline semaphore counter value for queue index {}!", queueIndex);
-                return nullptr;
+                continue;
             }
+            uint64_t &maxValue = semaphoreMaxValues[recordBuffer.semaphore];
+            maxValue = std::max(maxValue, recordBuffer.signalValue);
         }
-
-        std::this_thread::yield();
-        // std::this_thread::sleep_for(std::chrono::microseconds(10000));
-    }
-
-    // ===== 首先清理已完成的资源 =====
-    cleanupCompletedResources();
-
-    // 保存当前 pendingResources 的引用，在提交成功后使用
-    auto localPendingResources = std::move(pendingResources);
-    pendingResources.clear();
-    pendingResources.reserve(32);
-
-    if (!commitCommand(queue))
+    };
+    for (const auto &familyPool : familyPools)
     {
-        for (auto &resource : localPendingResources)
+        collectMaxValues(familyPool.commandBuffers);
+        for (const auto &shardPool : familyPool.shardPools)
         {
-            pendingResources.push_back(std::move(resource));
+            collectMaxValues(shardPool.commandBuffers);
         }
-        localPendingResources.clear();
-
-        waitSemaphores.clear();
-        signalSemaphores.clear();
-        waitFence = VK_NULL_HANDLE;
-        queue->queueMutex->unlock();
-        return nullptr;
     }
 
-    // P0 修复：确保 currentRecordQueue 始终指向本次选出的队列
-    // commit() 的 lambda 已经设置了此值（幂等），但外部调用者（如 displayFrame 的 present lambda）
-    // 可能不会设置。统一在此处赋值，保证后续 timeline 管理和 vkQueueSubmit2 作用于正确的队列。
-    this->currentRecordQueue = queue;
-
+    if (!semaphoreMaxValues.empty())
     {
+        std::vector<VkSemaphore> semaphores;
+        std::vector<uint64_t> values;
+        for (const auto &[semaphore, value] : semaphoreMaxValues)
+        {
+            semaphores.push_back(semaphore);
+            values.push_back(value);
+        }
 
-        VkCommandBufferSubmitInfo commandBufferSubmitInfo{};
-        commandBufferSubmitInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
-        commandBufferSubmitInfo.commandBuffer = currentRecordQueue->commandBuffer;
-
-        // 用单次 fetch_add 同时获取 wait 和 signal 值，消除两次原子操作间的竞态窗口
-        uint64_t waitValue = currentRecordQueue->timelineValue->fetch_add(1);
-        uint64_t signalValue = waitValue + 1;
-
-        VkSemaphoreSubmitInfo timelineWaitSemaphoreSubmitInfo{};
-        timelineWaitSemaphoreSubmitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
-        timelineWaitSemaphoreSubmitInfo.semaphore = currentRecordQueue->timelineSemaphore;
-        timelineWaitSemaphoreSubmitInfo.value = waitValue;
-        timelineWaitSemaphoreSubmitInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
-        waitSemaphores.push_back(timelineWaitSemaphoreSubmitInfo);
-
-        VkSemaphoreSubmitInfo timelineSignalSemaphoreSubmitInfo{};
-        timelineSignalSemaphoreSubmitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
-        timelineSignalSemaphoreSubmitInfo.semaphore = currentRecordQueue->timelineSemaphore;
-        timelineSignalSemaphoreSubmitInfo.value = signalValue;
-        timelineSignalSemaphoreSubmitInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
-        signalSemaphores.push_back(timelineSignalSemaphoreSubmitInfo);
-
-        std::vector<VkSemaphoreSubmitInfo> mergedWaitSemaphores = mergeSemaphoreSubmitInfos(waitSemaphores);
-        std::vector<VkSemaphoreSubmitInfo> mergedSignalSemaphores = mergeSemaphoreSubmitInfos(signalSemaphores);
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = static_cast<uint32_t>(semaphores.size());
+        waitInfo.pSemaphores = semaphores.data();
+        waitInfo.pValues = values.data();
 
-        // timeline semaphore 在同一次 submit 中 wait+signal 时，signal value 必须严格大于 wait value。
-        // binary semaphore 的 value 固定为 0，这里通过 value==0 直接跳过。
-        std::unordered_map<VkSemaphore, uint64_t> waitValueMap;
-        waitValueMap.reserve(mergedWaitSemaphores.size());
-        for (const auto &waitSem : mergedWaitSemaphores)
+        constexpr uint64_t timeoutNs = 5'000'000'000ULL; // 5 seconds
+        VkResult result = vkWaitSemaphores(device, &waitInfo, timeoutNs);
+        if (result != VK_SUCCESS)
         {
-            waitValueMap.emplace(waitSem.semaphore, waitSem.value);
+            CFW_LOG_ERROR("ExecutorCommandPool destructor: vkWaitSemaphores failed with {}",
+                          static_cast<int>(result));
         }
-        for (auto &signalSem : mergedSignalSemaphores)
+        else
         {
-            if (signalSem.value == 0)
+            for (size_t i = 0; i < semaphores.size(); ++i)
             {
-                continue;
-            }
-
-            auto it = waitValueMap.find(signalSem.semaphore);
-            if (it != waitValueMap.end() && signalSem.value <= it->second)
-            {
-                signalSem.value = it->second + 1;
+                timelineValueCache.observe(semaphores[i], values[i]);
             }
         }
+    }
 
-        // ===== 修复4: Semaphore 值验证 =====
-        // 在提交前验证所有 timeline semaphore 的当前值是否有效
-        // 如果 semaphore 值为 UINT64_MAX，说明 semaphore 已损坏或设备丢失
-        bool semaphoreValid = true;
-        for (const auto &waitSem : mergedWaitSemaphores)
+    // 销毁 pool 会一并释放其中分配的命令缓冲
+    for (auto &familyPool : familyPools)
+    {
+        if (familyPool.commandPool != VK_NULL_HANDLE)
+        {
+            vkDestroyCommandPool(device, familyPool.commandPool, nullptr);
+            familyPool.commandPool = VK_NULL_HANDLE;
+        }
+        for (auto &shardPool : familyPool.shardPools)
         {
-            // 跳过 Binary Semaphore（Binary Semaphore 的 value 固定为 0）
-            if (waitSem.value == 0)
+            if (shardPool.commandPool != VK_NULL_HANDLE)
             {
-                continue;
+                vkDestroyCommandPool(device, shardPool.commandPool, nullptr);
+                shardPool.commandPool = VK_NULL_HANDLE;
             }
+        }
+    }
+    familyPools.clear();
+}
+
+ExecutorCommandPool::FamilyPool *ExecutorCommandPool::findFamilyPool(uint32_t queueFamilyIndex)
+{
+    for (auto &pool : familyPools)
+    {
+        if (pool.queueFamilyIndex == queueFamilyIndex)
+        {
+            return &pool;
+        }
+    }
+    return nullptr;
+}
+
+ExecutorCommandPool::RecordCommandBuffer *ExecutorCommandPool::acquire(uint32_t queueFamilyIndex)
+{
+    FamilyPool *familyPool = findFamilyPool(queueFamilyIndex);
+    if (familyPool == nullptr)
+    {
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        poolInfo.queueFamilyIndex = queueFamilyIndex;
+
+        FamilyPool newPool{};
+        newPool.queueFamilyIndex = queueFamilyIndex;
+        coronaHardwareCheck(vkCreateCommandPool(device, &poolInfo, nullptr, &newPool.commandPool));
+
+        familyPools.push_back(std::move(newPool));
+        familyPool = &familyPools.back();
+    }
+
+    RecordCommandBuffer *recordBuffer = acquireFrom(familyPool->commandPool,
+                                                    familyPool->commandBuffers,
+                                                    VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    if (recordBuffer == nullptr)
+    {
+        CFW_LOG_ERROR("ExecutorCommandPool: failed to allocate command buffer for queue family {}", queueFamilyIndex);
+        return nullptr;
+    }
+    recordBuffer->queueFamilyIndex = queueFamilyIndex;
+    return recordBuffer;
+}
+
+ExecutorCommandPool::RecordCommandBuffer *ExecutorCommandPool::acquireSecondary(RecordCommandBuffer &primary, uint32_t shardIndex)
+{
+    FamilyPool *familyPool = findFamilyPool(primary.queueFamilyIndex);
+    if (familyPool == nullptr)
+    {
+        return nullptr;
+    }
+
+    while (familyPool->shardPools.size() <= shardIndex)
+    {
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        poolInfo.queueFamilyIndex = primary.queueFamilyIndex;
+
+        ShardPool newPool{};
+        if (vkCreateCommandPool(device, &poolInfo, nullptr, &newPool.commandPool) != VK_SUCCESS)
+        {
+            CFW_LOG_ERROR("ExecutorCommandPool: failed to create secondary command pool for queue family {}", primary.queueFamilyIndex);
+            return nullptr;
+        }
+        familyPool->shardPools.push_back(std::move(newPool));
+    }
+
+    ShardPool &shardPool = familyPool->shardPools[shardIndex];
+    RecordCommandBuffer *recordBuffer = acquireFrom(shardPool.commandPool,
+                                                    shardPool.commandBuffers,
+                                                    VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    if (recordBuffer == nullptr)
+    {
+        CFW_LOG_ERROR("ExecutorCommandPool: failed to allocate secondary command buffer for queue family {}", primary.queueFamilyIndex);
+        return nullptr;
+    }
+    recordBuffer->queueFamilyIndex = primary.queueFamilyIndex;
+    primary.secondaries.push_back(recordBuffer);
+    return recordBuffer;
+}
+
+ExecutorCommandPool::RecordCommandBuffer *ExecutorCommandPool::acquireFrom(VkCommandPool commandPool,
+                                                                           std::deque<RecordCommandBuffer> &commandBuffers,
+                                                                           VkCommandBufferLevel level)
+{
+    // 优先复用 GPU 已执行完毕的命令缓冲
+    for (auto &recordBuffer : commandBuffers)
+    {
+        if (recordBuffer.inUse)
+        {
+            continue;
+        }
+
+        const bool completed = recordBuffer.semaphore == VK_NULL_HANDLE ||
+                               timelineValueCache.isReached(recordBuffer.semaphore, recordBuffer.signalValue);
+
+        if (completed)
+        {
+            vkResetCommandBuffer(recordBuffer.commandBuffer, 0);
+            recordBuffer.semaphore = VK_NULL_HANDLE;
+            recordBuffer.signalValue = 0;
+            recordBuffer.inUse = true;
+            return &recordBuffer;
+        }
+    }
+
+    // 全部仍在飞行中：扩容而不是等待 GPU
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = level;
+    allocInfo.commandBufferCount = 1;
+
+    RecordCommandBuffer newBuffer{};
+    if (vkAllocateCommandBuffers(device, &allocInfo, &newBuffer.commandBuffer) != VK_SUCCESS)
+    {
+        return nullptr;
+    }
+    newBuffer.inUse = true;
+    commandBuffers.push_back(std::move(newBuffer));
+    return &commandBuffers.back();
+}
+
+void ExecutorCommandPool::markSubmitted(RecordCommandBuffer &recordBuffer, VkSemaphore semaphore, uint64_t signalValue)
+{
+    recordBuffer.semaphore = semaphore;
+    recordBuffer.signalValue = signalValue;
+    recordBuffer.inUse = false;
+
+    if (recordBuffer.profileBlock != nullptr)
+    {
+        recordBuffer.profileBlock->profiler->submitBlock(*recordBuffer.profileBlock, semaphore, signalValue);
+        recordBuffer.profileBlock = nullptr;
+    }
+    for (ExecutorQueryPool::QueryBlock *queryBlock : recordBuffer.queryBlocks)
+    {
+        queryBlock->owner->submitBlock(*queryBlock, semaphore, signalValue);
+    }
+    recordBuffer.queryBlocks.clear();
+
+    // 二级命令缓冲随所属主命令缓冲一起回收
+    for (RecordCommandBuffer *secondary : recordBuffer.secondaries)
+    {
+        secondary->semaphore = semaphore;
+        secondary->signalValue = signalValue;
+        secondary->inUse = false;
+    }
+    recordBuffer.secondaries.clear();
+}
+
+void ExecutorCommandPool::release(RecordCommandBuffer &recordBuffer)
+{
+    recordBuffer.inUse = false;
+
+    if (recordBuffer.profileBlock != nullptr)
+    {
+        recordBuffer.profileBlock->profiler->releaseBlock(*recordBuffer.profileBlock);
+        recordBuffer.profileBlock = nullptr;
+    }
+    for (ExecutorQueryPool::QueryBlock *queryBlock : recordBuffer.queryBlocks)
+    {
+        queryBlock->owner->releaseBlock(*queryBlock);
+    }
+    recordBuffer.queryBlocks.clear();
+
+    for (RecordCommandBuffer *secondary : recordBuffer.secondaries)
+    {
+        secondary->inUse = false;
+    }
+    recordBuffer.secondaries.clear();
+}
+
+// ========== 命令缓冲内的资源状态跟踪 ==========
+namespace
+{
+constexpr VkAccessFlags2 kWriteAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT |
+                                            VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+                                            VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+                                            VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                            VK_ACCESS_2_TRANSFER_WRITE_BIT |
+                                            VK_ACCESS_2_HOST_WRITE_BIT |
+                                            VK_ACCESS_2_MEMORY_WRITE_BIT |
+                                            VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+
+// 返回 false 表示该屏障可以省略；需要保留时改写 srcStage/srcAccess 为实际的上一次访问
+bool resolveHazard(CommandHazardTracker::AccessState &state,
+                   bool firstAccess,
+                   bool layoutChange,
+                   VkPipelineStageFlags2 dstStage,
+                   VkAccessFlags2 dstAccess,
+                   VkPipelineStageFlags2 &srcStage,
+                   VkAccessFlags2 &srcAccess)
+{
+    const bool write = layoutChange || (dstAccess & kWriteAccessMask) != 0;
+    bool keep = false;
+
+    if (firstAccess)
+    {
+        // 命令缓冲内首次访问：只有布局转换需要屏障，保留记录给出的保守 src 范围与之前的提交衔接
+        keep = layoutChange;
+    }
+    else if (!write)
+    {
+        // 读后读不需要屏障；写后读只在该阶段/访问尚未可见时需要
+        const bool visible = (state.visibleStages & dstStage) == dstStage &&
+                             (state.visibleAccess & dstAccess) == dstAccess;
+        keep = state.writeStages != VK_PIPELINE_STAGE_2_NONE && !visible;
+        if (keep)
+        {
+            srcStage = state.writeStages;
+            srcAccess = state.writeAccess;
+        }
+    }
+    else
+    {
+        // 写后写/读后写：等待上一次写入及其后的全部读取，读取只需要执行依赖
+        keep = true;
+        srcStage = state.writeStages | state.readStages;
+        srcAccess = state.writeAccess;
+        if (srcStage == VK_PIPELINE_STAGE_2_NONE)
+        {
+            srcStage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        }
+    }
+
+    if (write)
+    {
+        state.writeStages = dstStage;
+        state.writeAccess = layoutChange ? VK_ACCESS_2_MEMORY_WRITE_BIT : (dstAccess & kWriteAccessMask);
+        state.readStages = VK_PIPELINE_STAGE_2_NONE;
+        state.visibleStages = VK_PIPELINE_STAGE_2_NONE;
+        state.visibleAccess = VK_ACCESS_2_NONE;
+    }
+    else
+    {
+        state.readStages |= dstStage;
+        if (keep)
+        {
+            state.visibleStages |= dstStage;
+            state.visibleAccess |= dstAccess;
+        }
+    }
+
+    return keep;
+}
+} // namespace
+
+void CommandHazardTracker::reset()
+{
+    ++currentEpoch;
+    untrackedAccessPending = false;
+    if (bufferStates.size() + imageStates.size() > MAX_RETAINED_STATES)
+    {
+        bufferStates.clear();
+        imageStates.clear();
+    }
+}
+
+void CommandHazardTracker::resolve(const CommandRecordVulkan::RequiredBarriers &requested,
+                                   CommandRecordVulkan::RequiredBarriers &resolved)
+{
+    // 全局内存屏障无法对应到具体资源，原样保留
+    resolved.memoryBarriers.insert(resolved.memoryBarriers.end(),
+                                   requested.memoryBarriers.begin(),
+                                   requested.memoryBarriers.end());
+
+    // 上一条记录的访问集合不完整，而本记录只声明了具体资源：补一个覆盖所有后续命令的全局屏障
+    if (untrackedAccessPending && requested.memoryBarriers.empty())
+    {
+        VkMemoryBarrier2 memoryBarrier{};
+        memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+        memoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        memoryBarrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+        memoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        memoryBarrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+        resolved.memoryBarriers.push_back(memoryBarrier);
+    }
+    untrackedAccessPending = !requested.memoryBarriers.empty();
 
-            if (waitSem.semaphore != VK_NULL_HANDLE)
+    for (const auto &bufferBarrier : requested.bufferBarriers)
+    {
+        AccessState &state = bufferStates[bufferBarrier.buffer];
+        const bool firstAccess = state.epoch != currentEpoch;
+        if (firstAccess)
+        {
+            state = AccessState{};
+            state.epoch = currentEpoch;
+        }
+
+        VkBufferMemoryBarrier2 barrier = bufferBarrier;
+        if (resolveHazard(state, firstAccess, false,
+                          barrier.dstStageMask, barrier.dstAccessMask,
+                          barrier.srcStageMask, barrier.srcAccessMask))
+        {
+            resolved.bufferBarriers.push_back(barrier);
+        }
+    }
+
+    for (const auto &imageBarrier : requested.imageBarriers)
+    {
+        AccessState &state = imageStates[imageBarrier.image];
+        const bool firstAccess = state.epoch != currentEpoch;
+        if (firstAccess)
+        {
+            state = AccessState{};
+            state.epoch = currentEpoch;
+        }
+
+        VkImageMemoryBarrier2 barrier = imageBarrier;
+        if (resolveHazard(state, firstAccess, barrier.oldLayout != barrier.newLayout,
+                          barrier.dstStageMask, barrier.dstAccessMask,
+                          barrier.srcStageMask, barrier.srcAccessMask))
+        {
+            resolved.imageBarriers.push_back(barrier);
+        }
+    }
+}
+
+bool HardwareExecutorVulkan::submitCommandBuffer(DeviceManager::QueueUtils *queue,
+                                                 VkCommandBuffer commandBuffer,
+                                                 std::vector<std::shared_ptr<CopyCommandImpl>> &localPendingResources)
+{
+    // P0 修复：确保 currentRecordQueue 始终指向本次选出的队列
+    // commit() 的 lambda 已经设置了此值（幂等），但外部调用者（如 displayFrame 的 present lambda）
+    // 可能不会设置。统一在此处赋值，保证后续 timeline 管理和 vkQueueSubmit2 作用于正确的队列。
+    this->currentRecordQueue = queue;
+
+    VkCommandBufferSubmitInfo commandBufferSubmitInfo{};
+    commandBufferSubmitInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+    commandBufferSubmitInfo.commandBuffer = commandBuffer;
+
+    // 用单次 fetch_add 同时获取 wait 和 signal 值，消除两次原子操作间的竞态窗口
+    uint64_t waitValue = currentRecordQueue->timelineValue->fetch_add(1);
+    uint64_t signalValue = waitValue + 1;
+
+    VkSemaphoreSubmitInfo timelineWaitSemaphoreSubmitInfo{};
+    timelineWaitSemaphoreSubmitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    timelineWaitSemaphoreSubmitInfo.semaphore = currentRecordQueue->timelineSemaphore;
+    timelineWaitSemaphoreSubmitInfo.value = waitValue;
+    timelineWaitSemaphoreSubmitInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    waitSemaphores.push_back(timelineWaitSemaphoreSubmitInfo);
+
+    VkSemaphoreSubmitInfo timelineSignalSemaphoreSubmitInfo{};
+    timelineSignalSemaphoreSubmitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    timelineSignalSemaphoreSubmitInfo.semaphore = currentRecordQueue->timelineSemaphore;
+    timelineSignalSemaphoreSubmitInfo.value = signalValue;
+    timelineSignalSemaphoreSubmitInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    signalSemaphores.push_back(timelineSignalSemaphoreSubmitInfo);
+
+    // 只等待读写了相同资源的先前提交，不相关的提交可以在其他队列上并行执行
+    ResourceDependencyTracker &dependencyTracker = hardwareContext->deviceManager.getDependencyTracker();
+    dependencyUndoLog.clear();
+    dependencyTracker.trackSubmission(resourceAccesses,
+                                      currentRecordQueue->timelineSemaphore,
+                                      signalValue,
+                                      waitSemaphores,
+                                      dependencyUndoLog);
+
+    const bool semaphoreValid = prepareSubmitSemaphores(hardwareContext->deviceManager.getTimelineValueCache(),
+                                                        waitSemaphores,
+                                                        signalSemaphores,
+                                                        mergedWaitSemaphores,
+                                                        mergedSignalSemaphores);
+
+    if (!semaphoreValid)
+    {
+        CFW_LOG_ERROR("[commit] Aborting submit due to invalid semaphore state");
+        // 回滚 fetch_add：提交未发生，timeline 值不应递增，
+        // 否则 semaphore counter 永远无法追上 timelineValue 导致死锁
+        currentRecordQueue->timelineValue->fetch_sub(1);
+        dependencyTracker.rollback(dependencyUndoLog);
+        latencyStats->failedSubmits.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    VkSubmitInfo2 submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+    submitInfo.waitSemaphoreInfoCount = static_cast<uint32_t>(mergedWaitSemaphores.size());
+    submitInfo.pWaitSemaphoreInfos = mergedWaitSemaphores.data();
+    submitInfo.signalSemaphoreInfoCount = static_cast<uint32_t>(mergedSignalSemaphores.size());
+    submitInfo.pSignalSemaphoreInfos = mergedSignalSemaphores.data();
+    // 空提交（段内命令未能执行）不带命令缓冲，只保留等待、signal 与 fence
+    submitInfo.commandBufferInfoCount = commandBuffer != VK_NULL_HANDLE ? 1 : 0;
+    submitInfo.pCommandBufferInfos = &commandBufferSubmitInfo;
+
+    const uint64_t submitBeginNs = CommitLatencyStatsVulkan::nowNs();
+    VkResult result = vkQueueSubmit2(currentRecordQueue->vkQueue, 1, &submitInfo, waitFence);
+    latencyStats->queueSubmit.record(CommitLatencyStatsVulkan::nowNs() - submitBeginNs);
+    if (result != VK_SUCCESS)
+    {
+        CFW_LOG_ERROR("Failed to submit command buffer! VkResult: {}", coronaHardwareResultStr(result));
+        // 提交失败：回滚 timeline 值，避免死锁
+        currentRecordQueue->timelineValue->fetch_sub(1);
+        dependencyTracker.rollback(dependencyUndoLog);
+        latencyStats->failedSubmits.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    latencyStats->submits.fetch_add(1, std::memory_order_relaxed);
+
+    // 记录本次提交的 signal 值，供 commit() 尾部和 wait() 使用
+    this->lastSignalValue = signalValue;
+    lastSubmissions.push_back({currentRecordQueue, signalValue});
+    dependencyUndoLog.clear();
+
+    // ===== 将待释放资源绑定到此次提交的 timeline 值 =====
+    for (auto &resource : localPendingResources)
+    {
+        deferRelease(currentRecordQueue->timelineSemaphore, signalValue, std::move(resource));
+    }
+    localPendingResources.clear();
+
+    // 处理在 commitCommand 期间新增的 pendingResources（例如 RasterizerPipeline 的保活资源）
+    for (auto &resource : pendingResources)
+    {
+        deferRelease(currentRecordQueue->timelineSemaphore, signalValue, std::move(resource));
+    }
+    pendingResources.clear();
+
+    return true;
+}
+
+DeviceManager::QueueUtils *HardwareExecutorVulkan::pickQueueAndCommit(std::atomic_uint16_t &currentQueueIndex,
+                                                                      std::vector<DeviceManager::QueueUtils> &currentQueues,
+                                                                      QueueCommitCallback commitCommand)
+{
+    DeviceManager::QueueUtils *queue = nullptr;
+    const size_t queueCount = currentQueues.size();
+    const DeviceManager::QueuePriority queuePriority = closestQueuePriority(currentQueues, UINT32_MAX, priority);
+
+    while (queue == nullptr)
+    {
+        // 按未完成的 timeline 差值选择队列：优先取空闲且锁可立即获得的队列，
+        // 同时记录负载最小的队列，没有空闲队列时在它上面等待。轮询起点只用于在负载相同的队列之间分摊
+        const uint16_t startIndex = currentQueueIndex.fetch_add(1);
+        DeviceManager::QueueUtils *leastLoadedQueue = nullptr;
+        uint64_t leastLoad = UINT64_MAX;
+        for (size_t i = 0; i < queueCount; ++i)
+        {
+            DeviceManager::QueueUtils *candidate = &currentQueues[(startIndex + i) % queueCount];
+            if (candidate->priority != queuePriority)
             {
-                uint64_t currentValue = 0;
-                VkResult queryResult = vkGetSemaphoreCounterValue(
-                    hardwareContext->deviceManager.logicalDevice,
-                    waitSem.semaphore,
-                    &currentValue);
+                continue;
+            }
 
-                if (queryResult != VK_SUCCESS)
-                {
-                    CFW_LOG_ERROR("[commit] Failed to query semaphore counter value, VkResult: {}",
-                                  static_cast<int>(queryResult));
-                    semaphoreValid = false;
-                    break;
-                }
+            const uint64_t load = queueOutstandingWork(*candidate);
 
-                // 检查 semaphore 值是否为无效的 UINT64_MAX
-                if (currentValue == UINT64_MAX)
-                {
-                    CFW_LOG_ERROR("[commit] Timeline semaphore {} has invalid value UINT64_MAX, device may be lost!",
-                                  reinterpret_cast<uintptr_t>(waitSem.semaphore));
-                    semaphoreValid = false;
-                    break;
-                }
+            // ===== 修复3&4: 检测损坏的 semaphore 值 =====
+            if (load == UINT64_MAX)
+            {
+                CFW_LOG_ERROR("[pickQueueAndCommit] Queue {} timeline semaphore is invalid, skipping",
+                              (startIndex + i) % queueCount);
+                continue; // 跳过这个队列，尝试下一个
+            }
 
-                // 检查等待值是否超出合理范围（maxTimelineSemaphoreValueDifference 通常是 UINT64_MAX）
-                // 但如果当前值和期望等待值差距过大，可能存在逻辑错误
-                if (waitSem.value > currentValue && (waitSem.value - currentValue) > 10000)
-                {
-                    CFW_LOG_WARNING("[commit] Semaphore wait value {} is far ahead of current value {}, potential sync issue",
-                                    waitSem.value, currentValue);
-                }
+            if (load == 0 && candidate->queueMutex->try_lock())
+            {
+                latencyStats->queueLockWait.record(0);
+                queue = candidate;
+                break;
+            }
+            if (load < leastLoad)
+            {
+                leastLoadedQueue = candidate;
+                leastLoad = load;
             }
         }
 
-        if (!semaphoreValid)
+        if (queue == nullptr)
         {
-            CFW_LOG_ERROR("[commit] Aborting submit due to invalid semaphore state");
-            // 回滚 fetch_add：提交未发生，timeline 值不应递增，
-            // 否则 semaphore counter 永远无法追上 timelineValue 导致死锁
-            currentRecordQueue->timelineValue->fetch_sub(1);
-            waitSemaphores.clear();
-            signalSemaphores.clear();
-            waitFence = VK_NULL_HANDLE;
-            queue->queueMutex->unlock();
-            return nullptr;
+            if (leastLoadedQueue == nullptr)
+            {
+                CFW_LOG_ERROR("[pickQueueAndCommit] No usable queue, all timeline semaphores are invalid");
+                return nullptr;
+            }
+            const uint64_t lockBeginNs = CommitLatencyStatsVulkan::nowNs();
+            leastLoadedQueue->queueMutex->lock();
+            latencyStats->queueLockWait.record(CommitLatencyStatsVulkan::nowNs() - lockBeginNs);
+            latencyStats->contendedQueueLocks.fetch_add(1, std::memory_order_relaxed);
+            queue = leastLoadedQueue;
         }
 
-        VkSubmitInfo2 submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
-        submitInfo.waitSemaphoreInfoCount = static_cast<uint32_t>(mergedWaitSemaphores.size());
-        submitInfo.pWaitSemaphoreInfos = mergedWaitSemaphores.data();
-        submitInfo.signalSemaphoreInfoCount = static_cast<uint32_t>(mergedSignalSemaphores.size());
-        submitInfo.pSignalSemaphoreInfos = mergedSignalSemaphores.data();
-        submitInfo.commandBufferInfoCount = 1;
-        submitInfo.pCommandBufferInfos = &commandBufferSubmitInfo;
+        // 只要环中下一个命令缓冲对应的提交已在 GPU 上完成即可复用，
+        // 不再要求整个队列空闲，从而允许多个提交同时在 GPU 上排队
+        DeviceManager::CommandBufferRing &ring = *queue->commandBufferRing;
+        const DeviceManager::CommandBufferSlot &slot = ring.slots[ring.nextSlot];
 
-        VkResult result = vkQueueSubmit2(currentRecordQueue->vkQueue, 1, &submitInfo, waitFence);
-        if (result != VK_SUCCESS)
+        // 缓存值已确认该槽位完成时无需查询驱动，否则阻塞等待而不是自旋。
+        // 等待期间不持有队列锁，其他线程仍可向该队列提交；等到后重新选择队列并在锁内复查槽位
+        TimelineValueCache &timelineValueCache = queue->deviceManager->getTimelineValueCache();
+        if (!timelineValueCache.isReached(queue->timelineSemaphore, slot.signalValue))
         {
-            CFW_LOG_ERROR("Failed to submit command buffer! VkResult: {}", coronaHardwareResultStr(result));
-            // 提交失败：回滚 timeline 值，解锁 mutex，避免死锁
-            currentRecordQueue->timelineValue->fetch_sub(1);
-            waitSemaphores.clear();
-            signalSemaphores.clear();
-            waitFence = VK_NULL_HANDLE;
+            const VkSemaphore timelineSemaphore = queue->timelineSemaphore;
+            const uint64_t slotSignalValue = slot.signalValue;
+            const VkDevice logicalDevice = queue->deviceManager->logicalDevice;
             queue->queueMutex->unlock();
-            return nullptr;
+            queue = nullptr;
+
+            VkSemaphoreWaitInfo waitInfo{};
+            waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+            waitInfo.semaphoreCount = 1;
+            waitInfo.pSemaphores = &timelineSemaphore;
+            waitInfo.pValues = &slotSignalValue;
+
+            constexpr uint64_t timeoutNs = 100'000'000ULL; // 100 ms，超时后重新评估各队列负载
+            const uint64_t waitBeginNs = CommitLatencyStatsVulkan::nowNs();
+            const VkResult result = vkWaitSemaphores(logicalDevice, &waitInfo, timeoutNs);
+            latencyStats->timelineWait.record(CommitLatencyStatsVulkan::nowNs() - waitBeginNs);
+            if (result == VK_TIMEOUT)
+            {
+                latencyStats->timelineWaitTimeouts.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (result != VK_SUCCESS)
+            {
+                CFW_LOG_ERROR("[pickQueueAndCommit] Failed to wait for queue timeline semaphore, VkResult: {}",
+                              static_cast<int>(result));
+                return nullptr;
+            }
+            timelineValueCache.observe(timelineSemaphore, slotSignalValue);
+            continue;
         }
 
-        // 记录本次提交的 signal 值，供 commit() 尾部和 wait() 使用
-        this->lastSignalValue = signalValue;
+        queue->commandBuffer = slot.commandBuffer;
+    }
 
-        // ===== 将待释放资源绑定到此次提交的 timeline 值 =====
-        for (auto &resource : localPendingResources)
-        {
-            deferredReleaseQueue.push_back({signalValue,
-                                            std::move(resource),
-                                            currentRecordQueue->timelineSemaphore});
-        }
-        localPendingResources.clear();
+    // ===== 首先清理已完成的资源 =====
+    cleanupCompletedResources();
 
-        // 处理在 commitCommand 期间新增的 pendingResources（例如 RasterizerPipeline 的保活资源）
-        for (auto &resource : pendingResources)
+    // 与复用的 submitPendingResources 交换，两边都保留容量
+    submitPendingResources.swap(pendingResources);
+
+    if (!commitCommand(queue))
+    {
+        for (auto &resource : submitPendingResources)
         {
-            deferredReleaseQueue.push_back({signalValue,
-                                            std::move(resource),
-                                            currentRecordQueue->timelineSemaphore});
+            pendingResources.push_back(std::move(resource));
         }
-        pendingResources.clear();
+        submitPendingResources.clear();
+
+        waitSemaphores.clear();
+        signalSemaphores.clear();
+        waitFence = VK_NULL_HANDLE;
+        queue->queueMutex->unlock();
+        return nullptr;
+    }
+
+    lastSubmissions.clear();
+    const bool submitted = submitCommandBuffer(queue, queue->commandBuffer, submitPendingResources);
+    submitPendingResources.clear();
+    if (submitted)
+    {
+        // 命令缓冲在 signalValue 达到之前仍被 GPU 使用，推进环到下一个槽位
+        DeviceManager::CommandBufferRing &ring = *queue->commandBufferRing;
+        ring.slots[ring.nextSlot].signalValue = lastSignalValue;
+        ring.nextSlot = (ring.nextSlot + 1) % ring.slots.size();
     }
 
     // 提交完成后清理已消费的 semaphore 状态，避免泄漏到后续的 pickQueueAndCommit 调用
@@ -562,145 +1197,619 @@ DeviceManager::QueueUtils *HardwareExecutorVulkan::pickQueueAndCommit(std::atomi
 
     queue->queueMutex->unlock();
 
-    return queue;
+    return submitted ? queue : nullptr;
 }
 
-HardwareExecutorVulkan &HardwareExecutorVulkan::commit()
+DeviceManager::QueueUtils *HardwareExecutorVulkan::submitRecordedCommands(std::atomic_uint16_t &currentQueueIndex,
+                                                                          std::vector<DeviceManager::QueueUtils> &currentQueues,
+                                                                          ExecutorCommandPool::RecordCommandBuffer &recordBuffer)
 {
-    if (commandList.size() > 0)
+    // 命令缓冲只能提交到与其 command pool 相同队列族的队列
+    QueueLockWait lockWait;
+    DeviceManager::QueueUtils *queue = lockQueueOfFamily(currentQueueIndex,
+                                                         currentQueues,
+                                                         currentQueues.front().queueFamilyIndex,
+                                                         priority,
+                                                         &lockWait);
+    if (queue == nullptr)
+    {
+        commandPool->release(recordBuffer);
+        return nullptr;
+    }
+    latencyStats->queueLockWait.record(lockWait.waitNs);
+    if (lockWait.blocked)
     {
+        latencyStats->contendedQueueLocks.fetch_add(1, std::memory_order_relaxed);
+    }
 
-        auto commitToQueue = [&](DeviceManager::QueueUtils *currentRecordQueue) -> bool {
-            this->currentRecordQueue = currentRecordQueue;
+    // ===== 首先清理已完成的资源 =====
+    cleanupCompletedResources();
 
-            vkResetCommandBuffer(currentRecordQueue->commandBuffer, 0);
+    submitPendingResources.swap(pendingResources);
 
-            VkCommandBufferBeginInfo beginInfo{};
-            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    const bool submitted = submitCommandBuffer(queue, recordBuffer.commandBuffer, submitPendingResources);
+    submitPendingResources.clear();
+    if (submitted)
+    {
+        commandPool->markSubmitted(recordBuffer, queue->timelineSemaphore, lastSignalValue);
+    }
+    else
+    {
+        commandPool->release(recordBuffer);
+    }
 
-            vkBeginCommandBuffer(currentRecordQueue->commandBuffer, &beginInfo);
+    waitSemaphores.clear();
+    signalSemaphores.clear();
+    waitFence = VK_NULL_HANDLE;
 
-            for (size_t i = 0; i < commandList.size(); i++)
-            {
-                CommandRecordVulkan::RequiredBarriers requiredBarriers = commandList[i]->getRequiredBarriers(*this);
+    queue->queueMutex->unlock();
 
-                if (!requiredBarriers.memoryBarriers.empty() || !requiredBarriers.bufferBarriers.empty() || !requiredBarriers.imageBarriers.empty())
-                {
-                    VkDependencyInfo dependencyInfo{};
-                    dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
-                    dependencyInfo.memoryBarrierCount = static_cast<uint32_t>(requiredBarriers.memoryBarriers.size());
-                    dependencyInfo.pMemoryBarriers = requiredBarriers.memoryBarriers.data();
-                    dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(requiredBarriers.bufferBarriers.size());
-                    dependencyInfo.pBufferMemoryBarriers = requiredBarriers.bufferBarriers.data();
-                    dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(requiredBarriers.imageBarriers.size());
-                    dependencyInfo.pImageMemoryBarriers = requiredBarriers.imageBarriers.data();
-                    dependencyInfo.pNext = nullptr;
-
-                    vkCmdPipelineBarrier2(currentRecordQueue->commandBuffer, &dependencyInfo);
-                }
+    return submitted ? queue : nullptr;
+}
 
-                if (commandList[i]->getExecutorType() != CommandRecordVulkan::ExecutorType::Invalid)
-                {
-                    commandList[i]->commitCommand(*this);
-                }
-            }
+void HardwareExecutorVulkan::recordCommandList(VkCommandBuffer commandBuffer,
+                                               size_t begin,
+                                               size_t end,
+                                               VkCommandBufferUsageFlags usageFlags)
+{
+    const uint64_t recordBeginNs = CommitLatencyStatsVulkan::nowNs();
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = usageFlags;
+    currentUsageFlags = usageFlags;
 
-            vkEndCommandBuffer(currentRecordQueue->commandBuffer);
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
-            return true;
-        };
+    resourceAccesses.clear();
 
-        CommandRecordVulkan::ExecutorType queueType = CommandRecordVulkan::ExecutorType::Transfer;
-        for (size_t i = 0; i < commandList.size(); i++)
+    hazardTracker.reset();
+
+    // 可重复提交的命令缓冲（命令包）不计时：同一查询块不能被多次在飞行中的提交同时写入
+    GpuProfilerVulkan::QueryBlock *profileBlock = nullptr;
+    if (GpuProfilerVulkan::isEnabled() && currentRecordBuffer != nullptr &&
+        (usageFlags & VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT) == 0)
+    {
+        profileBlock = hardwareContext->deviceManager.getGpuProfiler().beginBlock(commandBuffer, currentRecordBuffer->queueFamilyIndex);
+        currentRecordBuffer->profileBlock = profileBlock;
+    }
+
+    for (size_t i = begin; i < end; i++)
+    {
+        requestedBarriers.memoryBarriers.clear();
+        requestedBarriers.bufferBarriers.clear();
+        requestedBarriers.imageBarriers.clear();
+        commandList[i]->getRequiredBarriers(*this, requestedBarriers);
+
+        // 只保留真正存在冒险的屏障，合并为一次 vkCmdPipelineBarrier2
+        resolvedBarriers.memoryBarriers.clear();
+        resolvedBarriers.bufferBarriers.clear();
+        resolvedBarriers.imageBarriers.clear();
+        hazardTracker.resolve(requestedBarriers, resolvedBarriers);
+
+        if (!resolvedBarriers.memoryBarriers.empty() || !resolvedBarriers.bufferBarriers.empty() || !resolvedBarriers.imageBarriers.empty())
+        {
+            VkDependencyInfo dependencyInfo{};
+            dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+            dependencyInfo.memoryBarrierCount = static_cast<uint32_t>(resolvedBarriers.memoryBarriers.size());
+            dependencyInfo.pMemoryBarriers = resolvedBarriers.memoryBarriers.data();
+            dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(resolvedBarriers.bufferBarriers.size());
+            dependencyInfo.pBufferMemoryBarriers = resolvedBarriers.bufferBarriers.data();
+            dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(resolvedBarriers.imageBarriers.size());
+            dependencyInfo.pImageMemoryBarriers = resolvedBarriers.imageBarriers.data();
+            dependencyInfo.pNext = nullptr;
+
+            vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+        }
+
+        if (commandList[i]->getExecutorType() != CommandRecordVulkan::ExecutorType::Invalid)
         {
-            if (commandList[i]->getExecutorType() == CommandRecordVulkan::ExecutorType::Graphics)
+            const uint32_t profileRecord = profileBlock != nullptr
+                                               ? profileBlock->profiler->writeRecordBegin(commandBuffer, *profileBlock, commandList[i]->getDebugName())
+                                               : UINT32_MAX;
+
+            // 管线统计包住整条记录（光栅记录的渲染通道在其内部开始与结束）
+            ExecutorQueryPool::ActiveQuery statisticsQuery{};
+            if (pipelineStatisticsEnabled && hasActiveQueries() &&
+                commandList[i]->getExecutorType() != CommandRecordVulkan::ExecutorType::Transfer)
             {
-                queueType = CommandRecordVulkan::ExecutorType::Graphics;
-                break;
+                statisticsQuery = queryPool->beginQuery(commandBuffer,
+                                                        currentRecordBuffer->queryBlocks,
+                                                        ExecutorQueryPool::QueryKind::PipelineStatistics,
+                                                        currentRecordBuffer->queueFamilyIndex,
+                                                        commandList[i]->getDebugName(),
+                                                        0);
             }
-            else if (commandList[i]->getExecutorType() == CommandRecordVulkan::ExecutorType::Compute)
+
+            commandList[i]->commitCommand(*this);
+            commandList[i]->collectResourceAccesses(resourceAccesses);
+
+            endQuery(commandBuffer, statisticsQuery);
+
+            if (profileRecord != UINT32_MAX)
             {
-                queueType = CommandRecordVulkan::ExecutorType::Compute;
+                profileBlock->profiler->writeRecordEnd(commandBuffer, *profileBlock, profileRecord);
             }
         }
+    }
+
+    vkEndCommandBuffer(commandBuffer);
+
+    latencyStats->recording.record(CommitLatencyStatsVulkan::nowNs() - recordBeginNs);
+}
+
+void HardwareExecutorVulkan::setAsyncSubmit(bool enable)
+{
+    if (enable)
+    {
+        submitThread = &hardwareContext->deviceManager.getSubmitThread();
+    }
+    else
+    {
+        resolveAsyncSubmit();
+        submitThread = nullptr;
+    }
+}
+
+void HardwareExecutorVulkan::setPriority(DeviceManager::QueuePriority queuePriority)
+{
+    priority = queuePriority;
+}
+
+void HardwareExecutorVulkan::setPipelineStatistics(bool enable)
+{
+    if (enable && !queryPool)
+    {
+        queryPool = std::make_unique<ExecutorQueryPool>(hardwareContext->deviceManager);
+    }
+    if (enable && !queryPool->isSupported(ExecutorQueryPool::QueryKind::PipelineStatistics))
+    {
+        CFW_LOG_WARNING("Pipeline statistics queries are not supported on this device!");
+    }
+    pipelineStatisticsEnabled = enable;
+}
+
+void HardwareExecutorVulkan::setOcclusionQueries(bool enable)
+{
+    if (enable && !queryPool)
+    {
+        queryPool = std::make_unique<ExecutorQueryPool>(hardwareContext->deviceManager);
+    }
+    if (enable && !queryPool->isSupported(ExecutorQueryPool::QueryKind::Occlusion))
+    {
+        CFW_LOG_WARNING("Occlusion queries are not supported on this device!");
+    }
+    occlusionQueriesEnabled = enable;
+}
+
+void HardwareExecutorVulkan::takeQueryResults(std::vector<HardwarePipelineStatistics> &statistics, std::vector<HardwareOcclusionResult> &occlusion)
+{
+    // 异步提交的命令缓冲在回收后才带有 timeline 值
+    resolveAsyncSubmit();
+    if (queryPool)
+    {
+        queryPool->takeResults(statistics, occlusion);
+    }
+}
+
+bool HardwareExecutorVulkan::hasActiveQueries() const
+{
+    // 命令包可被多次同时提交，查询结果无法区分，不附加查询
+    return queryPool && (pipelineStatisticsEnabled || occlusionQueriesEnabled) && currentRecordBuffer != nullptr &&
+           (currentUsageFlags & VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT) == 0;
+}
+
+ExecutorQueryPool::ActiveQuery HardwareExecutorVulkan::beginOcclusionQuery(VkCommandBuffer commandBuffer,
+                                                                           const char *name,
+                                                                           uint32_t drawIndex,
+                                                                           uint32_t viewCount)
+{
+    if (!occlusionQueriesEnabled || !hasActiveQueries())
+    {
+        return {};
+    }
+    return queryPool->beginQuery(commandBuffer,
+                                 currentRecordBuffer->queryBlocks,
+                                 ExecutorQueryPool::QueryKind::Occlusion,
+                                 currentRecordBuffer->queueFamilyIndex,
+                                 name,
+                                 drawIndex,
+                                 viewCount);
+}
+
+void HardwareExecutorVulkan::endQuery(VkCommandBuffer commandBuffer, const ExecutorQueryPool::ActiveQuery &query)
+{
+    if (queryPool)
+    {
+        queryPool->endQuery(commandBuffer, query);
+    }
+}
+
+void HardwareExecutorVulkan::resolveAsyncSubmit()
+{
+    if (asyncRecordBuffers.empty())
+    {
+        return;
+    }
+
+    lastSubmissions.clear();
 
-        std::unique_lock<std::mutex> graphicsSubmitChainLock;
-        VkDevice graphicsSubmitChainDevice = VK_NULL_HANDLE;
-        if (queueType == CommandRecordVulkan::ExecutorType::Graphics)
+    for (size_t i = 0; i < asyncRecordBuffers.size(); i++)
+    {
+        SubmitBatchVulkan &batch = *asyncBatches[i];
+        if (batch.waitUntilProcessed())
         {
-            graphicsSubmitChainDevice = hardwareContext->deviceManager.getLogicalDevice();
-            graphicsSubmitChainLock = std::unique_lock<std::mutex>(gGraphicsSubmitChainMutex);
+            // 锁等待与 vkQueueSubmit2 由提交线程测得，同组合并提交的批次各自计入一次
+            latencyStats->queueLockWait.record(batch.queueLockWait.waitNs);
+            if (batch.queueLockWait.blocked)
+            {
+                latencyStats->contendedQueueLocks.fetch_add(1, std::memory_order_relaxed);
+            }
+            latencyStats->queueSubmit.record(batch.queueSubmitNs);
+            latencyStats->submits.fetch_add(1, std::memory_order_relaxed);
+
+            currentRecordQueue = batch.submittedQueue;
+            lastSignalValue = batch.signalValue;
+            lastSubmissions.push_back({currentRecordQueue, lastSignalValue});
+            commandPool->markSubmitted(*asyncRecordBuffers[i], currentRecordQueue->timelineSemaphore, lastSignalValue);
 
-            auto chainIt = gGraphicsSubmitChains.find(graphicsSubmitChainDevice);
-            if (chainIt != gGraphicsSubmitChains.end() &&
-                chainIt->second.semaphore != VK_NULL_HANDLE &&
-                chainIt->second.value > 0)
+            // 资源可能被任意一段使用，绑定到每个成功提交的段，全部完成后才真正释放
+            for (const auto &resource : asyncPendingResources)
             {
-                VkSemaphoreSubmitInfo graphicsChainWait{};
-                graphicsChainWait.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
-                graphicsChainWait.semaphore = chainIt->second.semaphore;
-                graphicsChainWait.value = chainIt->second.value;
-                graphicsChainWait.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
-                waitSemaphores.push_back(graphicsChainWait);
+                deferRelease(currentRecordQueue->timelineSemaphore, lastSignalValue, resource);
             }
         }
+        else
+        {
+            CFW_LOG_ERROR("Async submit failed in HardwareExecutorVulkan!");
+            latencyStats->failedSubmits.fetch_add(1, std::memory_order_relaxed);
+            commandPool->release(*asyncRecordBuffers[i]);
+        }
+    }
+
+    // 与同步路径 commit() 尾部一致：下一次提交等待本次提交完成
+    appendSubmissionWaits(waitSemaphores);
+
+    asyncPendingResources.clear();
+    asyncRecordBuffers.clear();
+}
+
+std::shared_ptr<CompletionTokenVulkan> HardwareExecutorVulkan::createCompletionToken()
+{
+    // 异步提交的 signal 值由提交线程分配，需先回收
+    resolveAsyncSubmit();
 
-        DeviceManager::QueueUtils *submittedQueue = nullptr;
-        switch (queueType)
+    if (lastSubmissions.empty())
+    {
+        return nullptr;
+    }
+
+    auto token = std::make_shared<CompletionTokenVulkan>();
+    token->deviceManager = lastSubmissions.front().queue->deviceManager;
+    token->semaphores.reserve(lastSubmissions.size());
+    token->values.reserve(lastSubmissions.size());
+    for (const SubmittedSegment &segment : lastSubmissions)
+    {
+        token->semaphores.push_back(segment.queue->timelineSemaphore);
+        token->values.push_back(segment.signalValue);
+    }
+    return token;
+}
+
+bool HardwareExecutorVulkan::selectQueues(CommandRecordVulkan::ExecutorType executorType,
+                                          std::atomic_uint16_t *&queueIndex,
+                                          std::vector<DeviceManager::QueueUtils> *&queues)
+{
+    DeviceManager &deviceManager = hardwareContext->deviceManager;
+    switch (executorType)
+    {
+    case CommandRecordVulkan::ExecutorType::Graphics:
+        queueIndex = &deviceManager.currentGraphicsQueueIndex;
+        queues = &deviceManager.graphicsQueues;
+        break;
+    case CommandRecordVulkan::ExecutorType::Compute:
+        if (!deviceManager.computeQueues.empty())
         {
-        case CommandRecordVulkan::ExecutorType::Graphics:
-            submittedQueue = pickQueueAndCommit(hardwareContext->deviceManager.currentGraphicsQueueIndex,
-                                                hardwareContext->deviceManager.graphicsQueues,
-                                                commitToQueue);
-            break;
-        case CommandRecordVulkan::ExecutorType::Compute:
-            if (!hardwareContext->deviceManager.computeQueues.empty())
+            queueIndex = &deviceManager.currentComputeQueueIndex;
+            queues = &deviceManager.computeQueues;
+        }
+        else
+        {
+            queueIndex = &deviceManager.currentGraphicsQueueIndex;
+            queues = &deviceManager.graphicsQueues;
+        }
+        break;
+    case CommandRecordVulkan::ExecutorType::Transfer:
+        if (!deviceManager.transferQueues.empty())
+        {
+            queueIndex = &deviceManager.currentTransferQueueIndex;
+            queues = &deviceManager.transferQueues;
+        }
+        else
+        {
+            queueIndex = &deviceManager.currentGraphicsQueueIndex;
+            queues = &deviceManager.graphicsQueues;
+        }
+        break;
+    default:
+        return false;
+    }
+
+    return !queues->empty();
+}
+
+void HardwareExecutorVulkan::buildQueueSegments()
+{
+    queueSegments.clear();
+
+    for (size_t i = 0; i < commandList.size(); i++)
+    {
+        std::atomic_uint16_t *queueIndex = nullptr;
+        std::vector<DeviceManager::QueueUtils> *queues = nullptr;
+        const bool selected = selectQueues(commandList[i]->getExecutorType(), queueIndex, queues);
+
+        // 命令包自带命令缓冲，与前后的记录都不能合并到同一段
+        const bool prerecorded = commandList[i]->isPrerecorded() ||
+                                 (!queueSegments.empty() && commandList[queueSegments.back().begin]->isPrerecorded());
+
+        // 同一队列族的命令缓冲可以提交到该族的任意队列，族相同的相邻记录无需拆分
+        if (!queueSegments.empty() && !prerecorded &&
+            (!selected || queueSegments.back().queues->front().queueFamilyIndex == queues->front().queueFamilyIndex))
+        {
+            queueSegments.back().end = i + 1;
+            continue;
+        }
+
+        if (!selected && !selectQueues(CommandRecordVulkan::ExecutorType::Transfer, queueIndex, queues))
+        {
+            CFW_LOG_ERROR("No valid queue for command in HardwareExecutorVulkan!");
+            continue;
+        }
+
+        queueSegments.push_back({queueIndex, queues, i, i + 1});
+    }
+}
+
+ExecutorCommandPool::RecordCommandBuffer *HardwareExecutorVulkan::recordReusable(uint32_t &queueFamilyIndex)
+{
+    ExecutorCommandPool::RecordCommandBuffer *recordBuffer = nullptr;
+
+    buildQueueSegments();
+
+    const bool nested = std::any_of(commandList.begin(), commandList.end(), [](CommandRecordVulkan *record) {
+        return record->isPrerecorded();
+    });
+
+    if (queueSegments.size() != 1 || nested)
+    {
+        CFW_LOG_ERROR("Command bundle must contain commands of a single queue family and no nested bundles!");
+    }
+    else
+    {
+        const QueueSegment &segment = queueSegments.front();
+        queueFamilyIndex = segment.queues->front().queueFamilyIndex;
+
+        recordBuffer = ensureCommandPool().acquire(queueFamilyIndex);
+        if (recordBuffer != nullptr)
+        {
+            // 命令包可能同时处于多次提交中，不能使用 ONE_TIME_SUBMIT
+            currentCommandBuffer = recordBuffer->commandBuffer;
+            currentRecordBuffer = recordBuffer;
+            recordCommandList(currentCommandBuffer, segment.begin, segment.end, VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT);
+            currentCommandBuffer = VK_NULL_HANDLE;
+            currentRecordBuffer = nullptr;
+        }
+    }
+
+    commandList.clear();
+    queueSegments.clear();
+    return recordBuffer;
+}
+
+VkCommandBuffer HardwareExecutorVulkan::acquireSecondaryCommandBuffer(uint32_t shardIndex)
+{
+    if (currentRecordBuffer == nullptr)
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    ExecutorCommandPool::RecordCommandBuffer *secondary = commandPool->acquireSecondary(*currentRecordBuffer, shardIndex);
+    return secondary != nullptr ? secondary->commandBuffer : VK_NULL_HANDLE;
+}
+
+void HardwareExecutorVulkan::appendSubmissionWaits(std::vector<VkSemaphoreSubmitInfo> &waits) const
+{
+    for (const SubmittedSegment &segment : lastSubmissions)
+    {
+        VkSemaphoreSubmitInfo timelineWaitSemaphoreSubmitInfo{};
+        timelineWaitSemaphoreSubmitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+        timelineWaitSemaphoreSubmitInfo.semaphore = segment.queue->timelineSemaphore;
+        // 使用提交时记录的确切 signal 值，
+        // 避免在 mutex 释放后读取可能已被其他线程递增的 timelineValue
+        timelineWaitSemaphoreSubmitInfo.value = segment.signalValue;
+        timelineWaitSemaphoreSubmitInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        waits.push_back(timelineWaitSemaphoreSubmitInfo);
+    }
+}
+
+HardwareExecutorVulkan &HardwareExecutorVulkan::commit()
+{
+    // 上一次异步提交的结果必须先回收，才能复用批次对象
+    resolveAsyncSubmit();
+    prerecordedBuffers.clear();
+    latencyStats->commits.fetch_add(1, std::memory_order_relaxed);
+
+    const uint64_t commitBeginNs = GpuProfilerVulkan::isEnabled() ? GpuProfilerVulkan::hostNowNs() : 0;
+    bool asyncSubmitted = false;
+
+    if (commandList.size() > 0)
+    {
+        buildQueueSegments();
+        prerecordedBuffers.reserve(queueSegments.size());
+
+        // 用户的 wait（含上一次 commit 的自等待）作用于每一段，signal/fence 只挂在最后一段
+        commitWaitSemaphores.assign(waitSemaphores.begin(), waitSemaphores.end());
+        commitSignalSemaphores.assign(signalSemaphores.begin(), signalSemaphores.end());
+        const VkFence commitFence = waitFence;
+        const bool joinSegments = !commitSignalSemaphores.empty() || commitFence != VK_NULL_HANDLE;
+
+        // commit 之前加入的资源可能被任意一段使用
+        commitPendingResources.swap(pendingResources);
+        pendingResources.clear();
+
+        lastSubmissions.clear();
+        SubmitBatchVulkan *previousBatch = nullptr;
+
+        // 跨队列族的段之间只有依赖跟踪器推导出的等待；一旦有记录未上报全部访问（bindless 等），
+        // 跟踪器无法证明与前序段无关，之后的每一段都等待前一段完成
+        bool accessesDeclared = true;
+
+        for (size_t segmentIndex = 0; segmentIndex < queueSegments.size(); segmentIndex++)
+        {
+            const QueueSegment &segment = queueSegments[segmentIndex];
+            const bool lastSegment = segmentIndex + 1 == queueSegments.size();
+
+            for (size_t i = segment.begin; i < segment.end && accessesDeclared; i++)
+            {
+                accessesDeclared = commandList[i]->declaresAllAccesses();
+            }
+            const bool chainPreviousSegment = segmentIndex > 0 && !accessesDeclared;
+
+            ExecutorCommandPool::RecordCommandBuffer *recordBuffer = nullptr;
+            if (commandList[segment.begin]->isPrerecorded())
             {
-                submittedQueue = pickQueueAndCommit(hardwareContext->deviceManager.currentComputeQueueIndex,
-                                                    hardwareContext->deviceManager.computeQueues,
-                                                    commitToQueue);
+                // 命令包：只校验并应用布局变化，提交状态记在执行器自己的条目上，多个执行器可同时提交同一命令包
+                const VkCommandBuffer prerecordedBuffer =
+                    commandList[segment.begin]->replayPrerecorded(*this, segment.queues->front().queueFamilyIndex);
+
+                // 失效的命令包不能执行，但本段仍要提交：最后一段携带用户的 signal 与 fence，
+                // 跳过会让等待它们的调用方永远挂起。以不含命令缓冲的空提交代替，并计入 droppedSegments
+                recordBuffer = &prerecordedBuffers.emplace_back();
+                recordBuffer->commandBuffer = prerecordedBuffer;
+                recordBuffer->inUse = true;
+
+                resourceAccesses.clear();
+                if (prerecordedBuffer != VK_NULL_HANDLE)
+                {
+                    commandList[segment.begin]->collectResourceAccesses(resourceAccesses);
+                }
+                else
+                {
+                    CFW_LOG_ERROR("Command bundle is no longer valid, its segment is submitted without commands in HardwareExecutorVulkan!");
+                    latencyStats->droppedSegments.fetch_add(1, std::memory_order_relaxed);
+                }
             }
             else
             {
-                submittedQueue = pickQueueAndCommit(hardwareContext->deviceManager.currentGraphicsQueueIndex,
-                                                    hardwareContext->deviceManager.graphicsQueues,
-                                                    commitToQueue);
+                recordBuffer = ensureCommandPool().acquire(segment.queues->front().queueFamilyIndex);
+                if (recordBuffer != nullptr)
+                {
+                    // 录制不持有任何队列锁，多个线程的执行器可以并行录制
+                    currentCommandBuffer = recordBuffer->commandBuffer;
+                    currentRecordBuffer = recordBuffer;
+                    recordCommandList(currentCommandBuffer, segment.begin, segment.end);
+                    currentCommandBuffer = VK_NULL_HANDLE;
+                    currentRecordBuffer = nullptr;
+                }
+                else
+                {
+                    // 与失效的命令包相同：以空提交保留本段的等待与 signal/fence
+                    CFW_LOG_ERROR("Failed to acquire a command buffer, its segment is submitted without commands in HardwareExecutorVulkan!");
+                    latencyStats->droppedSegments.fetch_add(1, std::memory_order_relaxed);
+                    recordBuffer = &prerecordedBuffers.emplace_back();
+                    recordBuffer->inUse = true;
+                    resourceAccesses.clear();
+                }
             }
-            break;
-        case CommandRecordVulkan::ExecutorType::Transfer:
-            if (!hardwareContext->deviceManager.transferQueues.empty())
+
+            waitSemaphores.assign(commitWaitSemaphores.begin(), commitWaitSemaphores.end());
+            signalSemaphores.clear();
+            waitFence = VK_NULL_HANDLE;
+            if (lastSegment)
             {
-                submittedQueue = pickQueueAndCommit(hardwareContext->deviceManager.currentTransferQueueIndex,
-                                                    hardwareContext->deviceManager.transferQueues,
-                                                    commitToQueue);
+                signalSemaphores.assign(commitSignalSemaphores.begin(), commitSignalSemaphores.end());
+                waitFence = commitFence;
+            }
+
+            if (submitThread != nullptr)
+            {
+                // 异步提交：批次交给提交线程，资源依赖与 timeline 值都由提交线程处理
+                const size_t batchIndex = asyncRecordBuffers.size();
+                if (batchIndex == asyncBatches.size())
+                {
+                    asyncBatches.push_back(std::make_shared<SubmitBatchVulkan>());
+                }
+
+                SubmitBatchVulkan &batch = *asyncBatches[batchIndex];
+                batch.queueIndex = segment.queueIndex;
+                batch.queues = segment.queues;
+                batch.priority = priority;
+                batch.commandBuffer = recordBuffer->commandBuffer;
+                batch.waitSemaphores.swap(waitSemaphores);
+                batch.signalSemaphores.swap(signalSemaphores);
+                batch.fence = waitFence;
+                batch.resourceAccesses.swap(resourceAccesses);
+                batch.previousSegment = previousBatch;
+                batch.joinPreviousSegments = lastSegment && joinSegments;
+                batch.waitPreviousSegment = chainPreviousSegment;
+                batch.state.store(SubmitBatchVulkan::State::Pending, std::memory_order_relaxed);
+
+                asyncRecordBuffers.push_back(recordBuffer);
+                for (auto &resource : pendingResources)
+                {
+                    asyncPendingResources.push_back(std::move(resource));
+                }
+                pendingResources.clear();
+
+                submitThread->enqueue(&batch);
+                previousBatch = &batch;
+                asyncSubmitted = true;
+                continue;
+            }
+
+            if (lastSegment && joinSegments)
+            {
+                appendSubmissionWaits(waitSemaphores);
+            }
+            else if (chainPreviousSegment && !lastSubmissions.empty())
+            {
+                VkSemaphoreSubmitInfo previousSegmentWaitInfo{};
+                previousSegmentWaitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+                previousSegmentWaitInfo.semaphore = lastSubmissions.back().queue->timelineSemaphore;
+                previousSegmentWaitInfo.value = lastSubmissions.back().signalValue;
+                previousSegmentWaitInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+                waitSemaphores.push_back(previousSegmentWaitInfo);
+            }
+
+            if (lastSegment)
+            {
+                for (auto &resource : commitPendingResources)
+                {
+                    pendingResources.push_back(std::move(resource));
+                }
+                commitPendingResources.clear();
             }
             else
             {
-                submittedQueue = pickQueueAndCommit(hardwareContext->deviceManager.currentGraphicsQueueIndex,
-                                                    hardwareContext->deviceManager.graphicsQueues,
-                                                    commitToQueue);
+                pendingResources.insert(pendingResources.end(), commitPendingResources.begin(), commitPendingResources.end());
             }
-            break;
-        case CommandRecordVulkan::ExecutorType::Invalid:
-            CFW_LOG_ERROR("No valid command to commit in HardwareExecutorVulkan!");
-            break;
-        default:
-            CFW_LOG_ERROR("Unknown executor type in HardwareExecutorVulkan!");
-            break;
+
+            submitRecordedCommands(*segment.queueIndex, *segment.queues, *recordBuffer);
         }
 
-        if (queueType == CommandRecordVulkan::ExecutorType::Graphics &&
-            submittedQueue != nullptr &&
-            graphicsSubmitChainDevice != VK_NULL_HANDLE &&
-            this->currentRecordQueue != nullptr &&
-            this->lastSignalValue > 0)
+        if (asyncSubmitted)
         {
-            gGraphicsSubmitChains[graphicsSubmitChainDevice] =
-                {this->currentRecordQueue->timelineSemaphore, this->lastSignalValue};
+            for (auto &resource : commitPendingResources)
+            {
+                asyncPendingResources.push_back(std::move(resource));
+            }
         }
 
         commandList.clear();
+        resourceAccesses.clear();
+        commitWaitSemaphores.clear();
+        commitSignalSemaphores.clear();
+        commitPendingResources.clear();
     }
 
     {
@@ -708,18 +1817,20 @@ HardwareExecutorVulkan &HardwareExecutorVulkan::commit()
         signalSemaphores.clear();
         waitFence = VK_NULL_HANDLE;
 
-        if (this->currentRecordQueue != nullptr)
+        // 异步提交的自等待在 resolveAsyncSubmit 中拿到 signal 值后追加
+        if (!asyncSubmitted)
         {
-            VkSemaphoreSubmitInfo timelineWaitSemaphoreSubmitInfo{};
-            timelineWaitSemaphoreSubmitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
-            timelineWaitSemaphoreSubmitInfo.semaphore = currentRecordQueue->timelineSemaphore;
-            // 使用 pickQueueAndCommit 中记录的确切 signal 值，
-            // 避免在 mutex 释放后读取可能已被其他线程递增的 timelineValue
-            timelineWaitSemaphoreSubmitInfo.value = this->lastSignalValue;
-            timelineWaitSemaphoreSubmitInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
-            waitSemaphores.push_back(timelineWaitSemaphoreSubmitInfo);
+            appendSubmissionWaits(waitSemaphores);
         }
     }
 
+    if (commitBeginNs != 0)
+    {
+        hardwareContext->deviceManager.getGpuProfiler().addCpuSpan("HardwareExecutor::commit", commitBeginNs, GpuProfilerVulkan::hostNowNs());
+    }
+
+    // 顺带回收 timeline 已经达到的延迟销毁资源，墓地为空时只读一个原子计数
+    hardwareContext->resourceManager.collectGraveyard();
+
     return *this;
 }
@@ -1,17 +1,43 @@
 ﻿#pragma once
 
 #include <atomic>
+#include <deque>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include "HardwareWrapperVulkan/HardwareContext.h"
+#include "CommitLatencyStatsVulkan.h"
+#include "ExecutorQueryPool.h"
+#include "GpuProfilerVulkan.h"
+#include "HardwareMetricsVulkan.h"
 #include "CabbageHardware.h"
 
 struct HardwareExecutorVulkan;
 struct CommandRecordVulkan;
+struct SubmitBatchVulkan;
+struct CompletionTokenVulkan;
+class SubmitThreadVulkan;
+
+// 在 queues 中锁定一个属于 queueFamilyIndex、优先级类别与 priority 最接近的队列：
+// 优先取没有未完成提交且锁空闲的队列，否则阻塞在负载最小的队列上；
+// 返回已加锁的队列，没有匹配队列时返回 nullptr。lockWait 非空时写入本次的等锁情况
+DeviceManager::QueueUtils *lockQueueOfFamily(std::atomic_uint16_t &queueIndex,
+                                             std::vector<DeviceManager::QueueUtils> &queues,
+                                             uint32_t queueFamilyIndex,
+                                             DeviceManager::QueuePriority priority,
+                                             QueueLockWait *lockWait = nullptr);
+
+// 合并 wait/signal 列表中重复的 semaphore，修正同一 semaphore 的 signal 值，并校验 timeline 状态；
+// 缓存或查询确认已经达到的 timeline 等待会被剔除。返回 false 表示 semaphore 已损坏或设备丢失，应放弃本次提交
+bool prepareSubmitSemaphores(TimelineValueCache &timelineValueCache,
+                             const std::vector<VkSemaphoreSubmitInfo> &waitSemaphores,
+                             const std::vector<VkSemaphoreSubmitInfo> &signalSemaphores,
+                             std::vector<VkSemaphoreSubmitInfo> &mergedWaitSemaphores,
+                             std::vector<VkSemaphoreSubmitInfo> &mergedSignalSemaphores);
 
 struct CopyCommandImpl
 {
@@ -37,6 +63,125 @@ struct DeferredRelease
     VkSemaphore semaphore;                     // 对应的 timeline semaphore
 };
 
+// ========== 单个 timeline semaphore 的延迟释放环 ==========
+// 同一 semaphore 上的提交按 timeline 值递增入队，只需从队头弹出已完成的条目，摊还 O(1)；
+// 槽位容量按 2 的幂增长并循环复用，稳态下不再分配内存
+struct DeferredReleaseRing
+{
+    VkSemaphore semaphore{VK_NULL_HANDLE};
+    uint64_t newestValue{0};         // 已入队条目中最大的 timeline 值，等待全部完成时使用
+    std::vector<DeferredRelease> slots;
+    size_t head{0};
+    size_t count{0};
+
+    [[nodiscard]] bool empty() const
+    {
+        return count == 0;
+    }
+
+    DeferredRelease &front()
+    {
+        return slots[head];
+    }
+
+    [[nodiscard]] const DeferredRelease &front() const
+    {
+        return slots[head];
+    }
+
+    void push(DeferredRelease &&entry);
+
+    // 释放队头条目持有的资源
+    void pop()
+    {
+        slots[head].resource.reset();
+        head = (head + 1) & (slots.size() - 1);
+        --count;
+        HardwareMetricsVulkan::get().removeDeferredRelease();
+    }
+
+    void clear()
+    {
+        while (count > 0)
+        {
+            pop();
+        }
+        head = 0;
+        newestValue = 0;
+    }
+};
+
+// ========== 执行器私有的命令缓冲池 ==========
+// 录制发生在队列锁之外，每个执行器按队列族持有自己的 VkCommandPool，
+// 命令缓冲通过提交时的 timeline 值判断 GPU 是否已用完，之后即可复用。
+// 池本身不加锁：只有创建它的执行器调用 acquire/markSubmitted/release 并在其命令缓冲上录制。
+// 执行器的拷贝不共享池，首次录制时创建自己的池；公开的 HardwareExecutor 拷贝共享同一个 HardwareExecutorVulkan，
+// 经 gExecutorStorage 的写句柄串行访问。命令包持有的引用只为让 VkCommandPool 活过其录制的命令缓冲，不会再从池中获取
+struct ExecutorCommandPool
+{
+    struct RecordCommandBuffer
+    {
+        VkCommandBuffer commandBuffer{VK_NULL_HANDLE};
+        VkSemaphore semaphore{VK_NULL_HANDLE}; // 最近一次提交所在队列的 timeline semaphore
+        uint64_t signalValue{0};               // semaphore 达到此值后命令缓冲可复用
+        uint32_t queueFamilyIndex{UINT32_MAX};
+        bool inUse{false};                     // 正在录制或等待提交
+        std::vector<RecordCommandBuffer *> secondaries; // 在本命令缓冲中执行的二级命令缓冲，随之提交与回收
+        GpuProfilerVulkan::QueryBlock *profileBlock{nullptr}; // 启用分析时本次录制借用的时间戳查询块
+        std::vector<ExecutorQueryPool::QueryBlock *> queryBlocks; // 本次录制使用的统计/遮挡查询块，随之提交
+    };
+
+    // 二级命令缓冲按分片各用一个 pool：pool 需要外部同步，不同分片才能在不同线程上同时录制
+    struct ShardPool
+    {
+        VkCommandPool commandPool{VK_NULL_HANDLE};
+        std::deque<RecordCommandBuffer> commandBuffers;
+    };
+
+    struct FamilyPool
+    {
+        uint32_t queueFamilyIndex{UINT32_MAX};
+        VkCommandPool commandPool{VK_NULL_HANDLE};
+        std::deque<RecordCommandBuffer> commandBuffers; // deque 保证扩容时已发出的指针不失效
+        std::deque<ShardPool> shardPools;
+    };
+
+    ExecutorCommandPool(VkDevice logicalDevice, TimelineValueCache &timelineValueCache)
+        : device(logicalDevice), timelineValueCache(timelineValueCache)
+    {
+    }
+
+    ~ExecutorCommandPool();
+
+    ExecutorCommandPool(const ExecutorCommandPool &) = delete;
+    ExecutorCommandPool &operator=(const ExecutorCommandPool &) = delete;
+
+    // 获取一个已重置、可直接 vkBeginCommandBuffer 的命令缓冲
+    RecordCommandBuffer *acquire(uint32_t queueFamilyIndex);
+
+    // 为 primary 的第 shardIndex 个分片获取一个已重置的二级命令缓冲，登记到 primary.secondaries；
+    // 只在录制 primary 的线程上调用，得到的命令缓冲随后可交给其他线程录制
+    RecordCommandBuffer *acquireSecondary(RecordCommandBuffer &primary, uint32_t shardIndex);
+
+    // 提交成功：命令缓冲在 semaphore 达到 signalValue 后回收
+    void markSubmitted(RecordCommandBuffer &recordBuffer, VkSemaphore semaphore, uint64_t signalValue);
+
+    // 未提交（录制或提交失败）：直接归还
+    void release(RecordCommandBuffer &recordBuffer);
+
+    VkDevice device{VK_NULL_HANDLE};
+    TimelineValueCache &timelineValueCache;
+    std::deque<FamilyPool> familyPools;
+
+  private:
+    FamilyPool *findFamilyPool(uint32_t queueFamilyIndex);
+
+    // 复用 commandBuffers 中 GPU 已执行完毕的命令缓冲，全部在飞行中时从 commandPool 分配新的
+    RecordCommandBuffer *acquireFrom(VkCommandPool commandPool,
+                                     std::deque<RecordCommandBuffer> &commandBuffers,
+                                     VkCommandBufferLevel level);
+};
+
 struct CommandRecordVulkan
 {
     enum class ExecutorType
@@ -61,9 +206,9 @@ struct CommandRecordVulkan
     {
     }
 
-    virtual RequiredBarriers getRequiredBarriers(HardwareExecutorVulkan &executor)
+    // 把本记录需要的屏障追加到 requiredBarriers；容器由执行器跨记录复用，避免每条记录分配
+    virtual void getRequiredBarriers(HardwareExecutorVulkan &executor, RequiredBarriers &requiredBarriers)
     {
-        return RequiredBarriers{};
     }
 
     virtual ExecutorType getExecutorType()
@@ -71,10 +216,79 @@ struct CommandRecordVulkan
         return ExecutorType::Invalid;
     }
 
+    // 上报本记录读写的缓冲/图像（在 commitCommand 之后调用），提交时据此推导跨提交的依赖
+    virtual void collectResourceAccesses(std::vector<ResourceAccessVulkan> &accesses)
+    {
+    }
+
+    // collectResourceAccesses 是否覆盖了本记录的全部访问；
+    // 默认否（bindless 等途径访问的资源无法上报），执行器据此把所在段串行到前一段之后
+    [[nodiscard]] virtual bool declaresAllAccesses() const
+    {
+        return false;
+    }
+
+    // 性能分析中显示的名称
+    [[nodiscard]] virtual const char *getDebugName() const
+    {
+        return "CommandRecord";
+    }
+
+    // 上报本记录当前绑定的缓冲与图像，不改变记录状态；
+    // 命令包在录制前后据此记录图像布局，并在回放前比对以发现绑定变化
+    virtual void collectBindings(std::vector<VkBuffer> &buffers, std::vector<ResourceManager::ImageHardwareWrap *> &images)
+    {
+    }
+
+    // 预录制的记录（命令包）自带命令缓冲：执行器让它单独成段，提交时不再录制
+    [[nodiscard]] virtual bool isPrerecorded() const
+    {
+        return false;
+    }
+
+    // 校验预录制的命令缓冲仍可用于 queueFamilyIndex 并应用其布局变化；
+    // 返回 VK_NULL_HANDLE 表示已失效，本段放弃提交
+    virtual VkCommandBuffer replayPrerecorded(HardwareExecutorVulkan &executor, uint32_t queueFamilyIndex)
+    {
+        return VK_NULL_HANDLE;
+    }
+
   protected:
     ExecutorType executorType{ExecutorType::Invalid};
 };
 
+// ========== 命令缓冲内的资源状态跟踪 ==========
+// 记录当前命令缓冲中每个缓冲/图像最近的访问，把各记录给出的保守屏障改写为最小屏障：
+// 读后读、以及命令缓冲内首次且无布局变化的访问直接省略（跨提交的依赖已由 timeline semaphore 等待覆盖）。
+// 请求了全局内存屏障的记录视为访问集合不完整：其后的下一条记录无论如何都会得到一个全局屏障，
+// 避免它经 bindless 间接读写的资源被后续只声明具体资源的记录当作“首次访问”而漏掉依赖
+struct CommandHazardTracker
+{
+    struct AccessState
+    {
+        VkPipelineStageFlags2 writeStages{VK_PIPELINE_STAGE_2_NONE};   // 最近一次写入（含布局转换）的阶段
+        VkAccessFlags2 writeAccess{VK_ACCESS_2_NONE};
+        VkPipelineStageFlags2 readStages{VK_PIPELINE_STAGE_2_NONE};    // 最近一次写入之后发生读取的阶段
+        VkPipelineStageFlags2 visibleStages{VK_PIPELINE_STAGE_2_NONE}; // 最近一次写入已对其可见的阶段/访问
+        VkAccessFlags2 visibleAccess{VK_ACCESS_2_NONE};
+        uint64_t epoch{0}; // 不等于 currentEpoch 的条目属于之前的命令缓冲，视为首次访问
+    };
+
+    // 开始新的命令缓冲：只推进 epoch，保留哈希表节点以免每次录制重新分配
+    void reset();
+
+    // 过滤 requested 中的屏障，仍然需要的屏障改写 src 范围后追加到 resolved
+    void resolve(const CommandRecordVulkan::RequiredBarriers &requested, CommandRecordVulkan::RequiredBarriers &resolved);
+
+    std::unordered_map<VkBuffer, AccessState> bufferStates;
+    std::unordered_map<VkImage, AccessState> imageStates;
+    uint64_t currentEpoch{1};
+    bool untrackedAccessPending{false}; // 上一条记录有未声明的访问
+
+    // 曾访问过的资源超过此数量时才真正清空，避免已销毁资源的条目无限累积
+    static constexpr size_t MAX_RETAINED_STATES = 4096;
+};
+
 struct HardwareExecutorVulkan
 {
     explicit HardwareExecutorVulkan(std::shared_ptr<HardwareContext::HardwareUtils> context)
@@ -84,22 +298,36 @@ struct HardwareExecutorVulkan
         {
             throw std::invalid_argument("Hardware context cannot be null");
         }
+        commandPool = std::make_shared<ExecutorCommandPool>(hardwareContext->deviceManager.getLogicalDevice(),
+                                                            hardwareContext->deviceManager.getTimelineValueCache());
         // 预分配以减少重分配
         pendingResources.reserve(32);
-        deferredReleaseQueue.reserve(128);
+        submitPendingResources.reserve(32);
+        deferredReleaseRings.reserve(8);
+        commandList.reserve(32);
     }
 
     // 兼容旧代码的构造函数，但建议逐步废弃，建议在调用处显式传递
     explicit HardwareExecutorVulkan()
         : hardwareContext(globalHardwareContext.getMainDevice())
     {
+        commandPool = std::make_shared<ExecutorCommandPool>(hardwareContext->deviceManager.getLogicalDevice(),
+                                                            hardwareContext->deviceManager.getTimelineValueCache());
         // 预分配以减少重分配
         pendingResources.reserve(32);
-        deferredReleaseQueue.reserve(128);
+        submitPendingResources.reserve(32);
+        deferredReleaseRings.reserve(8);
+        commandList.reserve(32);
     }
 
     ~HardwareExecutorVulkan();
 
+    // 拷贝只继承最近一次 commit 的提交点（供 wait 使用）、所属设备与提交设置；
+    // 命令池、待提交命令、延迟释放与查询都留在原执行器，拷贝在首次录制时创建自己的命令池，两者可在不同线程上同时使用。
+    // 原执行器若有未回收的异步批次，应先 resolveAsyncSubmit，否则拷贝看不到最近一次提交
+    HardwareExecutorVulkan(const HardwareExecutorVulkan &other);
+    HardwareExecutorVulkan &operator=(const HardwareExecutorVulkan &) = delete;
+
     HardwareExecutorVulkan &operator<<(CommandRecordVulkan *commandRecord)
     {
         if (commandRecord && commandRecord->getExecutorType() != CommandRecordVulkan::ExecutorType::Invalid)
@@ -125,19 +353,23 @@ struct HardwareExecutorVulkan
 
     HardwareExecutorVulkan &wait(HardwareExecutorVulkan &other)
     {
-        if (other)
+        // 异步提交时需要先拿到提交线程回填的队列与 timeline 值
+        other.resolveAsyncSubmit();
+
+        // 一次 commit 可能拆分到多个队列，需要等待其中每一段的 signal
+        for (const SubmittedSegment &segment : other.lastSubmissions)
         {
             // 跨设备时自动解析为本设备可用的 imported semaphore；同设备零开销直接返回
             VkSemaphore resolvedSemaphore = hardwareContext->deviceManager.getOrImportTimelineSemaphore(
-                *other.currentRecordQueue);
+                *segment.queue);
 
             if (resolvedSemaphore == VK_NULL_HANDLE)
             {
                 // CPU-bridge fallback：跨设备 semaphore 导入不可用（不同架构 GPU），
                 // 回退到 host 侧等待外部设备完成，再让本地 GPU 继续
-                uint64_t waitValue = other.lastSignalValue;
-                VkSemaphore foreignSem = other.currentRecordQueue->timelineSemaphore;
-                VkDevice foreignDevice = other.currentRecordQueue->deviceManager->getLogicalDevice();
+                uint64_t waitValue = segment.signalValue;
+                VkSemaphore foreignSem = segment.queue->timelineSemaphore;
+                VkDevice foreignDevice = segment.queue->deviceManager->getLogicalDevice();
 
                 VkSemaphoreWaitInfo cpuWaitInfo{};
                 cpuWaitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
@@ -154,13 +386,13 @@ struct HardwareExecutorVulkan
                                   static_cast<int>(r));
                 }
                 // 外部 GPU 工作已在 CPU 时间线上确认完成，无需添加 GPU 侧 wait semaphore
-                return *this;
+                continue;
             }
 
             VkSemaphoreSubmitInfo timelineWaitSemaphoreSubmitInfo{};
             timelineWaitSemaphoreSubmitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
             timelineWaitSemaphoreSubmitInfo.semaphore = resolvedSemaphore;
-            timelineWaitSemaphoreSubmitInfo.value = other.lastSignalValue;
+            timelineWaitSemaphoreSubmitInfo.value = segment.signalValue;
             timelineWaitSemaphoreSubmitInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
             waitSemaphores.push_back(timelineWaitSemaphoreSubmitInfo);
         }
@@ -175,6 +407,36 @@ struct HardwareExecutorVulkan
     HardwareExecutorVulkan &commit();
     //HardwareExecutorVulkan &commitTest();
 
+    // ========== 异步提交 ==========
+    // 启用后 commit() 只在调用线程录制命令缓冲，随后无锁入队给设备的提交线程，
+    // 由其合并批次调用 vkQueueSubmit2；提交结果在下次 commit/wait 时回收
+    void setAsyncSubmit(bool enable);
+    void setPriority(DeviceManager::QueuePriority queuePriority);
+
+    // ========== 管线统计与遮挡查询 ==========
+    void setPipelineStatistics(bool enable);
+    void setOcclusionQueries(bool enable);
+    void takeQueryResults(std::vector<HardwarePipelineStatistics> &statistics, std::vector<HardwareOcclusionResult> &occlusion);
+
+    // 当前录制中是否有查询处于启用状态；二级命令缓冲无法继承查询（需 inheritedQueries），此时光栅管线退回内联录制
+    [[nodiscard]] bool hasActiveQueries() const;
+
+    // 光栅管线在每次绘制前后调用；未启用时返回空查询，endQuery 对空查询不做任何事
+    ExecutorQueryPool::ActiveQuery beginOcclusionQuery(VkCommandBuffer commandBuffer, const char *name, uint32_t drawIndex, uint32_t viewCount);
+    void endQuery(VkCommandBuffer commandBuffer, const ExecutorQueryPool::ActiveQuery &query);
+    void resolveAsyncSubmit();
+
+    // 最近一次 commit 所有队列段的完成令牌；尚未提交过时返回 nullptr
+    std::shared_ptr<CompletionTokenVulkan> createCompletionToken();
+
+    // 把 commandList 录制为可重复提交的命令缓冲（SIMULTANEOUS_USE）而不提交，供命令包使用；
+    // 全部记录必须落在同一队列族。成功时命令缓冲归 commandPool 所有，resourceAccesses 与 pendingResources 保留录制结果
+    ExecutorCommandPool::RecordCommandBuffer *recordReusable(uint32_t &queueFamilyIndex);
+
+    // 为当前正在录制的主命令缓冲取得第 shardIndex 个二级命令缓冲，随主命令缓冲一起提交与回收；
+    // 只能在录制线程调用（返回的命令缓冲可交给工作线程录制），失败时返回 VK_NULL_HANDLE
+    VkCommandBuffer acquireSecondaryCommandBuffer(uint32_t shardIndex);
+
     // ========== 延迟释放相关接口 ==========
     void cleanupCompletedResources();
     void waitForAllDeferredResources();
@@ -186,30 +448,164 @@ struct HardwareExecutorVulkan
         size_t totalSemaphores = 0;  // 涉及的 semaphore 数量
         uint64_t oldestTimeline = 0; // 最老的等待 timeline
         uint64_t newestTimeline = 0; // 最新的等待 timeline
+
+        // 回收开销（cleanupCompletedResources 累计）
+        uint64_t cleanupCalls = 0;           // 调用次数
+        uint64_t retiredResources = 0;       // 累计释放的资源数
+        uint64_t semaphoreQueries = 0;       // 累计 vkGetSemaphoreCounterValue 调用次数
+        uint64_t totalCleanupNs = 0;         // 累计耗时（纳秒），包含资源析构
+        uint64_t lastCleanupNs = 0;          // 最近一次的耗时（纳秒）
+        size_t lastCleanupRetired = 0;       // 最近一次释放的资源数
     };
     DeferredReleaseStats getDeferredReleaseStats() const;
 
+    // 提交路径的 CPU 侧延迟：队列锁竞争、命令缓冲槽位的 GPU 反压、录制与 vkQueueSubmit2 各自的分布
+    struct CommitLatencyStats
+    {
+        uint64_t commits = 0;
+        uint64_t submits = 0;
+        uint64_t failedSubmits = 0;
+        uint64_t droppedSegments = 0;
+        uint64_t contendedQueueLocks = 0;
+        uint64_t timelineWaitTimeouts = 0;
+
+        LatencyHistogramVulkan::Summary queueLockWait;
+        LatencyHistogramVulkan::Summary timelineWait;
+        LatencyHistogramVulkan::Summary recording;
+        LatencyHistogramVulkan::Summary queueSubmit;
+    };
+    CommitLatencyStats getCommitLatencyStats() const;
+
     // void waitUntilCommitIsComplete();
     // void waitUntilAllCommitAreComplete();
     // void disposeWhenCommitCompletes(std::shared_ptr<Buffer> buffer);
     // void disposeWhenCommitCompletes(std::function<void()> &&deallocator);
 
+    // 不持有所有权的回调引用，调用期间可调用对象必须存活；与 std::function 不同，不会为捕获分配内存
+    struct QueueCommitCallback
+    {
+        template <typename Callable>
+        QueueCommitCallback(Callable &callable)
+            : object(&callable),
+              invoke([](void *object, DeviceManager::QueueUtils *queue) -> bool {
+                  return (*static_cast<Callable *>(object))(queue);
+              })
+        {
+        }
+
+        bool operator()(DeviceManager::QueueUtils *queue) const
+        {
+            return invoke(object, queue);
+        }
+
+        void *object;
+        bool (*invoke)(void *, DeviceManager::QueueUtils *);
+    };
+
+    // 旧路径：在队列锁内通过回调录制队列自带的命令缓冲（present 等仍在使用）
     DeviceManager::QueueUtils *pickQueueAndCommit(std::atomic_uint16_t &queueIndex,
                                                   std::vector<DeviceManager::QueueUtils> &queues,
-                                                  std::function<bool(DeviceManager::QueueUtils *currentRecordQueue)> commitCommand);
+                                                  QueueCommitCallback commitCommand);
+
+    // 新路径：命令缓冲已在锁外录制完成，只在 vkQueueSubmit2 期间持有同队列族的某个队列锁
+    DeviceManager::QueueUtils *submitRecordedCommands(std::atomic_uint16_t &queueIndex,
+                                                      std::vector<DeviceManager::QueueUtils> &queues,
+                                                      ExecutorCommandPool::RecordCommandBuffer &recordBuffer);
 
-    DeviceManager::QueueUtils *currentRecordQueue{nullptr};
+    // 最近一次 commit 中每个队列段的提交点；wait(other) 与下一次 commit 需要等待全部段完成
+    struct SubmittedSegment
+    {
+        DeviceManager::QueueUtils *queue{nullptr};
+        uint64_t signalValue{0};
+    };
+
+    DeviceManager::QueueUtils *currentRecordQueue{nullptr}; // 最近一次提交（多段时为最后一段）所在的队列
+    VkCommandBuffer currentCommandBuffer{VK_NULL_HANDLE}; // 当前正在录制的命令缓冲，CommandRecordVulkan 向其中写入命令
+    ExecutorCommandPool::RecordCommandBuffer *currentRecordBuffer{nullptr}; // currentCommandBuffer 在命令池中的条目，用于挂接二级命令缓冲
+    VkCommandBufferUsageFlags currentUsageFlags{0};                          // currentCommandBuffer 的 begin 标志，二级命令缓冲沿用 SIMULTANEOUS_USE
+    std::shared_ptr<ExecutorCommandPool> commandPool;     // 本执行器独占使用，拷贝得到的执行器首次录制时才创建；命令包只持有引用以延长生命周期
     uint64_t lastSignalValue{0}; // 记录最近一次提交的 signal timeline 值，避免跨原子操作竞态
+    std::vector<SubmittedSegment> lastSubmissions;
     std::shared_ptr<HardwareContext::HardwareUtils> hardwareContext;
     std::vector<CommandRecordVulkan *> commandList;
     std::vector<VkSemaphoreSubmitInfo> waitSemaphores;
     std::vector<VkSemaphoreSubmitInfo> signalSemaphores;
     // std::vector<VkFence> prentFences;
     VkFence waitFence{VK_NULL_HANDLE};
+    std::vector<ResourceAccessVulkan> resourceAccesses;                      // 本次提交涉及的资源访问，录制时收集
+    ResourceDependencyTracker::UndoLog dependencyUndoLog;                    // 提交失败时撤销依赖登记
+    CommandHazardTracker hazardTracker;                                      // 录制期间的命令缓冲内资源状态
+    CommandRecordVulkan::RequiredBarriers requestedBarriers;                 // 每条记录给出的屏障，跨记录复用容量
+    CommandRecordVulkan::RequiredBarriers resolvedBarriers;                  // 每条记录合并后的屏障，跨记录复用容量
+    std::vector<VkSemaphoreSubmitInfo> mergedWaitSemaphores;                 // prepareSubmitSemaphores 的输出，跨提交复用容量
+    std::vector<VkSemaphoreSubmitInfo> mergedSignalSemaphores;
+    std::vector<std::shared_ptr<CopyCommandImpl>> submitPendingResources;    // 提交期间与 pendingResources 交换，跨提交复用容量
     // std::unordered_map<VkFence, DeviceManager::QueueUtils*> fenceToPresent;
     // std::vector<std::vector<std::shared_ptr<Buffer>>> buffer_to_dispose_;
 
     // ========== 延迟释放成员 ==========
     std::vector<std::shared_ptr<CopyCommandImpl>> pendingResources;
-    std::vector<DeferredRelease> deferredReleaseQueue;
+    std::vector<DeferredReleaseRing> deferredReleaseRings; // 每个 timeline semaphore 一个环，数量与队列数相当
+    DeferredReleaseStats deferredReleaseCost;              // 只使用其中的回收开销字段
+
+    // ========== 提交延迟统计 ==========
+    std::shared_ptr<CommitLatencyStatsVulkan> latencyStats{std::make_shared<CommitLatencyStatsVulkan>()}; // 执行器拷贝之间共享
+
+    // 把资源挂到 semaphore 达到 timelineValue 时释放
+    void deferRelease(VkSemaphore semaphore, uint64_t timelineValue, std::shared_ptr<CopyCommandImpl> resource);
+
+    // ========== 异步提交成员 ==========
+    SubmitThreadVulkan *submitThread{nullptr};                                    // 非空表示启用异步提交
+    DeviceManager::QueuePriority priority{DeviceManager::QueuePriority::Normal};  // 选择队列与提交线程排序时使用的优先级类别
+    std::vector<std::shared_ptr<SubmitBatchVulkan>> asyncBatches;                 // 复用的提交批次，每个队列段一个
+    std::vector<ExecutorCommandPool::RecordCommandBuffer *> asyncRecordBuffers;   // 已入队但尚未回收结果的命令缓冲，与批次一一对应
+    std::vector<std::shared_ptr<CopyCommandImpl>> asyncPendingResources;          // 随异步批次一起等待 timeline 值的资源
+
+    // ========== 查询成员 ==========
+    std::unique_ptr<ExecutorQueryPool> queryPool; // 首次启用统计或遮挡查询时创建
+    bool pipelineStatisticsEnabled{false};
+    bool occlusionQueriesEnabled{false};
+
+  private:
+    // ========== 按队列分段 ==========
+    // commandList 中连续的、目标队列列表相同的记录组成一段，各段录制到独立的命令缓冲并提交到各自的队列，
+    // 段之间只通过 ResourceDependencyTracker 推导出的 timeline 等待衔接，互不相关的段可以并行执行
+    struct QueueSegment
+    {
+        std::atomic_uint16_t *queueIndex{nullptr};
+        std::vector<DeviceManager::QueueUtils> *queues{nullptr};
+        size_t begin{0};
+        size_t end{0};
+    };
+
+    // 按执行器类型选择队列列表，没有专用计算/传输队列时回退到图形队列
+    bool selectQueues(CommandRecordVulkan::ExecutorType executorType,
+                      std::atomic_uint16_t *&queueIndex,
+                      std::vector<DeviceManager::QueueUtils> *&queues);
+    void buildQueueSegments();
+
+    void recordCommandList(VkCommandBuffer commandBuffer,
+                           size_t begin,
+                           size_t end,
+                           VkCommandBufferUsageFlags usageFlags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+    // 追加对 lastSubmissions 中每一段的等待：用于下一次 commit 的自等待，
+    // 以及携带用户 signal semaphore / fence 的最后一段等待本次 commit 的其余段
+    void appendSubmissionWaits(std::vector<VkSemaphoreSubmitInfo> &waits) const;
+
+    std::vector<QueueSegment> queueSegments;
+    std::vector<VkSemaphoreSubmitInfo> commitWaitSemaphores;
+    std::vector<VkSemaphoreSubmitInfo> commitSignalSemaphores;
+    std::vector<std::shared_ptr<CopyCommandImpl>> commitPendingResources;
+    // 命令包段与空提交段的提交状态，各执行器独立，下次 commit 时清空。
+    // 每段最多一个条目，commit 开始时按段数预留，段内取出的指针在本次提交期间不会失效，容量跨提交复用
+    std::vector<ExecutorCommandPool::RecordCommandBuffer> prerecordedBuffers;
+
+    // 取得本执行器的命令池，拷贝构造的执行器在这里首次创建
+    ExecutorCommandPool &ensureCommandPool();
+
+    // 调用方需持有 queue->queueMutex；负责 timeline 推进、semaphore 合并校验与 vkQueueSubmit2
+    bool submitCommandBuffer(DeviceManager::QueueUtils *queue,
+                             VkCommandBuffer commandBuffer,
+                             std::vector<std::shared_ptr<CopyCommandImpl>> &localPendingResources);
 };
@@ -0,0 +1,133 @@
+﻿#include "HardwareMetricsVulkan.h"
+
+HardwareMetricsVulkan &HardwareMetricsVulkan::get()
+{
+    static HardwareMetricsVulkan metrics;
+    return metrics;
+}
+
+void HardwareMetricsVulkan::atomicMax(std::atomic_uint64_t &target, uint64_t value)
+{
+    uint64_t current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+void HardwareMetricsVulkan::trackBuffer(ResourceManager::BufferHardwareWrap &buffer)
+{
+    buffer.metricsBytes = static_cast<uint64_t>(buffer.elementCount) * buffer.elementSize;
+    liveBuffers.fetch_add(1, std::memory_order_relaxed);
+    liveBufferBytes.fetch_add(buffer.metricsBytes, std::memory_order_relaxed);
+}
+
+void HardwareMetricsVulkan::trackImage(ResourceManager::ImageHardwareWrap &image, uint64_t bytes)
+{
+    image.metricsBytes = bytes;
+    liveImages.fetch_add(1, std::memory_order_relaxed);
+    liveImageBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void HardwareMetricsVulkan::untrackBuffer(const ResourceManager::BufferHardwareWrap &buffer)
+{
+    liveBuffers.fetch_sub(1, std::memory_order_relaxed);
+    liveBufferBytes.fetch_sub(buffer.metricsBytes, std::memory_order_relaxed);
+    if (buffer.bindlessIndex >= 0)
+    {
+        bindless[static_cast<uint32_t>(BindlessSet::StorageBuffer)].occupied.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void HardwareMetricsVulkan::untrackImage(const ResourceManager::ImageHardwareWrap &image)
+{
+    liveImages.fetch_sub(1, std::memory_order_relaxed);
+    liveImageBytes.fetch_sub(image.metricsBytes, std::memory_order_relaxed);
+    if (image.bindlessIndex >= 0)
+    {
+        bindless[static_cast<uint32_t>(bindlessSetOf(image))].occupied.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void HardwareMetricsVulkan::setBindlessCapacity(BindlessSet set, uint32_t capacity)
+{
+    // 每个设备各有一组描述符集，按最先耗尽的设备报告
+    std::atomic_uint32_t &target = bindless[static_cast<uint32_t>(set)].capacity;
+    uint32_t current = target.load(std::memory_order_relaxed);
+    while ((current == 0 || capacity < current) &&
+           !target.compare_exchange_weak(current, capacity, std::memory_order_relaxed))
+    {
+    }
+}
+
+void HardwareMetricsVulkan::occupyBindlessSlot(BindlessSet set, int32_t index)
+{
+    AtomicBindlessSlots &slots = bindless[static_cast<uint32_t>(set)];
+    slots.occupied.fetch_add(1, std::memory_order_relaxed);
+
+    const uint32_t highWater = static_cast<uint32_t>(index) + 1;
+    uint32_t current = slots.highWater.load(std::memory_order_relaxed);
+    while (highWater > current && !slots.highWater.compare_exchange_weak(current, highWater, std::memory_order_relaxed))
+    {
+    }
+}
+
+HardwareMetricsVulkan::BindlessSet HardwareMetricsVulkan::bindlessSetOf(const ResourceManager::ImageHardwareWrap &image)
+{
+    return (image.imageUsage & VK_IMAGE_USAGE_STORAGE_BIT) ? BindlessSet::StorageImage : BindlessSet::Texture;
+}
+
+void HardwareMetricsVulkan::recordPipelineCompile(bool graphics, uint64_t compileNs)
+{
+    (graphics ? liveGraphicsPipelines : liveComputePipelines).fetch_add(1, std::memory_order_relaxed);
+    compiledPipelines.fetch_add(1, std::memory_order_relaxed);
+    totalCompileNs.fetch_add(compileNs, std::memory_order_relaxed);
+    atomicMax(maxCompileNs, compileNs);
+}
+
+void HardwareMetricsVulkan::releasePipeline(bool graphics)
+{
+    (graphics ? liveGraphicsPipelines : liveComputePipelines).fetch_sub(1, std::memory_order_relaxed);
+}
+
+void HardwareMetricsVulkan::recordStaging(uint64_t bytes)
+{
+    stagingAllocations.fetch_add(1, std::memory_order_relaxed);
+    stagingBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void HardwareMetricsVulkan::recordStagingRing(uint64_t bytes)
+{
+    stagingRingAllocations.fetch_add(1, std::memory_order_relaxed);
+    stagingRingBytes.fetch_add(bytes, std::memory_order_relaxed);
+    stagingBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+HardwareMetricsVulkan::Snapshot HardwareMetricsVulkan::snapshot() const
+{
+    Snapshot result;
+    result.liveBuffers = liveBuffers.load(std::memory_order_relaxed);
+    result.liveBufferBytes = liveBufferBytes.load(std::memory_order_relaxed);
+    result.liveImages = liveImages.load(std::memory_order_relaxed);
+    result.liveImageBytes = liveImageBytes.load(std::memory_order_relaxed);
+
+    for (uint32_t i = 0; i < BINDLESS_SET_COUNT; ++i)
+    {
+        result.bindless[i].capacity = bindless[i].capacity.load(std::memory_order_relaxed);
+        result.bindless[i].occupied = bindless[i].occupied.load(std::memory_order_relaxed);
+        result.bindless[i].highWater = bindless[i].highWater.load(std::memory_order_relaxed);
+    }
+
+    result.liveComputePipelines = liveComputePipelines.load(std::memory_order_relaxed);
+    result.liveGraphicsPipelines = liveGraphicsPipelines.load(std::memory_order_relaxed);
+    result.compiledPipelines = compiledPipelines.load(std::memory_order_relaxed);
+    result.totalCompileNs = totalCompileNs.load(std::memory_order_relaxed);
+    result.maxCompileNs = maxCompileNs.load(std::memory_order_relaxed);
+
+    result.deferredReleasePending = deferredReleasePending.load(std::memory_order_relaxed);
+
+    result.stagingAllocations = stagingAllocations.load(std::memory_order_relaxed);
+    result.stagingBytes = stagingBytes.load(std::memory_order_relaxed);
+    result.stagingRingAllocations = stagingRingAllocations.load(std::memory_order_relaxed);
+    result.stagingRingBytes = stagingRingBytes.load(std::memory_order_relaxed);
+    return result;
+}
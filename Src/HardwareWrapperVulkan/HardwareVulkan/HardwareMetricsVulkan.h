@@ -0,0 +1,118 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "ResourceManager.h"
+
+// ========== 全局资源指标 ==========
+// 各子系统在创建与释放处更新 relaxed 原子计数；snapshot 只做原子读取、不加任何锁，可以定期轮询。
+// 字段分别读取，彼此之间只保证近似一致，适合用于趋势与阈值告警
+class HardwareMetricsVulkan
+{
+  public:
+    // 与 ResourceManager::bindlessDescriptors 的下标一致
+    enum class BindlessSet : uint32_t
+    {
+        Texture = 0,
+        StorageBuffer = 1,
+        StorageImage = 2
+    };
+    static constexpr uint32_t BINDLESS_SET_COUNT = 3;
+
+    struct BindlessSlots
+    {
+        uint32_t capacity = 0;  // 描述符数组长度（多设备时取最小值）
+        uint32_t occupied = 0;  // 存活条目占用的槽位数
+        uint32_t highWater = 0; // 出现过的最大槽位下标 + 1，超过 capacity 即已越界
+    };
+
+    struct Snapshot
+    {
+        uint64_t liveBuffers = 0;
+        uint64_t liveBufferBytes = 0;
+        uint64_t liveImages = 0;
+        uint64_t liveImageBytes = 0; // 子图像与渲染图瞬态图像共享内存，不计字节
+
+        BindlessSlots bindless[BINDLESS_SET_COUNT];
+
+        uint64_t liveComputePipelines = 0;
+        uint64_t liveGraphicsPipelines = 0;
+        uint64_t compiledPipelines = 0; // 累计编译次数，包括光栅管线因状态变化的重建
+        uint64_t totalCompileNs = 0;
+        uint64_t maxCompileNs = 0;
+
+        uint64_t deferredReleasePending = 0; // 所有执行器延迟释放环中的条目数
+
+        uint64_t stagingAllocations = 0;     // 上传路径累计创建的独立暂存缓冲数
+        uint64_t stagingBytes = 0;           // 上传路径累计暂存的字节数（含暂存环）
+        uint64_t stagingRingAllocations = 0; // 从暂存环分配的次数
+        uint64_t stagingRingBytes = 0;
+    };
+
+    static HardwareMetricsVulkan &get();
+
+    // 存储条目创建后调用；字节数记在条目上，释放时按同一数值扣除
+    void trackBuffer(ResourceManager::BufferHardwareWrap &buffer);
+    void trackImage(ResourceManager::ImageHardwareWrap &image, uint64_t bytes);
+
+    // 存储条目引用计数归零时调用，同时归还其 bindless 槽位
+    void untrackBuffer(const ResourceManager::BufferHardwareWrap &buffer);
+    void untrackImage(const ResourceManager::ImageHardwareWrap &image);
+
+    void setBindlessCapacity(BindlessSet set, uint32_t capacity);
+    void occupyBindlessSlot(BindlessSet set, int32_t index);
+
+    // 图像按 storeDescriptorAt 的规则归入 StorageImage 或 Texture
+    static BindlessSet bindlessSetOf(const ResourceManager::ImageHardwareWrap &image);
+
+    // 每次 vkCreate*Pipelines 成功后调用，对应的 vkDestroyPipeline 处调用 releasePipeline
+    void recordPipelineCompile(bool graphics, uint64_t compileNs);
+    void releasePipeline(bool graphics);
+
+    void addDeferredRelease()
+    {
+        deferredReleasePending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void removeDeferredRelease()
+    {
+        deferredReleasePending.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // 新建独立暂存缓冲时调用 recordStaging，从暂存环分配时调用 recordStagingRing
+    void recordStaging(uint64_t bytes);
+    void recordStagingRing(uint64_t bytes);
+
+    [[nodiscard]] Snapshot snapshot() const;
+
+  private:
+    struct AtomicBindlessSlots
+    {
+        std::atomic_uint32_t capacity{0};
+        std::atomic_uint32_t occupied{0};
+        std::atomic_uint32_t highWater{0};
+    };
+
+    static void atomicMax(std::atomic_uint64_t &target, uint64_t value);
+
+    std::atomic_uint64_t liveBuffers{0};
+    std::atomic_uint64_t liveBufferBytes{0};
+    std::atomic_uint64_t liveImages{0};
+    std::atomic_uint64_t liveImageBytes{0};
+
+    AtomicBindlessSlots bindless[BINDLESS_SET_COUNT];
+
+    std::atomic_uint64_t liveComputePipelines{0};
+    std::atomic_uint64_t liveGraphicsPipelines{0};
+    std::atomic_uint64_t compiledPipelines{0};
+    std::atomic_uint64_t totalCompileNs{0};
+    std::atomic_uint64_t maxCompileNs{0};
+
+    std::atomic_uint64_t deferredReleasePending{0};
+
+    std::atomic_uint64_t stagingAllocations{0};
+    std::atomic_uint64_t stagingBytes{0};
+    std::atomic_uint64_t stagingRingAllocations{0};
+    std::atomic_uint64_t stagingRingBytes{0};
+};
@@ -0,0 +1,110 @@
+﻿#include "RecordWorkersVulkan.h"
+
+#include <algorithm>
+
+RecordWorkersVulkan::RecordWorkersVulkan()
+{
+    // 调用线程本身也会领取分片，工作线程比硬件线程少一个
+    const uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    workerThreads.reserve(hardwareThreads - 1);
+    for (uint32_t i = 1; i < hardwareThreads; ++i)
+    {
+        workerThreads.emplace_back(&RecordWorkersVulkan::threadLoop, this);
+    }
+}
+
+RecordWorkersVulkan::~RecordWorkersVulkan()
+{
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        running = false;
+    }
+    jobCondition.notify_all();
+
+    for (auto &workerThread : workerThreads)
+    {
+        if (workerThread.joinable())
+        {
+            workerThread.join();
+        }
+    }
+}
+
+void RecordWorkersVulkan::parallelFor(uint32_t taskCount, TaskCallback task)
+{
+    if (taskCount == 0)
+    {
+        return;
+    }
+
+    Job job{task, taskCount};
+
+    const bool distribute = taskCount > 1 && !workerThreads.empty();
+    if (distribute)
+    {
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            jobs.push_back(&job);
+        }
+        jobCondition.notify_all();
+    }
+
+    runTasks(job);
+
+    if (distribute)
+    {
+        // 分片已全部领取：撤下作业，再等仍在执行分片的工作线程退出，之后 job 才能销毁
+        std::unique_lock<std::mutex> lock(jobMutex);
+        if (auto it = std::find(jobs.begin(), jobs.end(), &job); it != jobs.end())
+        {
+            jobs.erase(it);
+        }
+        jobFinished.wait(lock, [&job] { return job.activeWorkers == 0; });
+    }
+}
+
+void RecordWorkersVulkan::runTasks(Job &job)
+{
+    while (true)
+    {
+        const uint32_t taskIndex = job.nextTask.fetch_add(1, std::memory_order_relaxed);
+        if (taskIndex >= job.taskCount)
+        {
+            break;
+        }
+        job.task(taskIndex);
+    }
+}
+
+void RecordWorkersVulkan::threadLoop()
+{
+    while (true)
+    {
+        Job *job = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            jobCondition.wait(lock, [this] { return !running || !jobs.empty(); });
+            if (jobs.empty())
+            {
+                return;
+            }
+
+            job = jobs.front();
+            if (job->nextTask.load(std::memory_order_relaxed) >= job->taskCount)
+            {
+                // 分片已被领完，交给发起线程收尾
+                jobs.pop_front();
+                continue;
+            }
+            ++job->activeWorkers;
+        }
+
+        runTasks(*job);
+
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            --job->activeWorkers;
+        }
+        jobFinished.notify_all();
+    }
+}
@@ -0,0 +1,72 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ========== 每设备一个的录制工作线程池 ==========
+// 把一次录制拆成互不相关的分片并行执行（例如大量绘制分到多个二级命令缓冲），
+// 调用线程同样领取分片，全部分片完成后 parallelFor 才返回；多个线程可以同时发起各自的 parallelFor
+class RecordWorkersVulkan
+{
+  public:
+    // 不持有所有权的任务引用，parallelFor 返回前可调用对象必须存活；不会为捕获分配内存
+    struct TaskCallback
+    {
+        template <typename Callable>
+        TaskCallback(Callable &callable)
+            : object(&callable),
+              invoke([](void *object, uint32_t taskIndex) {
+                  (*static_cast<Callable *>(object))(taskIndex);
+              })
+        {
+        }
+
+        void operator()(uint32_t taskIndex) const
+        {
+            invoke(object, taskIndex);
+        }
+
+        void *object;
+        void (*invoke)(void *, uint32_t);
+    };
+
+    RecordWorkersVulkan();
+    ~RecordWorkersVulkan();
+
+    RecordWorkersVulkan(const RecordWorkersVulkan &) = delete;
+    RecordWorkersVulkan &operator=(const RecordWorkersVulkan &) = delete;
+
+    // 工作线程数（不含调用线程），单核机器上为 0，此时 parallelFor 在调用线程上顺序执行
+    [[nodiscard]] uint32_t getWorkerCount() const
+    {
+        return static_cast<uint32_t>(workerThreads.size());
+    }
+
+    // 以 taskIndex = 0..taskCount-1 调用 task，各分片可能在不同线程上同时执行
+    void parallelFor(uint32_t taskCount, TaskCallback task);
+
+  private:
+    struct Job
+    {
+        TaskCallback task;
+        uint32_t taskCount{0};
+        std::atomic_uint32_t nextTask{0};
+        uint32_t activeWorkers{0}; // 正在执行本作业分片的工作线程数，受 jobMutex 保护
+    };
+
+    void threadLoop();
+    static void runTasks(Job &job);
+
+    std::mutex jobMutex;
+    std::condition_variable jobCondition;     // 有新作业或需要退出
+    std::condition_variable jobFinished;      // 某个作业的工作线程全部退出
+    std::deque<Job *> jobs;                   // 仍有未领取分片的作业，按发起顺序
+    bool running{true};
+
+    std::vector<std::thread> workerThreads;
+};
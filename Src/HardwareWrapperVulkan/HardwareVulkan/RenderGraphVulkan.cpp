@@ -0,0 +1,483 @@
+﻿#include "RenderGraphVulkan.h"
+
+#include <algorithm>
+#include <numeric>
+#include <unordered_set>
+
+#include "HardwareWrapperVulkan/ResourcePool.h"
+
+// ========== RenderGraphPassVulkan ==========
+
+CommandRecordVulkan::ExecutorType RenderGraphPassVulkan::getExecutorType()
+{
+    return graph->passes[graph->executionOrder[passIndex]].record->getExecutorType();
+}
+
+void RenderGraphPassVulkan::commitCommand(HardwareExecutorVulkan &hardwareExecutor)
+{
+    const RenderGraphVulkan::Pass &pass = graph->passes[graph->executionOrder[passIndex]];
+
+    // 屏障已录制：补充屏障里从 UNDEFINED 转换的图像此时才更新布局，记录自身绑定的图像由记录的 commitCommand 更新
+    for (const auto &access : pass.accesses)
+    {
+        if (access.image)
+        {
+            auto handle = globalImageStorages.acquire_write(access.resourceID);
+            if (handle->imageHandle != VK_NULL_HANDLE && handle->imageLayout == VK_IMAGE_LAYOUT_UNDEFINED)
+            {
+                handle->imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            }
+        }
+    }
+
+    pass.record->commitCommand(hardwareExecutor);
+}
+
+void RenderGraphPassVulkan::getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor, CommandRecordVulkan::RequiredBarriers &requiredBarriers)
+{
+    const RenderGraphVulkan::Pass &pass = graph->passes[graph->executionOrder[passIndex]];
+
+    // 本 pass 开始生命周期的瞬态图像：旧内容无需保留，布局从 UNDEFINED 开始，
+    // 之后由各记录自己的屏障完成布局转换
+    bool aliasingTransition = false;
+    for (uint32_t transientIndex : graph->lifetimeStarts[passIndex])
+    {
+        const auto &transientImage = graph->transientImages[transientIndex];
+        {
+            auto const handle = globalImageStorages.acquire_write(transientImage.image.getImageID());
+            handle->imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        }
+        if (transientImage.aliasSlot >= 0 && graph->aliasSlots[transientImage.aliasSlot].members.size() > 1)
+        {
+            aliasingTransition = true;
+        }
+    }
+
+    pass.record->getRequiredBarriers(hardwareExecutor, requiredBarriers);
+
+    if (aliasingTransition)
+    {
+        // 同一块内存上的前一个图像的所有访问必须在新图像使用前完成
+        VkMemoryBarrier2 aliasBarrier{};
+        aliasBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+        aliasBarrier.pNext = nullptr;
+        aliasBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        aliasBarrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+        aliasBarrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        aliasBarrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+        requiredBarriers.memoryBarriers.push_back(aliasBarrier);
+    }
+
+    // 补充 pass 声明但记录本身没有给出屏障的资源（例如只通过 bindless 索引间接访问的资源）
+    VkPipelineStageFlags2 dstStage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    switch (pass.record->getExecutorType())
+    {
+    case ExecutorType::Compute:
+        dstStage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        break;
+    case ExecutorType::Graphics:
+        dstStage = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+        break;
+    case ExecutorType::Transfer:
+        dstStage = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+        break;
+    default:
+        break;
+    }
+
+    for (const auto &access : pass.accesses)
+    {
+        const VkAccessFlags2 dstAccess = access.write ? (VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT)
+                                                      : VK_ACCESS_2_MEMORY_READ_BIT;
+        if (access.image)
+        {
+            auto const handle = globalImageStorages.acquire_read(access.resourceID);
+            if (handle->imageHandle == VK_NULL_HANDLE ||
+                std::any_of(requiredBarriers.imageBarriers.begin(), requiredBarriers.imageBarriers.end(),
+                            [&handle](const VkImageMemoryBarrier2 &barrier) { return barrier.image == handle->imageHandle; }))
+            {
+                continue;
+            }
+
+            VkImageMemoryBarrier2 imageBarrier{};
+            imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+            imageBarrier.pNext = nullptr;
+            imageBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+            imageBarrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+            imageBarrier.dstStageMask = dstStage;
+            imageBarrier.dstAccessMask = dstAccess;
+            imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.image = handle->imageHandle;
+            imageBarrier.oldLayout = handle->imageLayout;
+            imageBarrier.newLayout = handle->imageLayout == VK_IMAGE_LAYOUT_UNDEFINED ? VK_IMAGE_LAYOUT_GENERAL : handle->imageLayout;
+            imageBarrier.subresourceRange.aspectMask = handle->aspectMask;
+            imageBarrier.subresourceRange.baseMipLevel = 0;
+            imageBarrier.subresourceRange.levelCount = std::max(1u, handle->mipLevels);
+            imageBarrier.subresourceRange.baseArrayLayer = 0;
+            imageBarrier.subresourceRange.layerCount = std::max(1u, handle->arrayLayers);
+            requiredBarriers.imageBarriers.push_back(imageBarrier);
+        }
+        else
+        {
+            auto const handle = globalBufferStorages.acquire_read(access.resourceID);
+            if (handle->bufferHandle == VK_NULL_HANDLE ||
+                std::any_of(requiredBarriers.bufferBarriers.begin(), requiredBarriers.bufferBarriers.end(),
+                            [&handle](const VkBufferMemoryBarrier2 &barrier) { return barrier.buffer == handle->bufferHandle; }))
+            {
+                continue;
+            }
+
+            VkBufferMemoryBarrier2 bufferBarrier{};
+            bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+            bufferBarrier.pNext = nullptr;
+            bufferBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+            bufferBarrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+            bufferBarrier.dstStageMask = dstStage;
+            bufferBarrier.dstAccessMask = dstAccess;
+            bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            bufferBarrier.buffer = handle->bufferHandle;
+            bufferBarrier.offset = 0;
+            bufferBarrier.size = VK_WHOLE_SIZE;
+            requiredBarriers.bufferBarriers.push_back(bufferBarrier);
+        }
+    }
+}
+
+void RenderGraphPassVulkan::collectResourceAccesses(std::vector<ResourceAccessVulkan> &accesses)
+{
+    const RenderGraphVulkan::Pass &pass = graph->passes[graph->executionOrder[passIndex]];
+    pass.record->collectResourceAccesses(accesses);
+
+    for (const auto &access : pass.accesses)
+    {
+        if (!access.image)
+        {
+            auto const handle = globalBufferStorages.acquire_read(access.resourceID);
+            accesses.push_back({handle->bufferHandle, VK_NULL_HANDLE, access.write});
+            continue;
+        }
+
+        // 瞬态图像与同一块内存上的其它图像互为别名，跨提交时按写入处理整块内存
+        const int32_t transientIndex = graph->findTransientImage(access.resourceID);
+        if (transientIndex >= 0 && graph->transientImages[transientIndex].aliasSlot >= 0)
+        {
+            const auto &aliasSlot = graph->aliasSlots[graph->transientImages[transientIndex].aliasSlot];
+            for (uint32_t member : aliasSlot.members)
+            {
+                auto const handle = globalImageStorages.acquire_read(graph->transientImages[member].image.getImageID());
+                accesses.push_back({VK_NULL_HANDLE, handle->imageHandle, true});
+            }
+            continue;
+        }
+
+        auto const handle = globalImageStorages.acquire_read(access.resourceID);
+        accesses.push_back({VK_NULL_HANDLE, handle->imageHandle, access.write});
+    }
+}
+
+bool RenderGraphPassVulkan::declaresAllAccesses() const
+{
+    // pass 声明的访问只是补充，是否完整取决于包装的记录
+    const RenderGraphVulkan::Pass &pass = graph->passes[graph->executionOrder[passIndex]];
+    return pass.record->declaresAllAccesses();
+}
+
+// ========== RenderGraphVulkan ==========
+
+RenderGraphVulkan::RenderGraphVulkan()
+    : hardwareContext(globalHardwareContext.getMainDevice())
+{
+}
+
+RenderGraphVulkan::~RenderGraphVulkan()
+{
+    if (transientImages.empty())
+    {
+        return;
+    }
+
+    // 瞬态图像与别名内存可能仍被已提交的 pass 使用，交给墓地在各队列 timeline 追上后再销毁，析构不等待 GPU
+    ResourceManager &resourceManager = hardwareContext->resourceManager;
+    for (auto &transientImage : transientImages)
+    {
+        auto const handle = globalImageStorages.acquire_write(transientImage.image.getImageID());
+        resourceManager.destroyAliasableImage(*handle);
+    }
+    for (auto &aliasSlot : aliasSlots)
+    {
+        resourceManager.freeAliasingMemory(aliasSlot.allocation);
+        aliasSlot.allocation = VK_NULL_HANDLE;
+    }
+}
+
+void RenderGraphVulkan::addTransientImage(const HardwareImage &image, const VkMemoryRequirements &memoryRequirements)
+{
+    if (compiled)
+    {
+        CFW_LOG_ERROR("[RenderGraph] addTransientImage called after compile(), ignored");
+        return;
+    }
+
+    TransientImage transientImage{};
+    transientImage.image = image;
+    transientImage.memoryRequirements = memoryRequirements;
+    transientImageIndices[image.getImageID()] = static_cast<uint32_t>(transientImages.size());
+    transientImages.push_back(std::move(transientImage));
+}
+
+void RenderGraphVulkan::addPass(std::string name,
+                                CommandRecordVulkan *record,
+                                std::shared_ptr<CopyCommandImpl> copyCommand,
+                                const RenderPassResources &resources)
+{
+    if (compiled)
+    {
+        CFW_LOG_ERROR("[RenderGraph] addPass '{}' called after compile(), ignored", name);
+        return;
+    }
+    if (record == nullptr || record->getExecutorType() == CommandRecordVulkan::ExecutorType::Invalid)
+    {
+        return;
+    }
+
+    Pass pass{};
+    pass.name = std::move(name);
+    pass.record = record;
+    pass.copyCommand = std::move(copyCommand);
+
+    auto appendImages = [&pass](const std::vector<HardwareImage> &images, bool write) {
+        for (const auto &image : images)
+        {
+            if (image)
+            {
+                pass.accesses.push_back({image.getImageID(), true, write});
+            }
+        }
+    };
+    auto appendBuffers = [&pass](const std::vector<HardwareBuffer> &buffers, bool write) {
+        for (const auto &buffer : buffers)
+        {
+            if (buffer)
+            {
+                pass.accesses.push_back({buffer.getBufferID(), false, write});
+            }
+        }
+    };
+    appendImages(resources.readImages, false);
+    appendImages(resources.writeImages, true);
+    appendBuffers(resources.readBuffers, false);
+    appendBuffers(resources.writeBuffers, true);
+
+    passes.push_back(std::move(pass));
+}
+
+void RenderGraphVulkan::markOutput(const HardwareImage &image)
+{
+    if (image)
+    {
+        outputImages.push_back(image.getImageID());
+    }
+}
+
+int32_t RenderGraphVulkan::findTransientImage(uintptr_t imageID) const
+{
+    auto it = transientImageIndices.find(imageID);
+    return it != transientImageIndices.end() ? static_cast<int32_t>(it->second) : -1;
+}
+
+void RenderGraphVulkan::compile()
+{
+    if (compiled)
+    {
+        return;
+    }
+
+    cullPasses();
+    computeLifetimes();
+    assignAliasSlots();
+    allocateAliasSlots();
+
+    passRecords.clear();
+    passRecords.reserve(executionOrder.size());
+    for (uint32_t position = 0; position < executionOrder.size(); ++position)
+    {
+        passRecords.push_back(std::make_unique<RenderGraphPassVulkan>(this, position));
+    }
+
+    compiled = true;
+}
+
+void RenderGraphVulkan::execute(HardwareExecutorVulkan &executor)
+{
+    compile();
+
+    for (uint32_t position = 0; position < executionOrder.size(); ++position)
+    {
+        executor << passRecords[position].get();
+
+        if (const auto &copyCommand = passes[executionOrder[position]].copyCommand)
+        {
+            executor.pendingResources.push_back(copyCommand);
+        }
+    }
+}
+
+void RenderGraphVulkan::cullPasses()
+{
+    // 从后往前推导：写入外部资源（非瞬态图像、缓冲、标记为输出的图像）或没有声明写入的 pass 视为有副作用，
+    // 其余 pass 只有在写入的瞬态图像被保留下来的 pass 读取时才保留
+    std::unordered_set<uintptr_t> neededImages(outputImages.begin(), outputImages.end());
+    std::vector<bool> keep(passes.size(), false);
+
+    for (size_t passIndex = passes.size(); passIndex-- > 0;)
+    {
+        const Pass &pass = passes[passIndex];
+
+        bool hasWrite = false;
+        bool contributes = false;
+        for (const auto &access : pass.accesses)
+        {
+            if (!access.write)
+            {
+                continue;
+            }
+            hasWrite = true;
+            if (!access.image || findTransientImage(access.resourceID) < 0 || neededImages.contains(access.resourceID))
+            {
+                contributes = true;
+            }
+        }
+
+        if (hasWrite && !contributes)
+        {
+            continue;
+        }
+
+        keep[passIndex] = true;
+        for (const auto &access : pass.accesses)
+        {
+            // 写入也可能是读-改-写，保守地保留更早的生产者
+            if (access.image)
+            {
+                neededImages.insert(access.resourceID);
+            }
+        }
+    }
+
+    // 声明顺序本身就是合法的拓扑序（依赖只会指向更早的 pass），剔除后保持原有相对顺序
+    executionOrder.clear();
+    for (uint32_t passIndex = 0; passIndex < passes.size(); ++passIndex)
+    {
+        if (keep[passIndex])
+        {
+            executionOrder.push_back(passIndex);
+        }
+    }
+}
+
+void RenderGraphVulkan::computeLifetimes()
+{
+    lifetimeStarts.assign(executionOrder.size(), {});
+
+    for (uint32_t position = 0; position < executionOrder.size(); ++position)
+    {
+        for (const auto &access : passes[executionOrder[position]].accesses)
+        {
+            const int32_t transientIndex = access.image ? findTransientImage(access.resourceID) : -1;
+            if (transientIndex < 0)
+            {
+                continue;
+            }
+
+            auto &transientImage = transientImages[transientIndex];
+            if (transientImage.firstPass == UINT32_MAX)
+            {
+                transientImage.firstPass = position;
+                lifetimeStarts[position].push_back(static_cast<uint32_t>(transientIndex));
+            }
+            transientImage.lastPass = position;
+        }
+    }
+}
+
+void RenderGraphVulkan::assignAliasSlots()
+{
+    // 按内存需求从大到小放入第一个兼容且生命周期不重叠的槽位；
+    // 没有被任何保留 pass 使用的瞬态图像生命周期为空，可以放入任意槽位
+    std::vector<uint32_t> order(transientImages.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [this](uint32_t lhs, uint32_t rhs) {
+        return transientImages[lhs].memoryRequirements.size > transientImages[rhs].memoryRequirements.size;
+    });
+
+    auto overlaps = [](const TransientImage &lhs, const TransientImage &rhs) {
+        return lhs.firstPass <= rhs.lastPass && rhs.firstPass <= lhs.lastPass;
+    };
+
+    aliasSlots.clear();
+    for (uint32_t transientIndex : order)
+    {
+        auto &transientImage = transientImages[transientIndex];
+        const VkMemoryRequirements &requirements = transientImage.memoryRequirements;
+        if (transientImage.image.getImageID() == 0 || requirements.size == 0)
+        {
+            continue;
+        }
+
+        int32_t slotIndex = -1;
+        for (size_t candidate = 0; candidate < aliasSlots.size() && slotIndex < 0; ++candidate)
+        {
+            const AliasSlot &aliasSlot = aliasSlots[candidate];
+            if ((aliasSlot.memoryRequirements.memoryTypeBits & requirements.memoryTypeBits) == 0)
+            {
+                continue;
+            }
+            const bool conflict = std::any_of(aliasSlot.members.begin(), aliasSlot.members.end(), [&](uint32_t member) {
+                return overlaps(transientImages[member], transientImage);
+            });
+            if (!conflict)
+            {
+                slotIndex = static_cast<int32_t>(candidate);
+            }
+        }
+
+        if (slotIndex < 0)
+        {
+            slotIndex = static_cast<int32_t>(aliasSlots.size());
+            AliasSlot aliasSlot{};
+            aliasSlot.memoryRequirements = requirements;
+            aliasSlots.push_back(std::move(aliasSlot));
+        }
+
+        AliasSlot &aliasSlot = aliasSlots[slotIndex];
+        aliasSlot.memoryRequirements.size = std::max(aliasSlot.memoryRequirements.size, requirements.size);
+        aliasSlot.memoryRequirements.alignment = std::max(aliasSlot.memoryRequirements.alignment, requirements.alignment);
+        aliasSlot.memoryRequirements.memoryTypeBits &= requirements.memoryTypeBits;
+        aliasSlot.members.push_back(transientIndex);
+        transientImage.aliasSlot = slotIndex;
+    }
+}
+
+void RenderGraphVulkan::allocateAliasSlots()
+{
+    ResourceManager &resourceManager = hardwareContext->resourceManager;
+
+    aliasedMemorySize = 0;
+    unaliasedMemorySize = 0;
+    for (auto &aliasSlot : aliasSlots)
+    {
+        aliasSlot.allocation = resourceManager.allocateAliasingMemory(aliasSlot.memoryRequirements);
+        aliasedMemorySize += aliasSlot.memoryRequirements.size;
+
+        for (uint32_t member : aliasSlot.members)
+        {
+            auto &transientImage = transientImages[member];
+            unaliasedMemorySize += transientImage.memoryRequirements.size;
+
+            auto handle = globalImageStorages.acquire_write(transientImage.image.getImageID());
+            resourceManager.bindAliasingImage(*handle, aliasSlot.allocation);
+        }
+    }
+}
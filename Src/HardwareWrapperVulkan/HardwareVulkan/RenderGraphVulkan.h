@@ -0,0 +1,133 @@
+﻿#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "CabbageHardware.h"
+#include "HardwareWrapperVulkan/HardwareContext.h"
+#include "HardwareWrapperVulkan/HardwareVulkan/HardwareExecutorVulkan.h"
+
+struct RenderGraphVulkan;
+
+// ========== 渲染图中的一个 pass ==========
+// 包装实际的 CommandRecordVulkan：在其屏障之前插入别名切换所需的屏障，并补充 pass 声明的访问
+struct RenderGraphPassVulkan : public CommandRecordVulkan
+{
+    RenderGraphPassVulkan(RenderGraphVulkan *graph, uint32_t passIndex)
+        : graph(graph), passIndex(passIndex)
+    {
+    }
+
+    ExecutorType getExecutorType() override;
+    void commitCommand(HardwareExecutorVulkan &hardwareExecutor) override;
+    void getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor, RequiredBarriers &requiredBarriers) override;
+    void collectResourceAccesses(std::vector<ResourceAccessVulkan> &accesses) override;
+    [[nodiscard]] bool declaresAllAccesses() const override;
+
+  private:
+    RenderGraphVulkan *graph{nullptr};
+    uint32_t passIndex{0};
+};
+
+// ========== 声明式渲染图 ==========
+// pass 声明读写的图像/缓冲，compile() 时剔除对输出没有贡献的 pass、计算瞬态图像的生命周期，
+// 并把生命周期不重叠的瞬态图像绑定到同一块 VmaAllocation；execute() 按编译后的顺序把 pass 送入执行器
+struct RenderGraphVulkan
+{
+    struct PassAccess
+    {
+        uintptr_t resourceID{0};
+        bool image{false};
+        bool write{false};
+    };
+
+    struct Pass
+    {
+        std::string name;
+        CommandRecordVulkan *record{nullptr};
+        std::shared_ptr<CopyCommandImpl> copyCommand; // 拷贝 pass 持有命令，随执行器的延迟释放一起回收
+        std::vector<PassAccess> accesses;
+    };
+
+    struct TransientImage
+    {
+        HardwareImage image;
+        VkMemoryRequirements memoryRequirements{};
+        uint32_t firstPass{UINT32_MAX}; // 编译后顺序中的首个/最后一个使用位置
+        uint32_t lastPass{0};
+        int32_t aliasSlot{-1};
+    };
+
+    // 一块共享内存以及绑定在其上的瞬态图像
+    struct AliasSlot
+    {
+        VmaAllocation allocation{VK_NULL_HANDLE};
+        VkMemoryRequirements memoryRequirements{};
+        std::vector<uint32_t> members; // transientImages 下标
+    };
+
+    RenderGraphVulkan();
+    ~RenderGraphVulkan();
+
+    RenderGraphVulkan(const RenderGraphVulkan &) = delete;
+    RenderGraphVulkan &operator=(const RenderGraphVulkan &) = delete;
+
+    // image 由 ResourceManager::createAliasableImage 创建，尚未绑定内存；compile() 之后才能绑定到管线
+    void addTransientImage(const HardwareImage &image, const VkMemoryRequirements &memoryRequirements);
+
+    void addPass(std::string name,
+                 CommandRecordVulkan *record,
+                 std::shared_ptr<CopyCommandImpl> copyCommand,
+                 const RenderPassResources &resources);
+    void markOutput(const HardwareImage &image);
+
+    void compile();
+    void execute(HardwareExecutorVulkan &executor);
+
+    [[nodiscard]] bool isCompiled() const
+    {
+        return compiled;
+    }
+
+    // 别名前后瞬态图像占用的显存（字节），用于评估别名效果
+    [[nodiscard]] uint64_t getTransientMemorySize() const
+    {
+        return aliasedMemorySize;
+    }
+    [[nodiscard]] uint64_t getUnaliasedTransientMemorySize() const
+    {
+        return unaliasedMemorySize;
+    }
+
+    // 管线对象的引用，保证 pass 中的 CommandRecordVulkan 在图的生命周期内有效
+    std::vector<ComputePipelineBase> retainedComputePipelines;
+    std::vector<RasterizerPipelineBase> retainedRasterizerPipelines;
+
+  private:
+    friend struct RenderGraphPassVulkan;
+
+    void cullPasses();
+    void computeLifetimes();
+    void assignAliasSlots();
+    void allocateAliasSlots();
+
+    int32_t findTransientImage(uintptr_t imageID) const;
+
+    std::shared_ptr<HardwareContext::HardwareUtils> hardwareContext;
+
+    std::vector<Pass> passes;
+    std::vector<TransientImage> transientImages;
+    std::unordered_map<uintptr_t, uint32_t> transientImageIndices; // 图像 ID -> transientImages 下标
+    std::vector<uintptr_t> outputImages;
+
+    // 编译结果
+    std::vector<uint32_t> executionOrder;                                  // 保留下来的 pass 下标，按执行顺序
+    std::vector<std::unique_ptr<RenderGraphPassVulkan>> passRecords;      // 与 executionOrder 一一对应
+    std::vector<std::vector<uint32_t>> lifetimeStarts;                     // 每个执行位置开始生命周期的瞬态图像
+    std::vector<AliasSlot> aliasSlots;
+    uint64_t aliasedMemorySize{0};
+    uint64_t unaliasedMemorySize{0};
+    bool compiled{false};
+};
@@ -1,8 +1,12 @@
 ﻿#include "ResourceCommand.h"
 
 // CopyBufferCommand implementations
-CopyBufferCommand::CopyBufferCommand(ResourceManager::BufferHardwareWrap &src, ResourceManager::BufferHardwareWrap &dst)
-    : srcBuffer(src), dstBuffer(dst)
+CopyBufferCommand::CopyBufferCommand(ResourceManager::BufferHardwareWrap &src,
+                                     ResourceManager::BufferHardwareWrap &dst,
+                                     uint64_t srcOffset,
+                                     uint64_t dstOffset,
+                                     uint64_t size)
+    : srcBuffer(src), dstBuffer(dst), srcOffset(srcOffset), dstOffset(dstOffset), size(size)
 {
     executorType = ExecutorType::Transfer;
 }
@@ -14,13 +18,18 @@ CommandRecordVulkan::ExecutorType CopyBufferCommand::getExecutorType()
 
 void CopyBufferCommand::commitCommand(HardwareExecutorVulkan &hardwareExecutor)
 {
-    hardwareExecutor.hardwareContext->resourceManager.copyBuffer(hardwareExecutor.currentRecordQueue->commandBuffer, srcBuffer, dstBuffer);
+    if (size == 0)
+    {
+        hardwareExecutor.hardwareContext->resourceManager.copyBuffer(hardwareExecutor.currentCommandBuffer, srcBuffer, dstBuffer);
+    }
+    else
+    {
+        hardwareExecutor.hardwareContext->resourceManager.copyBuffer(hardwareExecutor.currentCommandBuffer, srcBuffer, dstBuffer, srcOffset, dstOffset, size);
+    }
 }
 
-CommandRecordVulkan::RequiredBarriers CopyBufferCommand::getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor)
+void CopyBufferCommand::getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor, CommandRecordVulkan::RequiredBarriers &requiredBarriers)
 {
-    CommandRecordVulkan::RequiredBarriers requiredBarriers;
-
     {
         VkBufferMemoryBarrier2 srcBufferBarrier{};
         srcBufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
@@ -54,8 +63,18 @@ CommandRecordVulkan::RequiredBarriers CopyBufferCommand::getRequiredBarriers(Har
 
         requiredBarriers.bufferBarriers.push_back(dstBufferBarrier);
     }
+}
 
-    return requiredBarriers;
+void CopyBufferCommand::collectResourceAccesses(std::vector<ResourceAccessVulkan> &accesses)
+{
+    accesses.push_back({srcBuffer.bufferHandle, VK_NULL_HANDLE, false});
+    accesses.push_back({dstBuffer.bufferHandle, VK_NULL_HANDLE, true});
+}
+
+void CopyBufferCommand::collectBindings(std::vector<VkBuffer> &buffers, std::vector<ResourceManager::ImageHardwareWrap *> &images)
+{
+    buffers.push_back(srcBuffer.bufferHandle);
+    buffers.push_back(dstBuffer.bufferHandle);
 }
 
 // CopyImageCommand implementations
@@ -91,7 +110,7 @@ void CopyImageCommand::commitCommand(HardwareExecutorVulkan &hardwareExecutor)
         return;
     }
 
-    hardwareExecutor.hardwareContext->resourceManager.copyImage(hardwareExecutor.currentRecordQueue->commandBuffer,
+    hardwareExecutor.hardwareContext->resourceManager.copyImage(hardwareExecutor.currentCommandBuffer,
                                                                 srcImage,
                                                                 dstImage,
                                                                 srcLayer,
@@ -103,7 +122,7 @@ void CopyImageCommand::commitCommand(HardwareExecutorVulkan &hardwareExecutor)
         srcImage.imageLayout != VK_IMAGE_LAYOUT_GENERAL)
     {
         hardwareExecutor.hardwareContext->resourceManager.transitionImageLayout(
-            hardwareExecutor.currentRecordQueue->commandBuffer,
+            hardwareExecutor.currentCommandBuffer,
             srcImage,
             VK_IMAGE_LAYOUT_GENERAL,
             VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
@@ -114,7 +133,7 @@ void CopyImageCommand::commitCommand(HardwareExecutorVulkan &hardwareExecutor)
         dstImage.imageLayout != VK_IMAGE_LAYOUT_GENERAL)
     {
         hardwareExecutor.hardwareContext->resourceManager.transitionImageLayout(
-            hardwareExecutor.currentRecordQueue->commandBuffer,
+            hardwareExecutor.currentCommandBuffer,
             dstImage,
             VK_IMAGE_LAYOUT_GENERAL,
             VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
@@ -122,17 +141,15 @@ void CopyImageCommand::commitCommand(HardwareExecutorVulkan &hardwareExecutor)
     }
 }
 
-CommandRecordVulkan::RequiredBarriers CopyImageCommand::getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor)
+void CopyImageCommand::getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor, CommandRecordVulkan::RequiredBarriers &requiredBarriers)
 {
-    CommandRecordVulkan::RequiredBarriers requiredBarriers;
-
     if (srcImage.imageFormat != dstImage.imageFormat ||
         srcLayer >= std::max(1u, srcImage.arrayLayers) ||
         dstLayer >= std::max(1u, dstImage.arrayLayers) ||
         srcMip >= std::max(1u, srcImage.mipLevels) ||
         dstMip >= std::max(1u, dstImage.mipLevels))
     {
-        return requiredBarriers;
+        return;
     }
 
     {
@@ -182,15 +199,27 @@ CommandRecordVulkan::RequiredBarriers CopyImageCommand::getRequiredBarriers(Hard
 
         requiredBarriers.imageBarriers.push_back(dstImageBarrier);
     }
+}
+
+void CopyImageCommand::collectResourceAccesses(std::vector<ResourceAccessVulkan> &accesses)
+{
+    // 源图像在 getRequiredBarriers 中会被转换布局，布局转换需要与其他访问串行，按写入处理
+    accesses.push_back({VK_NULL_HANDLE, srcImage.imageHandle, true});
+    accesses.push_back({VK_NULL_HANDLE, dstImage.imageHandle, true});
+}
 
-    return requiredBarriers;
+void CopyImageCommand::collectBindings(std::vector<VkBuffer> &buffers, std::vector<ResourceManager::ImageHardwareWrap *> &images)
+{
+    images.push_back(&srcImage);
+    images.push_back(&dstImage);
 }
 
 // CopyBufferToImageCommand implementations
 CopyBufferToImageCommand::CopyBufferToImageCommand(ResourceManager::BufferHardwareWrap &srcBuf,
                                                    ResourceManager::ImageHardwareWrap &dstImg,
-                                                   uint32_t mip)
-    : srcBuffer(srcBuf), dstImage(dstImg), mipLevel(mip)
+                                                   uint32_t mip,
+                                                   uint64_t bufferOffset)
+    : srcBuffer(srcBuf), dstImage(dstImg), mipLevel(mip), bufferOffset(bufferOffset)
 {
     executorType = ExecutorType::Transfer;
 }
@@ -204,17 +233,18 @@ void CopyBufferToImageCommand::commitCommand(HardwareExecutorVulkan &hardwareExe
 {
     // 使用带 mipLevel 参数的重载版本
     hardwareExecutor.hardwareContext->resourceManager.copyBufferToImage(
-        hardwareExecutor.currentRecordQueue->commandBuffer,
+        hardwareExecutor.currentCommandBuffer,
         srcBuffer,
         dstImage,
         mipLevel,
-        dstImage.arrayLayers);
+        dstImage.arrayLayers,
+        bufferOffset);
 
     if ((dstImage.imageUsage & (VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT)) != 0 &&
         dstImage.imageLayout != VK_IMAGE_LAYOUT_GENERAL)
     {
         hardwareExecutor.hardwareContext->resourceManager.transitionImageLayout(
-            hardwareExecutor.currentRecordQueue->commandBuffer,
+            hardwareExecutor.currentCommandBuffer,
             dstImage,
             VK_IMAGE_LAYOUT_GENERAL,
             VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
@@ -222,9 +252,8 @@ void CopyBufferToImageCommand::commitCommand(HardwareExecutorVulkan &hardwareExe
     }
 }
 
-CommandRecordVulkan::RequiredBarriers CopyBufferToImageCommand::getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor)
+void CopyBufferToImageCommand::getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor, CommandRecordVulkan::RequiredBarriers &requiredBarriers)
 {
-    CommandRecordVulkan::RequiredBarriers requiredBarriers;
     {
         VkBufferMemoryBarrier2 srcBufferBarrier{};
         srcBufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
@@ -235,7 +264,7 @@ CommandRecordVulkan::RequiredBarriers CopyBufferToImageCommand::getRequiredBarri
         srcBufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         srcBufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         srcBufferBarrier.buffer = srcBuffer.bufferHandle;
-        srcBufferBarrier.offset = 0;
+        srcBufferBarrier.offset = bufferOffset;
         srcBufferBarrier.size = VK_WHOLE_SIZE;
         srcBufferBarrier.pNext = nullptr;
 
@@ -265,7 +294,18 @@ CommandRecordVulkan::RequiredBarriers CopyBufferToImageCommand::getRequiredBarri
 
         requiredBarriers.imageBarriers.push_back(dstImageBarrier);
     }
-    return requiredBarriers;
+}
+
+void CopyBufferToImageCommand::collectResourceAccesses(std::vector<ResourceAccessVulkan> &accesses)
+{
+    accesses.push_back({srcBuffer.bufferHandle, VK_NULL_HANDLE, false});
+    accesses.push_back({VK_NULL_HANDLE, dstImage.imageHandle, true});
+}
+
+void CopyBufferToImageCommand::collectBindings(std::vector<VkBuffer> &buffers, std::vector<ResourceManager::ImageHardwareWrap *> &images)
+{
+    buffers.push_back(srcBuffer.bufferHandle);
+    images.push_back(&dstImage);
 }
 
 // CopyImageToBufferCommand implementations
@@ -282,13 +322,13 @@ CommandRecordVulkan::ExecutorType CopyImageToBufferCommand::getExecutorType()
 
 void CopyImageToBufferCommand::commitCommand(HardwareExecutorVulkan &hardwareExecutor)
 {
-    hardwareExecutor.hardwareContext->resourceManager.copyImageToBuffer(hardwareExecutor.currentRecordQueue->commandBuffer, srcImage, dstBuffer);
+    hardwareExecutor.hardwareContext->resourceManager.copyImageToBuffer(hardwareExecutor.currentCommandBuffer, srcImage, dstBuffer);
 
     if ((srcImage.imageUsage & (VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT)) != 0 &&
         srcImage.imageLayout != VK_IMAGE_LAYOUT_GENERAL)
     {
         hardwareExecutor.hardwareContext->resourceManager.transitionImageLayout(
-            hardwareExecutor.currentRecordQueue->commandBuffer,
+            hardwareExecutor.currentCommandBuffer,
             srcImage,
             VK_IMAGE_LAYOUT_GENERAL,
             VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
@@ -296,9 +336,8 @@ void CopyImageToBufferCommand::commitCommand(HardwareExecutorVulkan &hardwareExe
     }
 }
 
-CommandRecordVulkan::RequiredBarriers CopyImageToBufferCommand::getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor)
+void CopyImageToBufferCommand::getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor, CommandRecordVulkan::RequiredBarriers &requiredBarriers)
 {
-    CommandRecordVulkan::RequiredBarriers requiredBarriers;
     {
         VkImageMemoryBarrier2 srcImageBarrier{};
         srcImageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
@@ -338,7 +377,19 @@ CommandRecordVulkan::RequiredBarriers CopyImageToBufferCommand::getRequiredBarri
 
         requiredBarriers.bufferBarriers.push_back(dstBufferBarrier);
     }
-    return requiredBarriers;
+}
+
+void CopyImageToBufferCommand::collectResourceAccesses(std::vector<ResourceAccessVulkan> &accesses)
+{
+    // 源图像在 getRequiredBarriers 中会被转换布局，按写入处理
+    accesses.push_back({VK_NULL_HANDLE, srcImage.imageHandle, true});
+    accesses.push_back({dstBuffer.bufferHandle, VK_NULL_HANDLE, true});
+}
+
+void CopyImageToBufferCommand::collectBindings(std::vector<VkBuffer> &buffers, std::vector<ResourceManager::ImageHardwareWrap *> &images)
+{
+    images.push_back(&srcImage);
+    buffers.push_back(dstBuffer.bufferHandle);
 }
 
 // BlitImageCommand implementations
@@ -355,13 +406,13 @@ CommandRecordVulkan::ExecutorType BlitImageCommand::getExecutorType()
 
 void BlitImageCommand::commitCommand(HardwareExecutorVulkan &hardwareExecutor)
 {
-    hardwareExecutor.hardwareContext->resourceManager.blitImage(hardwareExecutor.currentRecordQueue->commandBuffer, srcImage, dstImage);
+    hardwareExecutor.hardwareContext->resourceManager.blitImage(hardwareExecutor.currentCommandBuffer, srcImage, dstImage);
 
     if ((srcImage.imageUsage & (VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT)) != 0 &&
         srcImage.imageLayout != VK_IMAGE_LAYOUT_GENERAL)
     {
         hardwareExecutor.hardwareContext->resourceManager.transitionImageLayout(
-            hardwareExecutor.currentRecordQueue->commandBuffer,
+            hardwareExecutor.currentCommandBuffer,
             srcImage,
             VK_IMAGE_LAYOUT_GENERAL,
             VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
@@ -372,7 +423,7 @@ void BlitImageCommand::commitCommand(HardwareExecutorVulkan &hardwareExecutor)
         dstImage.imageLayout != VK_IMAGE_LAYOUT_GENERAL)
     {
         hardwareExecutor.hardwareContext->resourceManager.transitionImageLayout(
-            hardwareExecutor.currentRecordQueue->commandBuffer,
+            hardwareExecutor.currentCommandBuffer,
             dstImage,
             VK_IMAGE_LAYOUT_GENERAL,
             VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
@@ -380,10 +431,8 @@ void BlitImageCommand::commitCommand(HardwareExecutorVulkan &hardwareExecutor)
     }
 }
 
-CommandRecordVulkan::RequiredBarriers BlitImageCommand::getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor)
+void BlitImageCommand::getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor, CommandRecordVulkan::RequiredBarriers &requiredBarriers)
 {
-    CommandRecordVulkan::RequiredBarriers requiredBarriers;
-
     {
         VkImageMemoryBarrier2 srcImageBarrier{};
         srcImageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
@@ -431,7 +480,19 @@ CommandRecordVulkan::RequiredBarriers BlitImageCommand::getRequiredBarriers(Hard
 
         requiredBarriers.imageBarriers.push_back(dstImageBarrier);
     }
-    return requiredBarriers;
+}
+
+void BlitImageCommand::collectResourceAccesses(std::vector<ResourceAccessVulkan> &accesses)
+{
+    // 源图像在 getRequiredBarriers 中会被转换布局，布局转换需要与其他访问串行，按写入处理
+    accesses.push_back({VK_NULL_HANDLE, srcImage.imageHandle, true});
+    accesses.push_back({VK_NULL_HANDLE, dstImage.imageHandle, true});
+}
+
+void BlitImageCommand::collectBindings(std::vector<VkBuffer> &buffers, std::vector<ResourceManager::ImageHardwareWrap *> &images)
+{
+    images.push_back(&srcImage);
+    images.push_back(&dstImage);
 }
 
 // TransitionImageLayoutCommand implementations
@@ -448,10 +509,20 @@ CommandRecordVulkan::ExecutorType TransitionImageLayoutCommand::getExecutorType(
 
 void TransitionImageLayoutCommand::commitCommand(HardwareExecutorVulkan &hardwareExecutor)
 {
-    hardwareExecutor.hardwareContext->resourceManager.transitionImageLayout(hardwareExecutor.currentRecordQueue->commandBuffer, image, imageLayout, dstStageMask, dstAccessMask);
+    hardwareExecutor.hardwareContext->resourceManager.transitionImageLayout(hardwareExecutor.currentCommandBuffer, image, imageLayout, dstStageMask, dstAccessMask);
+}
+
+void TransitionImageLayoutCommand::getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor, CommandRecordVulkan::RequiredBarriers &requiredBarriers)
+{
+}
+
+void TransitionImageLayoutCommand::collectResourceAccesses(std::vector<ResourceAccessVulkan> &accesses)
+{
+    // 布局转换会改写图像内容的解释方式，按写入处理
+    accesses.push_back({VK_NULL_HANDLE, image.imageHandle, true});
 }
 
-CommandRecordVulkan::RequiredBarriers TransitionImageLayoutCommand::getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor)
+void TransitionImageLayoutCommand::collectBindings(std::vector<VkBuffer> &buffers, std::vector<ResourceManager::ImageHardwareWrap *> &images)
 {
-    return CommandRecordVulkan::RequiredBarriers{};
+    images.push_back(&image);
 }
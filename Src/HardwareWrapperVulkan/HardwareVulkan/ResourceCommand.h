@@ -6,12 +6,29 @@ struct CopyBufferCommand : public CommandRecordVulkan
 {
     ResourceManager::BufferHardwareWrap &srcBuffer;
     ResourceManager::BufferHardwareWrap &dstBuffer;
-
-    CopyBufferCommand(ResourceManager::BufferHardwareWrap &src, ResourceManager::BufferHardwareWrap &dst);
-
+    uint64_t srcOffset;
+    uint64_t dstOffset;
+    uint64_t size; // 为 0 时拷贝整个缓冲（要求两端大小相同）
+
+    CopyBufferCommand(ResourceManager::BufferHardwareWrap &src,
+                      ResourceManager::BufferHardwareWrap &dst,
+                      uint64_t srcOffset = 0,
+                      uint64_t dstOffset = 0,
+                      uint64_t size = 0);
+
+    const char *getDebugName() const override
+    {
+        return "CopyBuffer";
+    }
     ExecutorType getExecutorType() override;
     void commitCommand(HardwareExecutorVulkan &hardwareExecutor) override;
-    CommandRecordVulkan::RequiredBarriers getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor) override;
+    void getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor, CommandRecordVulkan::RequiredBarriers &requiredBarriers) override;
+    void collectResourceAccesses(std::vector<ResourceAccessVulkan> &accesses) override;
+    [[nodiscard]] bool declaresAllAccesses() const override
+    {
+        return true;
+    }
+    void collectBindings(std::vector<VkBuffer> &buffers, std::vector<ResourceManager::ImageHardwareWrap *> &images) override;
 };
 
 struct CopyImageCommand : public CommandRecordVulkan
@@ -31,9 +48,19 @@ struct CopyImageCommand : public CommandRecordVulkan
                      uint32_t srcMip = 0,
                      uint32_t dstMip = 0);
 
+    const char *getDebugName() const override
+    {
+        return "CopyImage";
+    }
     ExecutorType getExecutorType() override;
     void commitCommand(HardwareExecutorVulkan &hardwareExecutor) override;
-    CommandRecordVulkan::RequiredBarriers getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor) override;
+    void getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor, CommandRecordVulkan::RequiredBarriers &requiredBarriers) override;
+    void collectResourceAccesses(std::vector<ResourceAccessVulkan> &accesses) override;
+    [[nodiscard]] bool declaresAllAccesses() const override
+    {
+        return true;
+    }
+    void collectBindings(std::vector<VkBuffer> &buffers, std::vector<ResourceManager::ImageHardwareWrap *> &images) override;
 };
 
 // struct CopyBufferToImageCommand : public CommandRecordVulkan {
@@ -55,7 +82,7 @@ struct CopyImageCommand : public CommandRecordVulkan
 //     void commitCommand(HardwareExecutorVulkan& hardwareExecutor) override {
 //         // 使用带 mipLevel 参数的重载版本
 //         hardwareExecutor.hardwareContext->resourceManager.copyBufferToImage(
-//             hardwareExecutor.currentRecordQueue->commandBuffer,
+//             hardwareExecutor.currentCommandBuffer,
 //             srcBuffer,
 //             dstImage,
 //             mipLevel);
@@ -111,14 +138,26 @@ struct CopyBufferToImageCommand : public CommandRecordVulkan
     ResourceManager::BufferHardwareWrap &srcBuffer;
     ResourceManager::ImageHardwareWrap &dstImage;
     uint32_t mipLevel;
+    uint64_t bufferOffset; // 源数据在缓冲中的起始偏移（暂存环分配）
 
     CopyBufferToImageCommand(ResourceManager::BufferHardwareWrap &srcBuf,
                              ResourceManager::ImageHardwareWrap &dstImg,
-                             uint32_t mip = 0);
+                             uint32_t mip = 0,
+                             uint64_t bufferOffset = 0);
 
+    const char *getDebugName() const override
+    {
+        return "CopyBufferToImage";
+    }
     ExecutorType getExecutorType() override;
     void commitCommand(HardwareExecutorVulkan &hardwareExecutor) override;
-    CommandRecordVulkan::RequiredBarriers getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor) override;
+    void getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor, CommandRecordVulkan::RequiredBarriers &requiredBarriers) override;
+    void collectResourceAccesses(std::vector<ResourceAccessVulkan> &accesses) override;
+    [[nodiscard]] bool declaresAllAccesses() const override
+    {
+        return true;
+    }
+    void collectBindings(std::vector<VkBuffer> &buffers, std::vector<ResourceManager::ImageHardwareWrap *> &images) override;
 };
 
 struct CopyImageToBufferCommand : public CommandRecordVulkan
@@ -128,9 +167,19 @@ struct CopyImageToBufferCommand : public CommandRecordVulkan
 
     CopyImageToBufferCommand(ResourceManager::ImageHardwareWrap &srcImg, ResourceManager::BufferHardwareWrap &dstBuf);
 
+    const char *getDebugName() const override
+    {
+        return "CopyImageToBuffer";
+    }
     ExecutorType getExecutorType() override;
     void commitCommand(HardwareExecutorVulkan &hardwareExecutor) override;
-    CommandRecordVulkan::RequiredBarriers getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor) override;
+    void getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor, CommandRecordVulkan::RequiredBarriers &requiredBarriers) override;
+    void collectResourceAccesses(std::vector<ResourceAccessVulkan> &accesses) override;
+    [[nodiscard]] bool declaresAllAccesses() const override
+    {
+        return true;
+    }
+    void collectBindings(std::vector<VkBuffer> &buffers, std::vector<ResourceManager::ImageHardwareWrap *> &images) override;
 };
 
 struct BlitImageCommand : public CommandRecordVulkan
@@ -140,9 +189,19 @@ struct BlitImageCommand : public CommandRecordVulkan
 
     BlitImageCommand(ResourceManager::ImageHardwareWrap &srcImg, ResourceManager::ImageHardwareWrap &dstImg);
 
+    const char *getDebugName() const override
+    {
+        return "BlitImage";
+    }
     ExecutorType getExecutorType() override;
     void commitCommand(HardwareExecutorVulkan &hardwareExecutor) override;
-    CommandRecordVulkan::RequiredBarriers getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor) override;
+    void getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor, CommandRecordVulkan::RequiredBarriers &requiredBarriers) override;
+    void collectResourceAccesses(std::vector<ResourceAccessVulkan> &accesses) override;
+    [[nodiscard]] bool declaresAllAccesses() const override
+    {
+        return true;
+    }
+    void collectBindings(std::vector<VkBuffer> &buffers, std::vector<ResourceManager::ImageHardwareWrap *> &images) override;
 };
 
 struct TransitionImageLayoutCommand : public CommandRecordVulkan
@@ -154,7 +213,17 @@ struct TransitionImageLayoutCommand : public CommandRecordVulkan
 
     TransitionImageLayoutCommand(ResourceManager::ImageHardwareWrap &image, VkImageLayout imageLayout, VkPipelineStageFlags2 dstStageMask, VkAccessFlags2 dstAccessMask);
 
+    const char *getDebugName() const override
+    {
+        return "TransitionImageLayout";
+    }
     ExecutorType getExecutorType() override;
     void commitCommand(HardwareExecutorVulkan &hardwareExecutor) override;
-    CommandRecordVulkan::RequiredBarriers getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor) override;
+    void getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor, CommandRecordVulkan::RequiredBarriers &requiredBarriers) override;
+    void collectResourceAccesses(std::vector<ResourceAccessVulkan> &accesses) override;
+    [[nodiscard]] bool declaresAllAccesses() const override
+    {
+        return true;
+    }
+    void collectBindings(std::vector<VkBuffer> &buffers, std::vector<ResourceManager::ImageHardwareWrap *> &images) override;
 };
@@ -0,0 +1,340 @@
+﻿#include "ResourceDependencyTracker.h"
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+
+void ResourceDependencyTracker::appendWait(const TimelinePoint &point,
+                                           VkSemaphore ownSemaphore,
+                                           std::vector<VkSemaphoreSubmitInfo> &waitSemaphores)
+{
+    // 同一队列上的提交已经由 timeline 自等待串行，无需额外依赖
+    if (point.semaphore == VK_NULL_HANDLE || point.value == 0 || point.semaphore == ownSemaphore)
+    {
+        return;
+    }
+
+    VkSemaphoreSubmitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    waitInfo.semaphore = point.semaphore;
+    waitInfo.value = point.value;
+    waitInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    waitSemaphores.push_back(waitInfo);
+}
+
+ResourceDependencyTracker::ResourceState *ResourceDependencyTracker::findState(const ResourceAccessVulkan &access)
+{
+    if (access.buffer != VK_NULL_HANDLE)
+    {
+        auto it = bufferStates.find(access.buffer);
+        return it != bufferStates.end() ? &it->second : nullptr;
+    }
+    auto it = imageStates.find(access.image);
+    return it != imageStates.end() ? &it->second : nullptr;
+}
+
+template <typename StateMap>
+ResourceDependencyTracker::ResourceState &ResourceDependencyTracker::acquireState(StateMap &states,
+                                                                                std::vector<typename StateMap::node_type> &freeNodes,
+                                                                                typename StateMap::key_type key)
+{
+    auto it = states.find(key);
+    if (it != states.end())
+    {
+        return it->second;
+    }
+    if (freeNodes.empty())
+    {
+        // 读取者按 semaphore 去重，数量不超过队列数：一次预留，节点复用后不再增长
+        ResourceState &state = states[key];
+        state.readers.reserve(INITIAL_READER_CAPACITY);
+        return state;
+    }
+
+    typename StateMap::node_type node = std::move(freeNodes.back());
+    freeNodes.pop_back();
+    node.key() = key;
+    node.mapped().lastWriter = {};
+    node.mapped().readers.clear();
+    return states.insert(std::move(node)).position->second;
+}
+
+template <typename StateMap>
+void ResourceDependencyTracker::recycleState(StateMap &states,
+                                             std::vector<typename StateMap::node_type> &freeNodes,
+                                             typename StateMap::iterator it)
+{
+    freeNodes.push_back(states.extract(it));
+}
+
+void ResourceDependencyTracker::trimFreeNodes()
+{
+    const size_t maxFreeNodes = pruneThreshold * 2;
+    if (freeBufferNodes.size() > maxFreeNodes)
+    {
+        freeBufferNodes.resize(maxFreeNodes);
+    }
+    if (freeImageNodes.size() > maxFreeNodes)
+    {
+        freeImageNodes.resize(maxFreeNodes);
+    }
+}
+
+ResourceDependencyTracker::ResourceState &ResourceDependencyTracker::acquireState(const ResourceAccessVulkan &access)
+{
+    if (access.buffer != VK_NULL_HANDLE)
+    {
+        return acquireState(bufferStates, freeBufferNodes, access.buffer);
+    }
+    return acquireState(imageStates, freeImageNodes, access.image);
+}
+
+void ResourceDependencyTracker::recycleState(const ResourceAccessVulkan &access)
+{
+    if (access.buffer != VK_NULL_HANDLE)
+    {
+        if (auto it = bufferStates.find(access.buffer); it != bufferStates.end())
+        {
+            recycleState(bufferStates, freeBufferNodes, it);
+        }
+    }
+    else if (auto it = imageStates.find(access.image); it != imageStates.end())
+    {
+        recycleState(imageStates, freeImageNodes, it);
+    }
+}
+
+void ResourceDependencyTracker::restoreState(const UndoEntry &entry)
+{
+    ResourceState *state = findState(entry.access);
+    if (state == nullptr)
+    {
+        return;
+    }
+
+    const TimelinePoint &submission = entry.submission;
+    if (entry.access.write)
+    {
+        // 之后其他队列的写入已经取代了本次写入，节点不再属于本次提交
+        if (state->lastWriter.semaphore == submission.semaphore && state->lastWriter.value == submission.value)
+        {
+            state->lastWriter = entry.previousState.lastWriter;
+
+            // 放回本次写入清除的读取者，之后其他队列登记的读取者保留
+            for (const TimelinePoint &previousReader : entry.previousState.readers)
+            {
+                auto readerIt = std::find_if(state->readers.begin(), state->readers.end(), [&previousReader](const TimelinePoint &reader) {
+                    return reader.semaphore == previousReader.semaphore;
+                });
+                if (readerIt != state->readers.end())
+                {
+                    readerIt->value = std::max(readerIt->value, previousReader.value);
+                }
+                else
+                {
+                    state->readers.push_back(previousReader);
+                }
+            }
+        }
+    }
+    else
+    {
+        // 同一 semaphore 的读取者只保留最大值：仍是本次提交的值时退回登记前的值
+        auto readerIt = std::find_if(state->readers.begin(), state->readers.end(), [&submission](const TimelinePoint &reader) {
+            return reader.semaphore == submission.semaphore;
+        });
+        if (readerIt != state->readers.end() && readerIt->value == submission.value)
+        {
+            auto previousIt = std::find_if(entry.previousState.readers.begin(), entry.previousState.readers.end(), [&submission](const TimelinePoint &reader) {
+                return reader.semaphore == submission.semaphore;
+            });
+            if (previousIt != entry.previousState.readers.end())
+            {
+                readerIt->value = previousIt->value;
+            }
+            else
+            {
+                state->readers.erase(readerIt);
+            }
+        }
+    }
+
+    if (state->lastWriter.semaphore == VK_NULL_HANDLE && state->readers.empty())
+    {
+        recycleState(entry.access);
+    }
+}
+
+void ResourceDependencyTracker::trackSubmission(const std::vector<ResourceAccessVulkan> &accesses,
+                                                VkSemaphore semaphore,
+                                                uint64_t signalValue,
+                                                std::vector<VkSemaphoreSubmitInfo> &waitSemaphores,
+                                                UndoLog &undoLog)
+{
+    if (accesses.empty())
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(trackerMutex);
+
+    if (bufferStates.size() + imageStates.size() > pruneThreshold)
+    {
+        pruneCompletedStates();
+    }
+
+    const TimelinePoint submission{semaphore, signalValue};
+
+    for (const auto &access : accesses)
+    {
+        if (access.buffer == VK_NULL_HANDLE && access.image == VK_NULL_HANDLE)
+        {
+            continue;
+        }
+
+        // 拷贝赋值复用条目中 readers 已有的容量
+        UndoEntry &undoEntry = undoLog.append();
+        undoEntry.access = access;
+        undoEntry.submission = submission;
+        undoEntry.previousState.lastWriter = {};
+        undoEntry.previousState.readers.clear();
+        if (const ResourceState *existingState = findState(access))
+        {
+            undoEntry.previousState.lastWriter = existingState->lastWriter;
+            undoEntry.previousState.readers.assign(existingState->readers.begin(), existingState->readers.end());
+        }
+
+        ResourceState &state = acquireState(access);
+
+        // RAW / WAW：等待最近一次写入
+        appendWait(state.lastWriter, semaphore, waitSemaphores);
+
+        if (access.write)
+        {
+            // WAR：等待上次写入之后的所有读取，随后成为唯一的写入者
+            for (const auto &reader : state.readers)
+            {
+                appendWait(reader, semaphore, waitSemaphores);
+            }
+            state.readers.clear();
+            state.lastWriter = submission;
+            continue;
+        }
+
+        auto readerIt = std::find_if(state.readers.begin(), state.readers.end(), [semaphore](const TimelinePoint &reader) {
+            return reader.semaphore == semaphore;
+        });
+        if (readerIt != state.readers.end())
+        {
+            readerIt->value = std::max(readerIt->value, signalValue);
+        }
+        else
+        {
+            state.readers.push_back(submission);
+        }
+    }
+}
+
+void ResourceDependencyTracker::rollback(UndoLog &undoLog)
+{
+    if (undoLog.empty())
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    for (size_t i = undoLog.count; i > 0; --i)
+    {
+        restoreState(undoLog.entries[i - 1]);
+    }
+    undoLog.clear();
+}
+
+void ResourceDependencyTracker::clear()
+{
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    bufferStates.clear();
+    imageStates.clear();
+    freeBufferNodes.clear();
+    freeImageNodes.clear();
+    pruneThreshold = MIN_PRUNE_THRESHOLD;
+}
+
+void ResourceDependencyTracker::pruneCompletedStates()
+{
+    // 涉及的 semaphore 只有各队列的 timeline，数量很少：放在栈上的小数组里按 semaphore 线性查找，
+    // 先用缓存值判断，不足时每个 semaphore 最多查询一次；数组满后的 semaphore 不再记忆，每次直接判断
+    struct CompletedValue
+    {
+        VkSemaphore semaphore{VK_NULL_HANDLE};
+        uint64_t value{0};
+        bool refreshed{false};
+    };
+    std::array<CompletedValue, MAX_PRUNE_SEMAPHORES> completedValues{};
+    size_t completedCount = 0;
+    CompletedValue overflowValue;
+    auto isReached = [this, &completedValues, &completedCount, &overflowValue](VkSemaphore semaphore, uint64_t value) -> bool {
+        CompletedValue *completedPtr = nullptr;
+        for (size_t i = 0; i < completedCount && completedPtr == nullptr; i++)
+        {
+            if (completedValues[i].semaphore == semaphore)
+            {
+                completedPtr = &completedValues[i];
+            }
+        }
+        if (completedPtr == nullptr)
+        {
+            completedPtr = completedCount < completedValues.size() ? &completedValues[completedCount++] : &overflowValue;
+            *completedPtr = {semaphore, timelineValueCache->cachedValue(semaphore), false};
+        }
+        CompletedValue &completed = *completedPtr;
+        if (completed.value >= value)
+        {
+            return true;
+        }
+        if (!completed.refreshed)
+        {
+            completed.refreshed = true;
+            uint64_t counterValue = 0;
+            if (timelineValueCache->refresh(semaphore, counterValue) && counterValue != UINT64_MAX)
+            {
+                completed.value = std::max(completed.value, counterValue);
+            }
+        }
+        return completed.value >= value;
+    };
+
+    auto isCompleted = [&isReached](const ResourceState &state) {
+        if (state.lastWriter.semaphore != VK_NULL_HANDLE &&
+            !isReached(state.lastWriter.semaphore, state.lastWriter.value))
+        {
+            return false;
+        }
+        return std::all_of(state.readers.begin(), state.readers.end(), [&isReached](const TimelinePoint &reader) {
+            return isReached(reader.semaphore, reader.value);
+        });
+    };
+
+    for (auto it = bufferStates.begin(); it != bufferStates.end();)
+    {
+        auto next = std::next(it);
+        if (isCompleted(it->second))
+        {
+            recycleState(bufferStates, freeBufferNodes, it);
+        }
+        it = next;
+    }
+    for (auto it = imageStates.begin(); it != imageStates.end();)
+    {
+        auto next = std::next(it);
+        if (isCompleted(it->second))
+        {
+            recycleState(imageStates, freeImageNodes, it);
+        }
+        it = next;
+    }
+
+    // 仍在飞行中的资源较多时放宽阈值，避免每次提交都重新扫描
+    pruneThreshold = std::max(MIN_PRUNE_THRESHOLD, (bufferStates.size() + imageStates.size()) * 2);
+    trimFreeNodes();
+}
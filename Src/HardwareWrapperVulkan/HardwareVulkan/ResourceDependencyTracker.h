@@ -0,0 +1,130 @@
+﻿#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "HardwareWrapperVulkan/HardwareUtilsVulkan.h"
+#include "TimelineValueCache.h"
+
+// 一次提交对某个缓冲/图像的访问，由 CommandRecordVulkan 在录制后上报
+struct ResourceAccessVulkan
+{
+    VkBuffer buffer{VK_NULL_HANDLE};
+    VkImage image{VK_NULL_HANDLE};
+    bool write{false};
+};
+
+// ========== 每设备一个的资源依赖跟踪器 ==========
+// 记录每个缓冲/图像最近一次写入者以及此后的读取者（以 timeline semaphore + value 标识一次提交），
+// 提交时只等待真正存在 RAW/WAR/WAW 依赖的提交，互不相关的执行器可以在多个队列上并行执行
+class ResourceDependencyTracker
+{
+  public:
+    struct TimelinePoint
+    {
+        VkSemaphore semaphore{VK_NULL_HANDLE};
+        uint64_t value{0};
+    };
+
+    struct ResourceState
+    {
+        TimelinePoint lastWriter;
+        std::vector<TimelinePoint> readers; // 每个 semaphore 只保留最大值，同一队列上的提交天然有序
+    };
+
+    // 修改前的状态快照，提交失败时按逆序撤销。
+    // 其他队列可能在登记与撤销之间访问同一资源，撤销只回退节点上仍属于 submission 的部分
+    struct UndoEntry
+    {
+        ResourceAccessVulkan access;
+        TimelinePoint submission;
+        ResourceState previousState; // 登记前不存在的资源为空状态
+    };
+
+    // 撤销日志：clear() 只重置计数，条目及其 readers 容量跨提交复用，稳态下记录快照不再分配内存
+    struct UndoLog
+    {
+        std::vector<UndoEntry> entries;
+        size_t count{0};
+
+        [[nodiscard]] bool empty() const
+        {
+            return count == 0;
+        }
+
+        void clear()
+        {
+            count = 0;
+        }
+
+        UndoEntry &append()
+        {
+            if (count == entries.size())
+            {
+                entries.emplace_back();
+            }
+            return entries[count++];
+        }
+    };
+
+    ResourceDependencyTracker() = default;
+    ResourceDependencyTracker(const ResourceDependencyTracker &) = delete;
+    ResourceDependencyTracker &operator=(const ResourceDependencyTracker &) = delete;
+
+    // 清理已完成状态时通过设备的 timeline 值缓存判断，尽量避免驱动查询
+    void setTimelineValueCache(TimelineValueCache &cache)
+    {
+        timelineValueCache = &cache;
+    }
+
+    // 调用方需持有目标队列锁，且已为本次提交分配 signalValue。
+    // 依赖的 timeline 点追加到 waitSemaphores，本次提交登记为新的写入者/读取者，修改记录写入 undoLog
+    void trackSubmission(const std::vector<ResourceAccessVulkan> &accesses,
+                         VkSemaphore semaphore,
+                         uint64_t signalValue,
+                         std::vector<VkSemaphoreSubmitInfo> &waitSemaphores,
+                         UndoLog &undoLog);
+
+    // vkQueueSubmit2 失败时撤销 trackSubmission 的登记，避免后续提交等待永远不会 signal 的值。
+    // 与其他队列并发的登记互不覆盖：写入者已被替换的资源保持不变，读取者只回退本次提交的值
+    void rollback(UndoLog &undoLog);
+
+    void clear();
+
+  private:
+    using BufferStateMap = std::unordered_map<VkBuffer, ResourceState>;
+    using ImageStateMap = std::unordered_map<VkImage, ResourceState>;
+
+    ResourceState *findState(const ResourceAccessVulkan &access);
+    ResourceState &acquireState(const ResourceAccessVulkan &access);
+    void recycleState(const ResourceAccessVulkan &access);
+    void restoreState(const UndoEntry &entry);
+
+    // 移除的条目以节点形式保留（连同 readers 的容量），新资源改写节点的键后重新插入，稳态下不再分配节点
+    template <typename StateMap>
+    static ResourceState &acquireState(StateMap &states, std::vector<typename StateMap::node_type> &freeNodes, typename StateMap::key_type key);
+    template <typename StateMap>
+    static void recycleState(StateMap &states, std::vector<typename StateMap::node_type> &freeNodes, typename StateMap::iterator it);
+    // 清理后空闲节点最多保留到阈值的两倍，足够在下一次清理前重新填满，又不会无限占用内存
+    void trimFreeNodes();
+
+    // 条目数超过阈值时移除所有访问都已在 GPU 上完成的资源
+    void pruneCompletedStates();
+
+    static void appendWait(const TimelinePoint &point,
+                           VkSemaphore ownSemaphore,
+                           std::vector<VkSemaphoreSubmitInfo> &waitSemaphores);
+
+    static constexpr size_t MIN_PRUNE_THRESHOLD = 1024;
+    static constexpr size_t MAX_PRUNE_SEMAPHORES = 16;   // 清理时记忆完成值的 semaphore 数（各队列的 timeline）
+    static constexpr size_t INITIAL_READER_CAPACITY = 4; // 新节点预留的读取者数
+
+    TimelineValueCache *timelineValueCache{nullptr};
+    std::mutex trackerMutex;
+    BufferStateMap bufferStates;
+    ImageStateMap imageStates;
+    std::vector<BufferStateMap::node_type> freeBufferNodes;
+    std::vector<ImageStateMap::node_type> freeImageNodes;
+    size_t pruneThreshold{MIN_PRUNE_THRESHOLD};
+};
@@ -1,5 +1,8 @@
 ﻿#include "ResourceManager.h"
 
+#include "HardwareMetricsVulkan.h"
+#include "StagingRingVulkan.h"
+#include "SubmitThreadVulkan.h"
 #include "HardwareWrapperVulkan/HardwareContext.h"
 #include "HardwareWrapperVulkan/ResourcePool.h"
 
@@ -46,6 +49,14 @@ void ResourceManager::cleanUpResourceManager()
     // 等待设备空闲
     vkDeviceWaitIdle(logicalDevice);
 
+    {
+        std::lock_guard<std::mutex> lock(stagingRingMutex);
+        stagingRing.reset();
+    }
+
+    // 设备已空闲，墓地中的资源无需再等 timeline
+    flushGraveyard();
+
     // 清理bindless描述符相关资源
     for (auto &bindlessDesc : bindlessDescriptors)
     {
@@ -257,6 +268,7 @@ void ResourceManager::createBindlessDescriptorSet()
     for (size_t i = 0; i < 3; ++i)
     {
         maxResourceCounts[i] = configs[i].computeMaxCount(cachedIndexingProperties);
+        HardwareMetricsVulkan::get().setBindlessCapacity(static_cast<HardwareMetricsVulkan::BindlessSet>(i), maxResourceCounts[i]);
     }
 
     constexpr VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT 
@@ -416,15 +428,17 @@ void ResourceManager::createExternalBufferMemoryPool()
     //     queueFamilyCount);
 }
 
-ResourceManager::ImageHardwareWrap ResourceManager::createImage(ktm::uvec2 imageSize,
-                                                                VkFormat imageFormat,
-                                                                float pixelSize,
-                                                                VkImageUsageFlags imageUsage,
-                                                                uint32_t arrayLayers,
-                                                                uint32_t mipLevels,
-                                                                VkImageTiling tiling)
+bool ResourceManager::prepareImageCreateInfo(ImageHardwareWrap &resultImage,
+                                             ktm::uvec2 imageSize,
+                                             VkFormat imageFormat,
+                                             float pixelSize,
+                                             VkImageUsageFlags imageUsage,
+                                             uint32_t arrayLayers,
+                                             uint32_t mipLevels,
+                                             VkImageTiling tiling,
+                                             VkImageCreateInfo &imageInfo,
+                                             std::vector<uint32_t> &queueFamilyIndices)
 {
-    ImageHardwareWrap resultImage{};
     resultImage.device = device;
     resultImage.resourceManager = this;
     resultImage.imageSize = imageSize;
@@ -456,10 +470,10 @@ ResourceManager::ImageHardwareWrap ResourceManager::createImage(ktm::uvec2 image
     if (imageSize.x == 0 || imageSize.y == 0)
     {
         // 无效尺寸，返回空图像
-        return resultImage;
+        return false;
     }
 
-    VkImageCreateInfo imageInfo{};
+    imageInfo = VkImageCreateInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.imageType = VK_IMAGE_TYPE_2D;
     imageInfo.extent = {imageSize.x, imageSize.y, 1};
@@ -472,7 +486,7 @@ ResourceManager::ImageHardwareWrap ResourceManager::createImage(ktm::uvec2 image
     imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 
     // 配置队列族共享模式
-    std::vector<uint32_t> queueFamilyIndices;
+    queueFamilyIndices.clear();
     const uint32_t queueFamilyCount = device->getQueueFamilyNumber();
 
     if (queueFamilyCount > 1)
@@ -491,11 +505,36 @@ ResourceManager::ImageHardwareWrap ResourceManager::createImage(ktm::uvec2 image
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     }
 
+    return true;
+}
+
+ResourceManager::ImageHardwareWrap ResourceManager::createImage(ktm::uvec2 imageSize,
+                                                                VkFormat imageFormat,
+                                                                float pixelSize,
+                                                                VkImageUsageFlags imageUsage,
+                                                                uint32_t arrayLayers,
+                                                                uint32_t mipLevels,
+                                                                VkImageTiling tiling)
+{
+    ImageHardwareWrap resultImage{};
+    VkImageCreateInfo imageInfo{};
+    std::vector<uint32_t> queueFamilyIndices;
+    if (!prepareImageCreateInfo(resultImage, imageSize, imageFormat, pixelSize, imageUsage, arrayLayers, mipLevels, tiling, imageInfo, queueFamilyIndices))
+    {
+        return resultImage;
+    }
+
     VmaAllocationCreateInfo allocInfo{};
     allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE; // 优先使用设备本地内存
 
     coronaHardwareCheck(vmaCreateImage(vmaAllocator, &imageInfo, &allocInfo, &resultImage.imageHandle, &resultImage.imageAlloc, &resultImage.imageAllocInfo));
 
+    resultImage.ownedImage = std::make_shared<OwnedImage>();
+    resultImage.ownedImage->resourceManager = this;
+    resultImage.ownedImage->imageHandle = resultImage.imageHandle;
+    resultImage.ownedImage->imageAlloc = resultImage.imageAlloc;
+    resultImage.ownedImage->allocSize = resultImage.imageAllocInfo.size;
+
     // 创建图像视图
     resultImage.imageView = createImageView(resultImage);
 
@@ -506,6 +545,91 @@ ResourceManager::ImageHardwareWrap ResourceManager::createImage(ktm::uvec2 image
     return resultImage;
 }
 
+ResourceManager::ImageHardwareWrap ResourceManager::createAliasableImage(ktm::uvec2 imageSize,
+                                                                         VkFormat imageFormat,
+                                                                         float pixelSize,
+                                                                         VkImageUsageFlags imageUsage,
+                                                                         uint32_t arrayLayers,
+                                                                         uint32_t mipLevels,
+                                                                         VkMemoryRequirements &memoryRequirements)
+{
+    ImageHardwareWrap resultImage{};
+    VkImageCreateInfo imageInfo{};
+    std::vector<uint32_t> queueFamilyIndices;
+    memoryRequirements = VkMemoryRequirements{};
+    if (!prepareImageCreateInfo(resultImage, imageSize, imageFormat, pixelSize, imageUsage, arrayLayers, mipLevels, VK_IMAGE_TILING_OPTIMAL, imageInfo, queueFamilyIndices))
+    {
+        return resultImage;
+    }
+
+    // 只创建 VkImage，内存由调用方统一分配后通过 bindAliasingImage 绑定
+    coronaHardwareCheck(vkCreateImage(device->getLogicalDevice(), &imageInfo, nullptr, &resultImage.imageHandle));
+    vkGetImageMemoryRequirements(device->getLogicalDevice(), resultImage.imageHandle, &memoryRequirements);
+
+    return resultImage;
+}
+
+VmaAllocation ResourceManager::allocateAliasingMemory(const VkMemoryRequirements &memoryRequirements)
+{
+    VmaAllocationCreateInfo allocInfo{};
+    allocInfo.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    VmaAllocation allocation{VK_NULL_HANDLE};
+    VmaAllocationInfo allocationInfo{};
+    coronaHardwareCheck(vmaAllocateMemory(vmaAllocator, &memoryRequirements, &allocInfo, &allocation, &allocationInfo));
+
+    deviceMemorySize += allocationInfo.size;
+    return allocation;
+}
+
+void ResourceManager::bindAliasingImage(ImageHardwareWrap &image, VmaAllocation allocation)
+{
+    coronaHardwareCheck(vmaBindImageMemory(vmaAllocator, allocation, image.imageHandle));
+    vmaGetAllocationInfo(vmaAllocator, allocation, &image.imageAllocInfo);
+
+    // 新绑定内存的内容未定义，从 UNDEFINED 开始
+    image.imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    image.imageView = createImageView(image);
+}
+
+void ResourceManager::destroyAliasableImage(ImageHardwareWrap &image)
+{
+    GraveyardEntry entry;
+    for (auto &[cacheKey, imageView] : image.allSubViews)
+    {
+        entry.imageViews.push_back(imageView);
+    }
+    entry.image = image.imageHandle;
+
+    image.allSubViews.clear();
+    image.imageView = VK_NULL_HANDLE;
+    image.imageHandle = VK_NULL_HANDLE;
+    image.imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (entry.image != VK_NULL_HANDLE || !entry.imageViews.empty())
+    {
+        buryInGraveyard(std::move(entry));
+    }
+    collectGraveyard();
+}
+
+void ResourceManager::freeAliasingMemory(VmaAllocation allocation)
+{
+    if (allocation == VK_NULL_HANDLE || vmaAllocator == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    VmaAllocationInfo allocationInfo{};
+    vmaGetAllocationInfo(vmaAllocator, allocation, &allocationInfo);
+    deviceMemorySize -= std::min(deviceMemorySize, allocationInfo.size);
+
+    GraveyardEntry entry;
+    entry.aliasingMemory = allocation;
+    buryInGraveyard(std::move(entry));
+    collectGraveyard();
+}
+
 // VkImageView ResourceManager::createImageView(ImageHardwareWrap& image, uint32_t layer, uint32_t mipLevel) {
 //     VkImageViewCreateInfo viewInfo{};
 //     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -628,6 +752,22 @@ VkImageView ResourceManager::createImageView(ImageHardwareWrap &image, uint32_t
     return imageView;
 }
 
+ResourceManager::OwnedImage::~OwnedImage()
+{
+    if (resourceManager == nullptr || imageHandle == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    GraveyardEntry entry;
+    entry.image = imageHandle;
+    entry.imageAlloc = imageAlloc;
+    entry.imageViews = std::move(retiredViews);
+
+    resourceManager->deviceMemorySize -= std::min<uint64_t>(resourceManager->deviceMemorySize, allocSize);
+    resourceManager->buryInGraveyard(std::move(entry));
+}
+
 void ResourceManager::destroyImage(ImageHardwareWrap &image)
 {
     if (vmaAllocator == VK_NULL_HANDLE)
@@ -635,37 +775,33 @@ void ResourceManager::destroyImage(ImageHardwareWrap &image)
         return;
     }
 
-    VkDevice logicalDevice = device->getLogicalDevice();
-
-    // if (image.generateMips) {
-    //     // 清理每个 mip level 的视图
-    //     for (auto& mipView : image.mipLevelImageViews) {
-    //         if (mipView != VK_NULL_HANDLE) {
-    //             vkDestroyImageView(logicalDevice, mipView, nullptr);
-    //         }
-    //     }
-    //     image.mipLevelImageViews.clear();
-    // }
-
-    // 清理主 ImageView
-    /*if (image.imageView != VK_NULL_HANDLE) {
-        vkDestroyImageView(logicalDevice, image.imageView, nullptr);
+    // 瞬态图像由渲染图销毁，交换链图像由交换链管理
+    if (image.ownedImage)
+    {
+        // 子图像的视图缓存在创建它的图像上，统一移交给共享的 OwnedImage，随 VkImage 一起销毁
+        {
+            std::lock_guard<std::mutex> lock(image.ownedImage->viewMutex);
+            for (auto &[cacheKey, imageView] : image.allSubViews)
+            {
+                image.ownedImage->retiredViews.push_back(imageView);
+            }
+        }
+        image.allSubViews.clear();
         image.imageView = VK_NULL_HANDLE;
-    }*/
-
-    // 销毁图像
-    /*if (image.imageHandle != VK_NULL_HANDLE) {
-        vmaDestroyImage(vmaAllocator, image.imageHandle, image.imageAlloc);
         image.imageHandle = VK_NULL_HANDLE;
         image.imageAlloc = VK_NULL_HANDLE;
-    }*/
+        image.ownedImage.reset();
+    }
+
+    collectGraveyard();
 }
 
 ResourceManager::BufferHardwareWrap ResourceManager::createBuffer(uint32_t elementCount,
                                                                   uint32_t elementSize,
                                                                   VkBufferUsageFlags usage,
-                                                                  bool hostVisibleMapped,
-                                                                  bool useDedicated)
+                                                                  BufferPlacement placement,
+                                                                  bool useDedicated,
+                                                                  bool exportable)
 {
     BufferHardwareWrap resultBuffer{};
     resultBuffer.device = device;
@@ -711,20 +847,45 @@ ResourceManager::BufferHardwareWrap ResourceManager::createBuffer(uint32_t eleme
         bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     }
 
-    // 配置外部内存支持
-    VkExternalMemoryBufferCreateInfo externalMemoryInfo{};
-    externalMemoryInfo.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO_KHR;
-    externalMemoryInfo.handleTypes = EXTERNAL_MEMORY_HANDLE_TYPE;
-    bufferInfo.pNext = &externalMemoryInfo;
-
     VmaAllocationCreateInfo allocInfo{};
     allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
 
-    if (hostVisibleMapped)
+    switch (placement)
     {
+    case BufferPlacement::HostVisible:
         allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+        break;
+    case BufferPlacement::Auto:
+        // 允许 VMA 选择不可映射的显存，此时 pMappedData 为空，读写改走暂存缓冲
+        allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                          VMA_ALLOCATION_CREATE_HOST_ACCESS_ALLOW_TRANSFER_INSTEAD_BIT |
+                          VMA_ALLOCATION_CREATE_MAPPED_BIT;
+        break;
+    case BufferPlacement::DeviceLocal:
+        // 不带任何 HOST_ACCESS 标志时 VMA_MEMORY_USAGE_AUTO 会选择 DEVICE_LOCAL 内存
+        break;
+    }
+
+    if (!exportable)
+    {
+        // 不导出的缓冲不挂外部内存信息，由 VMA 从大块 VkDeviceMemory 中子分配，
+        // 避免每个小缓冲各占一次 vkAllocateMemory 而触及 maxMemoryAllocationCount
+        if (useDedicated)
+        {
+            allocInfo.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+        }
+        createNonExportableBuffer(bufferInfo, allocInfo, resultBuffer);
+        resultBuffer.readbackViaTransfer = placement == BufferPlacement::Auto && resultBuffer.bufferAllocInfo.pMappedData != nullptr && !isHostCached(resultBuffer);
+        return resultBuffer;
     }
 
+    // 配置外部内存支持
+    VkExternalMemoryBufferCreateInfo externalMemoryInfo{};
+    externalMemoryInfo.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO_KHR;
+    externalMemoryInfo.handleTypes = EXTERNAL_MEMORY_HANDLE_TYPE;
+    bufferInfo.pNext = &externalMemoryInfo;
+    resultBuffer.exportable = true;
+
     if (useDedicated)
     {
         // 强制使用专用内存
@@ -745,14 +906,17 @@ ResourceManager::BufferHardwareWrap ResourceManager::createBuffer(uint32_t eleme
         vkGetPhysicalDeviceExternalBufferProperties(device->getPhysicalDevice(), &externalBufferInfo, &externalBufferProperties);
 
         const auto features = externalBufferProperties.externalMemoryProperties.externalMemoryFeatures;
-        const bool exportable = (features & VK_EXTERNAL_MEMORY_FEATURE_EXPORTABLE_BIT) != 0;
-        const bool importable = (features & VK_EXTERNAL_MEMORY_FEATURE_IMPORTABLE_BIT) != 0;
+        const bool canExport = (features & VK_EXTERNAL_MEMORY_FEATURE_EXPORTABLE_BIT) != 0;
+        const bool canImport = (features & VK_EXTERNAL_MEMORY_FEATURE_IMPORTABLE_BIT) != 0;
         const bool dedicatedOnly = (features & VK_EXTERNAL_MEMORY_FEATURE_DEDICATED_ONLY_BIT) != 0;
 
-        if (!exportable || !importable)
+        if (!canExport || !canImport)
         {
             // 回退到非导出缓冲区
-            createNonExportableBuffer(bufferInfo, allocInfo, resultBuffer);
+            VkBufferCreateInfo fallbackInfo = bufferInfo;
+            fallbackInfo.pNext = nullptr;
+            resultBuffer.exportable = false;
+            createNonExportableBuffer(fallbackInfo, allocInfo, resultBuffer);
         }
         else if (dedicatedOnly || exportBufferPool == VK_NULL_HANDLE)
         {
@@ -766,9 +930,81 @@ ResourceManager::BufferHardwareWrap ResourceManager::createBuffer(uint32_t eleme
         }
     }
 
+    resultBuffer.readbackViaTransfer = placement == BufferPlacement::Auto && resultBuffer.bufferAllocInfo.pMappedData != nullptr && !isHostCached(resultBuffer);
     return resultBuffer;
 }
 
+bool ResourceManager::isHostCached(const BufferHardwareWrap &buffer) const
+{
+    if (buffer.bufferAllocInfo.pMappedData == nullptr || buffer.bufferAlloc == VK_NULL_HANDLE)
+    {
+        return false;
+    }
+    VkMemoryPropertyFlags memoryFlags = 0;
+    vmaGetAllocationMemoryProperties(vmaAllocator, buffer.bufferAlloc, &memoryFlags);
+    return (memoryFlags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) != 0;
+}
+
+ResourceManager::BufferHardwareWrap ResourceManager::createStagingBuffer(uint64_t size, bool readback)
+{
+    BufferHardwareWrap resultBuffer{};
+    resultBuffer.device = device;
+    resultBuffer.resourceManager = this;
+    resultBuffer.bufferUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    if (size == 0)
+    {
+        return resultBuffer;
+    }
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = resultBuffer.bufferUsage;
+
+    // 任意队列族上的传输命令都可能读取暂存环
+    std::vector<uint32_t> queueFamilyIndices;
+    const uint32_t queueFamilyCount = device->getQueueFamilyNumber();
+    if (queueFamilyCount > 1)
+    {
+        queueFamilyIndices.resize(queueFamilyCount);
+        std::iota(queueFamilyIndices.begin(), queueFamilyIndices.end(), 0u);
+
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilyIndices.size());
+        bufferInfo.pQueueFamilyIndices = queueFamilyIndices.data();
+    }
+    else
+    {
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    VmaAllocationCreateInfo allocInfo{};
+    allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+    allocInfo.flags = (readback ? VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT : VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT) |
+                      VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    if (vmaCreateBuffer(vmaAllocator, &bufferInfo, &allocInfo, &resultBuffer.bufferHandle, &resultBuffer.bufferAlloc, &resultBuffer.bufferAllocInfo) != VK_SUCCESS)
+    {
+        resultBuffer.bufferHandle = VK_NULL_HANDLE;
+        resultBuffer.bufferAlloc = VK_NULL_HANDLE;
+        return resultBuffer;
+    }
+
+    resultBuffer.elementCount = static_cast<uint32_t>(size);
+    resultBuffer.elementSize = 1;
+    return resultBuffer;
+}
+
+StagingRingVulkan &ResourceManager::getStagingRing()
+{
+    std::lock_guard<std::mutex> lock(stagingRingMutex);
+    if (!stagingRing)
+    {
+        stagingRing = std::make_unique<StagingRingVulkan>(*this);
+    }
+    return *stagingRing;
+}
+
 void ResourceManager::createDedicatedBuffer(const VkBufferCreateInfo &bufferInfo,
                                             const VmaAllocationCreateInfo &allocInfo,
                                             BufferHardwareWrap &resultBuffer)
@@ -804,6 +1040,7 @@ void ResourceManager::createDedicatedBuffer(const VkBufferCreateInfo &bufferInfo
 
         VkBufferCreateInfo fallbackInfo = bufferInfo;
         fallbackInfo.pNext = nullptr;
+        resultBuffer.exportable = false;
 
         coronaHardwareCheck(vmaCreateBuffer(vmaAllocator,
                                             &fallbackInfo,
@@ -831,75 +1068,243 @@ void ResourceManager::createNonExportableBuffer(const VkBufferCreateInfo &buffer
     coronaHardwareCheck(vmaCreateBuffer(vmaAllocator, &bufferInfo, &allocInfo, &resultBuffer.bufferHandle, &resultBuffer.bufferAlloc, &resultBuffer.bufferAllocInfo));
 }
 
-void ResourceManager::destroyBuffer(BufferHardwareWrap &buffer)
+void ResourceManager::collectQueueTimelines(std::vector<VkSemaphore> &semaphores, std::vector<uint64_t> &values) const
 {
-    if (buffer.bufferHandle != VK_NULL_HANDLE && vmaAllocator != VK_NULL_HANDLE)
-    {
-        // 修复2: 使用基于 timeline semaphore 的延迟销毁，避免 vkDeviceWaitIdle 阻塞
-        // vkDeviceWaitIdle 会阻塞整个设备，导致多线程场景下的竞态条件和 TDR
-        
-        // 收集所有队列的当前 timeline 值，等待所有正在进行的 GPU 操作完成
-        std::vector<VkSemaphore> semaphores;
-        std::vector<uint64_t> waitValues;
-        
-        auto collectQueueSemaphores = [&](const std::vector<DeviceManager::QueueUtils>& queues) {
-            for (const auto& queue : queues) {
-                if (queue.timelineSemaphore != VK_NULL_HANDLE && queue.timelineValue) {
-                    uint64_t currentValue = queue.timelineValue->load(std::memory_order_acquire);
-                    if (currentValue > 0) {
-                        semaphores.push_back(queue.timelineSemaphore);
-                        waitValues.push_back(currentValue);
-                    }
+    auto collectQueueSemaphores = [&](const std::vector<DeviceManager::QueueUtils> &queues) {
+        for (const auto &queue : queues)
+        {
+            if (queue.timelineSemaphore != VK_NULL_HANDLE && queue.timelineValue)
+            {
+                uint64_t currentValue = queue.timelineValue->load(std::memory_order_acquire);
+                if (currentValue > 0)
+                {
+                    semaphores.push_back(queue.timelineSemaphore);
+                    values.push_back(currentValue);
                 }
             }
-        };
+        }
+    };
+
+    collectQueueSemaphores(device->graphicsQueues);
+    collectQueueSemaphores(device->computeQueues);
+    collectQueueSemaphores(device->transferQueues);
+}
+
+void ResourceManager::waitForInFlightWork()
+{
+    // 收集所有队列的当前 timeline 值，等待所有正在进行的 GPU 操作完成
+    std::vector<VkSemaphore> semaphores;
+    std::vector<uint64_t> waitValues;
+    collectQueueTimelines(semaphores, waitValues);
+    
+    if (!semaphores.empty()) {
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.pNext = nullptr;
+        waitInfo.flags = 0;
+        waitInfo.semaphoreCount = static_cast<uint32_t>(semaphores.size());
+        waitInfo.pSemaphores = semaphores.data();
+        waitInfo.pValues = waitValues.data();
         
-        collectQueueSemaphores(device->graphicsQueues);
-        collectQueueSemaphores(device->computeQueues);
-        collectQueueSemaphores(device->transferQueues);
+        // 设置合理的超时时间（2秒），避免无限等待
+        constexpr uint64_t timeoutNs = 2'000'000'000ULL;
         
-        if (!semaphores.empty()) {
-            VkSemaphoreWaitInfo waitInfo{};
-            waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
-            waitInfo.pNext = nullptr;
-            waitInfo.flags = 0;
-            waitInfo.semaphoreCount = static_cast<uint32_t>(semaphores.size());
-            waitInfo.pSemaphores = semaphores.data();
-            waitInfo.pValues = waitValues.data();
-            
-            // 设置合理的超时时间（2秒），避免无限等待
-            constexpr uint64_t timeoutNs = 2'000'000'000ULL;
-            
-            VkResult result = vkWaitSemaphores(device->getLogicalDevice(), &waitInfo, timeoutNs);
-            if (result == VK_TIMEOUT) {
-                CFW_LOG_WARNING("[ResourceManager] destroyBuffer: timeout waiting for GPU operations, forcing device wait");
-                vkDeviceWaitIdle(device->getLogicalDevice());
-            } else if (result != VK_SUCCESS && result != VK_ERROR_DEVICE_LOST) {
-                CFW_LOG_ERROR("[ResourceManager] destroyBuffer: vkWaitSemaphores failed with {}", static_cast<int>(result));
-                // 回退到 vkDeviceWaitIdle
-                vkDeviceWaitIdle(device->getLogicalDevice());
+        VkResult result = vkWaitSemaphores(device->getLogicalDevice(), &waitInfo, timeoutNs);
+        if (result == VK_TIMEOUT) {
+            CFW_LOG_WARNING("[ResourceManager] waitForInFlightWork: timeout waiting for GPU operations, forcing device wait");
+            vkDeviceWaitIdle(device->getLogicalDevice());
+        } else if (result != VK_SUCCESS && result != VK_ERROR_DEVICE_LOST) {
+            CFW_LOG_ERROR("[ResourceManager] waitForInFlightWork: vkWaitSemaphores failed with {}", static_cast<int>(result));
+            // 回退到 vkDeviceWaitIdle
+            vkDeviceWaitIdle(device->getLogicalDevice());
+        }
+        // 如果是 VK_ERROR_DEVICE_LOST，不再调用任何 Vulkan API，直接清理
+    } else {
+        // 没有活跃的 timeline semaphore，说明没有进行中的 GPU 操作
+        // 这种情况下可以安全地直接销毁
+    }
+}
+
+void ResourceManager::destroyBuffer(BufferHardwareWrap &buffer)
+{
+    if (buffer.bufferHandle != VK_NULL_HANDLE && vmaAllocator != VK_NULL_HANDLE)
+    {
+        // 不再同步等待 GPU：已提交的工作可能仍在读写此缓冲，交给墓地在各队列 timeline 达到后释放
+        GraveyardEntry entry;
+        entry.buffer = buffer.bufferHandle;
+        entry.bufferAlloc = buffer.bufferAlloc;
+        entry.hostImportedManualBind = buffer.hostImportedManualBind;
+        buryInGraveyard(std::move(entry));
+
+        buffer.hostImportedManualBind = false;
+        buffer.bufferHandle = VK_NULL_HANDLE;
+        buffer.bufferAlloc = VK_NULL_HANDLE;
+        buffer.elementCount = 0;
+    }
+
+    collectGraveyard();
+}
+
+void ResourceManager::destroyPipelineObjects(const PipelineObjects &objects)
+{
+    GraveyardEntry entry;
+    entry.pipelineObjects = objects;
+    buryInGraveyard(std::move(entry));
+
+    collectGraveyard();
+}
+
+uint64_t ResourceManager::pendingSubmitCount() const
+{
+    std::lock_guard<std::mutex> lock(device->submitThreadMutex);
+    if (!device->submitThread)
+    {
+        return 0;
+    }
+    const uint64_t enqueuedCount = device->submitThread->getEnqueuedCount();
+    return device->submitThread->getProcessedCount() < enqueuedCount ? enqueuedCount : 0;
+}
+
+bool ResourceManager::isSubmitCountProcessed(uint64_t submitCount) const
+{
+    // 提交线程停止前已处理完所有批次
+    std::lock_guard<std::mutex> lock(device->submitThreadMutex);
+    return !device->submitThread || device->submitThread->getProcessedCount() >= submitCount;
+}
+
+void ResourceManager::buryInGraveyard(GraveyardEntry &&entry)
+{
+    // 已入队的异步提交可能引用该资源，但 timeline 值要到提交线程处理时才分配，此时的快照不包含它们
+    entry.pendingSubmitCount = pendingSubmitCount();
+    if (entry.pendingSubmitCount == 0)
+    {
+        collectQueueTimelines(entry.semaphores, entry.timelineValues);
+        if (entry.semaphores.empty())
+        {
+            // 从未有过提交，没有 GPU 工作可能引用它
+            releaseGraveyardEntry(entry);
+            return;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(graveyardMutex);
+    graveyard.push_back(std::move(entry));
+    graveyardSize.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ResourceManager::collectGraveyard()
+{
+    if (graveyardSize.load(std::memory_order_relaxed) == 0)
+    {
+        return;
+    }
+
+    TimelineValueCache &timelineValueCache = device->getTimelineValueCache();
+
+    std::lock_guard<std::mutex> lock(graveyardMutex);
+    while (!graveyard.empty())
+    {
+        GraveyardEntry &entry = graveyard.front();
+        if (entry.pendingSubmitCount != 0)
+        {
+            if (!isSubmitCountProcessed(entry.pendingSubmitCount))
+            {
+                return;
             }
-            // 如果是 VK_ERROR_DEVICE_LOST，不再调用任何 Vulkan API，直接清理
-        } else {
-            // 没有活跃的 timeline semaphore，说明没有进行中的 GPU 操作
-            // 这种情况下可以安全地直接销毁
+            // 销毁前入队的批次都已分配 timeline 值，此时的快照覆盖了它们
+            entry.pendingSubmitCount = 0;
+            collectQueueTimelines(entry.semaphores, entry.timelineValues);
         }
-        
-        if (buffer.hostImportedManualBind)
+
+        for (size_t i = 0; i < entry.semaphores.size(); ++i)
         {
-            vkDestroyBuffer(device->getLogicalDevice(), buffer.bufferHandle, nullptr);
-            vmaFreeMemory(vmaAllocator, buffer.bufferAlloc);
-            buffer.hostImportedManualBind = false;
+            if (!timelineValueCache.isReached(entry.semaphores[i], entry.timelineValues[i]))
+            {
+                return;
+            }
+        }
+
+        releaseGraveyardEntry(entry);
+        graveyard.pop_front();
+        graveyardSize.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void ResourceManager::flushGraveyard()
+{
+    std::lock_guard<std::mutex> lock(graveyardMutex);
+    for (GraveyardEntry &entry : graveyard)
+    {
+        releaseGraveyardEntry(entry);
+    }
+    graveyard.clear();
+    graveyardSize.store(0, std::memory_order_relaxed);
+}
+
+void ResourceManager::releaseGraveyardEntry(GraveyardEntry &entry)
+{
+    VkDevice logicalDevice = device->getLogicalDevice();
+
+    if (entry.buffer != VK_NULL_HANDLE)
+    {
+        if (entry.hostImportedManualBind)
+        {
+            vkDestroyBuffer(logicalDevice, entry.buffer, nullptr);
+            vmaFreeMemory(vmaAllocator, entry.bufferAlloc);
         }
         else
         {
-            vmaDestroyBuffer(vmaAllocator, buffer.bufferHandle, buffer.bufferAlloc);
+            vmaDestroyBuffer(vmaAllocator, entry.buffer, entry.bufferAlloc);
         }
+        entry.buffer = VK_NULL_HANDLE;
+        entry.bufferAlloc = VK_NULL_HANDLE;
+    }
 
-        buffer.bufferHandle = VK_NULL_HANDLE;
-        buffer.bufferAlloc = VK_NULL_HANDLE;
-        buffer.elementCount = 0;
+    for (VkImageView imageView : entry.imageViews)
+    {
+        vkDestroyImageView(logicalDevice, imageView, nullptr);
+    }
+    entry.imageViews.clear();
+
+    if (entry.image != VK_NULL_HANDLE)
+    {
+        vmaDestroyImage(vmaAllocator, entry.image, entry.imageAlloc);
+        entry.image = VK_NULL_HANDLE;
+        entry.imageAlloc = VK_NULL_HANDLE;
+    }
+
+    if (entry.aliasingMemory != VK_NULL_HANDLE)
+    {
+        vmaFreeMemory(vmaAllocator, entry.aliasingMemory);
+        entry.aliasingMemory = VK_NULL_HANDLE;
+    }
+
+    PipelineObjects &objects = entry.pipelineObjects;
+    if (objects.framebuffer != VK_NULL_HANDLE)
+    {
+        vkDestroyFramebuffer(logicalDevice, objects.framebuffer, nullptr);
+    }
+    if (objects.pipeline != VK_NULL_HANDLE)
+    {
+        vkDestroyPipeline(logicalDevice, objects.pipeline, nullptr);
+    }
+    if (objects.pipelineLayout != VK_NULL_HANDLE)
+    {
+        vkDestroyPipelineLayout(logicalDevice, objects.pipelineLayout, nullptr);
+    }
+    if (objects.renderPass != VK_NULL_HANDLE)
+    {
+        vkDestroyRenderPass(logicalDevice, objects.renderPass, nullptr);
     }
+    if (objects.descriptorPool != VK_NULL_HANDLE)
+    {
+        vkDestroyDescriptorPool(logicalDevice, objects.descriptorPool, nullptr);
+    }
+    if (objects.descriptorSetLayout != VK_NULL_HANDLE)
+    {
+        vkDestroyDescriptorSetLayout(logicalDevice, objects.descriptorSetLayout, nullptr);
+    }
+    objects = {};
 }
 
 ResourceManager::ExternalMemoryHandle ResourceManager::exportBufferMemory(BufferHardwareWrap &sourceBuffer)
@@ -911,6 +1316,12 @@ ResourceManager::ExternalMemoryHandle ResourceManager::exportBufferMemory(Buffer
             "Cannot export memory from invalid buffer: "
             "buffer handle or allocation is null");
     }
+    if (!sourceBuffer.exportable)
+    {
+        throw std::runtime_error(
+            "Cannot export memory from buffer: "
+            "buffer was not created as exportable");
+    }
 
     ExternalMemoryHandle memHandle{};
 
@@ -1171,6 +1582,7 @@ int32_t ResourceManager::storeDescriptor(Corona::Kernel::Utils::Storage<Resource
     if (image->bindlessIndex < 0)
     {
         image->bindlessIndex = globalImageStorages.seq_id(image);
+        HardwareMetricsVulkan::get().occupyBindlessSlot(HardwareMetricsVulkan::bindlessSetOf(*image), image->bindlessIndex);
     }
     storeDescriptorAt(image, static_cast<uint32_t>(image->bindlessIndex));
 
@@ -1182,6 +1594,7 @@ int32_t ResourceManager::storeDescriptor(Corona::Kernel::Utils::Storage<Resource
     if (buffer->bindlessIndex < 0)
     {
         buffer->bindlessIndex = globalBufferStorages.seq_id(buffer);
+        HardwareMetricsVulkan::get().occupyBindlessSlot(HardwareMetricsVulkan::BindlessSet::StorageBuffer, buffer->bindlessIndex);
     }
     storeDescriptorAt(buffer, static_cast<uint32_t>(buffer->bindlessIndex));
 
@@ -1265,6 +1678,77 @@ ResourceManager &ResourceManager::copyBuffer(VkCommandBuffer &commandBuffer,
     return *this;
 }
 
+ResourceManager &ResourceManager::copyBuffer(VkCommandBuffer &commandBuffer,
+                                             BufferHardwareWrap &srcBuffer,
+                                             BufferHardwareWrap &dstBuffer,
+                                             uint64_t srcOffset,
+                                             uint64_t dstOffset,
+                                             uint64_t size)
+{
+    const uint64_t srcSize = static_cast<uint64_t>(srcBuffer.elementCount) * srcBuffer.elementSize;
+    const uint64_t dstSize = static_cast<uint64_t>(dstBuffer.elementCount) * dstBuffer.elementSize;
+    if (size != 0 && srcOffset + size <= srcSize && dstOffset + size <= dstSize)
+    {
+        VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = srcOffset;
+        copyRegion.dstOffset = dstOffset;
+        copyRegion.size = size;
+        vkCmdCopyBuffer(commandBuffer, srcBuffer.bufferHandle, dstBuffer.bufferHandle, 1, &copyRegion);
+    }
+
+    return *this;
+}
+
+ResourceManager &ResourceManager::updateUniformBuffer(VkCommandBuffer &commandBuffer,
+                                                      BufferHardwareWrap &buffer,
+                                                      const void *data,
+                                                      uint64_t size,
+                                                      VkPipelineStageFlags2 dstStageMask)
+{
+    // vkCmdUpdateBuffer 单次最多 65536 字节
+    constexpr uint64_t MAX_UPDATE_SIZE = 65536;
+
+    const uint64_t bufferSize = static_cast<uint64_t>(buffer.elementCount) * buffer.elementSize;
+    size = std::min(size, bufferSize) & ~uint64_t{3};
+    if (buffer.bufferHandle == VK_NULL_HANDLE || data == nullptr || size == 0)
+    {
+        return *this;
+    }
+
+    VkBufferMemoryBarrier2 bufferBarrier{};
+    bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+    bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.buffer = buffer.bufferHandle;
+    bufferBarrier.offset = 0;
+    bufferBarrier.size = size;
+
+    VkDependencyInfo dependencyInfo{};
+    dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependencyInfo.bufferMemoryBarrierCount = 1;
+    dependencyInfo.pBufferMemoryBarriers = &bufferBarrier;
+
+    // 读后写：之前提交或录制的命令可能仍在读取旧内容
+    bufferBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    bufferBarrier.srcAccessMask = VK_ACCESS_2_NONE;
+    bufferBarrier.dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    for (uint64_t offset = 0; offset < size; offset += MAX_UPDATE_SIZE)
+    {
+        vkCmdUpdateBuffer(commandBuffer, buffer.bufferHandle, offset, std::min(MAX_UPDATE_SIZE, size - offset), bytes + offset);
+    }
+
+    bufferBarrier.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+    bufferBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    bufferBarrier.dstStageMask = dstStageMask;
+    bufferBarrier.dstAccessMask = VK_ACCESS_2_UNIFORM_READ_BIT;
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+    return *this;
+}
+
 ResourceManager &ResourceManager::copyImage(VkCommandBuffer &commandBuffer,
                                             ImageHardwareWrap &source,
                                             ImageHardwareWrap &destination,
@@ -1349,7 +1833,8 @@ ResourceManager &ResourceManager::copyBufferToImage(VkCommandBuffer &commandBuff
                                                     BufferHardwareWrap &buffer,
                                                     ImageHardwareWrap &image,
                                                     uint32_t mipLevel,
-                                                    uint32_t layerCount)
+                                                    uint32_t layerCount,
+                                                    uint64_t bufferOffset)
 {
     if (mipLevel >= image.mipLevels)
     {
@@ -1361,7 +1846,7 @@ ResourceManager &ResourceManager::copyBufferToImage(VkCommandBuffer &commandBuff
     uint32_t mipHeight = std::max(1u, image.imageSize.y >> mipLevel);
 
     VkBufferImageCopy region{};
-    region.bufferOffset = 0;
+    region.bufferOffset = bufferOffset;
     region.bufferRowLength = 0;
     region.bufferImageHeight = 0;
     region.imageSubresource.aspectMask = image.aspectMask;
@@ -1436,10 +1921,28 @@ void ResourceManager::copyBufferToHost(BufferHardwareWrap &buffer, void *cpuData
 {
     if (buffer.bufferAllocInfo.pMappedData != nullptr)
     {
+        // 带缓存但非 HOST_COHERENT 的内存需要先失效 CPU 缓存才能看到 GPU 的写入，一致内存上为空操作
+        if (buffer.bufferAlloc != VK_NULL_HANDLE)
+        {
+            vmaInvalidateAllocation(vmaAllocator, buffer.bufferAlloc, 0, VK_WHOLE_SIZE);
+        }
         std::memcpy(cpuData, buffer.bufferAllocInfo.pMappedData, size);
     }
 }
 
+void ResourceManager::copyHostToBuffer(BufferHardwareWrap &buffer, const void *cpuData, uint64_t offset, uint64_t size)
+{
+    if (buffer.bufferAllocInfo.pMappedData != nullptr)
+    {
+        std::memcpy(static_cast<uint8_t *>(buffer.bufferAllocInfo.pMappedData) + offset, cpuData, size);
+        // 一致内存上为空操作；VMA 会把区间扩展到 nonCoherentAtomSize 的整数倍
+        if (buffer.bufferAlloc != VK_NULL_HANDLE)
+        {
+            vmaFlushAllocation(vmaAllocator, buffer.bufferAlloc, offset, size);
+        }
+    }
+}
+
 // Todo: 有待优化
 void ResourceManager::transitionImageLayout(VkCommandBuffer &commandBuffer,
                                             ImageHardwareWrap &image,
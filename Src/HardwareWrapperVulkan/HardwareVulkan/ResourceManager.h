@@ -1,5 +1,10 @@
 ﻿#pragma once
 
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+
 #include <ktm/ktm.h>
 
 #include "DeviceManager.h"
@@ -7,6 +12,7 @@
 #include "corona/kernel/utils/storage.h"
 
 class HardwareExecutor;
+class StagingRingVulkan;
 
 struct ResourceManager
 {
@@ -31,13 +37,30 @@ struct ResourceManager
         VmaAllocation bufferAlloc{VK_NULL_HANDLE};
         VmaAllocationInfo bufferAllocInfo{};
         bool hostImportedManualBind{false};
+        bool exportable{false}; // 创建时带外部内存信息，exportBufferMemory 只接受此类缓冲
+        bool readbackViaTransfer{false}; // Auto 放置映射到了不带 CPU 缓存的（写合并）内存，CPU 读取极慢，回读经回读缓冲中转
 
         int32_t bindlessIndex{-1};
+        uint64_t metricsBytes{0}; // 计入 HardwareMetricsVulkan 的字节数
 
         DeviceManager *device{nullptr};
         ResourceManager *resourceManager{nullptr};
     };
 
+    // createImage 创建的 VkImage 及其内存由父图像与子图像共享，最后一个引用释放时连同视图交给墓地
+    struct OwnedImage
+    {
+        ResourceManager *resourceManager{nullptr};
+        VkImage imageHandle{VK_NULL_HANDLE};
+        VmaAllocation imageAlloc{VK_NULL_HANDLE};
+        VkDeviceSize allocSize{0};
+
+        std::mutex viewMutex;
+        std::vector<VkImageView> retiredViews; // 各持有者 destroyImage 时移交的视图
+
+        ~OwnedImage();
+    };
+
     struct ImageHardwareWrap
     {
         VkImageLayout imageLayout{VK_IMAGE_LAYOUT_UNDEFINED};
@@ -61,13 +84,26 @@ struct ResourceManager
 
         VmaAllocation imageAlloc{VK_NULL_HANDLE};
         VmaAllocationInfo imageAllocInfo{};
+        std::shared_ptr<OwnedImage> ownedImage; // 瞬态图像与交换链图像为空
 
         int32_t bindlessIndex{-1};
+        uint64_t metricsBytes{0}; // 计入 HardwareMetricsVulkan 的字节数
 
         DeviceManager *device{nullptr};
         ResourceManager *resourceManager{nullptr};
     };
 
+    // 管线对象及其附属的描述符对象，空句柄会被跳过
+    struct PipelineObjects
+    {
+        VkPipeline pipeline{VK_NULL_HANDLE};
+        VkPipelineLayout pipelineLayout{VK_NULL_HANDLE};
+        VkRenderPass renderPass{VK_NULL_HANDLE};
+        VkFramebuffer framebuffer{VK_NULL_HANDLE};
+        VkDescriptorPool descriptorPool{VK_NULL_HANDLE};
+        VkDescriptorSetLayout descriptorSetLayout{VK_NULL_HANDLE};
+    };
+
     struct BindlessDescriptorSet
     {
         VkDescriptorPool descriptorPool{VK_NULL_HANDLE};
@@ -92,13 +128,60 @@ struct ResourceManager
     [[nodiscard]] VkImageView createImageView(ImageHardwareWrap &image, uint32_t layer = -1, uint32_t mipLevel = -1);
     void destroyImage(ImageHardwareWrap &image);
 
+    // Aliasing operations：VkImage 与内存分开创建，多个生命周期不重叠的图像可以绑定到同一块内存
+    [[nodiscard]] ImageHardwareWrap createAliasableImage(ktm::uvec2 imageSize,
+                                                         VkFormat imageFormat,
+                                                         float pixelSize,
+                                                         VkImageUsageFlags imageUsage,
+                                                         uint32_t arrayLayers,
+                                                         uint32_t mipLevels,
+                                                         VkMemoryRequirements &memoryRequirements);
+    [[nodiscard]] VmaAllocation allocateAliasingMemory(const VkMemoryRequirements &memoryRequirements);
+    void bindAliasingImage(ImageHardwareWrap &image, VmaAllocation allocation);
+    // 与 OwnedImage 一样交给墓地，已提交的 pass 仍可能使用这些图像与内存
+    void destroyAliasableImage(ImageHardwareWrap &image);
+    void freeAliasingMemory(VmaAllocation allocation);
+
+    // 缓冲的内存放置：
+    // HostVisible 持久映射，CPU 直接读写；DeviceLocal 放在显存，不映射，读写经暂存缓冲中转；
+    // Auto 优先显存，若该显存恰好可映射（ReBAR、集成显卡）则同时映射，否则与 DeviceLocal 相同。
+    // Auto 的映射只为顺序写入分配，不带 CPU 缓存时读取仍经回读缓冲（见 BufferHardwareWrap::readbackViaTransfer）
+    enum class BufferPlacement
+    {
+        HostVisible,
+        DeviceLocal,
+        Auto,
+    };
+
     // Buffer operations
     [[nodiscard]] BufferHardwareWrap createBuffer(uint32_t elementCount,
                                                   uint32_t elementSize,
                                                   VkBufferUsageFlags usage,
-                                                  bool hostVisibleMapped = true,
-                                                  bool useDedicated = false);
+                                                  BufferPlacement placement = BufferPlacement::HostVisible,
+                                                  bool useDedicated = false,
+                                                  bool exportable = false);
     void destroyBuffer(BufferHardwareWrap &buffer);
+    [[nodiscard]] bool isHostCached(const BufferHardwareWrap &buffer) const;
+
+    // 与缓冲、图像一样进入墓地，已提交的命令缓冲仍可能引用这些管线对象
+    void destroyPipelineObjects(const PipelineObjects &objects);
+
+    // 释放已进入墓地且各队列 timeline 均已达到销毁时快照值的资源，不等待 GPU。
+    // destroyBuffer/destroyImage 与执行器 commit 时顺带调用
+    void collectGraveyard();
+
+    // 持久映射、不可导出的传输缓冲：默认作为上传源供暂存环使用；
+    // readback 为 true 时改用 CPU 随机读取友好的（通常带缓存的）内存，作为回读目标
+    [[nodiscard]] BufferHardwareWrap createStagingBuffer(uint64_t size, bool readback = false);
+
+    // 每设备一个的上传暂存环，首次使用时创建
+    StagingRingVulkan &getStagingRing();
+
+    // 等待所有队列上已提交的工作完成（基于 timeline semaphore，超时回退到 vkDeviceWaitIdle）
+    void waitForInFlightWork();
+
+    // 各队列 timeline semaphore 当前已分配的最大值，只收集大于 0 的
+    void collectQueueTimelines(std::vector<VkSemaphore> &semaphores, std::vector<uint64_t> &values) const;
 
     // External memory operations
     [[nodiscard]] ExternalMemoryHandle exportBufferMemory(BufferHardwareWrap &sourceBuffer);
@@ -117,14 +200,22 @@ struct ResourceManager
 
     // Copy operations
     ResourceManager &copyBuffer(VkCommandBuffer &commandBuffer, BufferHardwareWrap &srcBuffer, BufferHardwareWrap &dstBuffer);
+    ResourceManager &copyBuffer(VkCommandBuffer &commandBuffer, BufferHardwareWrap &srcBuffer, BufferHardwareWrap &dstBuffer, uint64_t srcOffset, uint64_t dstOffset, uint64_t size);
+
+    // 把 UBO 内容以 vkCmdUpdateBuffer 录入命令缓冲（数据随命令缓冲保存，每次提交各有一份），
+    // 前后各加一个屏障：等待之前命令对该缓冲的读取，再让 dstStageMask 阶段的 uniform 读取看到新内容。
+    // 须在渲染通道外调用，size 须为 4 的倍数
+    ResourceManager &updateUniformBuffer(VkCommandBuffer &commandBuffer, BufferHardwareWrap &buffer, const void *data, uint64_t size, VkPipelineStageFlags2 dstStageMask);
     //ResourceManager &copyImage(VkCommandBuffer &commandBuffer, ImageHardwareWrap &source, ImageHardwareWrap &destination);
     ResourceManager &copyImage(VkCommandBuffer &commandBuffer, ImageHardwareWrap &source, ImageHardwareWrap &destination, uint32_t srcLayer = 0, uint32_t dstLayer = 0, uint32_t srcMip = 0, uint32_t dstMip = 0);
 
-    ResourceManager &copyBufferToImage(VkCommandBuffer &commandBuffer, BufferHardwareWrap &buffer, ImageHardwareWrap &image, uint32_t mipLevel = 0, uint32_t layerCount = 1);
+    ResourceManager &copyBufferToImage(VkCommandBuffer &commandBuffer, BufferHardwareWrap &buffer, ImageHardwareWrap &image, uint32_t mipLevel = 0, uint32_t layerCount = 1, uint64_t bufferOffset = 0);
     ResourceManager &copyImageToBuffer(VkCommandBuffer &commandBuffer, ImageHardwareWrap &image, BufferHardwareWrap &buffer);
     ResourceManager &blitImage(VkCommandBuffer &commandBuffer, ImageHardwareWrap &srcImage, ImageHardwareWrap &dstImage);
 
     void copyBufferToHost(BufferHardwareWrap &buffer, void *cpuData, uint64_t size);
+    // 写入持久映射缓冲的 [offset, offset + size) 并刷新该区间，非 HOST_COHERENT 内存上 GPU 才能看到写入
+    void copyHostToBuffer(BufferHardwareWrap &buffer, const void *cpuData, uint64_t offset, uint64_t size);
 
     // Layout transition
     void transitionImageLayout(VkCommandBuffer &commandBuffer,
@@ -160,6 +251,17 @@ struct ResourceManager
     void createBindlessDescriptorSet();
     void createExternalBufferMemoryPool();
     
+    bool prepareImageCreateInfo(ImageHardwareWrap &resultImage,
+                                ktm::uvec2 imageSize,
+                                VkFormat imageFormat,
+                                float pixelSize,
+                                VkImageUsageFlags imageUsage,
+                                uint32_t arrayLayers,
+                                uint32_t mipLevels,
+                                VkImageTiling tiling,
+                                VkImageCreateInfo &imageInfo,
+                                std::vector<uint32_t> &queueFamilyIndices);
+
     void createDedicatedBuffer(const VkBufferCreateInfo &bufferInfo, const VmaAllocationCreateInfo &allocInfo, BufferHardwareWrap &resultBuffer);
     void createPooledBuffer(const VkBufferCreateInfo &bufferInfo, const VmaAllocationCreateInfo &allocInfo, BufferHardwareWrap &resultBuffer);
     void createNonExportableBuffer(const VkBufferCreateInfo &bufferInfo, const VmaAllocationCreateInfo &allocInfo, BufferHardwareWrap &resultBuffer);
@@ -180,6 +282,43 @@ struct ResourceManager
 
     DeviceManager *device{nullptr};
 
+    std::mutex stagingRingMutex;
+    std::unique_ptr<StagingRingVulkan> stagingRing;
+
+    // ========== 延迟销毁墓地 ==========
+    // 条目记录销毁时刻各队列 timeline 的值；这些值单调递增，队头未达到时其后的条目也不会达到，按 FIFO 回收即可。
+    // 销毁时提交线程中还有未处理的批次（可能引用该资源，但还没有 timeline 值）则记下入队数，
+    // 等这些批次处理完再记录 timeline 值
+    struct GraveyardEntry
+    {
+        VkBuffer buffer{VK_NULL_HANDLE};
+        VmaAllocation bufferAlloc{VK_NULL_HANDLE};
+        bool hostImportedManualBind{false};
+
+        VkImage image{VK_NULL_HANDLE};
+        VmaAllocation imageAlloc{VK_NULL_HANDLE}; // 别名图像不拥有内存，为空
+        std::vector<VkImageView> imageViews;
+
+        VmaAllocation aliasingMemory{VK_NULL_HANDLE}; // 别名图像共享的内存块
+
+        PipelineObjects pipelineObjects;
+
+        std::vector<VkSemaphore> semaphores;
+        std::vector<uint64_t> timelineValues;
+        uint64_t pendingSubmitCount{0}; // 非 0 时 timelineValues 尚未记录
+    };
+
+    void buryInGraveyard(GraveyardEntry &&entry);
+    // 提交线程中尚未分配 timeline 值的批次：有则返回当前入队数，否则返回 0
+    uint64_t pendingSubmitCount() const;
+    bool isSubmitCountProcessed(uint64_t submitCount) const;
+    void releaseGraveyardEntry(GraveyardEntry &entry);
+    void flushGraveyard(); // 只在设备空闲后调用
+
+    std::mutex graveyardMutex;
+    std::deque<GraveyardEntry> graveyard;
+    std::atomic_size_t graveyardSize{0};
+
     // 缓存的物理设备属性，避免重复查询
     VkPhysicalDeviceProperties cachedDeviceProperties{};
     VkPhysicalDeviceDescriptorIndexingProperties cachedIndexingProperties{};
@@ -0,0 +1,205 @@
+﻿#include "StagingRingVulkan.h"
+
+#include <algorithm>
+
+#include "HardwareMetricsVulkan.h"
+#include "corona/kernel/core/i_logger.h"
+
+StagingRingVulkan::Allocation::~Allocation()
+{
+    if (state != nullptr)
+    {
+        state->release(sequence);
+    }
+}
+
+void StagingRingVulkan::Allocation::write(const void *data, uint64_t dataSize)
+{
+    state->resourceManager.copyHostToBuffer(*buffer, data, offset, std::min(dataSize, size));
+}
+
+StagingRingVulkan::StagingRingVulkan(ResourceManager &resourceManager, uint64_t capacity)
+    : state(std::make_shared<RingState>(resourceManager))
+{
+    state->ringBuffer = resourceManager.createStagingBuffer(capacity);
+    if (state->ringBuffer.bufferHandle == VK_NULL_HANDLE || state->ringBuffer.bufferAllocInfo.pMappedData == nullptr)
+    {
+        CFW_LOG_WARNING("[StagingRing] Failed to create {} bytes of mapped staging memory, uploads fall back to dedicated buffers",
+                        capacity);
+        return;
+    }
+    this->capacity = capacity;
+}
+
+StagingRingVulkan::~StagingRingVulkan()
+{
+    // 只在设备清理（vkDeviceWaitIdle 之后）销毁：GPU 不再读取环缓冲，仍存活的分配析构时只归还到共享状态
+    std::lock_guard<std::mutex> lock(allocateMutex);
+    retiredStates.push_back(std::move(state));
+    for (const std::shared_ptr<RingState> &ringState : retiredStates)
+    {
+        std::lock_guard<std::mutex> ringLock(ringState->ringMutex);
+        if (!ringState->liveBlocks.empty())
+        {
+            CFW_LOG_WARNING("[StagingRing] Destroyed with {} allocations still alive", ringState->liveBlocks.size());
+        }
+        ringState->resourceManager.destroyBuffer(ringState->ringBuffer);
+    }
+    retiredStates.clear();
+}
+
+std::shared_ptr<StagingRingVulkan::Allocation> StagingRingVulkan::allocate(uint64_t size, uint64_t alignment)
+{
+    if (size == 0 || size > MAX_ALLOCATION_SIZE)
+    {
+        return nullptr;
+    }
+    if (alignment == 0)
+    {
+        alignment = 1;
+    }
+
+    std::lock_guard<std::mutex> lock(allocateMutex);
+    destroyDrainedRetiredStates();
+
+    if (size <= capacity / 2)
+    {
+        if (auto allocation = allocateFromRing(size, alignment))
+        {
+            return allocation;
+        }
+    }
+
+    // 放不下时换用更大的环，而不是让调用方为每次上传新建暂存缓冲
+    if (!grow(size))
+    {
+        return nullptr;
+    }
+    return allocateFromRing(size, alignment);
+}
+
+std::shared_ptr<StagingRingVulkan::Allocation> StagingRingVulkan::allocateFromRing(uint64_t size, uint64_t alignment)
+{
+    std::lock_guard<std::mutex> lock(state->ringMutex);
+    std::deque<Block> &liveBlocks = state->liveBlocks;
+
+    uint64_t offset = 0;
+    if (!liveBlocks.empty())
+    {
+        const uint64_t tail = liveBlocks.front().offset;
+        const uint64_t alignedHead = (liveBlocks.back().end + alignment - 1) / alignment * alignment;
+
+        if (liveBlocks.back().offset >= tail)
+        {
+            // 未回绕：空闲区间为 [head, capacity) 与 [0, tail)
+            if (alignedHead + size <= capacity)
+            {
+                offset = alignedHead;
+            }
+            else if (size <= tail)
+            {
+                offset = 0;
+            }
+            else
+            {
+                return nullptr;
+            }
+        }
+        else
+        {
+            // 已回绕：空闲区间只剩 [head, tail)
+            if (alignedHead + size > tail)
+            {
+                return nullptr;
+            }
+            offset = alignedHead;
+        }
+    }
+
+    auto allocation = std::make_shared<Allocation>();
+    allocation->state = state;
+    allocation->buffer = &state->ringBuffer;
+    allocation->offset = offset;
+    allocation->size = size;
+    allocation->mappedData = static_cast<uint8_t *>(state->ringBuffer.bufferAllocInfo.pMappedData) + offset;
+    allocation->sequence = state->frontSequence + liveBlocks.size();
+
+    liveBlocks.push_back({offset, offset + size, false});
+    state->bytesInUse += size;
+
+    HardwareMetricsVulkan::get().recordStagingRing(size);
+    return allocation;
+}
+
+bool StagingRingVulkan::grow(uint64_t size)
+{
+    uint64_t newCapacity = std::max(capacity * 2, DEFAULT_CAPACITY);
+    while (newCapacity < size * 2)
+    {
+        newCapacity *= 2;
+    }
+    newCapacity = std::min(newCapacity, MAX_CAPACITY);
+    if (newCapacity <= capacity)
+    {
+        // 已达上限且没有空闲区间
+        return false;
+    }
+
+    auto newState = std::make_shared<RingState>(state->resourceManager);
+    newState->ringBuffer = state->resourceManager.createStagingBuffer(newCapacity);
+    if (newState->ringBuffer.bufferHandle == VK_NULL_HANDLE || newState->ringBuffer.bufferAllocInfo.pMappedData == nullptr)
+    {
+        CFW_LOG_WARNING("[StagingRing] Failed to grow to {} bytes of mapped staging memory", newCapacity);
+        state->resourceManager.destroyBuffer(newState->ringBuffer);
+        return false;
+    }
+
+    // 旧环上已提交的拷贝仍在读取它，等分配全部归还后再销毁
+    retiredStates.push_back(std::move(state));
+    state = std::move(newState);
+    capacity = newCapacity;
+    return true;
+}
+
+void StagingRingVulkan::destroyDrainedRetiredStates()
+{
+    retiredStates.erase(std::remove_if(retiredStates.begin(), retiredStates.end(), [](const std::shared_ptr<RingState> &ringState) {
+                            std::lock_guard<std::mutex> lock(ringState->ringMutex);
+                            if (!ringState->liveBlocks.empty())
+                            {
+                                return false;
+                            }
+                            // 分配都已归还（拷贝已完成），照常交给墓地销毁
+                            ringState->resourceManager.destroyBuffer(ringState->ringBuffer);
+                            return true;
+                        }),
+                        retiredStates.end());
+}
+
+uint64_t StagingRingVulkan::getBytesInUse() const
+{
+    std::lock_guard<std::mutex> lock(allocateMutex);
+    uint64_t bytesInUse = 0;
+    for (const std::shared_ptr<RingState> &ringState : retiredStates)
+    {
+        std::lock_guard<std::mutex> ringLock(ringState->ringMutex);
+        bytesInUse += ringState->bytesInUse;
+    }
+    std::lock_guard<std::mutex> ringLock(state->ringMutex);
+    return bytesInUse + state->bytesInUse;
+}
+
+void StagingRingVulkan::RingState::release(uint64_t sequence)
+{
+    std::lock_guard<std::mutex> lock(ringMutex);
+
+    Block &block = liveBlocks[sequence - frontSequence];
+    block.released = true;
+    bytesInUse -= block.end - block.offset;
+
+    while (!liveBlocks.empty() && liveBlocks.front().released)
+    {
+        liveBlocks.pop_front();
+        ++frontSequence;
+    }
+}
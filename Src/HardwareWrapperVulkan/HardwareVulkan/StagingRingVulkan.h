@@ -0,0 +1,101 @@
+﻿#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "HardwareExecutorVulkan.h"
+
+// ========== 每设备一个的持久映射暂存环 ==========
+// 一块常驻映射、不可导出的主机可见缓冲按分配顺序循环切分给上传路径，替代每次上传新建、销毁一个专用暂存缓冲。
+// 分配以 CopyCommandImpl 的形式交给执行器持有，随延迟释放在提交的 timeline 值达到后析构、归还区间；
+// 不同队列上的归还可能乱序，环只在队头连续归还后才推进回收位置。
+// 环满或请求超过容量一半时按两倍扩容（不超过 MAX_CAPACITY）：新建更大的环缓冲接替，旧环上的分配全部归还后销毁；
+// 请求超过 MAX_ALLOCATION_SIZE 或扩容失败时返回空，由调用方分块或退回独立暂存缓冲。
+// 环的簿记放在分配共同持有的状态里：环先于分配销毁（设备清理时执行器或未提交的命令仍持有分配）时，归还只修改该状态
+class StagingRingVulkan
+{
+    struct RingState;
+
+  public:
+    static constexpr uint64_t DEFAULT_CAPACITY = 64ull << 20;
+    static constexpr uint64_t MAX_CAPACITY = 512ull << 20;
+    static constexpr uint64_t MAX_ALLOCATION_SIZE = MAX_CAPACITY / 2;
+
+    struct Allocation : public CopyCommandImpl
+    {
+        ResourceManager::BufferHardwareWrap *buffer{nullptr}; // 环缓冲本身，拷贝命令按 offset 读取
+        uint64_t offset{0};
+        uint64_t size{0};
+        void *mappedData{nullptr}; // 指向本次分配的起始字节
+        uint64_t sequence{0};
+
+        ~Allocation() override;
+
+        // 写入本次分配并刷新对应区间：环所在的内存不保证 HOST_COHERENT，直接写 mappedData 后 GPU 未必可见
+        void write(const void *data, uint64_t dataSize);
+
+        CommandRecordVulkan *getCommandRecord() override
+        {
+            return nullptr;
+        }
+
+      private:
+        friend class StagingRingVulkan;
+        std::shared_ptr<RingState> state;
+    };
+
+    explicit StagingRingVulkan(ResourceManager &resourceManager, uint64_t capacity = DEFAULT_CAPACITY);
+    ~StagingRingVulkan();
+
+    StagingRingVulkan(const StagingRingVulkan &) = delete;
+    StagingRingVulkan &operator=(const StagingRingVulkan &) = delete;
+
+    // alignment 不要求是 2 的幂（例如 12 字节的 RGB 纹素）；放不下时先扩容，size 超过 MAX_ALLOCATION_SIZE 或扩容失败时返回空
+    [[nodiscard]] std::shared_ptr<Allocation> allocate(uint64_t size, uint64_t alignment);
+
+    [[nodiscard]] uint64_t getCapacity() const
+    {
+        std::lock_guard<std::mutex> lock(allocateMutex);
+        return capacity;
+    }
+
+    [[nodiscard]] uint64_t getBytesInUse() const;
+
+  private:
+    struct Block
+    {
+        uint64_t offset{0};
+        uint64_t end{0};
+        bool released{false};
+    };
+
+    struct RingState
+    {
+        explicit RingState(ResourceManager &resourceManager)
+            : resourceManager(resourceManager)
+        {
+        }
+
+        void release(uint64_t sequence);
+
+        ResourceManager &resourceManager;
+        ResourceManager::BufferHardwareWrap ringBuffer{};
+
+        mutable std::mutex ringMutex;
+        std::deque<Block> liveBlocks; // 按分配顺序排列，队头最旧
+        uint64_t frontSequence{0};    // liveBlocks 队头的分配序号
+        uint64_t bytesInUse{0};
+    };
+
+    // 在当前环上分配，调用方持有 allocateMutex
+    std::shared_ptr<Allocation> allocateFromRing(uint64_t size, uint64_t alignment);
+    bool grow(uint64_t size);
+    void destroyDrainedRetiredStates();
+
+    mutable std::mutex allocateMutex; // 保护 state、capacity 与 retiredStates 的替换
+    std::shared_ptr<RingState> state;
+    uint64_t capacity{0};
+    std::vector<std::shared_ptr<RingState>> retiredStates; // 扩容后被替换、仍有分配未归还的旧环
+};
@@ -0,0 +1,279 @@
+﻿#include "SubmitThreadVulkan.h"
+
+#include "HardwareExecutorVulkan.h"
+#include "corona/kernel/core/i_logger.h"
+#include <algorithm>
+
+SubmitThreadVulkan::SubmitThreadVulkan(DeviceManager &deviceManager)
+    : deviceManager(deviceManager)
+{
+    drainedBatches.reserve(64);
+    groupBatches.reserve(64);
+    submitInfos.reserve(64);
+
+    submitThread = std::thread(&SubmitThreadVulkan::threadLoop, this);
+}
+
+SubmitThreadVulkan::~SubmitThreadVulkan()
+{
+    running.store(false, std::memory_order_release);
+    wakeSequence.fetch_add(1, std::memory_order_release);
+    wakeSequence.notify_one();
+
+    if (submitThread.joinable())
+    {
+        submitThread.join();
+    }
+}
+
+void SubmitThreadVulkan::enqueue(SubmitBatchVulkan *batch)
+{
+    // 先计数再压入：处理数按整条链表累加，压入早于某批次的批次总在它所在的链表或更早的链表中处理，
+    // 所以处理数达到读到的入队数时，读取前已压入的批次都处理完了
+    enqueuedCount.fetch_add(1, std::memory_order_relaxed);
+
+    // Treiber 栈式压入：多生产者只需一次 CAS，不持有任何锁
+    SubmitBatchVulkan *head = batchHead.load(std::memory_order_relaxed);
+    do
+    {
+        batch->next = head;
+    } while (!batchHead.compare_exchange_weak(head, batch, std::memory_order_release, std::memory_order_relaxed));
+
+    wakeSequence.fetch_add(1, std::memory_order_release);
+    wakeSequence.notify_one();
+}
+
+void SubmitThreadVulkan::threadLoop()
+{
+    while (true)
+    {
+        const uint32_t observedSequence = wakeSequence.load(std::memory_order_acquire);
+
+        // 单消费者一次性摘下整条链表
+        SubmitBatchVulkan *batchList = batchHead.exchange(nullptr, std::memory_order_acquire);
+        if (batchList == nullptr)
+        {
+            if (!running.load(std::memory_order_acquire))
+            {
+                break;
+            }
+            wakeSequence.wait(observedSequence, std::memory_order_acquire);
+            continue;
+        }
+
+        // 栈是 LIFO，反转回入队顺序
+        drainedBatches.clear();
+        for (SubmitBatchVulkan *batch = batchList; batch != nullptr; batch = batch->next)
+        {
+            drainedBatches.push_back(batch);
+        }
+        std::reverse(drainedBatches.begin(), drainedBatches.end());
+
+        // 高优先级的批次先提交；稳定排序保持同一优先级（包括同一执行器的各段）的入队顺序
+        std::stable_sort(drainedBatches.begin(), drainedBatches.end(), [](const SubmitBatchVulkan *lhs, const SubmitBatchVulkan *rhs) {
+            return lhs->priority < rhs->priority;
+        });
+
+        submitBatches(drainedBatches);
+        processedCount.fetch_add(drainedBatches.size(), std::memory_order_release);
+    }
+}
+
+void SubmitThreadVulkan::submitBatches(std::vector<SubmitBatchVulkan *> &batches)
+{
+    // 目标队列列表与优先级相同的批次合并为一次 vkQueueSubmit2，组内保持入队顺序。
+    // 分段提交的后续段依赖前序段的依赖登记，合并时不越过它，保证它在入队顺序上的所有批次之后处理
+    for (size_t i = 0; i < batches.size(); ++i)
+    {
+        if (batches[i] == nullptr)
+        {
+            continue;
+        }
+
+        groupBatches.clear();
+        std::vector<DeviceManager::QueueUtils> *queues = batches[i]->queues;
+        const DeviceManager::QueuePriority priority = batches[i]->priority;
+        for (size_t j = i; j < batches.size(); ++j)
+        {
+            if (j != i && batches[j] != nullptr && batches[j]->previousSegment != nullptr)
+            {
+                break;
+            }
+            if (batches[j] == nullptr || batches[j]->queues != queues || batches[j]->priority != priority)
+            {
+                continue;
+            }
+
+            groupBatches.push_back(batches[j]);
+            batches[j] = nullptr;
+
+            // fence 只能挂在整次 vkQueueSubmit2 上，带 fence 的批次结束本组
+            if (groupBatches.back()->fence != VK_NULL_HANDLE)
+            {
+                break;
+            }
+        }
+
+        submitGroup(groupBatches);
+    }
+}
+
+void SubmitThreadVulkan::submitGroup(std::vector<SubmitBatchVulkan *> &group)
+{
+    auto publish = [&group](DeviceManager::QueueUtils *queue, SubmitBatchVulkan::State state) {
+        for (SubmitBatchVulkan *batch : group)
+        {
+            batch->submittedQueue = queue;
+            batch->state.store(state, std::memory_order_release);
+            batch->state.notify_all();
+        }
+    };
+
+    SubmitBatchVulkan &firstBatch = *group.front();
+    QueueLockWait lockWait;
+    DeviceManager::QueueUtils *queue = lockQueueOfFamily(*firstBatch.queueIndex,
+                                                         *firstBatch.queues,
+                                                         firstBatch.queues->front().queueFamilyIndex,
+                                                         firstBatch.priority,
+                                                         &lockWait);
+    if (queue == nullptr)
+    {
+        publish(nullptr, SubmitBatchVulkan::State::Failed);
+        return;
+    }
+
+    TimelineValueCache &timelineValueCache = deviceManager.getTimelineValueCache();
+
+    ResourceDependencyTracker &dependencyTracker = deviceManager.getDependencyTracker();
+
+    submitInfos.clear();
+    dependencyUndoLog.clear();
+    uint64_t reservedValues = 0;
+    bool semaphoreValid = true;
+
+    for (SubmitBatchVulkan *batch : group)
+    {
+        // timeline 值由提交线程在持有队列锁时分配，保证与同步提交路径的顺序一致
+        uint64_t waitValue = queue->timelineValue->fetch_add(1);
+        uint64_t signalValue = waitValue + 1;
+        ++reservedValues;
+
+        VkSemaphoreSubmitInfo timelineWaitSemaphoreSubmitInfo{};
+        timelineWaitSemaphoreSubmitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+        timelineWaitSemaphoreSubmitInfo.semaphore = queue->timelineSemaphore;
+        timelineWaitSemaphoreSubmitInfo.value = waitValue;
+        timelineWaitSemaphoreSubmitInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        batch->waitSemaphores.push_back(timelineWaitSemaphoreSubmitInfo);
+
+        VkSemaphoreSubmitInfo timelineSignalSemaphoreSubmitInfo{};
+        timelineSignalSemaphoreSubmitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+        timelineSignalSemaphoreSubmitInfo.semaphore = queue->timelineSemaphore;
+        timelineSignalSemaphoreSubmitInfo.value = signalValue;
+        timelineSignalSemaphoreSubmitInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        batch->signalSemaphores.push_back(timelineSignalSemaphoreSubmitInfo);
+
+        // 前序段已在更早的组中处理完毕，此时可以读取它们的提交结果
+        if (batch->joinPreviousSegments || batch->waitPreviousSegment)
+        {
+            for (SubmitBatchVulkan *segment = batch->previousSegment; segment != nullptr; segment = segment->previousSegment)
+            {
+                if (segment->state.load(std::memory_order_acquire) != SubmitBatchVulkan::State::Submitted)
+                {
+                    continue;
+                }
+
+                VkSemaphoreSubmitInfo segmentWaitSemaphoreSubmitInfo{};
+                segmentWaitSemaphoreSubmitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+                segmentWaitSemaphoreSubmitInfo.semaphore = segment->submittedQueue->timelineSemaphore;
+                segmentWaitSemaphoreSubmitInfo.value = segment->signalValue;
+                segmentWaitSemaphoreSubmitInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+                batch->waitSemaphores.push_back(segmentWaitSemaphoreSubmitInfo);
+
+                // 只串行到最近一个成功提交的段，它已传递地等待了更早的段
+                if (!batch->joinPreviousSegments)
+                {
+                    break;
+                }
+            }
+        }
+
+        // 组内先前批次写入的资源会登记在同一 semaphore 上，已由 timeline 自等待保证顺序
+        dependencyTracker.trackSubmission(batch->resourceAccesses,
+                                          queue->timelineSemaphore,
+                                          signalValue,
+                                          batch->waitSemaphores,
+                                          dependencyUndoLog);
+        batch->resourceAccesses.clear();
+
+        if (!prepareSubmitSemaphores(timelineValueCache,
+                                     batch->waitSemaphores,
+                                     batch->signalSemaphores,
+                                     batch->mergedWaitSemaphores,
+                                     batch->mergedSignalSemaphores))
+        {
+            semaphoreValid = false;
+            break;
+        }
+
+        batch->signalValue = signalValue;
+
+        batch->commandBufferInfo = {};
+        batch->commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+        batch->commandBufferInfo.commandBuffer = batch->commandBuffer;
+
+        VkSubmitInfo2 submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+        submitInfo.waitSemaphoreInfoCount = static_cast<uint32_t>(batch->mergedWaitSemaphores.size());
+        submitInfo.pWaitSemaphoreInfos = batch->mergedWaitSemaphores.data();
+        submitInfo.signalSemaphoreInfoCount = static_cast<uint32_t>(batch->mergedSignalSemaphores.size());
+        submitInfo.pSignalSemaphoreInfos = batch->mergedSignalSemaphores.data();
+        submitInfo.commandBufferInfoCount = batch->commandBuffer != VK_NULL_HANDLE ? 1 : 0;
+        submitInfo.pCommandBufferInfos = &batch->commandBufferInfo;
+        submitInfos.push_back(submitInfo);
+    }
+
+    VkResult result = VK_SUCCESS;
+    uint64_t submitNs = 0;
+    if (semaphoreValid)
+    {
+        const uint64_t submitBeginNs = CommitLatencyStatsVulkan::nowNs();
+        result = vkQueueSubmit2(queue->vkQueue,
+                                static_cast<uint32_t>(submitInfos.size()),
+                                submitInfos.data(),
+                                group.back()->fence);
+        submitNs = CommitLatencyStatsVulkan::nowNs() - submitBeginNs;
+    }
+
+    // 计时在 publish 之前回填，执行器看到 Submitted 后即可读取
+    for (SubmitBatchVulkan *batch : group)
+    {
+        batch->queueLockWait = lockWait;
+        batch->queueSubmitNs = submitNs;
+    }
+
+    if (!semaphoreValid || result != VK_SUCCESS)
+    {
+        if (!semaphoreValid)
+        {
+            CFW_LOG_ERROR("[SubmitThreadVulkan] Aborting {} batches due to invalid semaphore state", group.size());
+        }
+        else
+        {
+            CFW_LOG_ERROR("[SubmitThreadVulkan] Failed to submit {} batches! VkResult: {}",
+                          group.size(), coronaHardwareResultStr(result));
+        }
+
+        // 回滚本组分配的 timeline 值（分配与回滚都在队列锁内，不会与其他提交交错）
+        queue->timelineValue->fetch_sub(reservedValues);
+        dependencyTracker.rollback(dependencyUndoLog);
+        queue->queueMutex->unlock();
+
+        publish(nullptr, SubmitBatchVulkan::State::Failed);
+        return;
+    }
+
+    dependencyUndoLog.clear();
+    queue->queueMutex->unlock();
+
+    publish(queue, SubmitBatchVulkan::State::Submitted);
+}
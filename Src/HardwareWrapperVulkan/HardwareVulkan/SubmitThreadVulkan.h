@@ -0,0 +1,100 @@
+﻿#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "CommitLatencyStatsVulkan.h"
+#include "DeviceManager.h"
+
+// ========== 提交批次 ==========
+// 由执行器持有并复用，入队后归提交线程所有，直到 state 离开 Pending
+struct SubmitBatchVulkan
+{
+    enum class State : uint32_t
+    {
+        Idle,
+        Pending,
+        Submitted,
+        Failed
+    };
+
+    SubmitBatchVulkan *next{nullptr}; // MPSC 队列的侵入式链表指针
+
+    // ===== 生产者（执行器）填写 =====
+    std::atomic_uint16_t *queueIndex{nullptr};
+    std::vector<DeviceManager::QueueUtils> *queues{nullptr};
+    DeviceManager::QueuePriority priority{DeviceManager::QueuePriority::Normal};
+    VkCommandBuffer commandBuffer{VK_NULL_HANDLE};
+    std::vector<VkSemaphoreSubmitInfo> waitSemaphores;
+    std::vector<VkSemaphoreSubmitInfo> signalSemaphores;
+    VkFence fence{VK_NULL_HANDLE};
+    std::vector<ResourceAccessVulkan> resourceAccesses; // 录制时收集的资源访问，用于推导跨提交依赖
+    SubmitBatchVulkan *previousSegment{nullptr};        // 同一次 commit 拆分出的前一段；非空时不得越过前一段提前提交
+    bool joinPreviousSegments{false};                   // 等待所有前序段完成后再执行（携带用户 signal/fence 的最后一段）
+    bool waitPreviousSegment{false};                    // 等待前一段完成后再执行（跟踪器无法证明两段无关时）
+
+    // ===== 提交线程回填 =====
+    std::vector<VkSemaphoreSubmitInfo> mergedWaitSemaphores;
+    std::vector<VkSemaphoreSubmitInfo> mergedSignalSemaphores;
+    VkCommandBufferSubmitInfo commandBufferInfo{};
+    DeviceManager::QueueUtils *submittedQueue{nullptr};
+    uint64_t signalValue{0};
+    QueueLockWait queueLockWait;  // 所在组获取队列锁的等待
+    uint64_t queueSubmitNs{0};    // 所在组 vkQueueSubmit2 的耗时
+    std::atomic<State> state{State::Idle};
+
+    // 阻塞直到提交线程处理完此批次，返回是否提交成功
+    bool waitUntilProcessed()
+    {
+        state.wait(State::Pending, std::memory_order_acquire);
+        return state.load(std::memory_order_acquire) == State::Submitted;
+    }
+};
+
+// ========== 每设备一个的提交线程 ==========
+// 应用线程只做无锁入队，提交线程按优先级统一分配 timeline 值、合并同一队列列表的批次为一次 vkQueueSubmit2
+class SubmitThreadVulkan
+{
+  public:
+    explicit SubmitThreadVulkan(DeviceManager &deviceManager);
+    ~SubmitThreadVulkan();
+
+    SubmitThreadVulkan(const SubmitThreadVulkan &) = delete;
+    SubmitThreadVulkan &operator=(const SubmitThreadVulkan &) = delete;
+
+    // 无锁多生产者入队
+    void enqueue(SubmitBatchVulkan *batch);
+
+    // 已入队与已处理的批次数。先读入队数再等处理数达到它：此前入队的批次都已分配 timeline 值（或已失败）
+    uint64_t getEnqueuedCount() const
+    {
+        return enqueuedCount.load(std::memory_order_acquire);
+    }
+    uint64_t getProcessedCount() const
+    {
+        return processedCount.load(std::memory_order_acquire);
+    }
+
+  private:
+    void threadLoop();
+    void submitBatches(std::vector<SubmitBatchVulkan *> &batches);
+    void submitGroup(std::vector<SubmitBatchVulkan *> &group);
+    DeviceManager::QueueUtils *lockQueue(SubmitBatchVulkan &batch);
+
+    DeviceManager &deviceManager;
+
+    std::atomic<SubmitBatchVulkan *> batchHead{nullptr};
+    std::atomic_uint32_t wakeSequence{0};
+    std::atomic_bool running{true};
+    std::atomic_uint64_t enqueuedCount{0};
+    std::atomic_uint64_t processedCount{0};
+
+    // 以下容器只由提交线程访问，跨批次复用容量
+    std::vector<SubmitBatchVulkan *> drainedBatches;
+    std::vector<SubmitBatchVulkan *> groupBatches;
+    std::vector<VkSubmitInfo2> submitInfos;
+    ResourceDependencyTracker::UndoLog dependencyUndoLog;
+
+    std::thread submitThread;
+};
@@ -0,0 +1,113 @@
+﻿#include "TimelineValueCache.h"
+
+#include <functional>
+
+const TimelineValueCache::Entry *TimelineValueCache::findEntry(VkSemaphore semaphore) const
+{
+    const size_t start = std::hash<VkSemaphore>{}(semaphore) % CAPACITY;
+    for (size_t i = 0; i < CAPACITY; ++i)
+    {
+        const Entry &entry = entries[(start + i) % CAPACITY];
+        const VkSemaphore key = entry.semaphore.load(std::memory_order_acquire);
+        if (key == semaphore)
+        {
+            return &entry;
+        }
+        if (key == VK_NULL_HANDLE)
+        {
+            return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+TimelineValueCache::Entry *TimelineValueCache::findEntry(VkSemaphore semaphore, bool insert)
+{
+    const size_t start = std::hash<VkSemaphore>{}(semaphore) % CAPACITY;
+    for (size_t i = 0; i < CAPACITY; ++i)
+    {
+        Entry &entry = entries[(start + i) % CAPACITY];
+        VkSemaphore key = entry.semaphore.load(std::memory_order_acquire);
+        if (key == semaphore)
+        {
+            return &entry;
+        }
+        if (key != VK_NULL_HANDLE)
+        {
+            continue;
+        }
+        if (!insert)
+        {
+            return nullptr;
+        }
+
+        // 槽位只会从空变为占用（clear 除外），CAS 失败说明被其他线程抢占，检查是否是同一个 semaphore
+        if (entry.semaphore.compare_exchange_strong(key, semaphore, std::memory_order_acq_rel) || key == semaphore)
+        {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+uint64_t TimelineValueCache::cachedValue(VkSemaphore semaphore) const
+{
+    const Entry *entry = findEntry(semaphore);
+    return entry != nullptr ? entry->value.load(std::memory_order_acquire) : 0;
+}
+
+void TimelineValueCache::observe(VkSemaphore semaphore, uint64_t value)
+{
+    if (semaphore == VK_NULL_HANDLE || value == 0 || value == UINT64_MAX)
+    {
+        return;
+    }
+
+    Entry *entry = findEntry(semaphore, true);
+    if (entry == nullptr)
+    {
+        return;
+    }
+
+    // 单调取最大值：并发观察到的较旧值不会覆盖较新的值
+    uint64_t current = entry->value.load(std::memory_order_relaxed);
+    while (current < value && !entry->value.compare_exchange_weak(current, value, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+}
+
+bool TimelineValueCache::refresh(VkSemaphore semaphore, uint64_t &value)
+{
+    driverQueries.fetch_add(1, std::memory_order_relaxed);
+
+    value = 0;
+    if (vkGetSemaphoreCounterValue(device, semaphore, &value) != VK_SUCCESS)
+    {
+        value = 0;
+        return false;
+    }
+
+    observe(semaphore, value);
+    return true;
+}
+
+bool TimelineValueCache::isReached(VkSemaphore semaphore, uint64_t value)
+{
+    if (cachedValue(semaphore) >= value)
+    {
+        return true;
+    }
+
+    uint64_t counterValue = 0;
+    return refresh(semaphore, counterValue) && counterValue != UINT64_MAX && counterValue >= value;
+}
+
+void TimelineValueCache::clear()
+{
+    for (auto &entry : entries)
+    {
+        entry.value.store(0, std::memory_order_relaxed);
+        entry.semaphore.store(VK_NULL_HANDLE, std::memory_order_release);
+    }
+    driverQueries.store(0, std::memory_order_relaxed);
+}
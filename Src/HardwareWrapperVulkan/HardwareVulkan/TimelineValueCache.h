@@ -0,0 +1,61 @@
+﻿#pragma once
+
+#include <array>
+#include <atomic>
+
+#include "HardwareWrapperVulkan/HardwareUtilsVulkan.h"
+
+// ========== 每设备一个的 timeline semaphore 值缓存 ==========
+// timeline 值只增不减，最近一次观察到的值是真实值的下界：缓存值已达到目标时无需调用 vkGetSemaphoreCounterValue。
+// 固定容量的开放寻址表，查找与单调更新都是无锁的，不分配内存。
+// 只用于设备生命周期内存在的 timeline semaphore（各队列 timeline、跨设备导入的 semaphore），设备清理时 clear()
+class TimelineValueCache
+{
+  public:
+    TimelineValueCache() = default;
+    TimelineValueCache(const TimelineValueCache &) = delete;
+    TimelineValueCache &operator=(const TimelineValueCache &) = delete;
+
+    void setDevice(VkDevice logicalDevice)
+    {
+        device = logicalDevice;
+    }
+
+    // 已观察到的值，未缓存时返回 0
+    [[nodiscard]] uint64_t cachedValue(VkSemaphore semaphore) const;
+
+    // 查询驱动并单调更新缓存，返回查询是否成功；
+    // semaphore 损坏时 value 为 UINT64_MAX，此值不会写入缓存
+    bool refresh(VkSemaphore semaphore, uint64_t &value);
+
+    // 缓存值不足时才查询驱动
+    bool isReached(VkSemaphore semaphore, uint64_t value);
+
+    // 记录通过其他途径（例如 vkWaitSemaphores 成功返回）得知已达到的值
+    void observe(VkSemaphore semaphore, uint64_t value);
+
+    // 累计的驱动查询次数，用于评估缓存效果
+    [[nodiscard]] uint64_t getDriverQueryCount() const
+    {
+        return driverQueries.load(std::memory_order_relaxed);
+    }
+
+    void clear();
+
+  private:
+    struct Entry
+    {
+        std::atomic<VkSemaphore> semaphore{VK_NULL_HANDLE};
+        std::atomic_uint64_t value{0};
+    };
+
+    // insert 为 true 时找不到则占用一个空槽位；表满时返回 nullptr（退化为不缓存）
+    Entry *findEntry(VkSemaphore semaphore, bool insert);
+    const Entry *findEntry(VkSemaphore semaphore) const;
+
+    static constexpr size_t CAPACITY = 256;
+
+    VkDevice device{VK_NULL_HANDLE};
+    std::array<Entry, CAPACITY> entries;
+    std::atomic_uint64_t driverQueries{0};
+};
@@ -1,8 +1,11 @@
 ﻿#include "ComputePipeline.h"
 
 #include "HardwareWrapperVulkan/HardwareUtilsVulkan.h"
+#include "HardwareWrapperVulkan/HardwareVulkan/HardwareMetricsVulkan.h"
 #include "HardwareWrapperVulkan/ResourcePool.h"
 #include "Compiler/ShaderLanguageConverter.h"
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 
 namespace
@@ -62,6 +65,14 @@ bool is_image_resource_bind_type(BindType bindType)
            bindType == BindType::sampler ||
            bindType == BindType::storageTexture;
 }
+
+// 只读采样的图像可以与其他读取并行；storage image 及无法判断用途的句柄按写入处理
+bool is_writable_image_bind_type(BindType bindType)
+{
+    return bindType != BindType::sampledImages &&
+           bindType != BindType::texture &&
+           bindType != BindType::sampler;
+}
 } // namespace
 
 ComputePipelineVulkan::ComputePipelineVulkan()
@@ -74,6 +85,8 @@ ComputePipelineVulkan::ComputePipelineVulkan(std::string shaderCode,
                                              const std::source_location &sourceLocation)
     : ComputePipelineVulkan()
 {
+    debugName = GpuProfilerVulkan::makeDebugName("ComputePipeline", sourceLocation);
+
     EmbeddedShader::ShaderCodeCompiler compiler(shaderCode,
                                                 EmbeddedShader::ShaderStage::ComputeShader,
                                                 language,
@@ -93,7 +106,7 @@ ComputePipelineVulkan::ComputePipelineVulkan(std::string shaderCode,
     if (uboSize > 0)
     {
         tempUBO = HardwarePushConstant(uboSize, 0);
-        uboBuffer = HardwareBuffer(uboSize, BufferUsage::UniformBuffer);
+        uboBuffer = HardwareBuffer(uboSize, BufferUsage::UniformBuffer, nullptr, false, false, BufferMemory::DeviceLocal);
     }
 }
 
@@ -101,6 +114,8 @@ ComputePipelineVulkan::ComputePipelineVulkan(const EmbeddedShader::ShaderCodeCom
                                              const std::source_location &sourceLocation)
     : ComputePipelineVulkan()
 {
+    debugName = GpuProfilerVulkan::makeDebugName("ComputePipeline", sourceLocation);
+
     this->shaderCode = compiler.getShaderCode(EmbeddedShader::ShaderLanguage::SpirV, true);
 
     const uint32_t pushConstantSize = this->shaderCode.shaderResources.pushConstantSize;
@@ -114,7 +129,7 @@ ComputePipelineVulkan::ComputePipelineVulkan(const EmbeddedShader::ShaderCodeCom
     if (uboSize > 0)
     {
         tempUBO = HardwarePushConstant(uboSize, 0);
-        uboBuffer = HardwareBuffer(uboSize, BufferUsage::UniformBuffer);
+        uboBuffer = HardwareBuffer(uboSize, BufferUsage::UniformBuffer, nullptr, false, false, BufferMemory::DeviceLocal);
     }
 }
 
@@ -122,6 +137,8 @@ ComputePipelineVulkan::ComputePipelineVulkan(const std::vector<uint32_t> &spirV,
                                              const std::source_location &sourceLocation)
     : ComputePipelineVulkan()
 {
+    debugName = GpuProfilerVulkan::makeDebugName("ComputePipeline", sourceLocation);
+
     // 直接使用预编译 SPIR-V + spirv-cross 反射（跳过 GLSL→SPIR-V 编译）
     auto resources = EmbeddedShader::ShaderLanguageConverter::spirvCrossReflectedBindInfo(spirV, EmbeddedShader::ShaderLanguage::HLSL);
 
@@ -137,46 +154,34 @@ ComputePipelineVulkan::ComputePipelineVulkan(const std::vector<uint32_t> &spirV,
     if (uboSize > 0)
     {
         tempUBO = HardwarePushConstant(uboSize, 0);
-        uboBuffer = HardwareBuffer(uboSize, BufferUsage::UniformBuffer);
+        uboBuffer = HardwareBuffer(uboSize, BufferUsage::UniformBuffer, nullptr, false, false, BufferMemory::DeviceLocal);
     }
 }
 
 ComputePipelineVulkan::~ComputePipelineVulkan()
 {
-    VkDevice device = VK_NULL_HANDLE;
-    if (const auto mainDevice = globalHardwareContext.getMainDevice())
+    const auto mainDevice = globalHardwareContext.getMainDevice();
+    if (!mainDevice || mainDevice->deviceManager.getLogicalDevice() == VK_NULL_HANDLE)
     {
-        device = mainDevice->deviceManager.getLogicalDevice();
+        return;
     }
 
-    if (device != VK_NULL_HANDLE)
-    {
-        vkDeviceWaitIdle(device);
+    // 不再 vkDeviceWaitIdle：已提交的命令可能仍在使用这些对象，交给墓地在 timeline 达到后销毁
+    ResourceManager::PipelineObjects objects;
+    objects.pipeline = pipeline;
+    objects.pipelineLayout = pipelineLayout;
+    objects.descriptorPool = uboDescriptorPool;
+    objects.descriptorSetLayout = uboDescriptorSetLayout;
+    mainDevice->resourceManager.destroyPipelineObjects(objects);
 
-        if (pipeline != VK_NULL_HANDLE)
-        {
-            vkDestroyPipeline(device, pipeline, nullptr);
-            pipeline = VK_NULL_HANDLE;
-        }
-
-        if (pipelineLayout != VK_NULL_HANDLE)
-        {
-            vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-            pipelineLayout = VK_NULL_HANDLE;
-        }
-
-        // 清理 per-pipeline UBO 描述符资源
-        if (uboDescriptorPool != VK_NULL_HANDLE)
-        {
-            vkDestroyDescriptorPool(device, uboDescriptorPool, nullptr);
-            uboDescriptorPool = VK_NULL_HANDLE;
-        }
-        if (uboDescriptorSetLayout != VK_NULL_HANDLE)
-        {
-            vkDestroyDescriptorSetLayout(device, uboDescriptorSetLayout, nullptr);
-            uboDescriptorSetLayout = VK_NULL_HANDLE;
-        }
+    if (pipeline != VK_NULL_HANDLE)
+    {
+        HardwareMetricsVulkan::get().releasePipeline(false);
     }
+    pipeline = VK_NULL_HANDLE;
+    pipelineLayout = VK_NULL_HANDLE;
+    uboDescriptorPool = VK_NULL_HANDLE;
+    uboDescriptorSetLayout = VK_NULL_HANDLE;
 }
 
 void ComputePipelineVulkan::setPushConstantDirect(uint64_t byteOffset, const void *data, size_t size, int32_t bindType)
@@ -204,13 +209,17 @@ void ComputePipelineVulkan::setResourceDirect(uint64_t byteOffset, uint32_t type
 
     if (typedBindType == BindType::pushConstantMembers)
     {
-        write_descriptor_handle(pushConstant, byteOffset, typeSize, descriptorIndex);
+        if (write_descriptor_handle(pushConstant, byteOffset, typeSize, descriptorIndex))
+        {
+            boundBuffers[{false, byteOffset}] = buffer;
+        }
         return;
     }
     if (typedBindType == BindType::uniformBufferMembers)
     {
         if (write_descriptor_handle(tempUBO, byteOffset, typeSize, descriptorIndex))
         {
+            boundBuffers[{true, byteOffset}] = buffer;
             uboDescriptorDirty = true;
         }
         return;
@@ -222,10 +231,12 @@ void ComputePipelineVulkan::setResourceDirect(uint64_t byteOffset, uint32_t type
 
     if (write_descriptor_handle(pushConstant, byteOffset, typeSize, descriptorIndex))
     {
+        boundBuffers[{false, byteOffset}] = buffer;
         return;
     }
     if (write_descriptor_handle(tempUBO, byteOffset, typeSize, descriptorIndex))
     {
+        boundBuffers[{true, byteOffset}] = buffer;
         uboDescriptorDirty = true;
     }
 }
@@ -234,16 +245,21 @@ void ComputePipelineVulkan::setResourceDirect(uint64_t byteOffset, uint32_t type
 {
     const auto typedBindType = static_cast<BindType>(bindType);
     const uint32_t descriptorIndex = const_cast<HardwareImage &>(image).storeDescriptor();
+    const BoundImage boundImage{image, is_writable_image_bind_type(typedBindType)};
 
     if (typedBindType == BindType::pushConstantMembers)
     {
-        write_descriptor_handle(pushConstant, byteOffset, typeSize, descriptorIndex);
+        if (write_descriptor_handle(pushConstant, byteOffset, typeSize, descriptorIndex))
+        {
+            boundImages[{false, byteOffset}] = boundImage;
+        }
         return;
     }
     if (typedBindType == BindType::uniformBufferMembers)
     {
         if (write_descriptor_handle(tempUBO, byteOffset, typeSize, descriptorIndex))
         {
+            boundImages[{true, byteOffset}] = boundImage;
             uboDescriptorDirty = true;
         }
         return;
@@ -255,10 +271,12 @@ void ComputePipelineVulkan::setResourceDirect(uint64_t byteOffset, uint32_t type
 
     if (write_descriptor_handle(pushConstant, byteOffset, typeSize, descriptorIndex))
     {
+        boundImages[{false, byteOffset}] = boundImage;
         return;
     }
     if (write_descriptor_handle(tempUBO, byteOffset, typeSize, descriptorIndex))
     {
+        boundImages[{true, byteOffset}] = boundImage;
         uboDescriptorDirty = true;
     }
 }
@@ -269,20 +287,142 @@ ComputePipelineVulkan *ComputePipelineVulkan::operator()(uint16_t x, uint16_t y,
     return this;
 }
 
-CommandRecordVulkan::RequiredBarriers ComputePipelineVulkan::getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor)
+void ComputePipelineVulkan::getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor, CommandRecordVulkan::RequiredBarriers &requiredBarriers)
 {
-    RequiredBarriers requiredBarriers;
-    requiredBarriers.memoryBarriers.resize(1);
-
-    auto &barrier = requiredBarriers.memoryBarriers[0];
-    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
-    barrier.pNext = nullptr;
-    barrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
-    barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
-    barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
-    barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
-
-    return requiredBarriers;
+    // 着色器可能经存放在其他缓冲中的 bindless 句柄访问未绑定的资源，默认保守地请求全局内存屏障
+    if (!preciseBarriers)
+    {
+        VkMemoryBarrier2 memoryBarrier{};
+        memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+        memoryBarrier.pNext = nullptr;
+        memoryBarrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+        memoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        memoryBarrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+        memoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        requiredBarriers.memoryBarriers.push_back(memoryBarrier);
+    }
+
+    // 按绑定的资源逐个声明访问，执行器的 CommandHazardTracker 据此省略读后读等不必要的屏障
+    VkBufferMemoryBarrier2 bufferBarrierTemplate{};
+    bufferBarrierTemplate.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+    bufferBarrierTemplate.pNext = nullptr;
+    bufferBarrierTemplate.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+    bufferBarrierTemplate.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    bufferBarrierTemplate.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    bufferBarrierTemplate.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    bufferBarrierTemplate.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrierTemplate.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrierTemplate.offset = 0;
+    bufferBarrierTemplate.size = VK_WHOLE_SIZE;
+
+    for (const auto &[slot, buffer] : boundBuffers)
+    {
+        if (!buffer)
+        {
+            continue;
+        }
+        VkBufferMemoryBarrier2 bufferBarrier = bufferBarrierTemplate;
+        {
+            auto const handle = globalBufferStorages.acquire_read(buffer.getBufferID());
+            bufferBarrier.buffer = handle->bufferHandle;
+        }
+        requiredBarriers.bufferBarriers.push_back(bufferBarrier);
+    }
+
+    for (const auto &[slot, boundImage] : boundImages)
+    {
+        if (!boundImage.image)
+        {
+            continue;
+        }
+        auto const handle = globalImageStorages.acquire_read(boundImage.image.getImageID());
+
+        const VkAccessFlags2 dstAccessMask = boundImage.write
+                                                 ? (VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT)
+                                                 : VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+
+        // 同一图像绑定到多个槽位时合并到已有的屏障，避免同一批屏障里出现两次布局转换
+        auto existing = std::find_if(requiredBarriers.imageBarriers.begin(), requiredBarriers.imageBarriers.end(),
+                                     [&handle](const VkImageMemoryBarrier2 &barrier) { return barrier.image == handle->imageHandle; });
+        if (existing != requiredBarriers.imageBarriers.end())
+        {
+            existing->dstAccessMask |= dstAccessMask;
+            continue;
+        }
+
+        // 布局保持不变，只表达内存依赖；内容未定义的图像（新建或瞬态别名）转换到 bindless 描述符使用的 GENERAL
+        // 这里只查询屏障，句柄上的布局在 commitCommand 中（屏障已录制之后）才更新
+        VkImageMemoryBarrier2 imageBarrier{};
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+        imageBarrier.pNext = nullptr;
+        imageBarrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+        imageBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        imageBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        imageBarrier.dstAccessMask = dstAccessMask;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image = handle->imageHandle;
+        imageBarrier.oldLayout = handle->imageLayout;
+        imageBarrier.newLayout = handle->imageLayout == VK_IMAGE_LAYOUT_UNDEFINED ? VK_IMAGE_LAYOUT_GENERAL : handle->imageLayout;
+        imageBarrier.subresourceRange.aspectMask = handle->aspectMask;
+        imageBarrier.subresourceRange.baseMipLevel = 0;
+        imageBarrier.subresourceRange.levelCount = std::max(1u, handle->mipLevels);
+        imageBarrier.subresourceRange.baseArrayLayer = 0;
+        imageBarrier.subresourceRange.layerCount = std::max(1u, handle->arrayLayers);
+        requiredBarriers.imageBarriers.push_back(imageBarrier);
+    }
+}
+
+void ComputePipelineVulkan::collectResourceAccesses(std::vector<ResourceAccessVulkan> &accesses)
+{
+    // storage/raw buffer 在着色器中可读可写，无法区分时保守地按写入处理
+    for (const auto &[slot, buffer] : boundBuffers)
+    {
+        if (!buffer)
+        {
+            continue;
+        }
+        auto const handle = globalBufferStorages.acquire_read(buffer.getBufferID());
+        accesses.push_back({handle->bufferHandle, VK_NULL_HANDLE, true});
+    }
+
+    for (const auto &[slot, boundImage] : boundImages)
+    {
+        if (!boundImage.image)
+        {
+            continue;
+        }
+        auto const handle = globalImageStorages.acquire_read(boundImage.image.getImageID());
+        accesses.push_back({VK_NULL_HANDLE, handle->imageHandle, boundImage.write});
+    }
+
+    // 每次提交都会在命令缓冲中改写 uboBuffer
+    if (uboSize > 0 && uboBuffer)
+    {
+        auto const handle = globalBufferStorages.acquire_read(uboBuffer.getBufferID());
+        accesses.push_back({handle->bufferHandle, VK_NULL_HANDLE, true});
+    }
+}
+
+void ComputePipelineVulkan::collectBindings(std::vector<VkBuffer> &buffers, std::vector<ResourceManager::ImageHardwareWrap *> &images)
+{
+    for (const auto &[slot, buffer] : boundBuffers)
+    {
+        if (buffer)
+        {
+            auto const handle = globalBufferStorages.acquire_read(buffer.getBufferID());
+            buffers.push_back(handle->bufferHandle);
+        }
+    }
+
+    for (const auto &[slot, boundImage] : boundImages)
+    {
+        if (boundImage.image)
+        {
+            auto handle = globalImageStorages.acquire_write(boundImage.image.getImageID());
+            images.push_back(&*handle);
+        }
+    }
 }
 
 void ComputePipelineVulkan::createComputePipeline()
@@ -345,7 +485,14 @@ void ComputePipelineVulkan::createComputePipeline()
     pipelineInfo.stage = shaderStageInfo;
     pipelineInfo.layout = pipelineLayout;
 
+    const auto compileStart = std::chrono::steady_clock::now();
     coronaHardwareCheck(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline));
+    if (pipeline != VK_NULL_HANDLE)
+    {
+        const uint64_t compileNs = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - compileStart).count());
+        HardwareMetricsVulkan::get().recordPipelineCompile(false, compileNs);
+    }
 
     // 清理着色器模块
     vkDestroyShaderModule(device, shaderModule, nullptr);
@@ -359,15 +506,35 @@ void ComputePipelineVulkan::commitCommand(HardwareExecutorVulkan &hardwareExecut
         createComputePipeline();
     }
 
-    const VkCommandBuffer commandBuffer = hardwareExecutor.currentRecordQueue->commandBuffer;
+    const VkCommandBuffer commandBuffer = hardwareExecutor.currentCommandBuffer;
+
+    // 执行器已录制 getRequiredBarriers 给出的屏障，与 transitionImageLayout 一样在此之后才更新句柄上的布局
+    for (const auto &[slot, boundImage] : boundImages)
+    {
+        if (boundImage.image)
+        {
+            auto handle = globalImageStorages.acquire_write(boundImage.image.getImageID());
+            if (handle->imageLayout == VK_IMAGE_LAYOUT_UNDEFINED)
+            {
+                handle->imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            }
+        }
+    }
 
     // 绑定管线
     vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
 
-    // 上传 UBO 数据并更新描述符
+    // UBO 内容录入命令缓冲：已提交但尚未执行完的命令仍可能在读取 uboBuffer，不能从 CPU 直接覆盖
     if (uboSize > 0 && tempUBO.getData())
     {
-        uboBuffer.copyFromData(tempUBO.getData(), uboSize);
+        {
+            auto uboHandle = globalBufferStorages.acquire_write(uboBuffer.getBufferID());
+            globalHardwareContext.getMainDevice()->resourceManager.updateUniformBuffer(hardwareExecutor.currentCommandBuffer,
+                                                                                      *uboHandle,
+                                                                                      tempUBO.getData(),
+                                                                                      uboSize,
+                                                                                      VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+        }
         if (uboDescriptorDirty)
         {
             updateUBODescriptor();
@@ -376,23 +543,22 @@ void ComputePipelineVulkan::commitCommand(HardwareExecutorVulkan &hardwareExecut
     }
 
     // 绑定描述符集
-    std::vector<VkDescriptorSet> descriptorSets;
-    descriptorSets.reserve(4);
+    boundDescriptorSets.clear();
     for (size_t i = 0; i < 3; ++i)
     {
-        descriptorSets.push_back(globalHardwareContext.getMainDevice()->resourceManager.bindlessDescriptors[i].descriptorSet);
+        boundDescriptorSets.push_back(globalHardwareContext.getMainDevice()->resourceManager.bindlessDescriptors[i].descriptorSet);
     }
     if (uboSize > 0)
     {
-        descriptorSets.push_back(uboDescriptorSet);
+        boundDescriptorSets.push_back(uboDescriptorSet);
     }
 
     vkCmdBindDescriptorSets(commandBuffer,
                             VK_PIPELINE_BIND_POINT_COMPUTE,
                             pipelineLayout,
                             0,
-                            static_cast<uint32_t>(descriptorSets.size()),
-                            descriptorSets.data(),
+                            static_cast<uint32_t>(boundDescriptorSets.size()),
+                            boundDescriptorSets.data(),
                             0,
                             nullptr);
 
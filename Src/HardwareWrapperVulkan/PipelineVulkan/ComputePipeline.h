@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <ktm/ktm.h>
+#include <map>
 
 #include "CabbageHardware.h"
 #include "Compiler/ShaderCodeCompiler.h"
@@ -31,13 +32,36 @@ struct ComputePipelineVulkan : public CommandRecordVulkan
 
     ComputePipelineVulkan *operator()(uint16_t x, uint16_t y, uint16_t z);
 
+    void setDebugName(std::string name)
+    {
+        debugName = std::move(name);
+    }
+
+    void setPreciseBarriers(bool enabled)
+    {
+        preciseBarriers = enabled;
+    }
+
     ExecutorType getExecutorType() override
     {
         return CommandRecordVulkan::ExecutorType::Compute;
     }
 
+    const char *getDebugName() const override
+    {
+        return debugName.c_str();
+    }
+
     void commitCommand(HardwareExecutorVulkan &hardwareExecutor) override;
-    RequiredBarriers getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor) override;
+    void getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor, RequiredBarriers &requiredBarriers) override;
+    void collectResourceAccesses(std::vector<ResourceAccessVulkan> &accesses) override;
+    void collectBindings(std::vector<VkBuffer> &buffers, std::vector<ResourceManager::ImageHardwareWrap *> &images) override;
+
+    // 启用精确屏障即表示管线只访问其绑定的资源
+    [[nodiscard]] bool declaresAllAccesses() const override
+    {
+        return preciseBarriers;
+    }
 
   private:
     void createComputePipeline();
@@ -60,4 +84,19 @@ struct ComputePipelineVulkan : public CommandRecordVulkan
     void updateUBODescriptor();
 
     ktm::uvec3 groupCount = {0, 0, 0};
+    std::vector<VkDescriptorSet> boundDescriptorSets; // 本次提交绑定的描述符集，跨提交复用容量
+
+    std::string debugName{"ComputePipeline"}; // 性能分析中的名称，默认取创建位置
+
+    // 为 false 时访问集合视为不完整（bindless 句柄可能藏在其他缓冲中），额外请求全局内存屏障
+    bool preciseBarriers{false};
+
+    // setResourceDirect 绑定的资源，按 (是否位于 UBO, 字节偏移) 记录，提交时据此上报依赖
+    struct BoundImage
+    {
+        HardwareImage image;
+        bool write{true};
+    };
+    std::map<std::pair<bool, uint64_t>, HardwareBuffer> boundBuffers;
+    std::map<std::pair<bool, uint64_t>, BoundImage> boundImages;
 };
\ No newline at end of file
@@ -1,9 +1,12 @@
 ﻿#include "RasterizerPipeline.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstring>
 
 #include "HardwareWrapperVulkan/HardwareUtilsVulkan.h"
+#include "HardwareWrapperVulkan/HardwareVulkan/HardwareMetricsVulkan.h"
 #include "HardwareWrapperVulkan/ResourcePool.h"
 #include "Compiler/ShaderLanguageConverter.h"
 
@@ -65,6 +68,14 @@ bool is_image_resource_bind_type(BindType bindType)
            bindType == BindType::storageTexture;
 }
 
+// 只读采样的图像可以与其他读取并行；storage image 及无法判断用途的句柄按写入处理
+bool is_writable_image_bind_type(BindType bindType)
+{
+    return bindType != BindType::sampledImages &&
+           bindType != BindType::texture &&
+           bindType != BindType::sampler;
+}
+
 bool bind_image_descriptor_slot(const HardwareImage &image, uint32_t descriptorSlot)
 {
     auto mainDevice = globalHardwareContext.getMainDevice();
@@ -160,6 +171,13 @@ VkFormat getVkFormatFromType(const std::string &typeName, uint32_t elementCount)
 RasterizerPipelineVulkan::RasterizerPipelineVulkan()
 {
     executorType = CommandRecordVulkan::ExecutorType::Graphics;
+
+    // 每个在飞行中的提交各占一个持有者，预先按命令缓冲环的深度创建，提交时不再分配
+    resourceHolders.reserve(DeviceManager::MAX_IN_FLIGHT_COMMAND_BUFFERS);
+    for (uint32_t i = 0; i < DeviceManager::MAX_IN_FLIGHT_COMMAND_BUFFERS; ++i)
+    {
+        resourceHolders.push_back(std::make_shared<ResourceHolderCommand>());
+    }
 }
 
 RasterizerPipelineVulkan::RasterizerPipelineVulkan(std::string vertexShaderCode,
@@ -170,6 +188,8 @@ RasterizerPipelineVulkan::RasterizerPipelineVulkan(std::string vertexShaderCode,
                                                    const std::source_location &sourceLocation)
     : RasterizerPipelineVulkan()
 {
+    debugName = GpuProfilerVulkan::makeDebugName("RasterizerPipeline", sourceLocation);
+
     // 编译着色器
     EmbeddedShader::ShaderCodeCompiler vertexCompiler(vertexShaderCode,
                                                       EmbeddedShader::ShaderStage::VertexShader,
@@ -225,7 +245,7 @@ RasterizerPipelineVulkan::RasterizerPipelineVulkan(std::string vertexShaderCode,
     if (uboSize > 0)
     {
         tempUBO = HardwarePushConstant(uboSize, 0);
-        uboBuffer = HardwareBuffer(uboSize, BufferUsage::UniformBuffer);
+        uboBuffer = HardwareBuffer(uboSize, BufferUsage::UniformBuffer, nullptr, false, false, BufferMemory::DeviceLocal);
     }
 }
 
@@ -235,6 +255,8 @@ RasterizerPipelineVulkan::RasterizerPipelineVulkan(const EmbeddedShader::ShaderC
                                                    const std::source_location &sourceLocation)
     : RasterizerPipelineVulkan()
 {
+    debugName = GpuProfilerVulkan::makeDebugName("RasterizerPipeline", sourceLocation);
+
     // 直接从已编译的 ShaderCodeCompiler 获取 SPIR-V 代码
     vertShaderCode = vertexCompiler.getShaderCode(EmbeddedShader::ShaderLanguage::SpirV, true);
     fragShaderCode = fragmentCompiler.getShaderCode(EmbeddedShader::ShaderLanguage::SpirV, true);
@@ -276,7 +298,7 @@ RasterizerPipelineVulkan::RasterizerPipelineVulkan(const EmbeddedShader::ShaderC
     if (uboSize > 0)
     {
         tempUBO = HardwarePushConstant(uboSize, 0);
-        uboBuffer = HardwareBuffer(uboSize, BufferUsage::UniformBuffer);
+        uboBuffer = HardwareBuffer(uboSize, BufferUsage::UniformBuffer, nullptr, false, false, BufferMemory::DeviceLocal);
     }
 }
 
@@ -286,6 +308,8 @@ RasterizerPipelineVulkan::RasterizerPipelineVulkan(const std::vector<uint32_t> &
                                                    const std::source_location &sourceLocation)
     : RasterizerPipelineVulkan()
 {
+    debugName = GpuProfilerVulkan::makeDebugName("RasterizerPipeline", sourceLocation);
+
     // 直接使用预编译 SPIR-V + spirv-cross 反射（跳过 glslang 编译）
     auto vertResources = EmbeddedShader::ShaderLanguageConverter::spirvCrossReflectedBindInfo(vertexSpirV, EmbeddedShader::ShaderLanguage::HLSL);
     auto fragResources = EmbeddedShader::ShaderLanguageConverter::spirvCrossReflectedBindInfo(fragmentSpirV, EmbeddedShader::ShaderLanguage::HLSL);
@@ -314,58 +338,38 @@ RasterizerPipelineVulkan::RasterizerPipelineVulkan(const std::vector<uint32_t> &
     if (uboSize > 0)
     {
         tempUBO = HardwarePushConstant(uboSize, 0);
-        uboBuffer = HardwareBuffer(uboSize, BufferUsage::UniformBuffer);
+        uboBuffer = HardwareBuffer(uboSize, BufferUsage::UniformBuffer, nullptr, false, false, BufferMemory::DeviceLocal);
     }
 }
 
 RasterizerPipelineVulkan::~RasterizerPipelineVulkan()
 {
-    VkDevice device = VK_NULL_HANDLE;
-    if (const auto mainDevice = globalHardwareContext.getMainDevice())
+    const auto mainDevice = globalHardwareContext.getMainDevice();
+    if (!mainDevice || mainDevice->deviceManager.getLogicalDevice() == VK_NULL_HANDLE)
     {
-        device = mainDevice->deviceManager.getLogicalDevice();
+        return;
     }
 
-    if (device != VK_NULL_HANDLE)
+    // 不再 vkDeviceWaitIdle：已提交的命令可能仍在使用这些对象，交给墓地在 timeline 达到后销毁
+    ResourceManager::PipelineObjects objects;
+    objects.pipeline = graphicsPipeline;
+    objects.pipelineLayout = pipelineLayout;
+    objects.renderPass = renderPass;
+    objects.framebuffer = frameBuffers;
+    objects.descriptorPool = uboDescriptorPool;
+    objects.descriptorSetLayout = uboDescriptorSetLayout;
+    mainDevice->resourceManager.destroyPipelineObjects(objects);
+
+    if (graphicsPipeline != VK_NULL_HANDLE)
     {
-        vkDeviceWaitIdle(device);
-
-        if (frameBuffers != VK_NULL_HANDLE)
-        {
-            vkDestroyFramebuffer(device, frameBuffers, nullptr);
-            frameBuffers = VK_NULL_HANDLE;
-        }
-
-        if (graphicsPipeline != VK_NULL_HANDLE)
-        {
-            vkDestroyPipeline(device, graphicsPipeline, nullptr);
-            graphicsPipeline = VK_NULL_HANDLE;
-        }
-
-        if (pipelineLayout != VK_NULL_HANDLE)
-        {
-            vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-            pipelineLayout = VK_NULL_HANDLE;
-        }
-
-        if (renderPass != VK_NULL_HANDLE)
-        {
-            vkDestroyRenderPass(device, renderPass, nullptr);
-            renderPass = VK_NULL_HANDLE;
-        }
-
-        // 清理 per-pipeline UBO 描述符资源
-        if (uboDescriptorPool != VK_NULL_HANDLE)
-        {
-            vkDestroyDescriptorPool(device, uboDescriptorPool, nullptr);
-            uboDescriptorPool = VK_NULL_HANDLE;
-        }
-        if (uboDescriptorSetLayout != VK_NULL_HANDLE)
-        {
-            vkDestroyDescriptorSetLayout(device, uboDescriptorSetLayout, nullptr);
-            uboDescriptorSetLayout = VK_NULL_HANDLE;
-        }
+        HardwareMetricsVulkan::get().releasePipeline(true);
     }
+    graphicsPipeline = VK_NULL_HANDLE;
+    pipelineLayout = VK_NULL_HANDLE;
+    renderPass = VK_NULL_HANDLE;
+    frameBuffers = VK_NULL_HANDLE;
+    uboDescriptorPool = VK_NULL_HANDLE;
+    uboDescriptorSetLayout = VK_NULL_HANDLE;
 }
 
 void RasterizerPipelineVulkan::createRenderPass(int multiviewCount)
@@ -659,12 +663,19 @@ void RasterizerPipelineVulkan::createGraphicsPipeline(EmbeddedShader::ShaderCode
     pipelineInfo.subpass = 0;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
+    const auto compileStart = std::chrono::steady_clock::now();
     coronaHardwareCheck(vkCreateGraphicsPipelines(device,
                                                   VK_NULL_HANDLE,
                                                   1,
                                                   &pipelineInfo,
                                                   nullptr,
                                                   &graphicsPipeline));
+    if (graphicsPipeline != VK_NULL_HANDLE)
+    {
+        const uint64_t compileNs = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - compileStart).count());
+        HardwareMetricsVulkan::get().recordPipelineCompile(true, compileNs);
+    }
 
     // 清理着色器模块
     vkDestroyShaderModule(device, fragShaderModule, nullptr);
@@ -734,13 +745,17 @@ void RasterizerPipelineVulkan::setResourceDirect(uint64_t byteOffset, uint32_t t
 
     if (typedBindType == BindType::pushConstantMembers)
     {
-        write_descriptor_handle(tempPushConstant, byteOffset, typeSize, descriptorIndex);
+        if (write_descriptor_handle(tempPushConstant, byteOffset, typeSize, descriptorIndex))
+        {
+            recordedBoundBuffers.push_back(buffer);
+        }
         return;
     }
     if (typedBindType == BindType::uniformBufferMembers)
     {
         if (write_descriptor_handle(tempUBO, byteOffset, typeSize, descriptorIndex))
         {
+            uboBoundBuffers[byteOffset] = buffer;
             uboDescriptorDirty = true;
         }
         return;
@@ -752,10 +767,12 @@ void RasterizerPipelineVulkan::setResourceDirect(uint64_t byteOffset, uint32_t t
 
     if (write_descriptor_handle(tempPushConstant, byteOffset, typeSize, descriptorIndex))
     {
+        recordedBoundBuffers.push_back(buffer);
         return;
     }
     if (write_descriptor_handle(tempUBO, byteOffset, typeSize, descriptorIndex))
     {
+        uboBoundBuffers[byteOffset] = buffer;
         uboDescriptorDirty = true;
     }
 }
@@ -773,16 +790,21 @@ void RasterizerPipelineVulkan::setResourceDirect(uint64_t byteOffset, uint32_t t
     }
 
     const uint32_t descriptorIndex = const_cast<HardwareImage &>(image).storeDescriptor();
+    const BoundImage boundImage{image, is_writable_image_bind_type(typedBindType)};
 
     if (typedBindType == BindType::pushConstantMembers)
     {
-        write_descriptor_handle(tempPushConstant, byteOffset, typeSize, descriptorIndex);
+        if (write_descriptor_handle(tempPushConstant, byteOffset, typeSize, descriptorIndex))
+        {
+            recordedBoundImages.push_back(boundImage);
+        }
         return;
     }
     if (typedBindType == BindType::uniformBufferMembers)
     {
         if (write_descriptor_handle(tempUBO, byteOffset, typeSize, descriptorIndex))
         {
+            uboBoundImages[byteOffset] = boundImage;
             uboDescriptorDirty = true;
         }
         return;
@@ -794,15 +816,20 @@ void RasterizerPipelineVulkan::setResourceDirect(uint64_t byteOffset, uint32_t t
 
     if (write_descriptor_handle(tempPushConstant, byteOffset, typeSize, descriptorIndex))
     {
+        recordedBoundImages.push_back(boundImage);
         return;
     }
     if (write_descriptor_handle(tempUBO, byteOffset, typeSize, descriptorIndex))
     {
+        uboBoundImages[byteOffset] = boundImage;
         uboDescriptorDirty = true;
         return;
     }
 
-    bind_image_descriptor_slot(image, location);
+    if (bind_image_descriptor_slot(image, location))
+    {
+        recordedBoundImages.push_back(boundImage);
+    }
 }
 
 RasterizerPipelineVulkan *RasterizerPipelineVulkan::operator()(uint16_t width, uint16_t height)
@@ -839,21 +866,23 @@ CommandRecordVulkan *RasterizerPipelineVulkan::record(const HardwareBuffer &inde
     return &dumpCommandRecordVulkan;
 }
 
-CommandRecordVulkan::RequiredBarriers RasterizerPipelineVulkan::getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor)
+void RasterizerPipelineVulkan::getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutor, CommandRecordVulkan::RequiredBarriers &requiredBarriers)
 {
-    RequiredBarriers requiredBarriers;
-
-    // 内存屏障
-    requiredBarriers.memoryBarriers.resize(1);
-    auto &memoryBarrier = requiredBarriers.memoryBarriers[0];
-    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
-    memoryBarrier.pNext = nullptr;
-    memoryBarrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
-    memoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
-    memoryBarrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
-    memoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT |
-                                 VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+    // 着色器可能经存放在其他缓冲中的 bindless 句柄访问未绑定的资源，默认保守地请求全局内存屏障
+    if (!preciseBarriers)
+    {
+        VkMemoryBarrier2 memoryBarrier{};
+        memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+        memoryBarrier.pNext = nullptr;
+        memoryBarrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+        memoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        memoryBarrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+        memoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT |
+                                     VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+        requiredBarriers.memoryBarriers.push_back(memoryBarrier);
+    }
 
+    // 附件、顶点/索引缓冲以及绑定的资源逐个声明访问，执行器的 CommandHazardTracker 据此省略不必要的屏障
     // 图像屏障
     VkImageMemoryBarrier2 imageBarrierTemplate{};
     imageBarrierTemplate.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
@@ -955,7 +984,72 @@ CommandRecordVulkan::RequiredBarriers RasterizerPipelineVulkan::getRequiredBarri
         }
     }
 
-    return requiredBarriers;
+    // 着色器通过 bindless 句柄访问的资源
+    constexpr VkPipelineStageFlags2 shaderStages = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT |
+                                                   VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+    auto appendBufferBarrier = [&](const HardwareBuffer &buffer) {
+        if (!buffer)
+        {
+            return;
+        }
+        VkBufferMemoryBarrier2 bufferBarrier = bufferBarrierTemplate;
+        {
+            auto const handle = globalBufferStorages.acquire_read(buffer.getBufferID());
+            bufferBarrier.buffer = handle->bufferHandle;
+        }
+        bufferBarrier.dstStageMask = shaderStages;
+        bufferBarrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+        requiredBarriers.bufferBarriers.push_back(bufferBarrier);
+    };
+    const size_t boundImageBarrierBegin = requiredBarriers.imageBarriers.size();
+    auto appendImageBarrier = [&](const BoundImage &boundImage) {
+        if (!boundImage.image)
+        {
+            return;
+        }
+        auto const handle = globalImageStorages.acquire_read(boundImage.image.getImageID());
+        const VkAccessFlags2 dstAccessMask = boundImage.write
+                                                 ? (VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT)
+                                                 : VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+
+        // 同一图像被多次绑定时合并到已有的屏障，避免同一批屏障里出现两次布局转换
+        auto existing = std::find_if(requiredBarriers.imageBarriers.begin() + boundImageBarrierBegin, requiredBarriers.imageBarriers.end(),
+                                     [&handle](const VkImageMemoryBarrier2 &barrier) { return barrier.image == handle->imageHandle; });
+        if (existing != requiredBarriers.imageBarriers.end())
+        {
+            existing->dstAccessMask |= dstAccessMask;
+            return;
+        }
+
+        // 内容未定义的图像转换到 bindless 描述符使用的 GENERAL；句柄上的布局在 commitCommand 中（屏障已录制之后）才更新
+        VkImageMemoryBarrier2 imageBarrier = imageBarrierTemplate;
+        imageBarrier.image = handle->imageHandle;
+        imageBarrier.oldLayout = handle->imageLayout;
+        imageBarrier.newLayout = handle->imageLayout == VK_IMAGE_LAYOUT_UNDEFINED ? VK_IMAGE_LAYOUT_GENERAL : handle->imageLayout;
+        imageBarrier.dstStageMask = shaderStages;
+        imageBarrier.dstAccessMask = dstAccessMask;
+        imageBarrier.subresourceRange.aspectMask = handle->aspectMask;
+        imageBarrier.subresourceRange.levelCount = std::max(1u, handle->mipLevels);
+        imageBarrier.subresourceRange.layerCount = std::max(1u, handle->arrayLayers);
+        requiredBarriers.imageBarriers.push_back(imageBarrier);
+    };
+
+    for (const auto &[byteOffset, buffer] : uboBoundBuffers)
+    {
+        appendBufferBarrier(buffer);
+    }
+    for (const auto &buffer : recordedBoundBuffers)
+    {
+        appendBufferBarrier(buffer);
+    }
+    for (const auto &[byteOffset, boundImage] : uboBoundImages)
+    {
+        appendImageBarrier(boundImage);
+    }
+    for (const auto &boundImage : recordedBoundImages)
+    {
+        appendImageBarrier(boundImage);
+    }
 }
 
 void RasterizerPipelineVulkan::commitCommand(HardwareExecutorVulkan &hardwareExecutor)
@@ -984,7 +1078,7 @@ void RasterizerPipelineVulkan::commitCommand(HardwareExecutorVulkan &hardwareExe
         // 转换深度图像布局
         {
             auto const handle = globalImageStorages.acquire_write(depthImage.getImageID());
-            mainDevice->resourceManager.transitionImageLayout(hardwareExecutor.currentRecordQueue->commandBuffer,
+            mainDevice->resourceManager.transitionImageLayout(hardwareExecutor.currentCommandBuffer,
                                                               *handle,
                                                               VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
                                                               VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
@@ -999,15 +1093,89 @@ void RasterizerPipelineVulkan::commitCommand(HardwareExecutorVulkan &hardwareExe
     {
         if (graphicsPipeline != VK_NULL_HANDLE)
         {
-            vkDestroyPipeline(mainDevice->deviceManager.getLogicalDevice(), graphicsPipeline, nullptr);
+            // 旧管线可能仍被之前提交的命令缓冲引用
+            ResourceManager::PipelineObjects objects;
+            objects.pipeline = graphicsPipeline;
+            mainDevice->resourceManager.destroyPipelineObjects(objects);
             graphicsPipeline = VK_NULL_HANDLE;
+            HardwareMetricsVulkan::get().releasePipeline(true);
         }
 
         createGraphicsPipeline(vertShaderCode, fragShaderCode);
         graphicsPipelineDirty = false;
     }
 
-    const VkCommandBuffer commandBuffer = hardwareExecutor.currentRecordQueue->commandBuffer;
+    const VkCommandBuffer commandBuffer = hardwareExecutor.currentCommandBuffer;
+
+    // 执行器已录制 getRequiredBarriers 给出的屏障，与 transitionImageLayout 一样在此之后才更新绑定图像的布局
+    auto commitBoundImageLayout = [](const BoundImage &boundImage) {
+        if (boundImage.image)
+        {
+            auto handle = globalImageStorages.acquire_write(boundImage.image.getImageID());
+            if (handle->imageLayout == VK_IMAGE_LAYOUT_UNDEFINED)
+            {
+                handle->imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            }
+        }
+    };
+    for (const auto &[byteOffset, boundImage] : uboBoundImages)
+    {
+        commitBoundImageLayout(boundImage);
+    }
+    for (const auto &boundImage : recordedBoundImages)
+    {
+        commitBoundImageLayout(boundImage);
+    }
+
+    // UBO 内容录入命令缓冲（渲染通道开始之前）：已提交但尚未执行完的绘制仍可能在读取 uboBuffer，不能从 CPU 直接覆盖
+    if (uboSize > 0 && tempUBO.getData())
+    {
+        {
+            auto uboHandle = globalBufferStorages.acquire_write(uboBuffer.getBufferID());
+            mainDevice->resourceManager.updateUniformBuffer(hardwareExecutor.currentCommandBuffer,
+                                                            *uboHandle,
+                                                            tempUBO.getData(),
+                                                            uboSize,
+                                                            VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT);
+        }
+        if (uboDescriptorDirty)
+        {
+            updateUBODescriptor();
+            uboDescriptorDirty = false;
+        }
+    }
+
+    // 绑定描述符集
+    boundDescriptorSets.clear();
+    for (size_t i = 0; i < 3; ++i)
+    {
+        boundDescriptorSets.push_back(mainDevice->resourceManager.bindlessDescriptors[i].descriptorSet);
+    }
+    if (uboSize > 0)
+    {
+        boundDescriptorSets.push_back(uboDescriptorSet);
+    }
+
+    // 绘制数较多时拆成分片，各分片录制到继承本渲染通道的二级命令缓冲；取不到二级命令缓冲时退回内联录制。
+    // 查询无法被二级命令缓冲继承（需要 inheritedQueries），启用统计或遮挡查询时同样内联录制
+    const size_t meshCount = geomMeshesRecord.size();
+    const bool queriesActive = hardwareExecutor.hasActiveQueries();
+    uint32_t shardCount = 0;
+    if (parallelDrawsPerShard > 0 && meshCount > parallelDrawsPerShard && !queriesActive)
+    {
+        shardCount = static_cast<uint32_t>((meshCount + parallelDrawsPerShard - 1) / parallelDrawsPerShard);
+        shardCommandBuffers.clear();
+        for (uint32_t shardIndex = 0; shardIndex < shardCount; ++shardIndex)
+        {
+            const VkCommandBuffer shardCommandBuffer = hardwareExecutor.acquireSecondaryCommandBuffer(shardIndex);
+            if (shardCommandBuffer == VK_NULL_HANDLE)
+            {
+                shardCount = 0;
+                break;
+            }
+            shardCommandBuffers.push_back(shardCommandBuffer);
+        }
+    }
 
     // 配置渲染通道
     std::vector<VkClearValue> clearValues;
@@ -1024,6 +1192,8 @@ void RasterizerPipelineVulkan::commitCommand(HardwareExecutorVulkan &hardwareExe
         clearValues.push_back(handle->clearValue);
     }
 
+    VkViewport viewport{};
+    VkRect2D scissor{};
     {
         auto const handle = globalImageStorages.acquire_read(depthImage.getImageID());
         VkRenderPassBeginInfo renderPassInfo{};
@@ -1036,51 +1206,178 @@ void RasterizerPipelineVulkan::commitCommand(HardwareExecutorVulkan &hardwareExe
         renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
         renderPassInfo.pClearValues = clearValues.data();
 
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(commandBuffer,
+                             &renderPassInfo,
+                             shardCount > 0 ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
 
-        // 设置动态视口和裁剪区
-        VkViewport viewport{};
+        // 动态视口和裁剪区
         viewport.x = 0.0f;
         viewport.y = 0.0f;
         viewport.width = static_cast<float>(handle->imageSize.x);
         viewport.height = static_cast<float>(handle->imageSize.y);
         viewport.minDepth = 0.0f;
         viewport.maxDepth = 1.0f;
-        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
-        VkRect2D scissor{};
         scissor.offset = {0, 0};
         scissor.extent.width = handle->imageSize.x;
         scissor.extent.height = handle->imageSize.y;
-        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
     }
 
-    // 绑定管线
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+    if (shardCount == 0)
+    {
+        bindDrawState(commandBuffer, viewport, scissor, boundDescriptorSets);
+        recordMeshDraws(commandBuffer, 0, meshCount, queriesActive ? &hardwareExecutor : nullptr);
+    }
+    else
+    {
+        // 每个分片从前一个分片结束时生效的裁剪区开始，保证与内联录制的结果一致
+        shardScissors.clear();
+        for (uint32_t shardIndex = 0; shardIndex < shardCount; ++shardIndex)
+        {
+            shardScissors.push_back(scissor);
+            const size_t shardEnd = std::min(meshCount, static_cast<size_t>(shardIndex + 1) * parallelDrawsPerShard);
+            for (size_t i = static_cast<size_t>(shardIndex) * parallelDrawsPerShard; i < shardEnd; ++i)
+            {
+                VkRect2D meshScissor{};
+                if (geomMeshesRecord[i].drawParams.enableScissor && clipMeshScissor(geomMeshesRecord[i], meshScissor))
+                {
+                    scissor = meshScissor;
+                }
+            }
+        }
 
-    // 上传 UBO 数据并更新描述符
-    if (uboSize > 0 && tempUBO.getData())
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = renderPass;
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer = frameBuffers;
+
+        // 命令包录制时主命令缓冲为 SIMULTANEOUS_USE，二级命令缓冲沿用同样的提交方式
+        VkCommandBufferBeginInfo shardBeginInfo{};
+        shardBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        shardBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | hardwareExecutor.currentUsageFlags;
+        shardBeginInfo.pInheritanceInfo = &inheritanceInfo;
+
+        auto recordShard = [&](uint32_t shardIndex) {
+            const VkCommandBuffer shardCommandBuffer = shardCommandBuffers[shardIndex];
+            const size_t shardBegin = static_cast<size_t>(shardIndex) * parallelDrawsPerShard;
+            const size_t shardEnd = std::min(meshCount, shardBegin + parallelDrawsPerShard);
+
+            vkBeginCommandBuffer(shardCommandBuffer, &shardBeginInfo);
+            bindDrawState(shardCommandBuffer, viewport, shardScissors[shardIndex], boundDescriptorSets);
+            recordMeshDraws(shardCommandBuffer, shardBegin, shardEnd, nullptr);
+            vkEndCommandBuffer(shardCommandBuffer);
+        };
+        mainDevice->deviceManager.getRecordWorkers().parallelFor(shardCount, recordShard);
+
+        vkCmdExecuteCommands(commandBuffer, shardCount, shardCommandBuffers.data());
+    }
+
+    vkCmdEndRenderPass(commandBuffer);
+
+    // Keep resources alive until GPU execution completes
+    if (!geomMeshesRecord.empty())
     {
-        uboBuffer.copyFromData(tempUBO.getData(), uboSize);
-        if (uboDescriptorDirty)
+        std::shared_ptr<ResourceHolderCommand> &resourceHolder = acquireResourceHolder();
+        resourceHolder->buffers.reserve(geomMeshesRecord.size() * 2 + recordedBoundBuffers.size());
+
+        for (const auto &mesh : geomMeshesRecord)
         {
-            updateUBODescriptor();
-            uboDescriptorDirty = false;
+            if (mesh.indexBuffer)
+            {
+                resourceHolder->buffers.push_back(mesh.indexBuffer);
+            }
+            if (mesh.vertexBuffer)
+            {
+                resourceHolder->buffers.push_back(mesh.vertexBuffer);
+            }
         }
+
+        // 按次绑定的资源只通过 bindless 句柄访问，同样需要存活到 GPU 执行完毕（命令包多次回放时尤其如此）
+        resourceHolder->buffers.insert(resourceHolder->buffers.end(), recordedBoundBuffers.begin(), recordedBoundBuffers.end());
+        for (const auto &boundImage : recordedBoundImages)
+        {
+            resourceHolder->images.push_back(boundImage.image);
+        }
+
+        hardwareExecutor.pendingResources.push_back(resourceHolder);
     }
 
-    // 绑定描述符集
-    std::vector<VkDescriptorSet> descriptorSets;
-    descriptorSets.reserve(4);
-    for (size_t i = 0; i < 3; ++i)
+    // 网格记录即将清空，先保存顶点/索引缓冲的读取访问
+    for (const auto &mesh : geomMeshesRecord)
     {
-        descriptorSets.push_back(mainDevice->resourceManager.bindlessDescriptors[i].descriptorSet);
+        for (const HardwareBuffer *meshBuffer : {&mesh.indexBuffer, &mesh.vertexBuffer})
+        {
+            if (*meshBuffer)
+            {
+                auto const handle = globalBufferStorages.acquire_read(meshBuffer->getBufferID());
+                committedAccesses.push_back({handle->bufferHandle, VK_NULL_HANDLE, false});
+            }
+        }
     }
-    if (uboSize > 0)
+
+    // 清空记录
+    geomMeshesRecord.clear();
+}
+
+std::shared_ptr<ResourceHolderCommand> &RasterizerPipelineVulkan::acquireResourceHolder()
+{
+    // 只剩本管线持有即执行器已放弃引用；fence 与其 release 递减同步后才能改写持有者的内容。
+    // 空闲持有者在这里统一清空，资源最多比逐次分配时多存活到本管线的下一次提交
+    std::shared_ptr<ResourceHolderCommand> *idleHolder = nullptr;
+    for (auto &holder : resourceHolders)
+    {
+        if (holder.use_count() == 1)
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            holder->buffers.clear();
+            holder->images.clear();
+            if (idleHolder == nullptr)
+            {
+                idleHolder = &holder;
+            }
+        }
+    }
+    if (idleHolder != nullptr)
     {
-        descriptorSets.push_back(uboDescriptorSet);
+        return *idleHolder;
     }
 
+    // 同一管线在多个队列上同时有提交时才会超过预建的数量
+    return resourceHolders.emplace_back(std::make_shared<ResourceHolderCommand>());
+}
+
+bool RasterizerPipelineVulkan::clipMeshScissor(const TriangleGeomMesh &mesh, VkRect2D &scissor) const
+{
+    const int32_t x = std::max<int32_t>(0, mesh.drawParams.scissor.x);
+    const int32_t y = std::max<int32_t>(0, mesh.drawParams.scissor.y);
+    const int32_t right = std::min<int32_t>(static_cast<int32_t>(imageSize.x),
+                                            mesh.drawParams.scissor.x + static_cast<int32_t>(mesh.drawParams.scissor.width));
+    const int32_t bottom = std::min<int32_t>(static_cast<int32_t>(imageSize.y),
+                                             mesh.drawParams.scissor.y + static_cast<int32_t>(mesh.drawParams.scissor.height));
+
+    if (right <= x || bottom <= y)
+    {
+        return false;
+    }
+
+    scissor.offset = {x, y};
+    scissor.extent.width = static_cast<uint32_t>(right - x);
+    scissor.extent.height = static_cast<uint32_t>(bottom - y);
+    return true;
+}
+
+void RasterizerPipelineVulkan::bindDrawState(VkCommandBuffer commandBuffer,
+                                             const VkViewport &viewport,
+                                             const VkRect2D &scissor,
+                                             const std::vector<VkDescriptorSet> &descriptorSets) const
+{
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    // 绑定管线
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+
     vkCmdBindDescriptorSets(commandBuffer,
                             VK_PIPELINE_BIND_POINT_GRAPHICS,
                             pipelineLayout,
@@ -1089,28 +1386,21 @@ void RasterizerPipelineVulkan::commitCommand(HardwareExecutorVulkan &hardwareExe
                             descriptorSets.data(),
                             0,
                             nullptr);
+}
 
-    // 绘制所有几何网格
-    for (const auto &mesh : geomMeshesRecord)
+void RasterizerPipelineVulkan::recordMeshDraws(VkCommandBuffer commandBuffer, size_t begin, size_t end, HardwareExecutorVulkan *queryExecutor) const
+{
+    for (size_t meshIndex = begin; meshIndex < end; ++meshIndex)
     {
+        const TriangleGeomMesh &mesh = geomMeshesRecord[meshIndex];
+
         if (mesh.drawParams.enableScissor)
         {
-            const int32_t x = std::max<int32_t>(0, mesh.drawParams.scissor.x);
-            const int32_t y = std::max<int32_t>(0, mesh.drawParams.scissor.y);
-            const int32_t right = std::min<int32_t>(static_cast<int32_t>(imageSize.x),
-                                                    mesh.drawParams.scissor.x + static_cast<int32_t>(mesh.drawParams.scissor.width));
-            const int32_t bottom = std::min<int32_t>(static_cast<int32_t>(imageSize.y),
-                                                     mesh.drawParams.scissor.y + static_cast<int32_t>(mesh.drawParams.scissor.height));
-
-            if (right <= x || bottom <= y)
+            VkRect2D scissor{};
+            if (!clipMeshScissor(mesh, scissor))
             {
                 continue;
             }
-
-            VkRect2D scissor{};
-            scissor.offset = {x, y};
-            scissor.extent.width = static_cast<uint32_t>(right - x);
-            scissor.extent.height = static_cast<uint32_t>(bottom - y);
             vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
         }
 
@@ -1179,40 +1469,130 @@ void RasterizerPipelineVulkan::commitCommand(HardwareExecutorVulkan &hardwareExe
             auto handle = globalBufferStorages.acquire_read(mesh.indexBuffer.getBufferID());
             const uint32_t draw_index_count =
                 mesh.drawParams.indexCount > 0 ? mesh.drawParams.indexCount : static_cast<uint32_t>(handle->elementCount);
+
+            // 多视图渲染通道内的查询占用与视图数相同的连续索引
+            const ExecutorQueryPool::ActiveQuery occlusionQuery =
+                queryExecutor != nullptr
+                    ? queryExecutor->beginOcclusionQuery(commandBuffer, debugName.c_str(), static_cast<uint32_t>(meshIndex), static_cast<uint32_t>(multiviewCount))
+                    : ExecutorQueryPool::ActiveQuery{};
             vkCmdDrawIndexed(commandBuffer,
                              draw_index_count,
                              1,
                              mesh.drawParams.firstIndex,
                              mesh.drawParams.vertexOffset,
                              0);
+            if (queryExecutor != nullptr)
+            {
+                queryExecutor->endQuery(commandBuffer, occlusionQuery);
+            }
         }
     }
+}
 
-    vkCmdEndRenderPass(commandBuffer);
+void RasterizerPipelineVulkan::collectResourceAccesses(std::vector<ResourceAccessVulkan> &accesses)
+{
+    accesses.insert(accesses.end(), committedAccesses.begin(), committedAccesses.end());
+    committedAccesses.clear();
 
-    // Keep resources alive until GPU execution completes
-    if (!geomMeshesRecord.empty())
+    // 颜色/深度附件在 render pass 中被清除和写入
+    for (const auto &renderTarget : renderTargets)
     {
-        auto resourceHolder = std::make_shared<ResourceHolderCommand>();
-        resourceHolder->buffers.reserve(geomMeshesRecord.size() * 2);
+        if (renderTarget)
+        {
+            auto const handle = globalImageStorages.acquire_read(renderTarget.getImageID());
+            accesses.push_back({VK_NULL_HANDLE, handle->imageHandle, true});
+        }
+    }
+    if (depthImage)
+    {
+        auto const handle = globalImageStorages.acquire_read(depthImage.getImageID());
+        accesses.push_back({VK_NULL_HANDLE, handle->imageHandle, true});
+    }
 
-        for (const auto &mesh : geomMeshesRecord)
+    // storage/raw buffer 在着色器中可读可写，无法区分时保守地按写入处理
+    auto appendBuffer = [&accesses](const HardwareBuffer &buffer) {
+        if (buffer)
         {
-            if (mesh.indexBuffer)
-            {
-                resourceHolder->buffers.push_back(mesh.indexBuffer);
-            }
-            if (mesh.vertexBuffer)
-            {
-                resourceHolder->buffers.push_back(mesh.vertexBuffer);
-            }
+            auto const handle = globalBufferStorages.acquire_read(buffer.getBufferID());
+            accesses.push_back({handle->bufferHandle, VK_NULL_HANDLE, true});
+        }
+    };
+    auto appendImage = [&accesses](const BoundImage &boundImage) {
+        if (boundImage.image)
+        {
+            auto const handle = globalImageStorages.acquire_read(boundImage.image.getImageID());
+            accesses.push_back({VK_NULL_HANDLE, handle->imageHandle, boundImage.write});
         }
+    };
 
-        hardwareExecutor.pendingResources.push_back(resourceHolder);
+    for (const auto &[byteOffset, buffer] : uboBoundBuffers)
+    {
+        appendBuffer(buffer);
+    }
+    for (const auto &[byteOffset, boundImage] : uboBoundImages)
+    {
+        appendImage(boundImage);
     }
+    for (const auto &buffer : recordedBoundBuffers)
+    {
+        appendBuffer(buffer);
+    }
+    for (const auto &boundImage : recordedBoundImages)
+    {
+        appendImage(boundImage);
+    }
+    recordedBoundBuffers.clear();
+    recordedBoundImages.clear();
 
-    // 清空记录
-    geomMeshesRecord.clear();
+    // 每次提交都会在命令缓冲中改写 uboBuffer
+    if (uboSize > 0 && uboBuffer)
+    {
+        auto const handle = globalBufferStorages.acquire_read(uboBuffer.getBufferID());
+        accesses.push_back({handle->bufferHandle, VK_NULL_HANDLE, true});
+    }
+}
+
+void RasterizerPipelineVulkan::collectBindings(std::vector<VkBuffer> &buffers, std::vector<ResourceManager::ImageHardwareWrap *> &images)
+{
+    auto appendBuffer = [&buffers](const HardwareBuffer &buffer) {
+        if (buffer)
+        {
+            auto const handle = globalBufferStorages.acquire_read(buffer.getBufferID());
+            buffers.push_back(handle->bufferHandle);
+        }
+    };
+    auto appendImage = [&images](const HardwareImage &image) {
+        if (image)
+        {
+            auto handle = globalImageStorages.acquire_write(image.getImageID());
+            images.push_back(&*handle);
+        }
+    };
+
+    for (const auto &renderTarget : renderTargets)
+    {
+        appendImage(renderTarget);
+    }
+    appendImage(depthImage);
+
+    for (const auto &[byteOffset, buffer] : uboBoundBuffers)
+    {
+        appendBuffer(buffer);
+    }
+    for (const auto &[byteOffset, boundImage] : uboBoundImages)
+    {
+        appendImage(boundImage.image);
+    }
+
+    // 按次记录的绑定只在提交前存在
+    for (const auto &buffer : recordedBoundBuffers)
+    {
+        appendBuffer(buffer);
+    }
+    for (const auto &boundImage : recordedBoundImages)
+    {
+        appendImage(boundImage.image);
+    }
 }
 
 VkFormat RasterizerPipelineVulkan::getVkFormatFromType(const std::string &typeName, uint32_t elementCount) const
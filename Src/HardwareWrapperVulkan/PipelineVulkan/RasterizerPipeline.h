@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include <map>
 #include <vector>
 
 #include "CabbageHardware.h"
@@ -47,6 +48,21 @@ struct RasterizerPipelineVulkan : public CommandRecordVulkan
         }
     }
 
+    void setParallelRecording(uint32_t drawsPerShard)
+    {
+        parallelDrawsPerShard = drawsPerShard;
+    }
+
+    void setDebugName(std::string name)
+    {
+        debugName = std::move(name);
+    }
+
+    void setPreciseBarriers(bool enabled)
+    {
+        preciseBarriers = enabled;
+    }
+
     //void setDepthWriteEnabled(bool enabled)
     //{
     //    if (depthWriteEnabled != enabled)
@@ -80,8 +96,21 @@ struct RasterizerPipelineVulkan : public CommandRecordVulkan
         return CommandRecordVulkan::ExecutorType::Graphics;
     }
 
+    const char *getDebugName() const override
+    {
+        return debugName.c_str();
+    }
+
     void commitCommand(HardwareExecutorVulkan &hardwareExecutorVulkan) override;
-    RequiredBarriers getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutorVulkan) override;
+    void getRequiredBarriers(HardwareExecutorVulkan &hardwareExecutorVulkan, RequiredBarriers &requiredBarriers) override;
+    void collectResourceAccesses(std::vector<ResourceAccessVulkan> &accesses) override;
+    void collectBindings(std::vector<VkBuffer> &buffers, std::vector<ResourceManager::ImageHardwareWrap *> &images) override;
+
+    // 启用精确屏障即表示管线只访问其绑定的资源
+    [[nodiscard]] bool declaresAllAccesses() const override
+    {
+        return preciseBarriers;
+    }
 
   private:
     struct TriangleGeomMesh
@@ -93,11 +122,35 @@ struct RasterizerPipelineVulkan : public CommandRecordVulkan
     };
     std::vector<TriangleGeomMesh> geomMeshesRecord;
 
+    // setResourceDirect 绑定的资源，提交时据此上报依赖：
+    // UBO 中的句柄跨帧保留，按字节偏移记录；推送常量与描述符槽位的绑定随本次提交累积，提交后清空
+    struct BoundImage
+    {
+        HardwareImage image;
+        bool write{true};
+    };
+    std::map<uint64_t, HardwareBuffer> uboBoundBuffers;
+    std::map<uint64_t, BoundImage> uboBoundImages;
+    std::vector<HardwareBuffer> recordedBoundBuffers;
+    std::vector<BoundImage> recordedBoundImages;
+    std::vector<ResourceAccessVulkan> committedAccesses; // commitCommand 清空网格记录前保存的顶点/索引缓冲访问
+
     void createRenderPass(int multiviewCount = 1);
     void createGraphicsPipeline(EmbeddedShader::ShaderCodeModule &vertShaderCode,
                                 EmbeddedShader::ShaderCodeModule &fragShaderCode);
     void createFramebuffers(ktm::uvec2 imageSize);
 
+    // 网格自带的裁剪区与渲染目标求交，交集为空时返回 false（该网格不绘制）
+    bool clipMeshScissor(const TriangleGeomMesh &mesh, VkRect2D &scissor) const;
+    // 二级命令缓冲不继承动态状态与绑定，每个分片开头都要重新设置
+    void bindDrawState(VkCommandBuffer commandBuffer,
+                       const VkViewport &viewport,
+                       const VkRect2D &scissor,
+                       const std::vector<VkDescriptorSet> &descriptorSets) const;
+    // 录制 geomMeshesRecord[begin, end) 的绘制，可在多个工作线程上对不相交的区间同时调用；
+    // queryExecutor 非空时为每次绘制附加遮挡查询（只用于内联录制）
+    void recordMeshDraws(VkCommandBuffer commandBuffer, size_t begin, size_t end, HardwareExecutorVulkan *queryExecutor) const;
+
     [[nodiscard]] VkFormat getVkFormatFromType(const std::string &typeName, uint32_t elementCount) const;
 
     ktm::uvec2 imageSize = {0, 0};
@@ -113,6 +166,21 @@ struct RasterizerPipelineVulkan : public CommandRecordVulkan
     //bool depthWriteEnabled{true};
     bool graphicsPipelineDirty{false};
 
+    std::string debugName{"RasterizerPipeline"}; // 性能分析中的名称，默认取创建位置
+
+    // 为 false 时访问集合视为不完整（bindless 句柄可能藏在其他缓冲中），额外请求全局内存屏障
+    bool preciseBarriers{false};
+
+    uint32_t parallelDrawsPerShard{0};               // 0 表示在主命令缓冲中内联录制全部绘制
+    std::vector<VkCommandBuffer> shardCommandBuffers; // 本次提交各分片的二级命令缓冲，跨提交复用容量
+    std::vector<VkRect2D> shardScissors;              // 各分片开头继承的裁剪区
+    std::vector<VkDescriptorSet> boundDescriptorSets; // 本次提交绑定的描述符集，跨提交复用容量
+
+    // 保活网格与绑定资源的持有者：构造时按 MAX_IN_FLIGHT_COMMAND_BUFFERS 预建，执行器的延迟释放放弃引用后复用，
+    // 连同容器容量，稳态下提交不再分配
+    std::vector<std::shared_ptr<ResourceHolderCommand>> resourceHolders;
+    std::shared_ptr<ResourceHolderCommand> &acquireResourceHolder();
+
     HardwareImage depthImage;
     std::vector<HardwareImage> renderTargets;
 
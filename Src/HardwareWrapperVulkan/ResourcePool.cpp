@@ -6,4 +6,6 @@ Corona::Kernel::Utils::Storage<RasterizerPipelineWrap> gRasterizerPipelineStorag
 Corona::Kernel::Utils::Storage<DisplayerHardwareWrap> globalDisplayerStorages;
 Corona::Kernel::Utils::Storage<ComputePipelineWrap> gComputePipelineStorage;
 Corona::Kernel::Utils::Storage<ExecutorWrap> gExecutorStorage;
+Corona::Kernel::Utils::Storage<RenderGraphWrap> gRenderGraphStorage;
+Corona::Kernel::Utils::Storage<CommandBundleWrap> gCommandBundleStorage;
 Corona::Kernel::Utils::Storage<PushConstantWrap> globalPushConstantStorages;
\ No newline at end of file
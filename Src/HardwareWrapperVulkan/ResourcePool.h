@@ -1,6 +1,8 @@
 ﻿#pragma once
 
 #include "HardwareWrapperVulkan/DisplayVulkan/DisplayManager.h"
+#include "HardwareWrapperVulkan/HardwareVulkan/CommandBundleVulkan.h"
+#include "HardwareWrapperVulkan/HardwareVulkan/RenderGraphVulkan.h"
 #include "HardwareWrapperVulkan/HardwareVulkan/ResourceManager.h"
 #include "HardwareWrapperVulkan/PipelineVulkan/ComputePipeline.h"
 #include "HardwareWrapperVulkan/PipelineVulkan/RasterizerPipeline.h"
@@ -42,6 +44,22 @@ struct ExecutorWrap
 
 extern Corona::Kernel::Utils::Storage<ExecutorWrap> gExecutorStorage;
 
+struct RenderGraphWrap
+{
+    RenderGraphVulkan *impl = nullptr;
+    uint64_t refCount = 1;
+};
+
+extern Corona::Kernel::Utils::Storage<RenderGraphWrap> gRenderGraphStorage;
+
+struct CommandBundleWrap
+{
+    CommandBundleVulkan *impl = nullptr;
+    uint64_t refCount = 1;
+};
+
+extern Corona::Kernel::Utils::Storage<CommandBundleWrap> gCommandBundleStorage;
+
 struct PushConstantWrap
 {
     uint8_t *data{nullptr};
@@ -1,8 +1,12 @@
 ﻿#pragma once
 
 #include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <type_traits>
 #include <vector>
 
@@ -22,6 +26,7 @@ typedef void *HANDLE;
 #endif
 
 struct HardwareExecutor;
+struct CompletionTokenVulkan;
 
 enum class ImageFormat : uint32_t
 {
@@ -72,6 +77,22 @@ enum class BufferUsage : uint32_t
     StorageBuffer = 8,
 };
 
+// 缓冲的内存放置
+enum class BufferMemory : uint32_t
+{
+    HostVisible = 0, // 持久映射的主机可见内存，CPU 直接读写（默认）
+    DeviceLocal = 1, // 显存，GPU 访问最快；不可映射，copyFromData/copyToData 自动经暂存缓冲中转
+    Auto = 2,        // 优先显存，ReBAR 或集成显卡上同时可映射，否则行为同 DeviceLocal
+};
+
+// 执行器的优先级类别：决定提交到哪一类队列（不同 pQueuePriorities）以及异步提交时的先后
+enum class ExecutorPriority : uint32_t
+{
+    Realtime = 0,   // 帧关键工作，例如每帧的图形与呈现；实时队列忙碌时可以借用空闲的普通队列
+    Normal = 1,     // 队列族只有两个队列时与 Background 共用第二个队列
+    Background = 2, // 可以让步的工作，例如纹理转码、BVH 重建；只在队列族内让步，不低于其他队列族
+};
+
 template <typename T>
 concept IsContainer = requires(T a) {
     { a.size() } -> std::convertible_to<size_t>;
@@ -95,16 +116,17 @@ struct HardwareBuffer
     HardwareBuffer();
     HardwareBuffer(const HardwareBuffer &other);
     HardwareBuffer(HardwareBuffer &&other) noexcept;
-    HardwareBuffer(uint32_t bufferSize, uint32_t elementSize, BufferUsage usage, const void *data = nullptr, bool useDedicated = true);
+    // 默认从大块显存中子分配；exportable 为 true 时才创建可供 exportBufferMemory 导出的专用外部内存
+    HardwareBuffer(uint32_t bufferSize, uint32_t elementSize, BufferUsage usage, const void *data = nullptr, bool useDedicated = false, bool exportable = false, BufferMemory memory = BufferMemory::HostVisible);
 
-    HardwareBuffer(uint32_t size, BufferUsage usage, const void *data = nullptr, bool useDedicated = true)
-        : HardwareBuffer(1, size, usage, data, useDedicated)
+    HardwareBuffer(uint32_t size, BufferUsage usage, const void *data = nullptr, bool useDedicated = false, bool exportable = false, BufferMemory memory = BufferMemory::HostVisible)
+        : HardwareBuffer(1, size, usage, data, useDedicated, exportable, memory)
     {
     }
 
     template <IsContainer Container>
-    HardwareBuffer(const Container &input, BufferUsage usage, bool useDedicated = true)
-        : HardwareBuffer(input.size(), sizeof(input[0]), usage, input.data(), useDedicated)
+    HardwareBuffer(const Container &input, BufferUsage usage, bool useDedicated = false, bool exportable = false, BufferMemory memory = BufferMemory::HostVisible)
+        : HardwareBuffer(input.size(), sizeof(input[0]), usage, input.data(), useDedicated, exportable, memory)
     {
     }
 
@@ -117,6 +139,7 @@ struct HardwareBuffer
 
     explicit operator bool() const;
 
+    // 只对以 exportable = true 创建的缓冲有效
     ExternalHandle exportBufferMemory();
     // HardwareBuffer importBufferMemory(const ExternalHandle &memHandle);
 
@@ -132,7 +155,7 @@ struct HardwareBuffer
                                               uint32_t imageLayer = 0,
                                               uint32_t imageMip = 0) const;
 
-    // CPU 映射内存操作（非 GPU 命令）
+    // CPU 读写缓冲内容：已映射时直接拷贝；不可映射的显存缓冲经暂存缓冲上传/回读，并阻塞到传输完成
     bool copyFromData(const void *inputData, uint64_t size) const;
     bool copyToData(void *outputData, uint64_t size) const;
 
@@ -142,6 +165,7 @@ struct HardwareBuffer
         return copyFromData(input.data(), input.size() * sizeof(T));
     }
 
+    // 不可映射的缓冲（DeviceLocal，或 Auto 落在不可映射的显存）返回 nullptr
     [[nodiscard]] void *getMappedData() const;
     [[nodiscard]] uint64_t getElementSize() const;
     [[nodiscard]] uint64_t getElementCount() const;
@@ -224,6 +248,7 @@ struct HardwareImage
     mutable std::mutex imageMutex;
 
     friend class HardwareDisplayer;
+    friend struct HardwareRenderGraph;
 };
 
 // ================= 对外封装：HardwarePushConstant =================
@@ -395,6 +420,13 @@ struct ComputePipelineBase
 
     ComputePipelineBase &operator()(uint16_t x, uint16_t y, uint16_t z);
 
+    // GPU 性能分析中的名称，默认取创建位置（文件名:行号）
+    void setDebugName(const std::string &name);
+
+    // 默认在每次调度前插入全局内存屏障，覆盖着色器经 bindless 句柄间接访问的任何资源；
+    // 确认着色器只访问经 setResource 绑定的资源时可开启，只为这些资源生成最小屏障，允许相邻调度重叠执行
+    void setPreciseBarriers(bool enabled);
+
     [[nodiscard]] uintptr_t getComputePipelineID() const
     {
         return computePipelineID.load(std::memory_order_acquire);
@@ -459,6 +491,16 @@ struct RasterizerPipelineBase
     void setDepthEnabled(bool enabled);
     //void setDepthWriteEnabled(bool enabled);
     void setDepthImage(HardwareImage &depthImage);
+
+    // 绘制数超过 drawsPerShard 时按每片 drawsPerShard 次绘制拆分，在设备的工作线程上并行录制到二级命令缓冲，
+    // 再按原顺序在主命令缓冲中执行；0 表示关闭（默认）
+    void setParallelRecording(uint32_t drawsPerShard);
+
+    // GPU 性能分析中的名称，默认取创建位置（文件名:行号）
+    void setDebugName(const std::string &name);
+
+    // 同 ComputePipelineBase::setPreciseBarriers：默认保守地插入全局内存屏障，开启后只为绑定的资源生成最小屏障
+    void setPreciseBarriers(bool enabled);
     [[nodiscard]] HardwareImage getDepthImage();
 
     // 通过 shader 反射键绑定资源（BindingKey 由 GLSL 编译生成的 .hpp 提供）
@@ -512,6 +554,240 @@ struct RasterizerPipelineBase
     std::vector<EmbeddedShader::AutoBindEntry> autoBindEntries_;
 };
 
+// ================= 对外封装：HardwareRenderGraph =================
+// pass 声明的读写资源，渲染图据此剔除无用 pass、计算瞬态图像生命周期并插入屏障
+struct RenderPassResources
+{
+    std::vector<HardwareImage> readImages;
+    std::vector<HardwareImage> writeImages;
+    std::vector<HardwareBuffer> readBuffers;
+    std::vector<HardwareBuffer> writeBuffers;
+};
+
+struct HardwareRenderGraph
+{
+  public:
+    HardwareRenderGraph();
+    HardwareRenderGraph(const HardwareRenderGraph &other);
+    HardwareRenderGraph(HardwareRenderGraph &&other) noexcept;
+    ~HardwareRenderGraph();
+
+    HardwareRenderGraph &operator=(const HardwareRenderGraph &other);
+    HardwareRenderGraph &operator=(HardwareRenderGraph &&other) noexcept;
+
+    /// @brief 创建由渲染图管理内存的瞬态图像：生命周期不重叠的瞬态图像共享同一块显存。
+    /// 内存在 compile() 时分配，因此需要在 compile() 之后再绑定到管线
+    [[nodiscard]] HardwareImage createTransientImage(const HardwareImageCreateInfo &createInfo);
+
+    HardwareRenderGraph &addPass(const std::string &name, ComputePipelineBase &computePipeline, const RenderPassResources &resources);
+    HardwareRenderGraph &addPass(const std::string &name, RasterizerPipelineBase &rasterizerPipeline, const RenderPassResources &resources);
+    HardwareRenderGraph &addPass(const std::string &name, const CopyCommand &cmd, const RenderPassResources &resources);
+
+    /// @brief 标记瞬态图像在渲染图之外仍被使用（例如送显），写入它的 pass 不会被剔除
+    HardwareRenderGraph &markOutput(const HardwareImage &image);
+
+    /// @brief 剔除无用 pass、确定执行顺序并为瞬态图像分配别名内存；编译后图的结构不再改变
+    HardwareRenderGraph &compile();
+
+    /// @brief 瞬态图像别名后/别名前占用的显存（字节）
+    [[nodiscard]] uint64_t getTransientMemorySize() const;
+    [[nodiscard]] uint64_t getUnaliasedTransientMemorySize() const;
+
+    [[nodiscard]] uintptr_t getRenderGraphID() const
+    {
+        return renderGraphID.load(std::memory_order_acquire);
+    }
+
+  private:
+    mutable std::mutex renderGraphMutex;
+    std::atomic<std::uintptr_t> renderGraphID;
+};
+
+// ================= 对外封装：HardwareCommandBundle =================
+// 录制一次、多次提交的命令包：record() 把加入的命令连同屏障录制进可重复提交的命令缓冲，
+// 之后每次送入执行器都直接提交该命令缓冲，省去逐条录制的 CPU 开销
+struct HardwareCommandBundle
+{
+  public:
+    HardwareCommandBundle();
+    HardwareCommandBundle(const HardwareCommandBundle &other);
+    HardwareCommandBundle(HardwareCommandBundle &&other) noexcept;
+    ~HardwareCommandBundle();
+
+    HardwareCommandBundle &operator=(const HardwareCommandBundle &other);
+    HardwareCommandBundle &operator=(HardwareCommandBundle &&other) noexcept;
+
+    HardwareCommandBundle &operator<<(ComputePipelineBase &computePipeline);
+    HardwareCommandBundle &operator<<(RasterizerPipelineBase &rasterizerPipeline);
+    HardwareCommandBundle &operator<<(const CopyCommand &cmd);
+
+    /// @brief 录制此前加入的命令并替换之前的录制结果，命令必须属于同一队列族。
+    /// 推送常量、绘制参数与调度尺寸在此时固化；录制时仍处于未定义布局的图像每次回放都不保留旧内容
+    bool record();
+
+    /// @brief 已录制，且绑定的缓冲/图像与图像布局都与录制时一致。
+    /// 失效的命令包提交时不执行任何命令（该段仍提交等待与 signal/fence，并计入 HardwareCommitLatencyStats::droppedSegments），
+    /// 需要重新加入命令并录制
+    [[nodiscard]] bool isValid() const;
+
+    /// @brief 释放录制结果以及持有的管线和拷贝命令
+    void reset();
+
+    [[nodiscard]] uintptr_t getCommandBundleID() const
+    {
+        return commandBundleID.load(std::memory_order_acquire);
+    }
+
+  private:
+    mutable std::mutex commandBundleMutex;
+    std::atomic<std::uintptr_t> commandBundleID;
+};
+
+// ================= 对外封装：HardwareCompletionToken =================
+// 一次 commit 的 GPU 完成令牌，只持有各队列段的 timeline semaphore 与 signal 值，可随意拷贝
+struct HardwareCompletionToken
+{
+  public:
+    HardwareCompletionToken() = default;
+
+    /// @brief 非阻塞查询 commit 是否已在 GPU 上完成；空令牌视为已完成
+    [[nodiscard]] bool isReady() const;
+
+    /// @brief 阻塞至完成或超时（纳秒），返回是否已完成
+    bool wait(uint64_t timeoutNs = UINT64_MAX) const;
+
+    /// @brief 设备出错或等待线程退出时放弃了等待：回调照常执行，但 GPU 工作未必完成
+    [[nodiscard]] bool isAbandoned() const;
+
+    /// @brief 完成后在设备的后台等待线程上调用 callback；空令牌在调用线程上立即调用。
+    /// 放弃等待时回调同样会被调用，可用 isAbandoned 区分
+    const HardwareCompletionToken &onComplete(std::function<void()> callback) const;
+
+    explicit operator bool() const
+    {
+        return impl != nullptr;
+    }
+
+    // ========== C++20 协程 ==========
+    // co_await token：已完成时不挂起；否则登记到设备的后台等待线程，完成后在该线程上恢复协程。
+    // 等待线程把所有未完成令牌合并为一次 vkWaitSemaphores，不会为每个挂起的协程占用一个线程；
+    // 恢复后的耗时工作应自行切换到其他线程，避免推迟其他协程的恢复。
+    // co_await 的结果为 false 表示放弃了等待（见 isAbandoned），协程仍会被恢复
+    [[nodiscard]] bool await_ready() const
+    {
+        return isReady();
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) const
+    {
+        onComplete([handle] { handle.resume(); });
+    }
+
+    bool await_resume() const
+    {
+        return !isAbandoned();
+    }
+
+  private:
+    friend struct HardwareExecutor;
+    std::shared_ptr<CompletionTokenVulkan> impl;
+};
+
+// ================= 管线统计与遮挡查询结果 =================
+// 由 HardwareExecutor::takeQueryResults 取回，name 为记录的调试名（管线默认取创建位置）
+struct HardwarePipelineStatistics
+{
+    std::string name;
+    uint64_t vertexShaderInvocations{0};
+    uint64_t fragmentShaderInvocations{0};
+    uint64_t computeShaderInvocations{0}; // 图形队列与计算队列都会统计
+};
+
+struct HardwareOcclusionResult
+{
+    std::string name;
+    uint32_t drawIndex{0};     // 该次提交中光栅管线的第几次 record()
+    uint64_t samplesPassed{0}; // 设备不支持精确遮挡查询时只保证可见与否（非零）
+};
+
+// ================= 提交延迟统计 =================
+// 由 HardwareExecutor::getCommitLatencyStats 读取，均为执行器创建以来的累计值；分位数为直方图桶上界，相对误差不超过 12.5%
+struct HardwareLatencySummary
+{
+    uint64_t count{0};
+    uint64_t totalNs{0};
+    uint64_t maxNs{0};
+    uint64_t p50Ns{0};
+    uint64_t p90Ns{0};
+    uint64_t p99Ns{0};
+};
+
+struct HardwareCommitLatencyStats
+{
+    uint64_t commits{0};
+    uint64_t submits{0};
+    uint64_t failedSubmits{0};
+    uint64_t droppedSegments{0};      // 命令未能执行（命令包已失效或命令缓冲分配失败）、只提交了等待与 signal/fence 的队列段数
+    uint64_t contendedQueueLocks{0};  // 没有空闲队列、只能阻塞等锁的次数
+    uint64_t timelineWaitTimeouts{0}; // 等待命令缓冲槽位超时后重新选择队列的次数
+
+    HardwareLatencySummary queueLockWait; // 队列锁竞争
+    HardwareLatencySummary timelineWait;  // 等待队列上先前提交完成（GPU 反压）
+    HardwareLatencySummary recording;     // 命令缓冲录制
+    HardwareLatencySummary queueSubmit;   // vkQueueSubmit2（驱动开销）
+};
+
+// ================= GPU 性能分析 =================
+// 启用后每次 commit 在每条命令前后写入 GPU 时间戳，结果在 GPU 完成后异步读取，不会阻塞提交
+struct HardwareProfiler
+{
+    static void setEnabled(bool enable = true);
+    [[nodiscard]] static bool isEnabled();
+
+    /// @brief 把所有设备已完成的 GPU 事件与 CPU commit 区间写为 Chrome trace_event JSON（chrome://tracing、Perfetto 可打开）。
+    /// 写出的事件随之清空；尚未在 GPU 上完成的提交留到下一次导出
+    static bool exportChromeTrace(const std::string &filePath);
+};
+
+// ================= 资源指标 =================
+// 全局计数的快照，读取不加锁，可以每秒轮询用于泄漏与描述符耗尽告警；各字段分别读取，只保证近似一致
+struct HardwareBindlessOccupancy
+{
+    uint32_t capacity{0};  // 描述符数组长度
+    uint32_t occupied{0};  // 存活资源占用的槽位数
+    uint32_t highWater{0}; // 出现过的最大槽位下标 + 1，超过 capacity 即已越界
+};
+
+struct HardwareMetricsSnapshot
+{
+    uint64_t liveBuffers{0};
+    uint64_t liveBufferBytes{0};
+    uint64_t liveImages{0};
+    uint64_t liveImageBytes{0}; // 子图像与渲染图瞬态图像不计字节
+
+    HardwareBindlessOccupancy textureSlots;
+    HardwareBindlessOccupancy storageBufferSlots;
+    HardwareBindlessOccupancy storageImageSlots;
+
+    uint64_t liveComputePipelines{0};
+    uint64_t liveGraphicsPipelines{0};
+    uint64_t compiledPipelines{0}; // 累计编译次数，包括状态变化导致的重建
+    uint64_t totalCompileNs{0};
+    uint64_t maxCompileNs{0};
+
+    uint64_t deferredReleasePending{0}; // 所有执行器中等待 GPU 完成后释放的资源数
+
+    uint64_t stagingAllocations{0};     // 上传路径累计新建的独立暂存缓冲数
+    uint64_t stagingBytes{0};           // 上传路径累计暂存的字节数（含暂存环）
+    uint64_t stagingRingAllocations{0}; // 从每设备暂存环分配的次数
+    uint64_t stagingRingBytes{0};
+};
+
+struct HardwareMetrics
+{
+    [[nodiscard]] static HardwareMetricsSnapshot snapshot();
+};
+
 // ================= 对外封装：HardwareExecutor =================
 struct HardwareExecutor
 {
@@ -528,10 +804,36 @@ struct HardwareExecutor
     HardwareExecutor &operator<<(RasterizerPipelineBase &rasterizerPipeline);
     HardwareExecutor &operator<<(HardwareExecutor &other);
     HardwareExecutor &operator<<(const CopyCommand &cmd);
+    HardwareExecutor &operator<<(HardwareRenderGraph &renderGraph);
+    HardwareExecutor &operator<<(HardwareCommandBundle &commandBundle);
 
     HardwareExecutor &wait(HardwareExecutor &other);
     HardwareExecutor &commit();
 
+    /// @brief 提交并返回本次提交的完成令牌（保留链式写法：executor << ... << executor.commit(token)）
+    HardwareExecutor &commit(HardwareCompletionToken &completionToken);
+
+    /// @brief 最近一次提交的完成令牌；尚未提交过时返回空令牌
+    [[nodiscard]] HardwareCompletionToken getCompletionToken();
+
+    /// @brief 启用异步提交：commit() 只在调用线程录制命令，提交交给设备的提交线程合并完成
+    HardwareExecutor &setAsyncSubmit(bool enable = true);
+
+    /// @brief 设置优先级类别，之后的 commit() 按该类别选择队列；默认 Normal
+    HardwareExecutor &setPriority(ExecutorPriority priority);
+
+    /// @brief 为之后提交的光栅/计算记录收集管线统计（顶点、片元、计算着色器调用次数）
+    HardwareExecutor &setPipelineStatistics(bool enable = true);
+
+    /// @brief 为之后提交的每次光栅绘制附加遮挡查询
+    HardwareExecutor &setOcclusionQueries(bool enable = true);
+
+    /// @brief 取走已在 GPU 上完成的提交的查询结果并追加到输出，不阻塞；仍在执行的提交留到下次
+    void takeQueryResults(std::vector<HardwarePipelineStatistics> &statistics, std::vector<HardwareOcclusionResult> &occlusion);
+
+    /// @brief 读取提交路径的 CPU 侧计数与延迟分布，不加锁、不阻塞提交
+    [[nodiscard]] HardwareCommitLatencyStats getCommitLatencyStats() const;
+
     // ========== 延迟释放相关接口 ==========
     /// @brief 等待所有延迟释放的资源完成（阻塞）
     void waitForDeferredResources();
@@ -549,6 +851,12 @@ struct HardwareExecutor
     std::atomic<std::uintptr_t> executorID;
 };
 
+/// @brief co_await executor.commit()：挂起直到最近一次提交在 GPU 上完成
+inline HardwareCompletionToken operator co_await(HardwareExecutor &executor)
+{
+    return executor.getCompletionToken();
+}
+
 // ================= ResourceProxy Implementation =================
 
 template <typename T>
@@ -0,0 +1,187 @@
+﻿// 资源依赖跟踪器的分配计数测试：稳态下（撤销日志、等待列表、状态节点都已复用）trackSubmission 与清理不应分配内存。
+// 不需要 Vulkan 设备：句柄只作为键使用；vkGetSemaphoreCounterValue 换成读取模拟 GPU 进度的函数，
+// 每个队列始终有若干提交未完成，清理时经 TimelineValueCache::refresh 查询“驱动”
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "HardwareWrapperVulkan/HardwareVulkan/ResourceDependencyTracker.h"
+
+namespace
+{
+std::atomic_uint64_t allocationCount{0};
+
+template <typename Handle>
+Handle fakeHandle(uint64_t value)
+{
+    if constexpr (std::is_pointer_v<Handle>)
+    {
+        return reinterpret_cast<Handle>(static_cast<uintptr_t>(value));
+    }
+    else
+    {
+        return static_cast<Handle>(value);
+    }
+}
+
+template <typename Handle>
+uint64_t fakeHandleValue(Handle handle)
+{
+    if constexpr (std::is_pointer_v<Handle>)
+    {
+        return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(handle));
+    }
+    else
+    {
+        return static_cast<uint64_t>(handle);
+    }
+}
+
+constexpr uint32_t QUEUE_COUNT = 2;
+constexpr uint64_t IN_FLIGHT_SUBMITS = 3; // 每个队列上 GPU 落后 CPU 的提交数
+
+// 模拟的 GPU 进度：第 i 个队列的 timeline semaphore 句柄为 i + 1
+uint64_t completedValues[QUEUE_COUNT] = {};
+
+VKAPI_ATTR VkResult VKAPI_CALL fakeGetSemaphoreCounterValue(VkDevice, VkSemaphore semaphore, uint64_t *value)
+{
+    const uint64_t queueIndex = fakeHandleValue(semaphore) - 1;
+    if (queueIndex >= QUEUE_COUNT)
+    {
+        return VK_ERROR_UNKNOWN;
+    }
+    *value = completedValues[queueIndex];
+    return VK_SUCCESS;
+}
+} // namespace
+
+void *operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *pointer = std::malloc(size != 0 ? size : 1))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+int main()
+{
+    constexpr uint32_t ACCESSES_PER_SUBMIT = 64;
+    constexpr uint64_t DISTINCT_RESOURCES = 4096; // 远超清理阈值，保证测量期间反复清理并复用节点
+    constexpr uint32_t WARMUP_SUBMITS = 1024;
+    constexpr uint32_t MEASURED_SUBMITS = 4096;
+
+    vkGetSemaphoreCounterValue = fakeGetSemaphoreCounterValue;
+
+    TimelineValueCache timelineValueCache;
+    ResourceDependencyTracker tracker;
+    tracker.setTimelineValueCache(timelineValueCache);
+
+    std::vector<ResourceAccessVulkan> accesses;
+    accesses.reserve(ACCESSES_PER_SUBMIT);
+    std::vector<VkSemaphoreSubmitInfo> waitSemaphores;
+    waitSemaphores.reserve(ACCESSES_PER_SUBMIT * QUEUE_COUNT * 2);
+    ResourceDependencyTracker::UndoLog undoLog;
+    uint64_t signalValues[QUEUE_COUNT] = {};
+
+    auto submit = [&](uint32_t submitIndex) {
+        const uint32_t queueIndex = submitIndex % QUEUE_COUNT;
+        const VkSemaphore semaphore = fakeHandle<VkSemaphore>(queueIndex + 1);
+        const uint64_t signalValue = ++signalValues[queueIndex];
+
+        accesses.clear();
+        for (uint32_t i = 0; i < ACCESSES_PER_SUBMIT; i++)
+        {
+            const uint64_t resource = (static_cast<uint64_t>(submitIndex) * ACCESSES_PER_SUBMIT / 2 + i) % DISTINCT_RESOURCES + 1;
+            if (i % 2 == 0)
+            {
+                accesses.push_back({fakeHandle<VkBuffer>(resource), VK_NULL_HANDLE, i % 4 == 0});
+            }
+            else
+            {
+                accesses.push_back({VK_NULL_HANDLE, fakeHandle<VkImage>(resource), i % 4 == 1});
+            }
+        }
+
+        waitSemaphores.clear();
+        undoLog.clear();
+        tracker.trackSubmission(accesses, semaphore, signalValue, waitSemaphores, undoLog);
+
+        // 每 7 次提交回滚一次，覆盖 rollback 移除新条目的路径
+        if (submitIndex % 7 == 0)
+        {
+            tracker.rollback(undoLog);
+            --signalValues[queueIndex];
+            return;
+        }
+
+        // 模拟 GPU 追赶：只有 IN_FLIGHT_SUBMITS 次之前的提交已完成，跟踪器须自行查询进度
+        if (signalValue > IN_FLIGHT_SUBMITS)
+        {
+            completedValues[queueIndex] = signalValue - IN_FLIGHT_SUBMITS;
+        }
+    };
+
+    uint32_t submitIndex = 0;
+    for (; submitIndex < WARMUP_SUBMITS; submitIndex++)
+    {
+        submit(submitIndex);
+    }
+
+    const uint64_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+    const uint64_t driverQueriesBefore = timelineValueCache.getDriverQueryCount();
+    for (; submitIndex < WARMUP_SUBMITS + MEASURED_SUBMITS; submitIndex++)
+    {
+        submit(submitIndex);
+    }
+    const uint64_t allocations = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+
+    // 未经 refresh 的测量无法说明清理路径不分配
+    if (timelineValueCache.getDriverQueryCount() == driverQueriesBefore)
+    {
+        std::printf("ResourceDependencyTracker never queried timeline values during the measurement\n");
+        return EXIT_FAILURE;
+    }
+
+    if (allocations != 0)
+    {
+        std::printf("ResourceDependencyTracker allocated %llu times in %u steady-state submissions\n",
+                    static_cast<unsigned long long>(allocations),
+                    MEASURED_SUBMITS);
+        return EXIT_FAILURE;
+    }
+
+    std::printf("ResourceDependencyTracker steady state: no allocations in %u submissions\n", MEASURED_SUBMITS);
+    return EXIT_SUCCESS;
+}
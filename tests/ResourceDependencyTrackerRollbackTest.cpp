@@ -0,0 +1,201 @@
+﻿// 资源依赖跟踪器的回滚测试：一个队列的提交失败并回滚时，不能抹掉其他队列在此期间登记的读取者/写入者。
+// 不需要 Vulkan 设备：句柄只作为键使用，资源数远低于清理阈值，不会查询 timeline 值
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "HardwareWrapperVulkan/HardwareVulkan/ResourceDependencyTracker.h"
+
+namespace
+{
+template <typename Handle>
+Handle fakeHandle(uint64_t value)
+{
+    if constexpr (std::is_pointer_v<Handle>)
+    {
+        return reinterpret_cast<Handle>(static_cast<uintptr_t>(value));
+    }
+    else
+    {
+        return static_cast<Handle>(value);
+    }
+}
+
+bool failed = false;
+
+void check(bool condition, const char *message)
+{
+    if (!condition)
+    {
+        std::printf("%s\n", message);
+        failed = true;
+    }
+}
+
+// 对 resource 登记一次提交，返回其等待的 timeline 点
+std::vector<VkSemaphoreSubmitInfo> track(ResourceDependencyTracker &tracker,
+                                         uint64_t resource,
+                                         bool write,
+                                         uint64_t semaphore,
+                                         uint64_t value,
+                                         ResourceDependencyTracker::UndoLog &undoLog)
+{
+    const std::vector<ResourceAccessVulkan> accesses = {{fakeHandle<VkBuffer>(resource), VK_NULL_HANDLE, write}};
+    std::vector<VkSemaphoreSubmitInfo> waitSemaphores;
+    undoLog.clear();
+    tracker.trackSubmission(accesses, fakeHandle<VkSemaphore>(semaphore), value, waitSemaphores, undoLog);
+    return waitSemaphores;
+}
+
+// 等待列表中 semaphore 对应的值，不存在时为 0
+uint64_t waitedValue(const std::vector<VkSemaphoreSubmitInfo> &waitSemaphores, uint64_t semaphore)
+{
+    uint64_t value = 0;
+    for (const auto &waitInfo : waitSemaphores)
+    {
+        if (waitInfo.semaphore == fakeHandle<VkSemaphore>(semaphore))
+        {
+            value = waitInfo.value > value ? waitInfo.value : value;
+        }
+    }
+    return value;
+}
+
+// 固定交错顺序：A 登记后、回滚前，B 访问同一资源
+void testInterleavedRollback()
+{
+    constexpr uint64_t QUEUE_A = 1;
+    constexpr uint64_t QUEUE_B = 2;
+    constexpr uint64_t QUEUE_C = 3;
+    ResourceDependencyTracker::UndoLog undoA;
+    ResourceDependencyTracker::UndoLog undoB;
+
+    // A 新建的条目上 B 也登记了读取：回滚 A 不能移除整个条目
+    {
+        ResourceDependencyTracker tracker;
+        track(tracker, 1, false, QUEUE_A, 5, undoA);
+        track(tracker, 1, false, QUEUE_B, 7, undoB);
+        tracker.rollback(undoA);
+        const auto waits = track(tracker, 1, true, QUEUE_C, 1, undoB);
+        check(waitedValue(waits, QUEUE_B) == 7, "rollback of a new entry dropped another queue's reader");
+        check(waitedValue(waits, QUEUE_A) == 0, "rollback of a new entry left its own reader behind");
+    }
+
+    // A 写入后 B 读取：回滚 A 只撤销写入者，B 的读取保留
+    {
+        ResourceDependencyTracker tracker;
+        track(tracker, 1, false, QUEUE_C, 2, undoB);
+        track(tracker, 1, true, QUEUE_A, 5, undoA);
+        track(tracker, 1, false, QUEUE_B, 7, undoB);
+        tracker.rollback(undoA);
+        const auto waits = track(tracker, 1, true, QUEUE_C, 3, undoB);
+        check(waitedValue(waits, QUEUE_B) == 7, "rollback of a write dropped a later reader");
+        check(waitedValue(waits, QUEUE_A) == 0, "rollback of a write left the rolled back writer");
+    }
+
+    // A 写入后 B 写入：B 已经取代 A，回滚 A 保持 B 为写入者
+    {
+        ResourceDependencyTracker tracker;
+        track(tracker, 1, true, QUEUE_A, 5, undoA);
+        track(tracker, 1, true, QUEUE_B, 7, undoB);
+        tracker.rollback(undoA);
+        const auto waits = track(tracker, 1, false, QUEUE_C, 1, undoB);
+        check(waitedValue(waits, QUEUE_B) == 7, "rollback of a write replaced a later writer");
+    }
+
+    // A 读取后 B 读取，A 的旧读取值在回滚后恢复
+    {
+        ResourceDependencyTracker tracker;
+        track(tracker, 1, false, QUEUE_A, 4, undoA);
+        track(tracker, 1, false, QUEUE_A, 5, undoA);
+        track(tracker, 1, false, QUEUE_B, 7, undoB);
+        tracker.rollback(undoA);
+        const auto waits = track(tracker, 1, true, QUEUE_C, 1, undoB);
+        check(waitedValue(waits, QUEUE_A) == 4, "rollback of a read did not restore the previous value");
+        check(waitedValue(waits, QUEUE_B) == 7, "rollback of a read dropped another queue's reader");
+    }
+}
+
+// 多个线程各自代表一个队列并发登记；其中一个线程的每次提交（写入和读取交替）都回滚
+void testConcurrentRollback()
+{
+    constexpr uint64_t COMMITTED_QUEUES = 3;
+    constexpr uint64_t ROLLBACK_QUEUE = COMMITTED_QUEUES + 1;
+    constexpr uint64_t FINAL_QUEUE = ROLLBACK_QUEUE + 1;
+    constexpr uint64_t RESOURCE_COUNT = 8;
+    constexpr uint64_t SUBMITS_PER_QUEUE = 20000;
+
+    ResourceDependencyTracker tracker;
+    std::atomic_bool start{false};
+    std::vector<std::thread> threads;
+
+    for (uint64_t queue = 1; queue <= ROLLBACK_QUEUE; queue++)
+    {
+        threads.emplace_back([&tracker, &start, queue]() {
+            while (!start.load(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+
+            const bool rollback = queue == ROLLBACK_QUEUE;
+            std::vector<ResourceAccessVulkan> accesses;
+            std::vector<VkSemaphoreSubmitInfo> waitSemaphores;
+            ResourceDependencyTracker::UndoLog undoLog;
+            for (uint64_t value = 1; value <= SUBMITS_PER_QUEUE; value++)
+            {
+                accesses.clear();
+                for (uint64_t resource = 1; resource <= RESOURCE_COUNT; resource++)
+                {
+                    accesses.push_back({fakeHandle<VkBuffer>(resource), VK_NULL_HANDLE, rollback && (value + resource) % 2 == 0});
+                }
+                waitSemaphores.clear();
+                undoLog.clear();
+                // 回滚的提交不会 signal，之后的提交复用同一个值
+                const uint64_t signalValue = rollback ? 1 : value;
+                tracker.trackSubmission(accesses, fakeHandle<VkSemaphore>(queue), signalValue, waitSemaphores, undoLog);
+                if (rollback)
+                {
+                    tracker.rollback(undoLog);
+                }
+            }
+        });
+    }
+
+    start.store(true, std::memory_order_release);
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    // 每个资源都应等待各个已提交队列的最后一次读取，且不再引用回滚的队列
+    ResourceDependencyTracker::UndoLog undoLog;
+    for (uint64_t resource = 1; resource <= RESOURCE_COUNT; resource++)
+    {
+        const auto waits = track(tracker, resource, true, FINAL_QUEUE, 1, undoLog);
+        for (uint64_t queue = 1; queue <= COMMITTED_QUEUES; queue++)
+        {
+            check(waitedValue(waits, queue) == SUBMITS_PER_QUEUE, "concurrent rollback lost a committed reader");
+        }
+        check(waitedValue(waits, ROLLBACK_QUEUE) == 0, "concurrent rollback left a rolled back access behind");
+    }
+}
+} // namespace
+
+int main()
+{
+    testInterleavedRollback();
+    testConcurrentRollback();
+
+    if (failed)
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::printf("ResourceDependencyTracker rollback keeps concurrent registrations\n");
+    return EXIT_SUCCESS;
+}